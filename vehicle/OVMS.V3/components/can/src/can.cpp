@@ -199,7 +199,7 @@ void can_tx(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const
     {
     frame.data.u8[k] = strtol(argv[k+1],NULL,16);
     }
-  sbus->Write(&frame);
+  sbus->Write(&frame, 0, CAN_TXPRIO_HIGH);
   }
 
 void can_rx(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
@@ -267,6 +267,33 @@ void can_status(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, c
     writer->printf("Wdg Timer: %20d sec(s)\n",monotonictime-sbus->m_watchdog_timer);
     }
   writer->printf("Err flags: 0x%08x\n",sbus->m_status.error_flags);
+
+  // TX scheduler:
+  OvmsMutexLock lock(&sbus->m_txsched_mutex);
+  CAN_txstats_t* ts = &sbus->m_txstats;
+  writer->printf("Tx queue:  %10d/%d/%d H/N/L\n",
+    uxQueueMessagesWaiting(sbus->m_txqueue[CAN_TXPRIO_HIGH]),
+    uxQueueMessagesWaiting(sbus->m_txqueue[CAN_TXPRIO_NORMAL]),
+    uxQueueMessagesWaiting(sbus->m_txqueue[CAN_TXPRIO_LOW]));
+  writer->printf("Tx queued: %10d/%d/%d H/N/L\n",
+    ts->queued[CAN_TXPRIO_HIGH], ts->queued[CAN_TXPRIO_NORMAL], ts->queued[CAN_TXPRIO_LOW]);
+  writer->printf("Tx q max:  %20d\n",ts->depth_max);
+  writer->printf("Tx latency:%14d/%d us avg/max\n",
+    ts->latency_cnt ? (int)(ts->latency_sum / ts->latency_cnt) : 0, ts->latency_max);
+  writer->printf("Tx ratelim:%20d\n",ts->ratelimited);
+  for (auto it = sbus->m_ratelimit.begin(); it != sbus->m_ratelimit.end(); ++it)
+    {
+    writer->printf("  limit %03x: %d ms, %d dropped\n",
+      it->first, it->second.interval_us / 1000, it->second.dropped);
+    }
+  for (auto it = sbus->m_periodic.begin(); it != sbus->m_periodic.end(); ++it)
+    {
+    CAN_periodic_t* p = it->second;
+    uint32_t cnt = p->sent + p->fails;
+    writer->printf("Periodic #%d: id %03x every %d ms: %d sent, %d failed, jitter %d/%d us avg/max\n",
+      p->id, p->frame.MsgID, p->period_us / 1000, p->sent, p->fails,
+      cnt ? (int)(p->jitter_sum / cnt) : 0, p->jitter_max);
+    }
   }
 
 void can_list(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
@@ -285,6 +312,9 @@ void can_list(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, con
         (sbus->GetDBC())?sbus->GetDBC()->GetName().c_str():"none");
       }
     }
+  writer->printf("Frame pool: %d/%d slots used, max %d, exhausted %lu\n",
+    MyCan.m_framepool.GetUsed(), CAN_FRAMEPOOL_SIZE, MyCan.m_framepool.m_maxused,
+    (unsigned long)MyCan.m_framepool.m_exhausted);
   }
 
 void can_clearstatus(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
@@ -696,6 +726,71 @@ void can::RemovePlayers()
     }
   }
 
+////////////////////////////////////////////////////////////////////////
+// CAN frame pool
+////////////////////////////////////////////////////////////////////////
+
+canframepool::canframepool()
+  {
+  for (int k=0; k<CAN_FRAMEPOOL_SIZE; k++)
+    m_slots[k].refs = 0;
+  m_used = 0;
+  m_next = 0;
+  m_maxused = 0;
+  m_exhausted = 0;
+  }
+
+/**
+ * Alloc: get a free slot with a reference count of 1
+ *  - returns NULL if the pool is exhausted
+ *  - the last CAN_FRAMEPOOL_RESERVE slots are only available for reserved (TX callback) use
+ *  - the frame content is undefined
+ */
+IRAM_ATTR CAN_frame_t* canframepool::Alloc(bool reserved /*=false*/)
+  {
+  int limit = reserved ? CAN_FRAMEPOOL_SIZE : CAN_FRAMEPOOL_SIZE - CAN_FRAMEPOOL_RESERVE;
+  int used = ++m_used;
+  if (used > limit)
+    {
+    --m_used;
+    ++m_exhausted;
+    return NULL;
+    }
+  if (used > m_maxused)
+    m_maxused = used;
+
+  // A free slot exists now, claim the first one found:
+  uint32_t k = m_next;
+  while (true)
+    {
+    if (++k >= CAN_FRAMEPOOL_SIZE) k = 0;
+    int expected = 0;
+    if (m_slots[k].refs.compare_exchange_strong(expected, 1))
+      {
+      m_next = k;
+      return &m_slots[k].frame;
+      }
+    }
+  }
+
+IRAM_ATTR CAN_frame_t* canframepool::Copy(const CAN_frame_t* frame, bool reserved /*=false*/)
+  {
+  CAN_frame_t* pframe = Alloc(reserved);
+  if (pframe) *pframe = *frame;
+  return pframe;
+  }
+
+IRAM_ATTR void canframepool::AddRef(CAN_frame_t* frame)
+  {
+  ++((slot_t*)frame)->refs;
+  }
+
+IRAM_ATTR void canframepool::Release(CAN_frame_t* frame)
+  {
+  if (--((slot_t*)frame)->refs == 0)
+    --m_used;
+  }
+
 ////////////////////////////////////////////////////////////////////////
 // CAN controller task
 ////////////////////////////////////////////////////////////////////////
@@ -712,7 +807,8 @@ static void CAN_rxtask(void *pvParameters)
       switch(msg.type)
         {
         case CAN_frame:
-          me->IncomingFrame(&msg.body.frame);
+          me->IncomingFrame(msg.body.frame);
+          me->m_framepool.Release(msg.body.frame);
           break;
         case CAN_asyncinterrupthandler:
           {
@@ -720,18 +816,25 @@ static void CAN_rxtask(void *pvParameters)
           // Loop until all interrupts are handled
           do {
             bool receivedFrame;
-            loop = msg.body.bus->AsynchronousInterruptHandler(&msg.body.frame, &receivedFrame);
+            CAN_frame_t local;
+            CAN_frame_t* frame = me->m_framepool.Alloc();
+            if (frame == NULL) frame = &local; // pool exhausted, listeners will miss the frame
+            loop = msg.body.bus->AsynchronousInterruptHandler(frame, &receivedFrame);
             if (receivedFrame)
-              me->IncomingFrame(&msg.body.frame);
+              me->IncomingFrame(frame);
+            if (frame != &local)
+              me->m_framepool.Release(frame);
             } while (loop);
           break;
           }
         case CAN_txcallback:
-          msg.body.bus->TxCallback(&msg.body.frame, true);
+          msg.body.frame->origin->TxCallback(msg.body.frame, true);
+          me->m_framepool.Release(msg.body.frame);
           break;
         case CAN_txfailedcallback:
-          msg.body.bus->TxCallback(&msg.body.frame, false);
-          msg.body.bus->LogStatus(CAN_LogStatus_Error);
+          msg.body.frame->origin->TxCallback(msg.body.frame, false);
+          msg.body.frame->origin->LogStatus(CAN_LogStatus_Error);
+          me->m_framepool.Release(msg.body.frame);
           break;
         case CAN_logerror:
           msg.body.bus->LogStatus(CAN_LogStatus_Error);
@@ -825,6 +928,13 @@ void can::IncomingFrame(CAN_frame_t* p_frame)
 void can::RegisterListener(QueueHandle_t queue, bool txfeedback)
   {
   m_listeners[queue] = txfeedback;
+
+  // Check the listener queues are covered by the frame pool:
+  int depth = 0;
+  for (CanListenerMap_t::iterator it = m_listeners.begin(); it != m_listeners.end(); ++it)
+    depth += uxQueueMessagesWaiting(it->first) + uxQueueSpacesAvailable(it->first);
+  if (depth > CAN_FRAMEPOOL_LISTENERS)
+    ESP_LOGW(TAG, "RegisterListener: listener queues (%d) exceed frame pool size, frames may be lost", depth);
   }
 
 void can::DeregisterListener(QueueHandle_t queue)
@@ -832,15 +942,48 @@ void can::DeregisterListener(QueueHandle_t queue)
   auto it = m_listeners.find(queue);
   if (it != m_listeners.end())
     m_listeners.erase(it);
+  FlushListenerQueue(queue);
+  }
+
+/**
+ * FlushListenerQueue: release all frame handles still queued
+ *  - to be called after stopping the listener task, before deleting the queue
+ */
+void can::FlushListenerQueue(QueueHandle_t queue)
+  {
+  CAN_frame_t* frame;
+  while (xQueueReceive(queue, &frame, 0) == pdTRUE)
+    m_framepool.Release(frame);
   }
 
 void can::NotifyListeners(const CAN_frame_t* frame, bool tx)
   {
+  if (m_listeners.empty()) return;
+
+  // Listeners share one pool slot, frames not yet pooled are copied once:
+  CAN_frame_t* pframe;
+  if (m_framepool.IsPooled(frame))
+    {
+    pframe = (CAN_frame_t*) frame;
+    m_framepool.AddRef(pframe);
+    }
+  else
+    {
+    pframe = m_framepool.Copy(frame);
+    if (pframe == NULL) return; // pool exhausted
+    }
+
   for (CanListenerMap_t::iterator it = m_listeners.begin(); it != m_listeners.end(); ++it)
     {
     if (!tx || (tx && it->second))
-      xQueueSend(it->first,frame,0);
+      {
+      m_framepool.AddRef(pframe);
+      if (xQueueSend(it->first,&pframe,0) != pdTRUE)
+        m_framepool.Release(pframe);
+      }
     }
+
+  m_framepool.Release(pframe);
   }
 
 void can::RegisterCallback(const char* caller, CanFrameCallback callback, bool txfeedback)
@@ -884,7 +1027,9 @@ canbus::canbus(const char* name)
   : pcp(name)
   {
   m_busnumber = name[strlen(name)-1] - '1';
-  m_txqueue = xQueueCreate(CONFIG_OVMS_HW_CAN_TX_QUEUE_SIZE, sizeof(CAN_frame_t));
+  for (int k=0; k<CAN_TXPRIO_COUNT; k++)
+    m_txqueue[k] = xQueueCreate(CONFIG_OVMS_HW_CAN_TX_QUEUE_SIZE, sizeof(CAN_txqueue_entry_t));
+  m_periodic_id = 0;
   m_mode = CAN_MODE_OFF;
   m_speed = CAN_SPEED_1000KBPS;
   m_dbcfile = NULL;
@@ -898,7 +1043,9 @@ canbus::canbus(const char* name)
 
 canbus::~canbus()
   {
-  vQueueDelete(m_txqueue);
+  RemovePeriodics();
+  for (int k=0; k<CAN_TXPRIO_COUNT; k++)
+    vQueueDelete(m_txqueue[k]);
   }
 
 esp_err_t canbus::Start(CAN_mode_t mode, CAN_speed_t speed)
@@ -934,6 +1081,7 @@ esp_err_t canbus::WriteReg( uint8_t reg, uint8_t value )
 void canbus::ClearStatus()
   {
   memset(&m_status, 0, sizeof(m_status));
+  memset(&m_txstats, 0, sizeof(m_txstats));
   m_status_chksum = 0;
   m_watchdog_timer = monotonictime;
   }
@@ -1023,9 +1171,10 @@ void canbus::TxCallback(CAN_frame_t* p_frame, bool success)
  *    - returns ESP_OK, ESP_QUEUED or ESP_FAIL
  *      … ESP_OK = frame delivered to CAN transceiver (not necessarily sent!)
  *      … ESP_FAIL = TX queue is full (TX overflow)
+ *    - txprio: priority class (CAN_txprio_t) used if the frame needs to be queued
  *    - actual TX implementation in driver override
  */
-esp_err_t canbus::Write(const CAN_frame_t* p_frame, TickType_t maxqueuewait /*=0*/)
+esp_err_t canbus::Write(const CAN_frame_t* p_frame, TickType_t maxqueuewait /*=0*/, int txprio /*=CAN_TXPRIO_NORMAL*/)
   {
   m_tx_frame = *p_frame; // save a local copy of this frame to be used later in txcallback
   m_tx_frame.origin = this;
@@ -1036,11 +1185,22 @@ esp_err_t canbus::Write(const CAN_frame_t* p_frame, TickType_t maxqueuewait /*=0
  * canbus::QueueWrite -- add a frame to the TX queue for later delivery
  *    - internal method, called by driver if no TX buffer is available
  */
-esp_err_t canbus::QueueWrite(const CAN_frame_t* p_frame, TickType_t maxqueuewait /*=0*/)
+esp_err_t canbus::QueueWrite(const CAN_frame_t* p_frame, TickType_t maxqueuewait /*=0*/, int txprio /*=CAN_TXPRIO_NORMAL*/)
   {
-  if (xQueueSend(m_txqueue, p_frame, maxqueuewait) == pdTRUE)
+  CAN_txqueue_entry_t entry;
+  entry.frame = *p_frame;
+  entry.queued = esp_timer_get_time();
+  int prio = txprio & CAN_TXPRIO_MASK;
+  if (prio >= CAN_TXPRIO_COUNT) prio = CAN_TXPRIO_NORMAL;
+
+  if (xQueueSend(m_txqueue[prio], &entry, maxqueuewait) == pdTRUE)
     {
     m_status.txbuf_delay++;
+    m_txstats.queued[prio]++;
+    uint16_t depth = 0;
+    for (int k=0; k<CAN_TXPRIO_COUNT; k++)
+      depth += uxQueueMessagesWaiting(m_txqueue[k]);
+    if (depth > m_txstats.depth_max) m_txstats.depth_max = depth;
     LogFrame(CAN_LogFrame_TX_Queue, p_frame);
     return ESP_QUEUED;
     }
@@ -1052,6 +1212,205 @@ esp_err_t canbus::QueueWrite(const CAN_frame_t* p_frame, TickType_t maxqueuewait
     }
   }
 
+/**
+ * canbus::TxQueueReceive -- fetch next frame from the TX queue
+ *    - called by driver when a TX buffer has become available
+ *    - delivers frames by priority class, FIFO within each class
+ *    - p_txprio receives the txprio to pass to Write() for the frame
+ */
+bool canbus::TxQueueReceive(CAN_frame_t* p_frame, int* p_txprio)
+  {
+  static const CAN_txprio_t order[CAN_TXPRIO_COUNT] = { CAN_TXPRIO_HIGH, CAN_TXPRIO_NORMAL, CAN_TXPRIO_LOW };
+  CAN_txqueue_entry_t entry;
+
+  for (int k=0; k<CAN_TXPRIO_COUNT; k++)
+    {
+    if (xQueueReceive(m_txqueue[order[k]], &entry, 0) == pdTRUE)
+      {
+      *p_frame = entry.frame;
+      *p_txprio = order[k] | CAN_TXPRIO_ADMITTED;
+      uint32_t latency = (uint32_t)esp_timer_get_time() - entry.queued;
+      m_txstats.latency_cnt++;
+      m_txstats.latency_sum += latency;
+      if (latency > m_txstats.latency_max) m_txstats.latency_max = latency;
+      return true;
+      }
+    }
+  return false;
+  }
+
+/**
+ * canbus::TxAdmit -- apply TX rate limits
+ *    - called by driver on new frame submissions
+ *    - returns false if the frame shall be dropped
+ */
+bool canbus::TxAdmit(const CAN_frame_t* p_frame, int txprio)
+  {
+  if (m_ratelimit.empty() || (txprio & CAN_TXPRIO_ADMITTED))
+    return true;
+
+  OvmsMutexLock lock(&m_txsched_mutex);
+  auto it = m_ratelimit.find(p_frame->MsgID);
+  if (it == m_ratelimit.end())
+    return true;
+
+  int64_t now = esp_timer_get_time();
+  if (it->second.last != 0 && now - it->second.last < it->second.interval_us)
+    {
+    it->second.dropped++;
+    m_txstats.ratelimited++;
+    return false;
+    }
+  it->second.last = now;
+  return true;
+  }
+
+/**
+ * canbus::SetTxRateLimit -- limit TX rate for a message ID
+ *    - frames sent faster than interval_ms are dropped
+ *    - interval_ms 0 removes the limit
+ */
+void canbus::SetTxRateLimit(uint32_t msgid, uint32_t interval_ms)
+  {
+  OvmsMutexLock lock(&m_txsched_mutex);
+  if (interval_ms == 0)
+    {
+    m_ratelimit.erase(msgid);
+    }
+  else
+    {
+    CAN_ratelimit_t& rl = m_ratelimit[msgid];
+    rl.interval_us = interval_ms * 1000;
+    rl.last = 0;
+    rl.dropped = 0;
+    }
+  }
+
+// The timer argument encodes bus number & registration ID, not the
+// registration itself: a callback already dispatched may run after
+// RemovePeriodic() has freed the registration.
+#define CAN_PERIODIC_ARG(bus,id)  ((void*)(intptr_t)((id) * CAN_MAXBUSES + (bus)))
+
+static void CAN_periodic_timer(void* arg)
+  {
+  intptr_t key = (intptr_t)arg;
+  canbus* bus = MyCan.GetBus(key % CAN_MAXBUSES);
+  if (bus) bus->PeriodicTransmit(key / CAN_MAXBUSES);
+  }
+
+/**
+ * canbus::AddPeriodic -- register a cyclic message
+ *    - the frame is sent every period_ms milliseconds, driven by a high
+ *      resolution timer independent of the FreeRTOS tick
+ *    - returns the registration ID or -1 on error
+ */
+int canbus::AddPeriodic(const CAN_frame_t* p_frame, uint32_t period_ms)
+  {
+  if (period_ms == 0) return -1;
+
+  CAN_periodic_t* p = new CAN_periodic_t;
+  memset(p, 0, sizeof(*p));
+  p->bus = this;
+  p->frame = *p_frame;
+  p->frame.origin = this;
+  p->period_us = period_ms * 1000;
+
+  OvmsMutexLock lock(&m_txsched_mutex);
+  p->id = ++m_periodic_id;
+
+  esp_timer_create_args_t args = {};
+  args.callback = CAN_periodic_timer;
+  args.arg = CAN_PERIODIC_ARG(m_busnumber, p->id);
+  args.dispatch_method = ESP_TIMER_TASK;
+  args.name = "CAN periodic";
+  if (esp_timer_create(&args, &p->timer) != ESP_OK)
+    {
+    delete p;
+    return -1;
+    }
+
+  m_periodic[p->id] = p;
+  p->due = esp_timer_get_time() + p->period_us;
+  esp_timer_start_periodic(p->timer, p->period_us);
+  return p->id;
+  }
+
+/**
+ * canbus::UpdatePeriodic -- update the payload of a cyclic message
+ */
+bool canbus::UpdatePeriodic(int id, const uint8_t* data, uint8_t length)
+  {
+  if (length > 8) return false;
+  OvmsMutexLock lock(&m_txsched_mutex);
+  auto it = m_periodic.find(id);
+  if (it == m_periodic.end()) return false;
+  it->second->frame.FIR.B.DLC = length;
+  memcpy(it->second->frame.data.u8, data, length);
+  return true;
+  }
+
+bool canbus::RemovePeriodic(int id)
+  {
+  OvmsMutexLock lock(&m_txsched_mutex);
+  auto it = m_periodic.find(id);
+  if (it == m_periodic.end()) return false;
+  esp_timer_stop(it->second->timer);
+  esp_timer_delete(it->second->timer);
+  delete it->second;
+  m_periodic.erase(it);
+  return true;
+  }
+
+void canbus::RemovePeriodics()
+  {
+  OvmsMutexLock lock(&m_txsched_mutex);
+  for (auto it = m_periodic.begin(); it != m_periodic.end(); ++it)
+    {
+    esp_timer_stop(it->second->timer);
+    esp_timer_delete(it->second->timer);
+    delete it->second;
+    }
+  m_periodic.clear();
+  }
+
+void canbus::PeriodicTransmit(int id)
+  {
+  CAN_frame_t frame;
+  bool active = (m_mode == CAN_MODE_ACTIVE && GetPowerMode() == On);
+
+  // Registration may have been removed while the timer callback was pending:
+  m_txsched_mutex.Lock();
+  auto it = m_periodic.find(id);
+  if (it == m_periodic.end())
+    {
+    m_txsched_mutex.Unlock();
+    return;
+    }
+  CAN_periodic_t* p = it->second;
+  int64_t now = esp_timer_get_time();
+  uint32_t jitter = (now > p->due) ? now - p->due : p->due - now;
+  p->due += p->period_us;
+  if (p->due < now) p->due = now + p->period_us; // resync after stall
+  if (active)
+    {
+    p->jitter_sum += jitter;
+    if (jitter > p->jitter_max) p->jitter_max = jitter;
+    }
+  frame = p->frame;
+  m_txsched_mutex.Unlock();
+
+  if (!active) return;
+  esp_err_t res = Write(&frame);
+
+  OvmsMutexLock lock(&m_txsched_mutex);
+  it = m_periodic.find(id);
+  if (it == m_periodic.end()) return;
+  if (res == ESP_FAIL)
+    it->second->fails++;
+  else
+    it->second->sent++;
+  }
+
 /**
  * canbus::WriteExtended -- application TX utility
  */
@@ -1102,9 +1461,9 @@ esp_err_t canbus::WriteStandard(uint16_t id, uint8_t length, uint8_t *data, Tick
  *      … ESP_OK = frame delivered to CAN transceiver (not necessarily sent!)
  *      … ESP_FAIL = TX queue is full (TX overflow)
  */
-esp_err_t CAN_frame_t::Write(canbus* bus /*=NULL*/, TickType_t maxqueuewait /*=0*/)
+esp_err_t CAN_frame_t::Write(canbus* bus /*=NULL*/, TickType_t maxqueuewait /*=0*/, int txprio /*=CAN_TXPRIO_NORMAL*/)
   {
   if (!bus)
     bus = origin;
-  return bus ? bus->Write(this, maxqueuewait) : ESP_FAIL;
+  return bus ? bus->Write(this, maxqueuewait, txprio & CAN_TXPRIO_MASK) : ESP_FAIL;
   }
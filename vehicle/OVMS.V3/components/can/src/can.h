@@ -42,9 +42,13 @@
 #include <stdint.h>
 #include <functional>
 #include <list>
+#include <map>
+#include <atomic>
+#include "esp_timer.h"
 #include "pcp.h"
 #include <esp_err.h>
 #include "ovms_events.h"
+#include "ovms_mutex.h"
 
 ////////////////////////////////////////////////////////////////////////
 // Constant ESP_QUEUED to indicate a 'queued' response
@@ -101,6 +105,20 @@ typedef enum
   CAN_RTR=1                  // RTR frame
   } CAN_RTR_t;
 
+// CAN TX priority classes
+// Frames are sent in the order of their submission as long as the
+// controller has free TX buffers. Frames that need to be queued are
+// delivered by priority class, FIFO within each class.
+typedef enum
+  {
+  CAN_TXPRIO_NORMAL=0,       // Default: application frames
+  CAN_TXPRIO_HIGH=1,         // Poll requests, user commands
+  CAN_TXPRIO_LOW=2           // Bulk / background traffic
+  } CAN_txprio_t;
+#define CAN_TXPRIO_COUNT 3
+#define CAN_TXPRIO_MASK       0x0f    // priority class bits of a txprio argument
+#define CAN_TXPRIO_ADMITTED   0x10    // internal: frame from the TX queue, rate limit already applied
+
 // CAN Frame Information Record
 typedef union
   {
@@ -135,7 +153,7 @@ struct CAN_frame_t
     uint64_t  u64;                      // Payload u64 access (Att: little endian!)
     } data;
 
-  esp_err_t Write(canbus* bus=NULL, TickType_t maxqueuewait=0);  // bus: NULL=origin
+  esp_err_t Write(canbus* bus=NULL, TickType_t maxqueuewait=0, int txprio=CAN_TXPRIO_NORMAL);  // bus: NULL=origin
   };
 
 // CAN status
@@ -154,6 +172,42 @@ typedef struct
   uint16_t error_resets;            // Error resolving reset counter
   } CAN_status_t;
 
+// CAN TX scheduler statistics
+typedef struct
+  {
+  uint32_t queued[CAN_TXPRIO_COUNT];  // frames routed through TX queue per priority class
+  uint16_t depth_max;               // max total TX queue depth
+  uint32_t latency_cnt;             // frames delivered from TX queue
+  uint64_t latency_sum;             // sum of TX queue latencies [us]
+  uint32_t latency_max;             // max TX queue latency [us]
+  uint32_t ratelimited;             // frames dropped by rate limiting
+  } CAN_txstats_t;
+
+// CAN periodic TX message
+typedef struct
+  {
+  canbus*   bus;
+  int       id;                     // registration ID
+  CAN_frame_t frame;                // frame to send (payload may be updated)
+  uint32_t  period_us;              // period [us]
+  esp_timer_handle_t timer;
+  int64_t   due;                    // next due time [us]
+  uint32_t  sent;                   // frames sent
+  uint32_t  fails;                  // frames failed to send
+  uint64_t  jitter_sum;             // sum of schedule deviations [us]
+  uint32_t  jitter_max;             // max schedule deviation [us]
+  } CAN_periodic_t;
+typedef std::map<int, CAN_periodic_t*> CAN_periodic_map_t;
+
+// CAN TX rate limit
+typedef struct
+  {
+  uint32_t  interval_us;            // min interval between frames [us]
+  int64_t   last;                   // last frame admitted [us]
+  uint32_t  dropped;                // frames dropped
+  } CAN_ratelimit_t;
+typedef std::map<uint32_t, CAN_ratelimit_t> CAN_ratelimit_map_t;
+
 ////////////////////////////////////////////////////////////////////////
 // CAN messages queue
 // This queue is between the CAN bus controller MyCAN and tasks that
@@ -170,17 +224,73 @@ typedef enum
   CAN_logerror
 } CAN_queue_type_t;
 
+// CAN TX queue entry
+typedef struct
+  {
+  CAN_frame_t frame;
+  uint32_t queued;          // queue time [us]
+  } CAN_txqueue_entry_t;
+
 // CAN message
 typedef struct
   {
   CAN_queue_type_t type;
   union
     {
-    CAN_frame_t frame;  // CAN_frame
-    canbus* bus;        
+    CAN_frame_t* frame; // CAN_frame, CAN_txcallback, CAN_txfailedcallback: frame pool slot
+    canbus* bus;        // CAN_asyncinterrupthandler, CAN_logerror
     } body;
   } CAN_queue_msg_t;
 
+////////////////////////////////////////////////////////////////////////
+// CAN frame pool
+// Frames passed from the drivers through the CAN task to the listeners
+// are stored once in a pool slot in internal RAM. Queues carry slot
+// pointers (CAN_frame_t*) as handles. Slots are reference counted, every
+// queue entry holds a reference and the last Release() frees the slot.
+// Alloc(), Copy(), AddRef() and Release() are lock free and IRAM resident,
+// they may be called from IRAM ISRs.
+// The pool covers the CAN task queue and all listener queues being full,
+// so a stalled listener only loses frames on its own queue.
+////////////////////////////////////////////////////////////////////////
+
+#define CAN_LISTENER_QUEUE_SIZE 20                  // Queue size for component listeners
+#define CAN_FRAMEPOOL_LISTENERS (CONFIG_OVMS_VEHICLE_CAN_RX_QUEUE_SIZE + 3*CAN_LISTENER_QUEUE_SIZE)
+#define CAN_FRAMEPOOL_RESERVE   (2*CAN_MAXBUSES)    // Slots reserved for TX callbacks
+#define CAN_FRAMEPOOL_SIZE      (CONFIG_OVMS_HW_CAN_RX_QUEUE_SIZE + CAN_FRAMEPOOL_LISTENERS \
+                                 + 16 + CAN_FRAMEPOOL_RESERVE)
+
+class canframepool
+  {
+  public:
+    canframepool();
+
+  public:
+    CAN_frame_t* Alloc(bool reserved=false);
+    CAN_frame_t* Copy(const CAN_frame_t* frame, bool reserved=false);
+    void AddRef(CAN_frame_t* frame);
+    void Release(CAN_frame_t* frame);
+    bool IsPooled(const CAN_frame_t* frame)
+      {
+      return (frame >= &m_slots[0].frame && frame <= &m_slots[CAN_FRAMEPOOL_SIZE-1].frame);
+      }
+    int GetUsed() { return m_used; }
+
+  protected:
+    typedef struct
+      {
+      CAN_frame_t frame;          // needs to be first: the slot address is the handle
+      std::atomic_int refs;
+      } slot_t;
+    slot_t m_slots[CAN_FRAMEPOOL_SIZE];
+    std::atomic_int m_used;
+    uint32_t m_next;              // next slot to try on Alloc()
+
+  public:
+    int m_maxused;                // high water mark
+    std::atomic_ulong m_exhausted; // Alloc() failures
+  };
+
 ////////////////////////////////////////////////////////////////////////
 // CAN Filtering (software based filter)
 // The canfilter object encapsulates the filtering of CAN frames
@@ -287,14 +397,24 @@ class canbus : public pcp, public InternalRamAllocated
     dbcfile* GetDBC();
 
   public:
-    virtual esp_err_t Write(const CAN_frame_t* p_frame, TickType_t maxqueuewait=0);
+    virtual esp_err_t Write(const CAN_frame_t* p_frame, TickType_t maxqueuewait=0, int txprio=CAN_TXPRIO_NORMAL);
     virtual esp_err_t WriteExtended(uint32_t id, uint8_t length, uint8_t *data, TickType_t maxqueuewait=0);
     virtual esp_err_t WriteStandard(uint16_t id, uint8_t length, uint8_t *data, TickType_t maxqueuewait=0);
     virtual bool AsynchronousInterruptHandler(CAN_frame_t* frame, bool* frameReceived);
     virtual void TxCallback(CAN_frame_t* frame, bool success);
 
+  public:
+    int AddPeriodic(const CAN_frame_t* p_frame, uint32_t period_ms);
+    bool UpdatePeriodic(int id, const uint8_t* data, uint8_t length);
+    bool RemovePeriodic(int id);
+    void RemovePeriodics();
+    void SetTxRateLimit(uint32_t msgid, uint32_t interval_ms);
+    void PeriodicTransmit(int id);
+
   protected:
-    virtual esp_err_t QueueWrite(const CAN_frame_t* p_frame, TickType_t maxqueuewait=0);
+    virtual esp_err_t QueueWrite(const CAN_frame_t* p_frame, TickType_t maxqueuewait=0, int txprio=CAN_TXPRIO_NORMAL);
+    bool TxQueueReceive(CAN_frame_t* p_frame, int* p_txprio);
+    bool TxAdmit(const CAN_frame_t* p_frame, int txprio);
     void BusTicker10(std::string event, void* data);
 
   public:
@@ -310,7 +430,12 @@ class canbus : public pcp, public InternalRamAllocated
     CAN_frame_t m_tx_frame;       // saved copy of last TX frame to be used in txcallback
     uint32_t m_status_chksum;
     uint32_t m_watchdog_timer;
-    QueueHandle_t m_txqueue;
+    QueueHandle_t m_txqueue[CAN_TXPRIO_COUNT];
+    CAN_txstats_t m_txstats;
+    CAN_periodic_map_t m_periodic;
+    CAN_ratelimit_map_t m_ratelimit;
+    OvmsMutex m_txsched_mutex;
+    int m_periodic_id;
     int m_busnumber;
 
   protected:
@@ -321,6 +446,8 @@ class canbus : public pcp, public InternalRamAllocated
 // can - the CAN system controller
 ////////////////////////////////////////////////////////////////////////
 
+// Listener queues receive frame pool handles (CAN_frame_t*), the receiver
+// needs to call MyCan.m_framepool.Release() after processing the frame:
 typedef std::map<QueueHandle_t, bool> CanListenerMap_t;
 
 
@@ -350,10 +477,12 @@ class can : public InternalRamAllocated
 
   public:
     QueueHandle_t m_rxqueue;
+    canframepool m_framepool;
 
   public:
     void RegisterListener(QueueHandle_t queue, bool txfeedback=false);
     void DeregisterListener(QueueHandle_t queue);
+    void FlushListenerQueue(QueueHandle_t queue);
     void NotifyListeners(const CAN_frame_t* frame, bool tx);
 
   public:
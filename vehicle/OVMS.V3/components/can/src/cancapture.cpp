@@ -0,0 +1,516 @@
+/*
+;    Project:       Open Vehicle Monitor System
+;    Module:        CAN pre-trigger capture ring
+;    Date:          19th October 2026
+;
+;    (C) 2026       Open Vehicles Project
+;
+; Permission is hereby granted, free of charge, to any person obtaining a copy
+; of this software and associated documentation files (the "Software"), to deal
+; in the Software without restriction, including without limitation the rights
+; to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+; copies of the Software, and to permit persons to whom the Software is
+; furnished to do so, subject to the following conditions:
+;
+; The above copyright notice and this permission notice shall be included in
+; all copies or substantial portions of the Software.
+;
+; THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+; IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+; FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+; AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+; LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+; OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+; THE SOFTWARE.
+*/
+
+#include "ovms_log.h"
+static const char *TAG = "cancapture";
+
+#include <string.h>
+#include <sys/time.h>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include "cancapture.h"
+#include "canformat.h"
+#include "ovms.h"
+#include "ovms_config.h"
+#include "ovms_events.h"
+#include "ovms_malloc.h"
+#include "ovms_metrics.h"
+#include "ovms_peripherals.h"
+#include "ovms_utils.h"
+
+#define CANCAPTURE_BATCH          32
+
+cancapture MyCanCapture __attribute__ ((init_priority (4517)));
+
+////////////////////////////////////////////////////////////////////////
+// Shell commands
+////////////////////////////////////////////////////////////////////////
+
+void can_capture_status(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  MyCanCapture.Status(writer);
+  }
+
+void can_capture_trigger(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  if (MyCanCapture.Trigger((argc > 0) ? argv[0] : "manual"))
+    writer->puts("CAN capture triggered");
+  else
+    writer->puts("Error: CAN capture disabled or in holdoff");
+  }
+
+////////////////////////////////////////////////////////////////////////
+// cancapture
+////////////////////////////////////////////////////////////////////////
+
+cancapture::cancapture()
+  {
+  ESP_LOGI(TAG, "Initialising CAN capture (4517)");
+
+  m_ring = NULL;
+  m_size = 0;
+  m_wrcount = 0;
+  m_ringkb = 0;
+  m_enabled = false;
+  m_pre_us = 0;
+  m_post_us = 0;
+  m_holdoff_us = 0;
+  m_metric_value = 0;
+  m_metric_state = false;
+  m_dumptask = NULL;
+  m_trigger_time = 0;
+  m_dump_end = 0;
+  m_last_trigger = 0;
+  m_triggers = 0;
+  m_triggers_ignored = 0;
+  m_dumps = 0;
+  m_dump_frames = 0;
+  m_dump_lost = 0;
+  m_dump_pre = 0;
+  m_dump_post = 0;
+
+  OvmsCommand* cmd_can = MyCommandApp.FindCommand("can");
+  if (cmd_can)
+    {
+    OvmsCommand* cmd_capture = cmd_can->RegisterCommand("capture", "CAN capture ring framework");
+    cmd_capture->RegisterCommand("status", "Show capture ring & trigger status", can_capture_status);
+    cmd_capture->RegisterCommand("trigger", "Trigger capture dump", can_capture_trigger, "[<reason>]", 0, 1);
+    }
+
+  MyCan.RegisterCallback(TAG, [this](const CAN_frame_t* frame, bool success)
+    {
+    Capture(frame, false);
+    });
+  MyCan.RegisterCallback(TAG, [this](const CAN_frame_t* frame, bool success)
+    {
+    if (success) Capture(frame, true);
+    }, true);
+
+  using std::placeholders::_1;
+  using std::placeholders::_2;
+  MyEvents.RegisterEvent(TAG, "*", std::bind(&cancapture::EventListener, this, _1, _2));
+  }
+
+cancapture::~cancapture()
+  {
+  MyCan.DeregisterCallback(TAG);
+  MyEvents.DeregisterEvent(TAG);
+  if (m_ring)
+    free(m_ring);
+  }
+
+void cancapture::EventListener(std::string event, void* data)
+  {
+  if (event == "ticker.1")
+    {
+    if (m_ring && !m_metric.empty() && CheckMetric())
+      Trigger(m_metric.c_str());
+    return;
+    }
+  else if (event == "config.mounted")
+    {
+    Configure();
+    }
+  else if (event == "config.changed")
+    {
+    OvmsConfigParam* param = (OvmsConfigParam*) data;
+    if (param && param->GetName() == "can")
+      Configure();
+    }
+
+  if (m_ring && m_events.find(event) != m_events.end())
+    Trigger(event.c_str());
+  }
+
+void cancapture::Configure()
+  {
+  bool enabled = MyConfig.GetParamValueBool("can", "capture.enable", false);
+  uint32_t ringkb = MyConfig.GetParamValueInt("can", "capture.size", 128);
+
+  OvmsMutexLock lock(&m_mutex);
+
+  m_format = MyConfig.GetParamValue("can", "capture.format", "crtd");
+  m_path = MyConfig.GetParamValue("can", "capture.path", "/sd/capture");
+  m_pre_us = std::max(MyConfig.GetParamValueInt("can", "capture.pre", 10), 0) * 1000000LL;
+  m_post_us = std::max(MyConfig.GetParamValueInt("can", "capture.post", 5), 0) * 1000000LL;
+  m_holdoff_us = std::max(MyConfig.GetParamValueInt("can", "capture.holdoff", 60), 0) * 1000000LL;
+
+  m_events.clear();
+  std::istringstream events(MyConfig.GetParamValue("can", "capture.events"));
+  std::string event;
+  while (std::getline(events, event, ','))
+    {
+    size_t start = event.find_first_not_of(" \t\r\n"), end = event.find_last_not_of(" \t\r\n");
+    if (start != std::string::npos)
+      m_events.insert(event.substr(start, end-start+1));
+    }
+
+  // Metric condition: <metric> <op> <value>
+  std::string condition = MyConfig.GetParamValue("can", "capture.metric");
+  std::istringstream cond(condition);
+  std::string metric, op;
+  float value;
+  if (condition.empty())
+    {
+    m_metric.clear();
+    }
+  else if ((cond >> metric >> op >> value) &&
+      (op == "<" || op == "<=" || op == ">" || op == ">=" || op == "=" || op == "==" || op == "!="))
+    {
+    if (metric != m_metric || op != m_metric_op || value != m_metric_value)
+      m_metric_state = false;
+    m_metric = metric;
+    m_metric_op = op;
+    m_metric_value = value;
+    }
+  else
+    {
+    ESP_LOGE(TAG, "Invalid metric condition '%s', expected '<metric> <op> <value>'", condition.c_str());
+    m_metric.clear();
+    }
+
+  if (enabled == m_enabled && ringkb == m_ringkb)
+    return;
+  if (m_dumptask)
+    {
+    ESP_LOGW(TAG, "Dump running, ring reconfiguration deferred");
+    return;
+    }
+
+  if (m_ring)
+    {
+    free(m_ring);
+    m_ring = NULL;
+    m_size = 0;
+    }
+  m_enabled = enabled;
+  m_ringkb = ringkb;
+  m_wrcount = 0;
+  if (!m_enabled || ringkb == 0)
+    return;
+
+  uint32_t size = 1;
+  while (size * 2 * sizeof(cancapture_entry_t) <= ringkb * 1024)
+    size *= 2;
+  m_ring = (cancapture_entry_t*)ExternalRamMalloc(size * sizeof(cancapture_entry_t));
+  if (m_ring == NULL)
+    {
+    ESP_LOGE(TAG, "Out of memory for %u KB capture ring", ringkb);
+    return;
+    }
+  m_size = size;
+  ESP_LOGI(TAG, "Capture ring enabled: %u frames", m_size);
+  }
+
+bool cancapture::CheckMetric()
+  {
+  OvmsMetric* metric = MyMetrics.Find(m_metric.c_str());
+  if (metric == NULL || !metric->IsDefined())
+    return false;
+
+  float value = metric->AsFloat();
+  bool state;
+  if (m_metric_op == "<")        state = (value < m_metric_value);
+  else if (m_metric_op == "<=")  state = (value <= m_metric_value);
+  else if (m_metric_op == ">")   state = (value > m_metric_value);
+  else if (m_metric_op == ">=")  state = (value >= m_metric_value);
+  else if (m_metric_op == "!=")  state = (value != m_metric_value);
+  else                           state = (value == m_metric_value);
+
+  bool fire = (state && !m_metric_state);
+  m_metric_state = state;
+  return fire;
+  }
+
+/**
+ * Capture: copy frame into the ring
+ *  (called by the CAN RX task)
+ */
+void cancapture::Capture(const CAN_frame_t* frame, bool tx)
+  {
+  if (m_ring == NULL || frame->origin == NULL) return;
+
+  OvmsMutexLock lock(&m_mutex);
+  if (m_ring == NULL) return;
+  cancapture_entry_t* e = &m_ring[m_wrcount & (m_size-1)];
+  e->time = esp_timer_get_time();
+  e->msgid = frame->MsgID;
+  e->bus = frame->origin->m_busnumber;
+  e->flags = ((frame->FIR.B.FF == CAN_frame_ext) ? CANCAPTURE_FL_EXT : 0)
+    | ((frame->FIR.B.RTR == CAN_RTR) ? CANCAPTURE_FL_RTR : 0)
+    | (tx ? CANCAPTURE_FL_TX : 0);
+  e->dlc = frame->FIR.B.DLC;
+  memcpy(e->data, frame->data.u8, 8);
+  m_wrcount++;
+  }
+
+/**
+ * Trigger: start a dump, or extend the post trigger window of a running dump
+ */
+bool cancapture::Trigger(const char* reason)
+  {
+  OvmsMutexLock lock(&m_mutex);
+  if (m_ring == NULL)
+    return false;
+
+  int64_t now = esp_timer_get_time();
+  m_triggers++;
+  m_trigger_counts[reason]++;
+
+  if (m_dumptask)
+    {
+    ESP_LOGI(TAG, "Trigger '%s': extending running dump", reason);
+    m_dump_end = now + m_post_us;
+    return true;
+    }
+  if (m_last_trigger && now - m_last_trigger < m_holdoff_us)
+    {
+    ESP_LOGD(TAG, "Trigger '%s' ignored: holdoff", reason);
+    m_triggers_ignored++;
+    return false;
+    }
+
+  ESP_LOGI(TAG, "Trigger '%s': dumping capture ring", reason);
+  m_last_trigger = now;
+  m_trigger_time = now;
+  m_dump_end = now + m_post_us;
+  m_reason = reason;
+  xTaskCreatePinnedToCore(DumpTask, "OVMS CanCapture", 4096, (void*)this, 5, &m_dumptask, CORE(1));
+  return true;
+  }
+
+void cancapture::DumpTask(void* context)
+  {
+  cancapture* me = (cancapture*) context;
+  me->Dump();
+  me->m_mutex.Lock();
+  me->m_dumptask = NULL;
+  me->m_mutex.Unlock();
+  // apply ring reconfiguration deferred during the dump:
+  me->Configure();
+  vTaskDelete(NULL);
+  }
+
+/**
+ * ReadEntries: copy entries from cursor on
+ *  Entries overwritten before being read are skipped & counted as lost.
+ */
+size_t cancapture::ReadEntries(uint32_t& cursor, cancapture_entry_t* buf, size_t max, int64_t& end)
+  {
+  OvmsMutexLock lock(&m_mutex);
+  end = m_dump_end;
+  if (m_wrcount - cursor > m_size)
+    {
+    m_dump_lost += m_wrcount - cursor - m_size;
+    cursor = m_wrcount - m_size;
+    }
+  size_t cnt = 0;
+  while (cnt < max && cursor != m_wrcount)
+    buf[cnt++] = m_ring[cursor++ & (m_size-1)];
+  return cnt;
+  }
+
+void cancapture::Dump()
+  {
+  m_mutex.Lock();
+  std::string format = m_format;
+  std::string path = m_path;
+  std::string reason = m_reason;
+  int64_t trigger_time = m_trigger_time;
+  int64_t start_time = trigger_time - m_pre_us;
+  uint32_t cursor = (m_wrcount > m_size) ? m_wrcount - m_size : 0;
+  m_dump_frames = 0;
+  m_dump_lost = 0;
+  m_dump_reason = reason;
+  m_mutex.Unlock();
+
+  // Create dump file:
+  canformat* formatter = MyCanFormatFactory.NewFormat(format.c_str());
+  if (formatter == NULL)
+    {
+    ESP_LOGE(TAG, "Unknown format '%s'", format.c_str());
+    return;
+    }
+
+#ifdef CONFIG_OVMS_COMP_SDCARD
+  if (startsWith(path, "/sd") && (!MyPeripherals || !MyPeripherals->m_sdcard || !MyPeripherals->m_sdcard->isavailable()))
+    {
+    ESP_LOGE(TAG, "Cannot dump to '%s' as SD filesystem not available", path.c_str());
+    delete formatter;
+    return;
+    }
+#endif // #ifdef CONFIG_OVMS_COMP_SDCARD
+
+  struct timeval tv0;
+  gettimeofday(&tv0, NULL);
+  int64_t time0 = esp_timer_get_time();
+
+  char timestr[20];
+  time_t now = tv0.tv_sec;
+  strftime(timestr, sizeof(timestr), "%Y%m%d-%H%M%S", localtime(&now));
+  std::string filename = path + "/" + timestr + "-";
+  for (const char* c = reason.c_str(); *c; c++)
+    filename.push_back((isalnum(*c) || *c == '.' || *c == '-') ? *c : '_');
+  filename.append(".");
+  filename.append(format);
+
+  mkpath(path);
+  FILE* file = fopen(filename.c_str(), "w");
+  if (file == NULL)
+    {
+    ESP_LOGE(TAG, "Can't write to '%s'", filename.c_str());
+    delete formatter;
+    return;
+    }
+  ESP_LOGI(TAG, "Dumping to '%s'", filename.c_str());
+
+  std::string out = formatter->getheader(&tv0);
+  if (out.length() > 0)
+    fwrite(out.c_str(), out.length(), 1, file);
+
+  // Output ring entries from start_time on until end of post trigger window:
+  cancapture_entry_t buf[CANCAPTURE_BATCH];
+  CAN_log_message_t msg;
+  bool marked = false, done = false;
+  int64_t first = 0, last = 0, end;
+  uint32_t frames = 0;
+  while (!done)
+    {
+    size_t cnt = ReadEntries(cursor, buf, CANCAPTURE_BATCH, end);
+    if (cnt == 0)
+      {
+      if (esp_timer_get_time() > end)
+        break;
+      vTaskDelay(pdMS_TO_TICKS(100));
+      continue;
+      }
+    for (size_t i = 0; i < cnt; i++)
+      {
+      cancapture_entry_t* e = &buf[i];
+      if (e->time < start_time)
+        continue;
+      if (e->time > end)
+        {
+        done = true;
+        break;
+        }
+
+      int64_t offset = tv0.tv_usec + (e->time - time0);
+      memset(&msg, 0, sizeof(msg));
+      msg.timestamp.tv_sec = tv0.tv_sec + offset / 1000000;
+      msg.timestamp.tv_usec = offset % 1000000;
+      if (msg.timestamp.tv_usec < 0)
+        {
+        msg.timestamp.tv_sec--;
+        msg.timestamp.tv_usec += 1000000;
+        }
+
+      if (!marked && e->time >= trigger_time)
+        {
+        // Mark trigger position:
+        std::string text = "capture trigger: " + reason;
+        msg.type = CAN_LogInfo_Event;
+        msg.text = (char*) text.c_str();
+        out = formatter->get(&msg);
+        if (out.length() > 0)
+          fwrite(out.c_str(), out.length(), 1, file);
+        memset(&msg.frame, 0, sizeof(msg.frame));
+        marked = true;
+        }
+
+      msg.type = (e->flags & CANCAPTURE_FL_TX) ? CAN_LogFrame_TX : CAN_LogFrame_RX;
+      msg.frame.origin = MyCan.GetBus(e->bus);
+      msg.frame.FIR.B.FF = (e->flags & CANCAPTURE_FL_EXT) ? CAN_frame_ext : CAN_frame_std;
+      msg.frame.FIR.B.RTR = (e->flags & CANCAPTURE_FL_RTR) ? CAN_RTR : CAN_no_RTR;
+      msg.frame.FIR.B.DLC = e->dlc;
+      msg.frame.MsgID = e->msgid;
+      memcpy(msg.frame.data.u8, e->data, 8);
+      out = formatter->get(&msg);
+      if (out.length() > 0)
+        fwrite(out.c_str(), out.length(), 1, file);
+
+      if (frames++ == 0) first = e->time;
+      last = e->time;
+      }
+    }
+
+  fclose(file);
+  delete formatter;
+
+  OvmsMutexLock lock(&m_mutex);
+  m_dumps++;
+  m_dump_file = filename;
+  m_dump_frames = frames;
+  m_dump_pre = (frames && first < trigger_time) ? (float)(trigger_time - first) / 1000000 : 0;
+  m_dump_post = (frames && last > trigger_time) ? (float)(last - trigger_time) / 1000000 : 0;
+  ESP_LOGI(TAG, "Dump '%s' done: %u frames, %.1f s pre, %.1f s post, %u lost",
+    filename.c_str(), m_dump_frames, m_dump_pre, m_dump_post, m_dump_lost);
+  }
+
+void cancapture::Status(OvmsWriter* writer)
+  {
+  OvmsMutexLock lock(&m_mutex);
+
+  if (m_ring == NULL)
+    {
+    writer->puts("CAN capture disabled (config can capture.enable)");
+    return;
+    }
+
+  uint32_t fill = (m_wrcount < m_size) ? m_wrcount : m_size;
+  float span = 0;
+  if (fill > 1)
+    {
+    const cancapture_entry_t* newest = &m_ring[(m_wrcount-1) & (m_size-1)];
+    const cancapture_entry_t* oldest = &m_ring[(m_wrcount-fill) & (m_size-1)];
+    span = (float)(newest->time - oldest->time) / 1000000;
+    }
+  writer->printf("Capture ring: %u KB, %u/%u frames = %.1f seconds, %u frames captured\n",
+    m_ringkb, fill, m_size, span, m_wrcount);
+  writer->printf("Dump: %s, pre %d s, post %d s, holdoff %d s, format %s, path %s\n",
+    m_dumptask ? "RUNNING" : "idle", (int)(m_pre_us / 1000000), (int)(m_post_us / 1000000),
+    (int)(m_holdoff_us / 1000000), m_format.c_str(), m_path.c_str());
+
+  writer->printf("Trigger events: ");
+  if (m_events.empty())
+    writer->printf("-");
+  for (auto& event : m_events)
+    writer->printf("%s ", event.c_str());
+  if (m_metric.empty())
+    writer->printf("\nTrigger metric: -\n");
+  else
+    writer->printf("\nTrigger metric: %s %s %g (currently %s)\n",
+      m_metric.c_str(), m_metric_op.c_str(), m_metric_value, m_metric_state ? "true" : "false");
+
+  writer->printf("Triggers: %u (%u ignored in holdoff)\n", m_triggers, m_triggers_ignored);
+  for (auto& it : m_trigger_counts)
+    writer->printf("  %-30s %u\n", it.first.c_str(), it.second);
+  writer->printf("Dumps: %u\n", m_dumps);
+  if (m_dumps)
+    writer->printf("  Last: %s (%s)\n  %u frames, %.1f s pre, %.1f s post trigger, %u lost\n",
+      m_dump_file.c_str(), m_dump_reason.c_str(), m_dump_frames, m_dump_pre, m_dump_post, m_dump_lost);
+  }
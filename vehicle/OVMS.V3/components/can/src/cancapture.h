@@ -0,0 +1,133 @@
+/*
+;    Project:       Open Vehicle Monitor System
+;    Module:        CAN pre-trigger capture ring
+;    Date:          19th October 2026
+;
+;    (C) 2026       Open Vehicles Project
+;
+; Permission is hereby granted, free of charge, to any person obtaining a copy
+; of this software and associated documentation files (the "Software"), to deal
+; in the Software without restriction, including without limitation the rights
+; to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+; copies of the Software, and to permit persons to whom the Software is
+; furnished to do so, subject to the following conditions:
+;
+; The above copyright notice and this permission notice shall be included in
+; all copies or substantial portions of the Software.
+;
+; THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+; IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+; FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+; AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+; LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+; OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+; THE SOFTWARE.
+*/
+
+#ifndef __CANCAPTURE_H__
+#define __CANCAPTURE_H__
+
+#include <string>
+#include <set>
+#include <map>
+#include "can.h"
+#include "ovms_mutex.h"
+#include "ovms_command.h"
+
+/**
+ * cancapture: always-on capture ring with triggered dump
+ *
+ * All frames received and sent are copied into a fixed size RAM ring
+ * (config "can capture.size" KB, allocated in SPIRAM). When a trigger
+ * fires, the frames of the last "capture.pre" seconds are written to a new
+ * file below "capture.path" in "capture.format", followed by the frames of
+ * the next "capture.post" seconds. Triggers during a running dump extend
+ * the post trigger window.
+ *
+ * Triggers: OVMS events listed in "capture.events" (comma separated),
+ * a metric condition in "capture.metric" (e.g. "v.b.12v.voltage < 11.5",
+ * fires on the transition to true, checked once per second), or the
+ * command "can capture trigger".
+ *
+ * The CAN RX task only copies the frame into the ring, all formatting and
+ * file output is done by a dump task.
+ */
+
+#define CANCAPTURE_FL_EXT         0x01
+#define CANCAPTURE_FL_RTR         0x02
+#define CANCAPTURE_FL_TX          0x04
+
+typedef struct
+  {
+  int64_t time;             // esp_timer time [us]
+  uint32_t msgid;
+  uint8_t bus;              // bus number
+  uint8_t flags;
+  uint8_t dlc;
+  uint8_t reserved;
+  uint8_t data[8];
+  } cancapture_entry_t;
+
+class cancapture : public InternalRamAllocated
+  {
+  public:
+    cancapture();
+    ~cancapture();
+
+  public:
+    void Capture(const CAN_frame_t* frame, bool tx);
+    bool Trigger(const char* reason);
+    void Status(OvmsWriter* writer);
+
+  protected:
+    static void DumpTask(void* context);
+    void Dump();
+    size_t ReadEntries(uint32_t& cursor, cancapture_entry_t* buf, size_t max, int64_t& end);
+    void Configure();
+    bool CheckMetric();
+    void EventListener(std::string event, void* data);
+
+  protected:
+    OvmsMutex m_mutex;
+    cancapture_entry_t* m_ring;
+    uint32_t m_size;              // ring entries (power of 2)
+    uint32_t m_wrcount;           // entries written (ring position = wrcount & (size-1))
+    uint32_t m_ringkb;
+
+    // Configuration:
+    bool m_enabled;
+    std::string m_format;
+    std::string m_path;
+    int64_t m_pre_us;
+    int64_t m_post_us;
+    int64_t m_holdoff_us;
+    std::set<std::string> m_events;
+    std::string m_metric;         // metric condition: name, operator, value
+    std::string m_metric_op;
+    float m_metric_value;
+    bool m_metric_state;
+
+    // Dump state:
+    TaskHandle_t m_dumptask;
+    std::string m_reason;
+    int64_t m_trigger_time;
+    int64_t m_dump_end;           // end of post trigger window [us]
+    int64_t m_last_trigger;
+
+  public:
+    // Statistics:
+    uint32_t m_triggers;
+    std::map<std::string, uint32_t> m_trigger_counts;
+    uint32_t m_triggers_ignored;  // during holdoff
+    uint32_t m_dumps;
+    uint32_t m_dump_frames;       // frames written in last dump
+    uint32_t m_dump_lost;         // frames overwritten before written in last dump
+    float m_dump_pre;             // pre trigger seconds covered by last dump
+    float m_dump_post;            // post trigger seconds covered by last dump
+    std::string m_dump_file;      // last dump file
+    std::string m_dump_reason;
+  };
+
+extern cancapture MyCanCapture;
+
+#endif // __CANCAPTURE_H__
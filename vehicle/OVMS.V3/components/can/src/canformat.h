@@ -41,6 +41,77 @@ using namespace std;
 
 typedef void (*canformat_put_write_fn)(uint8_t *buffer, size_t len, void* data);
 
+// Lookup tables for text encoders:
+extern const char canformat_hex_lc[513];    // "000102...feff"
+extern const char canformat_hex_uc[513];    // "000102...FEFF"
+extern const char canformat_dec[201];       // "000102...9899"
+
+/**
+ * canformat_puthex: write value in hex with at least <digits> digits (like "%0<digits>x")
+ *  Returns new end pointer, no string terminator is written.
+ */
+inline char* canformat_puthex(char* p, uint32_t value, int digits, const char* table = canformat_hex_lc)
+  {
+  int n = 1;
+  while (n < 8 && (value >> (4*n))) n++;
+  if (n < digits) n = digits;
+  if (n & 1)
+    {
+    n--;
+    *p++ = table[2*((value >> (4*n)) & 0x0f) + 1];
+    }
+  while (n > 0)
+    {
+    n -= 2;
+    const char* s = table + 2*((value >> (4*n)) & 0xff);
+    *p++ = s[0];
+    *p++ = s[1];
+    }
+  return p;
+  }
+
+/**
+ * canformat_putdec: write value in decimal with at least <digits> digits (like "%0<digits>lu")
+ *  Returns new end pointer, no string terminator is written.
+ */
+inline char* canformat_putdec(char* p, unsigned long value, int digits = 1)
+  {
+  char tmp[20];
+  char* t = tmp + sizeof(tmp);
+  while (value >= 100)
+    {
+    unsigned long q = value / 100;
+    t -= 2;
+    memcpy(t, canformat_dec + 2*(value - q*100), 2);
+    value = q;
+    }
+  if (value >= 10)
+    {
+    t -= 2;
+    memcpy(t, canformat_dec + 2*value, 2);
+    }
+  else
+    {
+    *--t = '0' + value;
+    }
+  int n = tmp + sizeof(tmp) - t;
+  for (; n < digits; digits--)
+    *p++ = '0';
+  memcpy(p, t, n);
+  return p + n;
+  }
+
+/**
+ * canformat_putdec: signed variant (like "%0<digits>ld")
+ */
+inline char* canformat_putdec(char* p, long value, int digits = 1)
+  {
+  if (value >= 0)
+    return canformat_putdec(p, (unsigned long)value, digits);
+  *p++ = '-';
+  return canformat_putdec(p, 0UL - (unsigned long)value, digits - 1);
+  }
+
 class canformat
   {
   public:
@@ -56,6 +127,9 @@ class canformat
   public: // Conversion from OVMS CAN log messages to specific format
     virtual std::string get(CAN_log_message_t* message);
     virtual std::string getheader(struct timeval *time = NULL);
+    // Append variant: appends the record to buffer & returns the length appended.
+    // Loggers keep the buffer to avoid allocations per record.
+    virtual size_t get(CAN_log_message_t* message, std::string& buffer);
 
   public: // Conversion from specific format to OVMS CAN log messages
     virtual size_t put(CAN_log_message_t* message, uint8_t *buffer, size_t len, void* userdata=NULL);
@@ -0,0 +1,435 @@
+/*
+;    Project:       Open Vehicle Monitor System
+;    Module:        CAN log format benchmark & fuzz test
+;    Date:          19th October 2026
+;
+;    (C) 2026       Open Vehicles Project
+;
+; Permission is hereby granted, free of charge, to any person obtaining a copy
+; of this software and associated documentation files (the "Software"), to deal
+; in the Software without restriction, including without limitation the rights
+; to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+; copies of the Software, and to permit persons to whom the Software is
+; furnished to do so, subject to the following conditions:
+;
+; The above copyright notice and this permission notice shall be included in
+; all copies or substantial portions of the Software.
+;
+; THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+; IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+; FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+; AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+; LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+; OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+; THE SOFTWARE.
+*/
+
+#include "ovms_log.h"
+static const char *TAG = "canformat-bench";
+
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+#include "esp_timer.h"
+#include "ovms.h"
+#include "ovms_command.h"
+#include "canformat.h"
+
+/**
+ * CAN log format benchmark & fuzz test
+ *
+ *  can format benchmark [<format>] [<frames>]
+ *    Encodes random frames with get() and the append variant of get(),
+ *    decodes the result with put() (fed in chunks like from a socket) and
+ *    verifies the frames come back unchanged. Reports messages per second
+ *    for all directions.
+ *
+ *  can format fuzz [<format>] [<rounds>] [<seed>]
+ *    Feeds random bytes, random text and mutated valid records into put()
+ *    in random chunk sizes. Checks the consumed length, the frame length of
+ *    parsed frames and a guard area behind the message for overruns.
+ *    Round n uses seed <seed>+n, so a failing round can be reproduced by
+ *    running a single round with that seed.
+ *
+ * Formats not given in the traits table are verified for ID & data only.
+ */
+
+#define CANFORMAT_BENCH_CHUNK       256     // Decoder input chunk size
+#define CANFORMAT_BENCH_FRAMES      1000    // Default benchmark frames
+#define CANFORMAT_FUZZ_ROUNDS       200     // Default fuzz rounds
+#define CANFORMAT_FUZZ_GUARD        32      // Guard bytes behind fuzz message
+
+#define CANFORMAT_TRAIT_BUS         0x01    // Format preserves the bus
+#define CANFORMAT_TRAIT_TX          0x02    // Format preserves the direction
+#define CANFORMAT_TRAIT_NOPUT       0x04    // put() does not parse get() output
+
+static const struct
+  {
+  const char* name;
+  uint8_t traits;
+  } canformat_traits[] =
+  {
+  { "cbin",     CANFORMAT_TRAIT_BUS|CANFORMAT_TRAIT_TX },
+  { "crtd",     CANFORMAT_TRAIT_BUS|CANFORMAT_TRAIT_TX },
+  { "gvret-a",  CANFORMAT_TRAIT_BUS },
+  { "gvret-b",  CANFORMAT_TRAIT_NOPUT },   // put() handles GVRET commands
+  { "lawricel", 0 },
+  { "pcap",     0 },
+  { "raw",      CANFORMAT_TRAIT_BUS|CANFORMAT_TRAIT_TX },
+  };
+
+typedef std::vector<CAN_log_message_t, ExtRamAllocator<CAN_log_message_t>> canformat_msglist_t;
+
+typedef struct
+  {
+  CAN_log_message_t msg;
+  uint8_t guard[CANFORMAT_FUZZ_GUARD];
+  } canformat_fuzz_msg_t;
+
+static uint8_t canformat_get_traits(const char* name)
+  {
+  for (size_t i = 0; i < sizeof(canformat_traits)/sizeof(canformat_traits[0]); i++)
+    {
+    if (strcmp(canformat_traits[i].name, name) == 0)
+      return canformat_traits[i].traits;
+    }
+  return 0;
+  }
+
+static inline uint32_t canformat_random(uint32_t& state)
+  {
+  // xorshift32:
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+  }
+
+static int canformat_get_buses(canbus** buses)
+  {
+  int cnt = 0;
+  for (int k = 0; k < CAN_MAXBUSES; k++)
+    {
+    canbus* bus = MyCan.GetBus(k);
+    if (bus) buses[cnt++] = bus;
+    }
+  return cnt;
+  }
+
+static void canformat_random_frame(CAN_log_message_t* msg, uint32_t& rnd, uint8_t traits,
+  canbus** buses, int nbuses, uint32_t n)
+  {
+  memset(msg, 0, sizeof(*msg));
+  uint32_t r = canformat_random(rnd);
+  msg->type = ((traits & CANFORMAT_TRAIT_TX) && (r & 1)) ? CAN_LogFrame_TX : CAN_LogFrame_RX;
+  msg->origin = (traits & CANFORMAT_TRAIT_BUS) ? buses[(r >> 1) % nbuses] : buses[0];
+  msg->timestamp.tv_sec = 1700000000 + n / 100;
+  msg->timestamp.tv_usec = canformat_random(rnd) % 1000000;
+  r = canformat_random(rnd);
+  if (r & 1)
+    {
+    msg->frame.FIR.B.FF = CAN_frame_ext;
+    msg->frame.MsgID = (r >> 1) & 0x1fffffff;
+    }
+  else
+    {
+    msg->frame.FIR.B.FF = CAN_frame_std;
+    msg->frame.MsgID = (r >> 1) & 0x7ff;
+    }
+  msg->frame.FIR.B.DLC = canformat_random(rnd) % 9;
+  for (int k = 0; k < msg->frame.FIR.B.DLC; k++)
+    msg->frame.data.u8[k] = canformat_random(rnd);
+  }
+
+static bool canformat_equal(const CAN_log_message_t* a, const CAN_log_message_t* b, uint8_t traits)
+  {
+  if (b->type != CAN_LogFrame_RX && b->type != CAN_LogFrame_TX)
+    return false;
+  if ((traits & CANFORMAT_TRAIT_TX) && a->type != b->type)
+    return false;
+  if ((traits & CANFORMAT_TRAIT_BUS) && a->origin != b->origin)
+    return false;
+  return (a->frame.FIR.B.FF == b->frame.FIR.B.FF &&
+          a->frame.MsgID == b->frame.MsgID &&
+          a->frame.FIR.B.DLC == b->frame.FIR.B.DLC &&
+          memcmp(a->frame.data.u8, b->frame.data.u8, a->frame.FIR.B.DLC) == 0);
+  }
+
+/**
+ * canformat_decode: feed a buffer through put() in chunks, collect messages
+ *  The formatters parse one record per call from their buffer, so after
+ *  the input has been consumed continue until the buffer cannot hold any
+ *  more records.
+ */
+static void canformat_decode(canformat* formatter, const uint8_t* data, size_t len,
+  size_t maxchunk, uint32_t& rnd, std::function<bool(CAN_log_message_t*, size_t, size_t)> callback)
+  {
+  size_t pos = 0, idle = 0;
+  canformat_fuzz_msg_t m;
+  while (idle <= CANFORMAT_SERVE_BUFFERSIZE)
+    {
+    size_t chunk = std::min(len - pos, (maxchunk > 1) ? 1 + canformat_random(rnd) % maxchunk : CANFORMAT_BENCH_CHUNK);
+    memset(&m, 0, sizeof(m));
+    size_t used = formatter->put(&m.msg, (uint8_t*)data + pos, chunk);
+    if (!callback(&m.msg, used, chunk))
+      return;
+    for (int k = 0; k < CANFORMAT_FUZZ_GUARD; k++)
+      {
+      if (m.guard[k] != 0)
+        {
+        callback(NULL, 0, 0);
+        return;
+        }
+      }
+    pos += std::min(used, chunk);
+    if (m.msg.origin == NULL && pos == len)
+      idle++;
+    else
+      idle = 0;
+    }
+  }
+
+static void canformat_benchmark_format(OvmsWriter* writer, const char* name, int frames,
+  canbus** buses, int nbuses)
+  {
+  uint8_t traits = canformat_get_traits(name);
+  uint32_t rnd = 0x12345678;
+  canformat_msglist_t msgs(frames);
+  for (int n = 0; n < frames; n++)
+    canformat_random_frame(&msgs[n], rnd, traits, buses, nbuses, n);
+
+  // Encode:
+  canformat* formatter = MyCanFormatFactory.NewFormat(name);
+  if (!formatter) return;
+  extram::string stream;
+  stream.reserve(frames * 40);
+  int64_t t0 = esp_timer_get_time();
+  std::string rec = formatter->getheader(&msgs[0].timestamp);
+  stream.append(rec.data(), rec.size());
+  for (int n = 0; n < frames; n++)
+    {
+    rec = formatter->get(&msgs[n]);
+    stream.append(rec.data(), rec.size());
+    }
+  uint32_t get_us = std::max((int64_t)1, esp_timer_get_time() - t0);
+  delete formatter;
+
+  // Encode using the append variant, like the loggers do:
+  formatter = MyCanFormatFactory.NewFormat(name);
+  extram::string stream2;
+  stream2.reserve(stream.size());
+  std::string outbuf;
+  t0 = esp_timer_get_time();
+  rec = formatter->getheader(&msgs[0].timestamp);
+  stream2.append(rec.data(), rec.size());
+  for (int n = 0; n < frames; n++)
+    {
+    outbuf.clear();
+    formatter->get(&msgs[n], outbuf);
+    stream2.append(outbuf.data(), outbuf.size());
+    }
+  uint32_t app_us = std::max((int64_t)1, esp_timer_get_time() - t0);
+  delete formatter;
+
+  writer->printf("%-9s get: %7u msg/s  append: %7u msg/s%s %5.1f bytes/msg", name,
+    (uint32_t)((int64_t)frames * 1000000 / get_us), (uint32_t)((int64_t)frames * 1000000 / app_us),
+    (stream2 == stream) ? "" : " (output differs!)", (float)stream.size() / frames);
+  if (traits & CANFORMAT_TRAIT_NOPUT)
+    {
+    writer->puts("  put: -");
+    return;
+    }
+
+  // Decode & verify:
+  formatter = MyCanFormatFactory.NewFormat(name);
+  formatter->SetServeMode(canformat::Simulate);
+  int count = 0, errors = 0, first = -1;
+  t0 = esp_timer_get_time();
+  canformat_decode(formatter, (const uint8_t*)stream.data(), stream.size(), 0, rnd,
+    [&](CAN_log_message_t* msg, size_t used, size_t len) -> bool
+      {
+      if (msg && msg->origin)
+        {
+        if (count >= frames || !canformat_equal(&msgs[count], msg, traits))
+          {
+          if (first < 0) first = count;
+          errors++;
+          }
+        count++;
+        }
+      return (count < frames);
+      });
+  uint32_t put_us = std::max((int64_t)1, esp_timer_get_time() - t0);
+  delete formatter;
+
+  if (count < frames)
+    errors += frames - count;
+  writer->printf("  put: %7u msg/s  round trip: ", (uint32_t)((int64_t)count * 1000000 / put_us));
+  if (errors == 0)
+    writer->puts("OK");
+  else
+    writer->printf("%d errors (%d/%d frames decoded, first error at #%d)\n",
+      errors, count, frames, (first >= 0) ? first : count);
+  }
+
+static void canformat_fuzz_format(OvmsWriter* writer, const char* name, int rounds, uint32_t seed,
+  canbus** buses, int nbuses)
+  {
+  static const char alphabet[] = "0123456789abcdefABCDEFRTSXtx -.:\n\n";
+  uint8_t traits = canformat_get_traits(name);
+  uint32_t bytes = 0, msgs = 0, errors = 0;
+  int64_t t0 = esp_timer_get_time();
+
+  for (int r = 0; r < rounds; r++)
+    {
+    uint32_t rnd = (seed + r) ? (seed + r) : 1;
+    canformat_random(rnd);
+    canformat* formatter = MyCanFormatFactory.NewFormat(name);
+    if (!formatter) return;
+    formatter->SetServeMode(canformat::Simulate);
+
+    // Generate input:
+    extram::string input;
+    size_t len = 1 + canformat_random(rnd) % (2*CANFORMAT_SERVE_BUFFERSIZE);
+    switch (canformat_random(rnd) % 3)
+      {
+      case 0:   // Random bytes
+        while (input.size() < len)
+          input += (char)canformat_random(rnd);
+        break;
+      case 1:   // Random text
+        while (input.size() < len)
+          input += alphabet[canformat_random(rnd) % (sizeof(alphabet)-1)];
+        break;
+      default:  // Mutated records
+        {
+        struct timeval tv = { 1700000000, 0 };
+        std::string rec = formatter->getheader(&tv);
+        input.assign(rec.data(), rec.size());
+        CAN_log_message_t msg;
+        uint32_t n = 0;
+        while (input.size() < len)
+          {
+          canformat_random_frame(&msg, rnd, traits, buses, nbuses, n++);
+          rec = formatter->get(&msg);
+          input.append(rec.data(), rec.size());
+          }
+        for (int k = 1 + canformat_random(rnd) % 8; k > 0 && !input.empty(); k--)
+          {
+          size_t pos = canformat_random(rnd) % input.size();
+          uint32_t v = canformat_random(rnd);
+          switch (v % 4)
+            {
+            case 0: input[pos] ^= 1 << ((v >> 8) % 8); break;
+            case 1: input[pos] = v >> 8; break;
+            case 2: input.insert(pos, 1 + (v >> 8) % 16, alphabet[(v >> 16) % (sizeof(alphabet)-1)]); break;
+            default: input.resize(pos); break;
+            }
+          }
+        }
+        break;
+      }
+    bytes += input.size();
+
+    // Feed & check:
+    const char* error = NULL;
+    canformat_decode(formatter, (const uint8_t*)input.data(), input.size(), 64, rnd,
+      [&](CAN_log_message_t* msg, size_t used, size_t len) -> bool
+        {
+        if (msg == NULL)
+          error = "message overrun (guard area modified)";
+        else if (used > len)
+          error = "consumed more than given";
+        else if (msg->origin && (msg->type == CAN_LogFrame_RX || msg->type == CAN_LogFrame_TX))
+          {
+          msgs++;
+          if (msg->frame.FIR.B.DLC > 8)
+            error = "frame length > 8";
+          }
+        return (error == NULL);
+        });
+    delete formatter;
+
+    if (error)
+      {
+      if (errors++ < 5)
+        writer->printf("%-9s round %d (seed %u): %s\n", name, r, seed + r, error);
+      }
+    }
+
+  uint32_t us = std::max((int64_t)1, esp_timer_get_time() - t0);
+  writer->printf("%-9s fuzz: %d rounds, %u bytes, %u frames parsed, %u kB/s: %s\n",
+    name, rounds, bytes, msgs, (uint32_t)((uint64_t)bytes * 1000 / us),
+    errors ? "FAIL" : "OK");
+  }
+
+void can_format_benchmark(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  canbus* buses[CAN_MAXBUSES];
+  int nbuses = canformat_get_buses(buses);
+  if (nbuses == 0)
+    {
+    writer->puts("Error: no CAN bus available");
+    return;
+    }
+  int frames = (argc > 1) ? atoi(argv[1]) : CANFORMAT_BENCH_FRAMES;
+  if (frames <= 0)
+    {
+    writer->puts("Error: invalid frame count");
+    return;
+    }
+  writer->printf("Benchmark: %d frames per format\n", frames);
+  for (auto it = MyCanFormatFactory.m_fmap.begin(); it != MyCanFormatFactory.m_fmap.end(); it++)
+    {
+    if (argc > 0 && strcmp(argv[0], "*") != 0 && strcmp(argv[0], it->first) != 0)
+      continue;
+    canformat_benchmark_format(writer, it->first, frames, buses, nbuses);
+    }
+  }
+
+void can_format_fuzz(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  canbus* buses[CAN_MAXBUSES];
+  int nbuses = canformat_get_buses(buses);
+  if (nbuses == 0)
+    {
+    writer->puts("Error: no CAN bus available");
+    return;
+    }
+  int rounds = (argc > 1) ? atoi(argv[1]) : CANFORMAT_FUZZ_ROUNDS;
+  uint32_t seed = (argc > 2) ? strtoul(argv[2], NULL, 10) : esp_timer_get_time();
+  if (rounds <= 0)
+    {
+    writer->puts("Error: invalid round count");
+    return;
+    }
+  ESP_LOGI(TAG, "Fuzz test: %d rounds, seed %u", rounds, seed);
+  writer->printf("Fuzz test: %d rounds per format, seed %u\n", rounds, seed);
+  for (auto it = MyCanFormatFactory.m_fmap.begin(); it != MyCanFormatFactory.m_fmap.end(); it++)
+    {
+    if (argc > 0 && strcmp(argv[0], "*") != 0 && strcmp(argv[0], it->first) != 0)
+      continue;
+    canformat_fuzz_format(writer, it->first, rounds, seed, buses, nbuses);
+    }
+  }
+
+class OvmsCanFormatBenchInit
+  {
+  public: OvmsCanFormatBenchInit();
+} MyOvmsCanFormatBenchInit  __attribute__ ((init_priority (4590)));
+
+OvmsCanFormatBenchInit::OvmsCanFormatBenchInit()
+  {
+  ESP_LOGI(TAG, "Initialising CAN format benchmark (4590)");
+
+  OvmsCommand* cmd_can = MyCommandApp.FindCommand("can");
+  if (cmd_can)
+    {
+    OvmsCommand* cmd_format = cmd_can->RegisterCommand("format","CAN log format tools");
+    cmd_format->RegisterCommand("benchmark","Measure & verify format conversions",can_format_benchmark,
+      "[<format>|*] [<frames>]", 0, 2);
+    cmd_format->RegisterCommand("fuzz","Feed random input into format parsers",can_format_fuzz,
+      "[<format>|*] [<rounds>] [<seed>]", 0, 3);
+    }
+  }
@@ -0,0 +1,488 @@
+/*
+;    Project:       Open Vehicle Monitor System
+;    Module:        CAN dump compact binary (CBIN) format
+;    Date:          19th October 2026
+;
+;    (C) 2026       Open Vehicles Project
+;
+; Permission is hereby granted, free of charge, to any person obtaining a copy
+; of this software and associated documentation files (the "Software"), to deal
+; in the Software without restriction, including without limitation the rights
+; to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+; copies of the Software, and to permit persons to whom the Software is
+; furnished to do so, subject to the following conditions:
+;
+; The above copyright notice and this permission notice shall be included in
+; all copies or substantial portions of the Software.
+;
+; THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+; IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+; FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+; AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+; LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+; OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+; THE SOFTWARE.
+*/
+
+#include "ovms_log.h"
+static const char *TAG = "canformat-cbin";
+
+#include "canformat_cbin.h"
+#include "ovms_config.h"
+
+class OvmsCanFormatCBINInit
+  {
+  public: OvmsCanFormatCBINInit();
+} MyOvmsCanFormatCBINInit  __attribute__ ((init_priority (4505)));
+
+OvmsCanFormatCBINInit::OvmsCanFormatCBINInit()
+  {
+  ESP_LOGI(TAG, "Registering CAN Format: CBIN (4505)");
+
+  MyCanFormatFactory.RegisterCanFormat<canformat_cbin>("cbin");
+  }
+
+////////////////////////////////////////////////////////////////////////
+// Encoding utilities
+////////////////////////////////////////////////////////////////////////
+
+static inline uint8_t* cbin_put_varint(uint8_t* p, uint32_t val)
+  {
+  while (val >= 0x80)
+    {
+    *p++ = (val & 0x7f) | 0x80;
+    val >>= 7;
+    }
+  *p++ = val;
+  return p;
+  }
+
+static inline uint8_t* cbin_put_u16(uint8_t* p, uint16_t val)
+  {
+  *p++ = val & 0xff;
+  *p++ = val >> 8;
+  return p;
+  }
+
+static inline uint8_t* cbin_put_u32(uint8_t* p, uint32_t val)
+  {
+  *p++ = val & 0xff;
+  *p++ = (val >> 8) & 0xff;
+  *p++ = (val >> 16) & 0xff;
+  *p++ = val >> 24;
+  return p;
+  }
+
+// Returns bytes used, 0 if incomplete, -1 if invalid
+static inline int cbin_get_varint(const uint8_t* p, size_t len, uint32_t* val)
+  {
+  uint32_t v = 0;
+  for (int k=0; k<5; k++)
+    {
+    if ((size_t)k >= len) return 0;
+    v |= ((uint32_t)(p[k] & 0x7f)) << (7*k);
+    if ((p[k] & 0x80) == 0)
+      {
+      *val = v;
+      return k+1;
+      }
+    }
+  return -1;
+  }
+
+static inline uint16_t cbin_get_u16(const uint8_t* p)
+  {
+  return p[0] | ((uint16_t)p[1] << 8);
+  }
+
+static inline uint32_t cbin_get_u32(const uint8_t* p)
+  {
+  return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+  }
+
+static uint8_t cbin_checksum(const uint8_t* p, size_t len)
+  {
+  uint8_t sum = 0;
+  while (len--) sum += *p++;
+  return sum ^ 0xff;
+  }
+
+////////////////////////////////////////////////////////////////////////
+// CBIN format implementation
+////////////////////////////////////////////////////////////////////////
+
+canformat_cbin::canformat_cbin(const char* type)
+  : canformat(type)
+  {
+  m_lasttime = 0;
+  m_indextime = 0;
+  m_indexinterval = (int64_t)MyConfig.GetParamValueInt("can", "log.cbin.index", 10) * 1000000;
+  if (m_indexinterval <= 0) m_indexinterval = 10000000;
+  m_offset = 0;
+  m_indexoffset = 0;
+  m_records = 0;
+  m_synced = false;
+  m_rtime = 0;
+  m_rsynced = false;
+  }
+
+canformat_cbin::~canformat_cbin()
+  {
+  }
+
+std::string canformat_cbin::getheader(struct timeval *time)
+  {
+  cbin_hdr_t h;
+  struct timeval t;
+
+  if (time == NULL)
+    {
+    gettimeofday(&t,NULL);
+    time = &t;
+    }
+
+  memset(&h,0,sizeof(h));
+  memcpy(h.magic, "OVCB", 4);
+  h.version = CANFORMAT_CBIN_VERSION;
+  cbin_put_u32((uint8_t*)&h.ts_sec, time->tv_sec);
+  cbin_put_u32((uint8_t*)&h.ts_usec, time->tv_usec);
+
+  // A new stream starts, next record needs to be an index block:
+  m_offset = sizeof(h);
+  m_indexoffset = 0;
+  m_records = 0;
+  m_synced = false;
+
+  return std::string((const char*)&h, sizeof(h));
+  }
+
+void canformat_cbin::PutIndex(std::string& out, const struct timeval* tv)
+  {
+  uint8_t buf[CANFORMAT_CBIN_INDEXLEN];
+  uint8_t* p = buf;
+
+  *p++ = CANFORMAT_CBIN_TAG_INDEX;
+  *p++ = 'I';
+  *p++ = 'X';
+  p = cbin_put_u32(p, tv->tv_sec);
+  p = cbin_put_u32(p, tv->tv_usec);
+  p = cbin_put_u32(p, m_records);
+  p = cbin_put_u32(p, m_indexoffset);
+  *p = cbin_checksum(buf+1, CANFORMAT_CBIN_INDEXLEN-2);
+
+  m_indexoffset = m_offset;
+  m_offset += sizeof(buf);
+  out.append((const char*)buf, sizeof(buf));
+
+  m_indextime = m_lasttime = (int64_t)tv->tv_sec * 1000000 + tv->tv_usec;
+  m_dict.clear();
+  m_synced = true;
+  }
+
+std::string canformat_cbin::get(CAN_log_message_t* message)
+  {
+  std::string result;
+  get(message, result);
+  return result;
+  }
+
+size_t canformat_cbin::get(CAN_log_message_t* message, std::string& out)
+  {
+  size_t start = out.size();
+  uint8_t buf[CANFORMAT_CBIN_MAXRECORD];
+  uint8_t* p = buf;
+
+  int64_t ts = (int64_t)message->timestamp.tv_sec * 1000000 + message->timestamp.tv_usec;
+  uint8_t bus = (message->origin != NULL) ? message->origin->m_busnumber : CANFORMAT_CBIN_BUS_NONE;
+  bool isframe = (message->type == CAN_LogFrame_RX || message->type == CAN_LogFrame_TX);
+
+  // Lookup frame ID in dictionary:
+  uint8_t fflags = 0;
+  uint64_t key = 0;
+  std::map<uint64_t, uint16_t>::iterator it = m_dict.end();
+  if (isframe)
+    {
+    if (message->frame.FIR.B.FF == CAN_frame_ext) fflags |= CANFORMAT_CBIN_FL_EXT;
+    if (message->frame.FIR.B.RTR == CAN_RTR) fflags |= CANFORMAT_CBIN_FL_RTR;
+    key = ((uint64_t)((fflags << 3) | bus) << 32) | message->frame.MsgID;
+    it = m_dict.find(key);
+    if (it == m_dict.end() && m_dict.size() >= CANFORMAT_CBIN_MAXDICT)
+      m_synced = false; // dictionary full, start a new segment
+    }
+
+  // Start a new segment (index block) if necessary:
+  if (!m_synced || ts < m_lasttime || ts - m_indextime >= m_indexinterval)
+    {
+    PutIndex(out, &message->timestamp);
+    it = m_dict.end();
+    }
+
+  uint32_t delta = ts - m_lasttime;
+  m_lasttime = ts;
+
+  switch (message->type)
+    {
+    case CAN_LogFrame_RX:
+    case CAN_LogFrame_TX:
+      {
+      uint8_t dlc = message->frame.FIR.B.DLC;
+      if (dlc > 8) dlc = 8;
+      uint16_t index;
+      if (it == m_dict.end())
+        {
+        // Add dictionary entry:
+        index = m_dict.size();
+        m_dict[key] = index;
+        *p++ = CANFORMAT_CBIN_TAG_DICT | fflags | bus;
+        if (fflags & CANFORMAT_CBIN_FL_EXT)
+          p = cbin_put_u32(p, message->frame.MsgID);
+        else
+          p = cbin_put_u16(p, message->frame.MsgID);
+        }
+      else
+        {
+        index = it->second;
+        }
+      uint8_t tag = CANFORMAT_CBIN_TAG_FRAME | dlc;
+      if (message->type == CAN_LogFrame_TX) tag |= CANFORMAT_CBIN_FL_TX;
+      if (index > 0xff) tag |= CANFORMAT_CBIN_FL_IDX16;
+      *p++ = tag;
+      p = cbin_put_varint(p, delta);
+      if (index > 0xff)
+        p = cbin_put_u16(p, index);
+      else
+        *p++ = index;
+      memcpy(p, message->frame.data.u8, dlc);
+      p += dlc;
+      break;
+      }
+
+    case CAN_LogFrame_TX_Queue:
+    case CAN_LogFrame_TX_Fail:
+      {
+      uint8_t dlc = message->frame.FIR.B.DLC;
+      if (dlc > 8) dlc = 8;
+      *p++ = CANFORMAT_CBIN_TAG_EVENT;
+      *p++ = message->type;
+      p = cbin_put_varint(p, delta);
+      *p++ = bus;
+      *p++ = ((message->frame.FIR.B.FF == CAN_frame_ext) ? CANFORMAT_CBIN_FL_EXT : 0) |
+             ((message->frame.FIR.B.RTR == CAN_RTR) ? CANFORMAT_CBIN_FL_RTR : 0);
+      p = cbin_put_u32(p, message->frame.MsgID);
+      *p++ = dlc;
+      memcpy(p, message->frame.data.u8, dlc);
+      p += dlc;
+      break;
+      }
+
+    case CAN_LogStatus_Error:
+    case CAN_LogStatus_Statistics:
+      *p++ = CANFORMAT_CBIN_TAG_STATUS;
+      *p++ = message->type;
+      p = cbin_put_varint(p, delta);
+      *p++ = bus;
+      p = cbin_put_varint(p, message->status.interrupts);
+      p = cbin_put_varint(p, message->status.packets_rx);
+      p = cbin_put_varint(p, message->status.packets_tx);
+      p = cbin_put_varint(p, message->status.txbuf_delay);
+      p = cbin_put_varint(p, message->status.rxbuf_overflow);
+      p = cbin_put_varint(p, message->status.txbuf_overflow);
+      p = cbin_put_varint(p, message->status.error_flags);
+      p = cbin_put_varint(p, message->status.errors_rx);
+      p = cbin_put_varint(p, message->status.errors_tx);
+      p = cbin_put_varint(p, message->status.watchdog_resets);
+      p = cbin_put_varint(p, message->status.error_resets);
+      break;
+
+    case CAN_LogInfo_Comment:
+    case CAN_LogInfo_Config:
+    case CAN_LogInfo_Event:
+      {
+      size_t len = (message->text) ? strlen(message->text) : 0;
+      if (len > CANFORMAT_CBIN_MAXTEXT) len = CANFORMAT_CBIN_MAXTEXT;
+      *p++ = CANFORMAT_CBIN_TAG_TEXT;
+      *p++ = message->type;
+      p = cbin_put_varint(p, delta);
+      *p++ = bus;
+      p = cbin_put_varint(p, len);
+      memcpy(p, message->text, len);
+      p += len;
+      break;
+      }
+
+    default:
+      break;
+    }
+
+  if (p > buf)
+    {
+    out.append((const char*)buf, p-buf);
+    m_offset += p-buf;
+    m_records++;
+    }
+  return out.size() - start;
+  }
+
+/**
+ * Decode: decode a single record
+ *  Returns bytes used, 0 if more data is needed, -1 if the record is invalid.
+ *  Only frames are returned in message, other records just update the state.
+ */
+int canformat_cbin::Decode(CAN_log_message_t* message, const uint8_t* p, size_t len)
+  {
+  if (len < 1) return 0;
+  uint8_t tag = p[0];
+  size_t pos = 1;
+  uint32_t delta;
+  int used;
+
+  if ((tag & 0xc0) == CANFORMAT_CBIN_TAG_FRAME)
+    {
+    if (!m_rsynced) return -1;
+    uint8_t dlc = tag & 0x0f;
+    if (dlc > 8) return -1;
+    if ((used = cbin_get_varint(p+pos, len-pos, &delta)) <= 0) return used;
+    pos += used;
+    size_t isize = (tag & CANFORMAT_CBIN_FL_IDX16) ? 2 : 1;
+    if (len < pos + isize + dlc) return 0;
+    uint16_t index = (isize == 2) ? cbin_get_u16(p+pos) : p[pos];
+    pos += isize;
+    if (index >= m_rdict.size()) return -1;
+    const dict_entry_t& entry = m_rdict[index];
+    m_rtime += delta;
+    message->type = (tag & CANFORMAT_CBIN_FL_TX) ? CAN_LogFrame_TX : CAN_LogFrame_RX;
+    message->timestamp.tv_sec = m_rtime / 1000000;
+    message->timestamp.tv_usec = m_rtime % 1000000;
+    message->frame.FIR.B.FF = (entry.flags & CANFORMAT_CBIN_FL_EXT) ? CAN_frame_ext : CAN_frame_std;
+    message->frame.FIR.B.RTR = (entry.flags & CANFORMAT_CBIN_FL_RTR) ? CAN_RTR : CAN_no_RTR;
+    message->frame.FIR.B.DLC = dlc;
+    message->frame.MsgID = entry.id;
+    memcpy(message->frame.data.u8, p+pos, dlc);
+    pos += dlc;
+    message->origin = (entry.bus == CANFORMAT_CBIN_BUS_NONE) ? NULL : MyCan.GetBus(entry.bus);
+    return pos;
+    }
+  else if ((tag & 0xc0) == CANFORMAT_CBIN_TAG_DICT)
+    {
+    if (!m_rsynced) return -1;
+    size_t isize = (tag & CANFORMAT_CBIN_FL_EXT) ? 4 : 2;
+    if (len < pos + isize) return 0;
+    if (m_rdict.size() >= CANFORMAT_CBIN_MAXDICT) return -1;
+    dict_entry_t entry;
+    entry.id = (isize == 4) ? cbin_get_u32(p+pos) : cbin_get_u16(p+pos);
+    entry.bus = tag & 0x07;
+    entry.flags = tag & (CANFORMAT_CBIN_FL_EXT|CANFORMAT_CBIN_FL_RTR);
+    m_rdict.push_back(entry);
+    return pos + isize;
+    }
+
+  switch (tag)
+    {
+    case CANFORMAT_CBIN_TAG_INDEX:
+      if (len < CANFORMAT_CBIN_INDEXLEN) return 0;
+      if (p[1] != 'I' || p[2] != 'X' ||
+          p[CANFORMAT_CBIN_INDEXLEN-1] != cbin_checksum(p+1, CANFORMAT_CBIN_INDEXLEN-2))
+        return -1;
+      m_rtime = (int64_t)cbin_get_u32(p+3) * 1000000 + cbin_get_u32(p+7);
+      m_rdict.clear();
+      m_rsynced = true;
+      return CANFORMAT_CBIN_INDEXLEN;
+
+    case CANFORMAT_CBIN_TAG_EVENT:
+      {
+      if (!m_rsynced) return -1;
+      if (len < pos + 1) return 0;
+      pos++; // type
+      if ((used = cbin_get_varint(p+pos, len-pos, &delta)) <= 0) return used;
+      pos += used;
+      if (len < pos + 7) return 0;
+      uint8_t dlc = p[pos+6];
+      if (dlc > 8) return -1;
+      if (len < pos + 7 + dlc) return 0;
+      m_rtime += delta;
+      return pos + 7 + dlc;
+      }
+
+    case CANFORMAT_CBIN_TAG_STATUS:
+      {
+      if (!m_rsynced) return -1;
+      if (len < pos + 1) return 0;
+      pos++; // type
+      if ((used = cbin_get_varint(p+pos, len-pos, &delta)) <= 0) return used;
+      pos += used + 1; // bus
+      for (int k=0; k<11; k++)
+        {
+        uint32_t val;
+        if (len < pos) return 0;
+        if ((used = cbin_get_varint(p+pos, len-pos, &val)) <= 0) return used;
+        pos += used;
+        }
+      m_rtime += delta;
+      return pos;
+      }
+
+    case CANFORMAT_CBIN_TAG_TEXT:
+      {
+      if (!m_rsynced) return -1;
+      if (len < pos + 1) return 0;
+      pos++; // type
+      if ((used = cbin_get_varint(p+pos, len-pos, &delta)) <= 0) return used;
+      pos += used + 1; // bus
+      uint32_t tlen;
+      if (len < pos) return 0;
+      if ((used = cbin_get_varint(p+pos, len-pos, &tlen)) <= 0) return used;
+      pos += used;
+      if (tlen > CANFORMAT_CBIN_MAXTEXT) return -1;
+      if (len < pos + tlen) return 0;
+      m_rtime += delta;
+      return pos + tlen;
+      }
+
+    default:
+      return -1;
+    }
+  }
+
+size_t canformat_cbin::put(CAN_log_message_t* message, uint8_t *buffer, size_t len, void* userdata)
+  {
+  if (m_buf.FreeSpace()==0) SetServeDiscarding(true); // Buffer full, so discard from now on
+  if (IsServeDiscarding()) return len;  // Quick return if discarding
+
+  size_t consumed = Stuff(buffer,len);  // Stuff m_buf with as much as possible
+
+  uint8_t rec[CANFORMAT_CBIN_MAXRECORD];
+  size_t avail = m_buf.Peek(sizeof(rec), rec);
+
+  if (!m_rsynced)
+    {
+    // Skip file header, then scan for the next index block:
+    size_t skip = 0;
+    if (avail >= sizeof(cbin_hdr_t) && memcmp(rec, "OVCB", 4) == 0)
+      {
+      skip = sizeof(cbin_hdr_t);
+      }
+    while (skip < avail && rec[skip] != CANFORMAT_CBIN_TAG_INDEX)
+      skip++;
+    if (skip > 0)
+      {
+      m_buf.Pop(skip, rec);
+      avail = m_buf.Peek(sizeof(rec), rec);
+      }
+    if (avail == 0) return consumed;
+    }
+
+  int used = Decode(message, rec, avail);
+  if (used > 0)
+    {
+    m_buf.Pop(used, rec);
+    }
+  else if (used < 0)
+    {
+    // Invalid record: drop a byte and resync at the next index block
+    ESP_LOGD(TAG, "Invalid record (tag %02x): resyncing", rec[0]);
+    m_buf.Pop(1, rec);
+    m_rsynced = false;
+    }
+
+  return consumed;
+  }
@@ -0,0 +1,130 @@
+/*
+;    Project:       Open Vehicle Monitor System
+;    Module:        CAN dump compact binary (CBIN) format
+;    Date:          19th October 2026
+;
+;    (C) 2026       Open Vehicles Project
+;
+; Permission is hereby granted, free of charge, to any person obtaining a copy
+; of this software and associated documentation files (the "Software"), to deal
+; in the Software without restriction, including without limitation the rights
+; to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+; copies of the Software, and to permit persons to whom the Software is
+; furnished to do so, subject to the following conditions:
+;
+; The above copyright notice and this permission notice shall be included in
+; all copies or substantial portions of the Software.
+;
+; THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+; IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+; FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+; AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+; LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+; OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+; THE SOFTWARE.
+*/
+
+#ifndef __CANFORMAT_CBIN_H__
+#define __CANFORMAT_CBIN_H__
+
+#include <map>
+#include <vector>
+#include "canformat.h"
+
+/**
+ * CBIN: compact indexed binary CAN log format
+ *
+ * All multi byte values are little endian, "varint" is unsigned LEB128.
+ *
+ * File header (16 bytes):
+ *    "OVCB" version(1) flags(1) reserved(2) ts_sec(4) ts_usec(4)
+ *
+ * Records, identified by the first (tag) byte:
+ *    00xxxxxx  Frame:        tag [5]=TX [4]=16 bit dict index [3:0]=DLC
+ *                            varint(delta_us) index(1|2) data(DLC)
+ *    01xxxxxx  Dictionary:   tag [5]=extended [3]=RTR [2:0]=bus (7=none)
+ *                            id(2|4), assigned the next free index
+ *    0x80      Index block:  "IX" ts_sec(4) ts_usec(4) records(4)
+ *                            prev_index_offset(4) checksum(1)
+ *    0x81      Frame event:  type(1) varint(delta_us) bus(1) flags(1) id(4)
+ *                            dlc(1) data(dlc)
+ *    0x82      Status:       type(1) varint(delta_us) bus(1) 11 x varint
+ *    0x83      Text:         type(1) varint(delta_us) bus(1) varint(len) text
+ *
+ * Timestamps are delta encoded against the previous record. Each index block
+ * carries an absolute timestamp and resets the ID dictionary, so every
+ * segment between index blocks can be decoded on its own. Readers may seek
+ * by time by scanning for the index sync pattern (see tools/cbinconv.c).
+ */
+
+#define CANFORMAT_CBIN_VERSION        1
+#define CANFORMAT_CBIN_MAXDICT        2048
+#define CANFORMAT_CBIN_MAXTEXT        512
+#define CANFORMAT_CBIN_MAXRECORD      (CANFORMAT_CBIN_MAXTEXT + 16)
+
+#define CANFORMAT_CBIN_TAG_FRAME      0x00
+#define CANFORMAT_CBIN_TAG_DICT       0x40
+#define CANFORMAT_CBIN_TAG_INDEX      0x80
+#define CANFORMAT_CBIN_TAG_EVENT      0x81
+#define CANFORMAT_CBIN_TAG_STATUS     0x82
+#define CANFORMAT_CBIN_TAG_TEXT       0x83
+
+#define CANFORMAT_CBIN_FL_TX          0x20
+#define CANFORMAT_CBIN_FL_IDX16       0x10
+#define CANFORMAT_CBIN_FL_EXT         0x20
+#define CANFORMAT_CBIN_FL_RTR         0x08
+#define CANFORMAT_CBIN_BUS_NONE       0x07
+
+#define CANFORMAT_CBIN_INDEXLEN       20
+
+typedef struct __attribute__ ((__packed__))
+  {
+  char magic[4];          /* "OVCB" */
+  uint8_t version;        /* format version */
+  uint8_t flags;          /* reserved, 0 */
+  uint16_t reserved;      /* reserved, 0 */
+  uint32_t ts_sec;        /* base timestamp seconds */
+  uint32_t ts_usec;       /* base timestamp microseconds */
+  } cbin_hdr_t;
+
+class canformat_cbin : public canformat
+  {
+  public:
+    canformat_cbin(const char* type);
+    virtual ~canformat_cbin();
+
+  public:
+    virtual std::string get(CAN_log_message_t* message);
+    virtual size_t get(CAN_log_message_t* message, std::string& buffer);
+    virtual std::string getheader(struct timeval *time);
+    virtual size_t put(CAN_log_message_t* message, uint8_t *buffer, size_t len, void* userdata=NULL);
+
+  protected:
+    void PutIndex(std::string& out, const struct timeval* tv);
+    int Decode(CAN_log_message_t* message, const uint8_t* p, size_t len);
+
+  protected:
+    // Encoder state:
+    std::map<uint64_t, uint16_t> m_dict;  // ID dictionary: (bus, flags, id) -> index
+    int64_t m_lasttime;                   // timestamp of last record [us]
+    int64_t m_indextime;                  // timestamp of last index block [us]
+    int64_t m_indexinterval;              // index block interval [us]
+    uint32_t m_offset;                    // output stream offset
+    uint32_t m_indexoffset;               // output stream offset of last index block
+    uint32_t m_records;                   // records written
+    bool m_synced;                        // false = index block needed
+
+  protected:
+    // Decoder state:
+    typedef struct
+      {
+      uint32_t id;
+      uint8_t bus;
+      uint8_t flags;
+      } dict_entry_t;
+    std::vector<dict_entry_t> m_rdict;
+    int64_t m_rtime;
+    bool m_rsynced;
+  };
+
+#endif // __CANFORMAT_CBIN_H__
@@ -54,9 +54,17 @@ canformat_crtd::~canformat_crtd()
   }
 
 std::string canformat_crtd::get(CAN_log_message_t* message)
+  {
+  std::string result;
+  get(message, result);
+  return result;
+  }
+
+size_t canformat_crtd::get(CAN_log_message_t* message, std::string& buffer)
   {
   char buf[CANFORMAT_CRTD_MAXLEN];
-  char *p;
+  char *p = buf;
+  int len;
 
   char busnumber;
   if (message->origin != NULL)
@@ -68,44 +76,53 @@ std::string canformat_crtd::get(CAN_log_message_t* message)
     {
     case CAN_LogFrame_RX:
     case CAN_LogFrame_TX:
-      snprintf(buf,sizeof(buf),"%ld.%06ld %c%c%s %0*X",
-        message->timestamp.tv_sec, message->timestamp.tv_usec,
-        busnumber,
-        (message->type == CAN_LogFrame_RX) ? 'R' : 'T',
-        (message->frame.FIR.B.FF == CAN_frame_std) ? "11":"29",
-        (message->frame.FIR.B.FF == CAN_frame_std) ? 3 : 8,
-        message->frame.MsgID);
-      p = buf+strlen(buf);
+    case CAN_LogFrame_TX_Queue:
+    case CAN_LogFrame_TX_Fail:
+      // Hot path, table driven equivalent of "%ld.%06ld %c%c%s %0*X" + " %02x" per byte:
+      p = canformat_putdec(p, (long)message->timestamp.tv_sec);
+      *p++ = '.';
+      p = canformat_putdec(p, (long)message->timestamp.tv_usec, 6);
+      *p++ = ' ';
+      *p++ = busnumber;
+      if (message->type == CAN_LogFrame_RX)
+        {
+        *p++ = 'R';
+        }
+      else if (message->type == CAN_LogFrame_TX)
+        {
+        *p++ = 'T';
+        }
+      else
+        {
+        const char* name = GetCanLogTypeName(message->type);
+        size_t namelen = strlen(name);
+        memcpy(p, "CER ", 4);
+        p += 4;
+        memcpy(p, name, namelen);
+        p += namelen;
+        *p++ = ' ';
+        *p++ = 'T';
+        }
+      if (message->frame.FIR.B.FF == CAN_frame_std)
+        {
+        *p++ = '1'; *p++ = '1'; *p++ = ' ';
+        p = canformat_puthex(p, message->frame.MsgID, 3, canformat_hex_uc);
+        }
+      else
+        {
+        *p++ = '2'; *p++ = '9'; *p++ = ' ';
+        p = canformat_puthex(p, message->frame.MsgID, 8, canformat_hex_uc);
+        }
       for (int k=0; k<message->frame.FIR.B.DLC; k++)
         {
         *p++ = ' ';
-        p = HexByte(p,message->frame.data.u8[k]);
+        p = canformat_puthex(p, message->frame.data.u8[k], 2);
         }
-      *p = 0;
-      break;
-
-    case CAN_LogFrame_TX_Queue:
-    case CAN_LogFrame_TX_Fail:
-      snprintf(buf,sizeof(buf),"%ld.%06ld %cCER %s %c%s %0*X",
-        message->timestamp.tv_sec, message->timestamp.tv_usec,
-        busnumber,
-        GetCanLogTypeName(message->type),
-        (message->type == CAN_LogFrame_RX) ? 'R' : 'T',
-        (message->frame.FIR.B.FF == CAN_frame_std) ? "11":"29",
-        (message->frame.FIR.B.FF == CAN_frame_std) ? 3 : 8,
-        message->frame.MsgID);
-        p = buf+strlen(buf);
-        for (int k=0; k<message->frame.FIR.B.DLC; k++)
-          {
-          *p++ = ' ';
-          p = HexByte(p,message->frame.data.u8[k]);
-          }
-        *p = 0;
       break;
 
     case CAN_LogStatus_Error:
     case CAN_LogStatus_Statistics:
-      snprintf(buf,sizeof(buf),"%ld.%06ld %c%s %s intr=%d rxpkt=%d txpkt=%d errflags=%#x rxerr=%d txerr=%d rxovr=%d txovr=%d txdelay=%d wdgreset=%d errreset=%d",
+      len = snprintf(buf,sizeof(buf),"%ld.%06ld %c%s %s intr=%d rxpkt=%d txpkt=%d errflags=%#x rxerr=%d txerr=%d rxovr=%d txovr=%d txdelay=%d wdgreset=%d errreset=%d",
         message->timestamp.tv_sec, message->timestamp.tv_usec,
         busnumber,
         (message->type == CAN_LogStatus_Error) ? "CER" : "CST",
@@ -114,27 +131,28 @@ std::string canformat_crtd::get(CAN_log_message_t* message)
         message->status.errors_rx, message->status.errors_tx, message->status.rxbuf_overflow,
         message->status.txbuf_overflow, message->status.txbuf_delay, message->status.watchdog_resets,
         message->status.error_resets);
-      break;
+      p = buf + ((len < 0) ? 0 : (len >= CANFORMAT_CRTD_MAXLEN) ? CANFORMAT_CRTD_MAXLEN-1 : len);
       break;
 
     case CAN_LogInfo_Comment:
     case CAN_LogInfo_Config:
     case CAN_LogInfo_Event:
-      snprintf(buf,sizeof(buf),"%ld.%06ld %c%s %s %s",
+      len = snprintf(buf,sizeof(buf),"%ld.%06ld %c%s %s %s",
         message->timestamp.tv_sec, message->timestamp.tv_usec,
         busnumber,
         (message->type == CAN_LogInfo_Event) ? "CEV" : "CXX",
         GetCanLogTypeName(message->type),
         message->text);
+      p = buf + ((len < 0) ? 0 : (len >= CANFORMAT_CRTD_MAXLEN) ? CANFORMAT_CRTD_MAXLEN-1 : len);
       break;
 
     default:
-      buf[0] = 0;
       break;
     }
 
-  strcat(buf,"\n");
-  return std::string(buf);
+  *p++ = '\n';
+  buffer.append(buf, p-buf);
+  return p-buf;
   }
 
 std::string canformat_crtd::getheader(struct timeval *time)
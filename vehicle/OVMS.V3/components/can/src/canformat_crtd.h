@@ -39,6 +39,7 @@ class canformat_crtd : public canformat
 
   public:
     virtual std::string get(CAN_log_message_t* message);
+    virtual size_t get(CAN_log_message_t* message, std::string& buffer);
     virtual std::string getheader(struct timeval *time);
     virtual size_t put(CAN_log_message_t* message, uint8_t *buffer, size_t len, void* userdata=NULL);
   };
@@ -87,28 +87,46 @@ canformat_gvret_ascii::canformat_gvret_ascii(const char* type)
   }
 
 std::string canformat_gvret_ascii::get(CAN_log_message_t* message)
+  {
+  std::string result;
+  get(message, result);
+  return result;
+  }
+
+size_t canformat_gvret_ascii::get(CAN_log_message_t* message, std::string& buffer)
   {
   char buf[CANFORMAT_GVRET_MAXLEN];
+  char *p = buf;
 
   if ((message->type != CAN_LogFrame_RX)&&
       (message->type != CAN_LogFrame_TX))
     {
-    return std::string("");
+    return 0;
     }
 
   char busnumber = (message->origin != NULL)?message->origin->m_busnumber + '0':'0';
 
-  sprintf(buf,"%u - %x %s %c %d",
-    (uint32_t)((message->timestamp.tv_sec * 1000000) + message->timestamp.tv_usec),
-    message->frame.MsgID,
-    (message->frame.FIR.B.FF == CAN_frame_std) ? "S" : "X",
-    busnumber,
-    message->frame.FIR.B.DLC);
-    for (int k=0; k<message->frame.FIR.B.DLC; k++)
-      sprintf(buf+strlen(buf)," %02x", message->frame.data.u8[k]);
-
-  strcat(buf,"\n");
-  return std::string(buf);
+  // Table driven equivalent of "%u - %x %s %c %d" + " %02x" per byte:
+  p = canformat_putdec(p, (unsigned long)(uint32_t)((message->timestamp.tv_sec * 1000000) + message->timestamp.tv_usec));
+  *p++ = ' ';
+  *p++ = '-';
+  *p++ = ' ';
+  p = canformat_puthex(p, message->frame.MsgID, 1);
+  *p++ = ' ';
+  *p++ = (message->frame.FIR.B.FF == CAN_frame_std) ? 'S' : 'X';
+  *p++ = ' ';
+  *p++ = busnumber;
+  *p++ = ' ';
+  p = canformat_putdec(p, (unsigned long)message->frame.FIR.B.DLC);
+  for (int k=0; k<message->frame.FIR.B.DLC; k++)
+    {
+    *p++ = ' ';
+    p = canformat_puthex(p, message->frame.data.u8[k], 2);
+    }
+
+  *p++ = '\n';
+  buffer.append(buf, p-buf);
+  return p-buf;
   }
 
 size_t canformat_gvret_ascii::put(CAN_log_message_t* message, uint8_t *buffer, size_t len, void* userdata)
@@ -125,56 +143,66 @@ size_t canformat_gvret_ascii::put(CAN_log_message_t* message, uint8_t *buffer, s
   else
     {
     std::string line = m_buf.ReadLine();
-    char *b = strdup(line.c_str());
+    char *b = (char*)line.c_str();
+    char *e;
 
     // We look for something like
     // 1000 - 100 S 0 4 01 02 03 04
-    // timestamp, message ID (hex), S or X, length, data bytes
+    // timestamp, message ID (hex), S or X, bus, length, data bytes
 
     message->type = CAN_LogFrame_RX;
 
-    uint32_t timestamp = strtol(b,&b,10);
-    message->timestamp.tv_sec = timestamp % 1000000;
-    message->timestamp.tv_usec = timestamp / 1000000;
+    uint32_t timestamp = strtoul(b,&e,10);
+    if (e == b) return consumed; // Bad timestamp - discard
+    message->timestamp.tv_sec = timestamp / 1000000;
+    message->timestamp.tv_usec = timestamp % 1000000;
+
+    b = e;
+    while (*b == ' ') b++;
+    if (*b != '-') return consumed; // Bad separator - discard
+    b++;
 
-    b += 2; // Skip the '-'
+    message->frame.MsgID = strtoul(b,&e,16);
+    if (e == b) return consumed; // Bad message ID - discard
 
-    message->frame.MsgID = strtol(b,&b,16);
-    if (b[1] == 'S')
+    b = e;
+    while (*b == ' ') b++;
+    if (*b == 'S')
       {
       message->frame.FIR.B.FF = CAN_frame_std;
       }
-    else if (b[1] == 'X')
+    else if (*b == 'X')
       {
       message->frame.FIR.B.FF = CAN_frame_ext;
       }
     else
       {
       // Bad frame type - discard
-      free(b);
       return consumed;
       }
+    b++; // Skip the frame type
 
-    b += 2; // Skip the frame type
+    int busnumber = strtol(b,&e,10);
+    if (e == b) return consumed; // Bad bus number - discard
 
-    uint32_t busnumber = strtol(b,&b,10);
-
-    message->frame.FIR.B.DLC = strtol(b,&b,10);
-    if (message->frame.FIR.B.DLC > 8)
+    b = e;
+    uint32_t length = strtoul(b,&e,10);
+    if ((e == b)||(length > 8))
       {
       // Bad frame length - discard
-      free(b);
       return consumed;
       }
+    message->frame.FIR.B.DLC = length;
 
-    for (size_t x=0;x<message->frame.FIR.B.DLC;x++)
+    for (size_t x=0;x<length;x++)
       {
-      message->frame.data.u8[x] = strtol(b,&b,16);
+      b = e;
+      message->frame.data.u8[x] = strtoul(b,&e,16);
+      if (e == b) return consumed; // Missing data byte - discard
       }
 
-    message->origin = MyCan.GetBus(busnumber-'0');
+    message->origin = MyCan.GetBus(busnumber);
 
-    free(b);
     return consumed;
     }
   }
@@ -189,6 +217,13 @@ canformat_gvret_binary::canformat_gvret_binary(const char* type)
   }
 
 std::string canformat_gvret_binary::get(CAN_log_message_t* message)
+  {
+  std::string result;
+  get(message, result);
+  return result;
+  }
+
+size_t canformat_gvret_binary::get(CAN_log_message_t* message, std::string& buffer)
   {
   gvret_binary_frame_t frame;
   memset(&frame,0,sizeof(frame));
@@ -196,7 +231,7 @@ std::string canformat_gvret_binary::get(CAN_log_message_t* message)
   if ((message->type != CAN_LogFrame_RX)&&
       (message->type != CAN_LogFrame_TX))
     {
-    return std::string("");
+    return 0;
     }
 
   char busnumber = (message->origin != NULL)?message->origin->m_busnumber:0;
@@ -209,7 +244,8 @@ std::string canformat_gvret_binary::get(CAN_log_message_t* message)
   frame.lenbus = message->frame.FIR.B.DLC + (busnumber<<4);
   for (int k=0; k<message->frame.FIR.B.DLC; k++)
     frame.data[k] = message->frame.data.u8[k];
-  return std::string((const char*)&frame,12 + message->frame.FIR.B.DLC);
+  buffer.append((const char*)&frame,12 + message->frame.FIR.B.DLC);
+  return 12 + message->frame.FIR.B.DLC;
   }
 
 size_t canformat_gvret_binary::put(CAN_log_message_t* message, uint8_t *buffer, size_t len, void* userdata)
@@ -244,36 +280,29 @@ size_t canformat_gvret_binary::put(CAN_log_message_t* message, uint8_t *buffer,
         if (m_buf.UsedSpace() >= 8)
           {
           m_buf.Peek(8,(uint8_t*)&m);
-          if (m_buf.UsedSpace() >= 8 + m.body.build_can_frame.length)
+          if (m.body.build_can_frame.length > 8)
+            {
+            // Bad frame length - skip header
+            m_buf.Pop(8,(uint8_t*)&m);
+            }
+          else if (m_buf.UsedSpace() >= 8 + m.body.build_can_frame.length)
             {
             m_buf.Pop(8 + m.body.build_can_frame.length,(uint8_t*)&m);
-            CAN_frame_t msg;
-            memset(&msg,0,sizeof(msg));
-            msg.origin = MyCan.GetBus(m.body.build_can_frame.bus);
-            if (m.body.build_can_frame.id & 0x8000000)
+            // We have a frame to be transmitted / simulated, Serve() will do that:
+            message->type = CAN_LogFrame_RX;
+            message->origin = MyCan.GetBus(m.body.build_can_frame.bus);
+            if (m.body.build_can_frame.id & 0x80000000)
               {
-              msg.MsgID = m.body.build_can_frame.id & 0x7fffffff;
-              msg.FIR.B.FF = CAN_frame_ext;
+              message->frame.MsgID = m.body.build_can_frame.id & 0x7fffffff;
+              message->frame.FIR.B.FF = CAN_frame_ext;
               }
             else
               {
-              msg.MsgID = m.body.build_can_frame.id;
-              msg.FIR.B.FF = CAN_frame_std;
-              }
-            msg.FIR.B.DLC = m.body.build_can_frame.length;
-            memcpy(&msg.data, &m.body.build_can_frame.data, m.body.build_can_frame.length);
-            // We have a frame to be transmitted / simulated
-            switch (m_servemode)
-              {
-              case Transmit:
-                if (msg.origin) msg.origin->Write(&msg);
-                break;
-              case Simulate:
-                if (msg.origin) MyCan.IncomingFrame(&msg);
-                break;
-              default:
-                break;
+              message->frame.MsgID = m.body.build_can_frame.id;
+              message->frame.FIR.B.FF = CAN_frame_std;
               }
+            message->frame.FIR.B.DLC = m.body.build_can_frame.length;
+            memcpy(&message->frame.data, &m.body.build_can_frame.data, m.body.build_can_frame.length);
             }
           }
         break;
@@ -29,7 +29,7 @@
 
 #include "canformat.h"
 
-#define CANFORMAT_GVRET_MAXLEN 48
+#define CANFORMAT_GVRET_MAXLEN 80
 
 #define GVRET_SET_BINARY 0xe7
 #define GVRET_START_BYTE 0xf1
@@ -177,6 +177,7 @@ class canformat_gvret_ascii : public canformat_gvret
   public:
     canformat_gvret_ascii(const char* type);
     virtual std::string get(CAN_log_message_t* message);
+    virtual size_t get(CAN_log_message_t* message, std::string& buffer);
     virtual size_t put(CAN_log_message_t* message, uint8_t *buffer, size_t len, void* userdata=NULL);
   };
 
@@ -185,6 +186,7 @@ class canformat_gvret_binary : public canformat_gvret
   public:
     canformat_gvret_binary(const char* type);
     virtual std::string get(CAN_log_message_t* message);
+    virtual size_t get(CAN_log_message_t* message, std::string& buffer);
     virtual size_t put(CAN_log_message_t* message, uint8_t *buffer, size_t len, void* userdata=NULL);
   };
 
@@ -61,30 +61,42 @@ canformat_lawricel::~canformat_lawricel()
   }
 
 std::string canformat_lawricel::get(CAN_log_message_t* message)
+  {
+  std::string result;
+  get(message, result);
+  return result;
+  }
+
+size_t canformat_lawricel::get(CAN_log_message_t* message, std::string& buffer)
   {
   char buf[CANFORMAT_LAWRICEL_MAXLEN];
+  char *p = buf;
 
   if ((message->type != CAN_LogFrame_RX)&&
       (message->type != CAN_LogFrame_TX))
     {
-    return std::string("");
+    return 0;
     }
 
   if (message->frame.FIR.B.FF == CAN_frame_std)
     {
-    sprintf(buf,"t%03x%01d",message->frame.MsgID, message->frame.FIR.B.DLC);
+    *p++ = 't';
+    p = canformat_puthex(p, message->frame.MsgID, 3);
     }
   else
     {
-    sprintf(buf,"T%08x%01d",message->frame.MsgID, message->frame.FIR.B.DLC);
+    *p++ = 'T';
+    p = canformat_puthex(p, message->frame.MsgID, 8);
     }
+  p = canformat_putdec(p, (unsigned long)message->frame.FIR.B.DLC);
 
   for (int k=0; k<message->frame.FIR.B.DLC; k++)
-    sprintf(buf+strlen(buf),"%02x", message->frame.data.u8[k]);
-  sprintf(buf+strlen(buf),"%04lx", message->timestamp.tv_usec/1000);
+    p = canformat_puthex(p, message->frame.data.u8[k], 2);
+  p = canformat_puthex(p, message->timestamp.tv_usec/1000, 4);
 
-  strcat(buf,"\n");
-  return std::string(buf);
+  *p++ = '\n';
+  buffer.append(buf, p-buf);
+  return p-buf;
   }
 
 std::string canformat_lawricel::getheader(struct timeval *time)
@@ -107,13 +119,15 @@ size_t canformat_lawricel::put(CAN_log_message_t* message, uint8_t *buffer, size
     {
     std::string line = m_buf.ReadLine();
     const char *b = line.c_str();
+    size_t idlen;
     char hex[9];
 
     // We look for something like
     // t100401020304000a
-    if (*b == 't')
+    if ((*b == 't')&&(line.size() >= 5))
       {
       // Standard frame
+      idlen = 3;
       memcpy(hex,b+1,3);
       hex[3] = 0;
       message->type = CAN_LogFrame_RX;
@@ -121,9 +135,10 @@ size_t canformat_lawricel::put(CAN_log_message_t* message, uint8_t *buffer, size
       message->frame.MsgID = strtol(hex,NULL,16);
       b += 4;
       }
-    else if (*b == 'T')
+    else if ((*b == 'T')&&(line.size() >= 10))
       {
       // Extended frame
+      idlen = 8;
       memcpy(hex,b+1,8);
       hex[8] = 0;
       message->type = CAN_LogFrame_RX;
@@ -137,18 +152,18 @@ size_t canformat_lawricel::put(CAN_log_message_t* message, uint8_t *buffer, size
       return consumed; // Discard invalid line
       }
 
-    message->frame.FIR.B.DLC = *b - '0';
-    if (message->frame.FIR.B.DLC > 8)
+    if ((*b < '0')||(*b > '8')||(line.size() < 2 + idlen + 2*(*b - '0')))
       {
       // Invalid length - discard
       return consumed; // Discard invalid line
       }
+    message->frame.FIR.B.DLC = *b - '0';
 
     b++;
     for (size_t x=0;x<message->frame.FIR.B.DLC;x++)
       {
       hex[0] = b[0];
-      hex[1] = b[2];
+      hex[1] = b[1];
       hex[2] = 0;
       b += 2;
       message->frame.data.u8[x] = (uint8_t)strtol(hex,NULL,16);
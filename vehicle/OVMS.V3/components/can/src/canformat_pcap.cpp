@@ -54,12 +54,19 @@ canformat_pcap::~canformat_pcap()
   }
 
 std::string canformat_pcap::get(CAN_log_message_t* message)
+  {
+  std::string result;
+  get(message, result);
+  return result;
+  }
+
+size_t canformat_pcap::get(CAN_log_message_t* message, std::string& buffer)
   {
   pcaprec_can_t m;
 
   if (message->type != CAN_LogFrame_RX)
     {
-    return std::string("");
+    return 0;
     }
 
   memset(&m,0,sizeof(m));
@@ -77,7 +84,8 @@ std::string canformat_pcap::get(CAN_log_message_t* message)
 
   memcpy(m.data, message->frame.data.u8, message->frame.FIR.B.DLC);
 
-  return std::string((const char*)&m, sizeof(m));
+  buffer.append((const char*)&m, sizeof(m));
+  return sizeof(m);
   }
 
 std::string canformat_pcap::getheader(struct timeval *time)
@@ -149,6 +157,11 @@ size_t canformat_pcap::put(CAN_log_message_t* message, uint8_t *buffer, size_t l
     // Just ignore it
     return consumed;
     }
+  if (m.record.phdr.len > 8)
+    {
+    // Invalid length - discard
+    return consumed;
+    }
   message->type = CAN_LogFrame_RX;
   message->frame.FIR.B.RTR = (idf & CANFORMAT_PCAP_FL_RTR)?CAN_RTR:CAN_no_RTR;
   message->frame.FIR.B.FF = (idf & CANFORMAT_PCAP_FL_EXT)?CAN_frame_ext:CAN_frame_std;
@@ -54,11 +54,19 @@ canformat_raw::~canformat_raw()
   }
 
 std::string canformat_raw::get(CAN_log_message_t* message)
+  {
+  std::string result;
+  get(message, result);
+  return result;
+  }
+
+size_t canformat_raw::get(CAN_log_message_t* message, std::string& buffer)
   {
   CAN_log_message_t raw;
   memcpy(&raw,message,sizeof(raw));
-  raw.origin = (canbus*)raw.origin->m_busnumber;
-  return std::string((const char*)&raw,sizeof(CAN_log_message_t));
+  raw.origin = (canbus*)((raw.origin != NULL) ? raw.origin->m_busnumber : 0);
+  buffer.append((const char*)&raw,sizeof(CAN_log_message_t));
+  return sizeof(CAN_log_message_t);
   }
 
 std::string canformat_raw::getheader(struct timeval *time)
@@ -76,6 +84,12 @@ size_t canformat_raw::put(CAN_log_message_t* message, uint8_t *buffer, size_t le
   if (m_buf.UsedSpace() < sizeof(CAN_log_message_t)) return consumed; // Insufficient data so far
 
   m_buf.Pop(sizeof(CAN_log_message_t), (uint8_t*)message);
+  if ((message->type > CAN_LogFrame_TX_Fail)||(message->frame.FIR.B.DLC > 8))
+    {
+    // Not a valid frame - discard
+    memset(message,0,sizeof(CAN_log_message_t));
+    return consumed;
+    }
   message->origin = MyCan.GetBus((int)message->origin);
   return consumed;
   }
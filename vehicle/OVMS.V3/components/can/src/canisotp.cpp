@@ -0,0 +1,704 @@
+/*
+;    Project:       Open Vehicle Monitor System
+;    Module:        CAN ISO-TP (ISO 15765-2) transport engine
+;    Date:          19th October 2026
+;
+;    (C) 2026       Open Vehicles Project
+;
+; Permission is hereby granted, free of charge, to any person obtaining a copy
+; of this software and associated documentation files (the "Software"), to deal
+; in the Software without restriction, including without limitation the rights
+; to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+; copies of the Software, and to permit persons to whom the Software is
+; furnished to do so, subject to the following conditions:
+;
+; The above copyright notice and this permission notice shall be included in
+; all copies or substantial portions of the Software.
+;
+; THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+; IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+; FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+; AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+; LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+; OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+; THE SOFTWARE.
+*/
+
+#include "ovms_log.h"
+static const char *TAG = "canisotp";
+
+#include <string.h>
+#include <ctype.h>
+#include <memory>
+#include "canisotp.h"
+#include "ovms_command.h"
+#include "ovms_semaphore.h"
+#include "ovms_utils.h"
+
+// ISO-TP protocol control information (PCI) frame types:
+#define ISOTP_PCI_SF      0x00      // single frame
+#define ISOTP_PCI_FF      0x10      // first frame
+#define ISOTP_PCI_CF      0x20      // consecutive frame
+#define ISOTP_PCI_FC      0x30      // flow control
+
+// Flow control status:
+#define ISOTP_FC_CTS      0x00      // continue to send
+#define ISOTP_FC_WAIT     0x01      // wait
+#define ISOTP_FC_OVFLW    0x02      // overflow / abort
+
+canisotp MyCanIsoTp __attribute__ ((init_priority (4515))) ("isotp");
+
+////////////////////////////////////////////////////////////////////////
+// Shell commands
+////////////////////////////////////////////////////////////////////////
+
+void can_isotp_request(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  canbus* bus = (canbus*)MyPcpApp.FindDeviceByName(argv[0]);
+  if (bus == NULL)
+    {
+    writer->puts("Error: Cannot find named CAN bus");
+    return;
+    }
+  uint32_t txid = strtoul(argv[1], NULL, 16);
+  uint32_t rxid = strtoul(argv[2], NULL, 16);
+
+  std::string request;
+  for (const char* p = argv[3]; p[0] && p[1]; p += 2)
+    {
+    if (!isxdigit(p[0]) || !isxdigit(p[1]))
+      {
+      writer->puts("Error: request must be given as hex bytes, e.g. 22f190");
+      return;
+      }
+    char hex[3] = { p[0], p[1], 0 };
+    request.push_back((char)strtoul(hex, NULL, 16));
+    }
+  if (request.empty() || request.size() > ISOTP_MAXLEN)
+    {
+    writer->puts("Error: invalid request length");
+    return;
+    }
+  uint32_t timeout = (argc > 4) ? atoi(argv[4]) : 3000;
+
+  std::string response;
+  if (!MyCanIsoTp.Request(bus, txid, rxid, request, response, timeout))
+    {
+    writer->printf("Error: request failed: %s\n", response.c_str());
+    return;
+    }
+
+  writer->printf("Response: %d bytes\n", response.size());
+  char *buf = NULL;
+  size_t rlen = response.size(), offset = 0;
+  do
+    {
+    rlen = FormatHexDump(&buf, response.data() + offset, rlen, 16);
+    offset += 16;
+    writer->printf("%s\n", buf ? buf : "-");
+    } while (rlen);
+  if (buf) free(buf);
+  }
+
+void can_isotp_status(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  writer->printf("ISO-TP sessions active: %d\n", MyCanIsoTp.GetSessionCount());
+  writer->printf("Requests: %u, responses: %u, errors: %u, response pending: %u\n",
+    MyCanIsoTp.m_requests, MyCanIsoTp.m_responses, MyCanIsoTp.m_errors, MyCanIsoTp.m_pending);
+  }
+
+class OvmsCanIsoTpInit
+  {
+  public: OvmsCanIsoTpInit();
+} MyOvmsCanIsoTpInit  __attribute__ ((init_priority (4520)));
+
+OvmsCanIsoTpInit::OvmsCanIsoTpInit()
+  {
+  ESP_LOGI(TAG, "Initialising CAN ISO-TP (4520)");
+
+  OvmsCommand* cmd_can = MyCommandApp.FindCommand("can");
+  if (cmd_can)
+    {
+    OvmsCommand* cmd_isotp = cmd_can->RegisterCommand("isotp", "CAN ISO-TP framework");
+    cmd_isotp->RegisterCommand("request", "Send ISO-TP request, output response", can_isotp_request,
+      "<bus> <txid> <rxid> <hexdata> [<timeout_ms>]\n"
+      "rxid 0 = functional request (standard IDs, response 7e8-7ef)\n"
+      "Example: can isotp request can1 7e4 7ec 22f190", 4, 5);
+    cmd_isotp->RegisterCommand("status", "Show ISO-TP status", can_isotp_status);
+    }
+
+  MyCan.RegisterCallback(TAG, [](const CAN_frame_t* frame, bool success)
+    {
+    MyCanIsoTp.IncomingFrame(frame);
+    });
+  }
+
+////////////////////////////////////////////////////////////////////////
+// canisotp: ISO-TP engine
+////////////////////////////////////////////////////////////////////////
+
+canisotp::canisotp(const char* name)
+  {
+  m_name = name;
+  m_fc_bs = 0;
+  m_fc_stmin = 0;
+  m_padding = 0;
+  m_callbacks = 0;
+  m_requests = 0;
+  m_responses = 0;
+  m_errors = 0;
+  m_pending = 0;
+
+  esp_timer_create_args_t args = {};
+  args.callback = TimerCallback;
+  args.arg = this;
+  args.dispatch_method = ESP_TIMER_TASK;
+  args.name = name;
+  if (esp_timer_create(&args, &m_timer) != ESP_OK)
+    m_timer = NULL;
+  }
+
+canisotp::~canisotp()
+  {
+  CancelAll();
+  if (m_timer)
+    {
+    esp_timer_stop(m_timer);
+    esp_timer_delete(m_timer);
+    }
+  }
+
+/**
+ * SetFlowControl: set block size & STmin we request from ECUs sending
+ *  segmented responses (default 0/0 = send all frames without delay)
+ */
+void canisotp::SetFlowControl(uint8_t blocksize, uint8_t stmin)
+  {
+  m_fc_bs = blocksize;
+  m_fc_stmin = stmin;
+  }
+
+/**
+ * SetPadding: set the fill byte for unused frame data bytes (default 0x00)
+ */
+void canisotp::SetPadding(uint8_t padding)
+  {
+  m_padding = padding;
+  }
+
+const char* canisotp::StatusName(canisotp_status_t status)
+  {
+  switch (status)
+    {
+    case ISOTP_OK:        return "OK";
+    case ISOTP_TIMEOUT:   return "timeout";
+    case ISOTP_OVERFLOW:  return "overflow";
+    case ISOTP_SEQERROR:  return "sequence error";
+    case ISOTP_TXERROR:   return "TX error";
+    case ISOTP_ABORTED:   return "aborted";
+    default:              return "unknown";
+    }
+  }
+
+/**
+ * DecodeSTmin: convert STmin parameter to microseconds
+ */
+uint32_t canisotp::DecodeSTmin(uint8_t stmin)
+  {
+  if (stmin <= 0x7f)
+    return stmin * 1000;
+  else if (stmin >= 0xf1 && stmin <= 0xf9)
+    return (stmin - 0xf0) * 100;
+  else
+    return 127000;
+  }
+
+/**
+ * Request: start a new session (asynchronous)
+ *  The callback is executed with the reassembled response, or on error.
+ *  Returns false if a session for (bus, txid, rxid) is already running.
+ */
+bool canisotp::Request(canbus* bus, uint32_t txid, uint32_t rxid, const std::string& request,
+  IsoTpCallback callback, bool expect_response /*=true*/, uint32_t timeout_ms /*=ISOTP_DEFAULT_TIMEOUT*/)
+  {
+  if (bus == NULL || request.empty() || request.size() > ISOTP_MAXLEN)
+    return false;
+
+  m_mutex.Lock();
+  if (FindSession(bus, txid, rxid) != NULL)
+    {
+    m_mutex.Unlock();
+    return false;
+    }
+
+  canisotp_session* s = new canisotp_session;
+  s->m_bus = bus;
+  s->m_txid = txid;
+  s->m_rxid = rxid;
+  s->m_extended = (txid > 0x7ff);
+  s->m_functional = (rxid == 0 && !s->m_extended);
+  s->m_callback = callback;
+  s->m_expect_response = expect_response;
+  s->m_timeout_us = timeout_ms * 1000;
+  s->m_status = ISOTP_OK;
+  s->m_txbuf = request;
+  s->m_txpos = 0;
+  s->m_txseq = 1;
+  s->m_tx_bs = 0;
+  s->m_tx_bs_left = 0;
+  s->m_tx_stmin_us = 0;
+  s->m_tx_next = 0;
+  s->m_rxlen = 0;
+  s->m_rxseq = 0;
+  s->m_rx_bs_count = 0;
+  s->m_deadline = esp_timer_get_time() + s->m_timeout_us;
+  m_sessions.push_back(s);
+  m_requests++;
+
+  uint8_t data[8];
+  size_t len = request.size();
+  if (len <= 7)
+    {
+    // Single frame:
+    data[0] = ISOTP_PCI_SF | len;
+    memcpy(data+1, request.data(), len);
+    s->m_txpos = len;
+    s->m_state = expect_response ? canisotp_session::RxWait : canisotp_session::Done;
+    if (!SendFrame(s, data, 1+len))
+      Finish(s, ISOTP_TXERROR);
+    else if (!expect_response)
+      Finish(s, ISOTP_OK);
+    }
+  else
+    {
+    // First frame:
+    data[0] = ISOTP_PCI_FF | (len >> 8);
+    data[1] = len & 0xff;
+    memcpy(data+2, request.data(), 6);
+    s->m_txpos = 6;
+    s->m_state = canisotp_session::TxWaitFC;
+    if (!SendFrame(s, data, 8))
+      Finish(s, ISOTP_TXERROR);
+    }
+
+  Schedule();
+  m_mutex.Unlock();
+
+  ProcessFinished();
+  return true;
+  }
+
+/**
+ * Request: synchronous variant for tools & scripts
+ *  Blocks until the response has been received or the request failed.
+ *  On failure, response contains the error name.
+ */
+bool canisotp::Request(canbus* bus, uint32_t txid, uint32_t rxid, const std::string& request,
+  std::string& response, uint32_t timeout_ms /*=ISOTP_DEFAULT_TIMEOUT*/)
+  {
+  struct result_t
+    {
+    OvmsSemaphore done;
+    canisotp_status_t status = ISOTP_ABORTED;
+    std::string response;
+    };
+  std::shared_ptr<result_t> result = std::make_shared<result_t>();
+
+  bool started = Request(bus, txid, rxid, request,
+    [result](canbus* bus, uint32_t txid, uint32_t rxid, canisotp_status_t status, const std::string& data)
+      {
+      result->status = status;
+      result->response = data;
+      result->done.Give();
+      }, true, timeout_ms);
+  if (!started)
+    {
+    response = "busy";
+    return false;
+    }
+
+  if (!result->done.Take(pdMS_TO_TICKS(timeout_ms + 1000)))
+    {
+    Cancel(bus, txid, rxid);
+    result->done.Take(pdMS_TO_TICKS(100));
+    }
+
+  if (result->status == ISOTP_OK)
+    {
+    response = result->response;
+    return true;
+    }
+  response = StatusName(result->status);
+  return false;
+  }
+
+bool canisotp::Cancel(canbus* bus, uint32_t txid, uint32_t rxid)
+  {
+  m_mutex.Lock();
+  canisotp_session* s = FindSession(bus, txid, rxid);
+  if (s) Finish(s, ISOTP_ABORTED);
+  m_mutex.Unlock();
+  ProcessFinished();
+  return (s != NULL);
+  }
+
+void canisotp::CancelAll()
+  {
+  m_mutex.Lock();
+  while (!m_sessions.empty())
+    Finish(m_sessions.front(), ISOTP_ABORTED);
+  m_mutex.Unlock();
+  ProcessFinished();
+  }
+
+/**
+ * Drain: cancel all sessions and wait for callbacks running in other tasks
+ *  Call before destroying the objects used by the callbacks.
+ *  (must not be called from a callback)
+ */
+void canisotp::Drain()
+  {
+  CancelAll();
+  for (int i = 0; i < 100; i++)
+    {
+    m_mutex.Lock();
+    int running = m_callbacks;
+    m_mutex.Unlock();
+    if (running == 0) return;
+    vTaskDelay(pdMS_TO_TICKS(10));
+    }
+  ESP_LOGE(TAG, "%s: callbacks still running after 1 second", m_name);
+  }
+
+bool canisotp::IsBusy(canbus* bus, uint32_t txid, uint32_t rxid)
+  {
+  OvmsMutexLock lock(&m_mutex);
+  return (FindSession(bus, txid, rxid) != NULL);
+  }
+
+int canisotp::GetSessionCount()
+  {
+  OvmsMutexLock lock(&m_mutex);
+  return m_sessions.size();
+  }
+
+canisotp_session* canisotp::FindSession(canbus* bus, uint32_t txid, uint32_t rxid)
+  {
+  for (auto it = m_sessions.begin(); it != m_sessions.end(); ++it)
+    {
+    canisotp_session* s = *it;
+    if (s->m_bus == bus && s->m_txid == txid && (s->m_rxid == rxid || (s->m_functional && rxid == 0)))
+      return s;
+    }
+  return NULL;
+  }
+
+canisotp_session* canisotp::FindRxSession(const CAN_frame_t* frame)
+  {
+  bool ext = (frame->FIR.B.FF == CAN_frame_ext);
+  canisotp_session* functional = NULL;
+  for (auto it = m_sessions.begin(); it != m_sessions.end(); ++it)
+    {
+    canisotp_session* s = *it;
+    if (s->m_bus != frame->origin || s->m_extended != ext)
+      continue;
+    if (s->m_rxid == frame->MsgID)
+      return s;
+    if (!functional && s->m_functional && s->m_rxid == 0 && frame->MsgID >= 0x7e8 && frame->MsgID <= 0x7ef)
+      functional = s;
+    }
+  // Physical sessions take precedence over a functional session waiting
+  // for the first response:
+  return functional;
+  }
+
+bool canisotp::SendFrame(canisotp_session* s, const uint8_t* data, uint8_t len)
+  {
+  CAN_frame_t frame;
+  memset(&frame, 0, sizeof(frame));
+  frame.origin = s->m_bus;
+  frame.FIR.B.FF = s->m_extended ? CAN_frame_ext : CAN_frame_std;
+  frame.FIR.B.DLC = 8;
+  frame.MsgID = s->m_txid;
+  memcpy(frame.data.u8, data, len);
+  if (len < 8) memset(frame.data.u8+len, m_padding, 8-len);
+  return (s->m_bus->Write(&frame, 0, CAN_TXPRIO_HIGH) != ESP_FAIL);
+  }
+
+bool canisotp::SendFlowControl(canisotp_session* s, uint8_t status)
+  {
+  uint8_t data[3] = { (uint8_t)(ISOTP_PCI_FC | status), m_fc_bs, m_fc_stmin };
+  CAN_frame_t frame;
+  memset(&frame, 0, sizeof(frame));
+  frame.origin = s->m_bus;
+  frame.FIR.B.FF = s->m_extended ? CAN_frame_ext : CAN_frame_std;
+  frame.FIR.B.DLC = 8;
+  // functional request: send flow control to the physical ECU address
+  frame.MsgID = (s->m_functional) ? s->m_rxid - 8 : s->m_txid;
+  memcpy(frame.data.u8, data, 3);
+  memset(frame.data.u8+3, m_padding, 5);
+  return (s->m_bus->Write(&frame, 0, CAN_TXPRIO_HIGH) != ESP_FAIL);
+  }
+
+/**
+ * SendConsecutive: send consecutive frames of a segmented request
+ *  as far as allowed by the receiver's block size & STmin
+ */
+void canisotp::SendConsecutive(canisotp_session* s, int64_t now)
+  {
+  uint8_t data[8];
+
+  while (s->m_state == canisotp_session::TxSending && s->m_tx_next <= now)
+    {
+    size_t len = s->m_txbuf.size() - s->m_txpos;
+    if (len > 7) len = 7;
+    data[0] = ISOTP_PCI_CF | (s->m_txseq & 0x0f);
+    memcpy(data+1, s->m_txbuf.data() + s->m_txpos, len);
+    if (!SendFrame(s, data, 1+len))
+      {
+      // TX queue full: retry shortly
+      s->m_tx_next = now + 1000;
+      return;
+      }
+    s->m_txpos += len;
+    s->m_txseq++;
+    s->m_deadline = now + s->m_timeout_us;
+
+    if (s->m_txpos >= s->m_txbuf.size())
+      {
+      // Request complete:
+      if (s->m_expect_response)
+        s->m_state = canisotp_session::RxWait;
+      else
+        Finish(s, ISOTP_OK);
+      return;
+      }
+    if (s->m_tx_bs > 0 && --s->m_tx_bs_left == 0)
+      {
+      // Block complete, wait for next flow control:
+      s->m_state = canisotp_session::TxWaitFC;
+      return;
+      }
+    if (s->m_tx_stmin_us > 0)
+      s->m_tx_next = now + s->m_tx_stmin_us;
+    }
+  }
+
+/**
+ * IncomingFrame: process a received frame
+ *  Returns true if the frame belonged to a session.
+ */
+bool canisotp::IncomingFrame(const CAN_frame_t* frame)
+  {
+  if (m_sessions.empty()) return false;
+
+  m_mutex.Lock();
+  canisotp_session* s = FindRxSession(frame);
+  if (s == NULL)
+    {
+    m_mutex.Unlock();
+    return false;
+    }
+
+  int64_t now = esp_timer_get_time();
+  const uint8_t* d = frame->data.u8;
+  uint8_t pci = d[0] & 0xf0;
+
+  switch (pci)
+    {
+    case ISOTP_PCI_FC:
+      if (s->m_state != canisotp_session::TxWaitFC) break;
+      switch (d[0] & 0x0f)
+        {
+        case ISOTP_FC_CTS:
+          s->m_tx_bs = s->m_tx_bs_left = d[1];
+          s->m_tx_stmin_us = DecodeSTmin(d[2]);
+          s->m_tx_next = now;
+          s->m_state = canisotp_session::TxSending;
+          SendConsecutive(s, now);
+          break;
+        case ISOTP_FC_WAIT:
+          s->m_deadline = now + s->m_timeout_us;
+          break;
+        default:
+          Finish(s, ISOTP_OVERFLOW);
+          break;
+        }
+      break;
+
+    case ISOTP_PCI_SF:
+      {
+      if (s->m_state != canisotp_session::RxWait) break;
+      uint8_t len = d[0] & 0x0f;
+      if (len == 0 || len > 7) break;
+      if (s->m_functional) s->m_rxid = frame->MsgID;
+      if (len == 3 && d[1] == 0x7f && d[3] == 0x78)
+        {
+        // UDS response pending: the final response follows within P2*
+        s->m_deadline = now + ISOTP_PENDING_TIMEOUT * 1000;
+        m_pending++;
+        break;
+        }
+      s->m_rxbuf.assign((const char*)d+1, len);
+      Finish(s, ISOTP_OK);
+      break;
+      }
+
+    case ISOTP_PCI_FF:
+      {
+      if (s->m_state != canisotp_session::RxWait) break;
+      size_t len = ((d[0] & 0x0f) << 8) | d[1];
+      if (s->m_functional) s->m_rxid = frame->MsgID;
+      if (len < 8)
+        {
+        SendFlowControl(s, ISOTP_FC_OVFLW);
+        Finish(s, ISOTP_OVERFLOW);
+        break;
+        }
+      s->m_rxlen = len;
+      s->m_rxbuf.clear();
+      s->m_rxbuf.reserve(len);
+      s->m_rxbuf.append((const char*)d+2, 6);
+      s->m_rxseq = 1;
+      s->m_rx_bs_count = 0;
+      s->m_state = canisotp_session::RxReceiving;
+      s->m_deadline = now + s->m_timeout_us;
+      SendFlowControl(s, ISOTP_FC_CTS);
+      break;
+      }
+
+    case ISOTP_PCI_CF:
+      {
+      if (s->m_state != canisotp_session::RxReceiving) break;
+      if ((d[0] & 0x0f) != (s->m_rxseq & 0x0f))
+        {
+        ESP_LOGD(TAG, "%s: %03x sequence error (got %d, expected %d)",
+          m_name, frame->MsgID, d[0] & 0x0f, s->m_rxseq & 0x0f);
+        Finish(s, ISOTP_SEQERROR);
+        break;
+        }
+      size_t len = s->m_rxlen - s->m_rxbuf.size();
+      if (len > 7) len = 7;
+      s->m_rxbuf.append((const char*)d+1, len);
+      s->m_rxseq++;
+      s->m_deadline = now + s->m_timeout_us;
+      if (s->m_rxbuf.size() >= s->m_rxlen)
+        {
+        Finish(s, ISOTP_OK);
+        }
+      else if (m_fc_bs > 0 && ++s->m_rx_bs_count >= m_fc_bs)
+        {
+        s->m_rx_bs_count = 0;
+        SendFlowControl(s, ISOTP_FC_CTS);
+        }
+      break;
+      }
+
+    default:
+      break;
+    }
+
+  Schedule();
+  m_mutex.Unlock();
+
+  ProcessFinished();
+  return true;
+  }
+
+/**
+ * Finish: remove session from active list, callback is done by ProcessFinished()
+ *  (needs to be called with mutex locked)
+ */
+void canisotp::Finish(canisotp_session* s, canisotp_status_t status)
+  {
+  s->m_state = canisotp_session::Done;
+  s->m_status = status;
+  if (status == ISOTP_OK)
+    {
+    if (s->m_expect_response) m_responses++;
+    }
+  else
+    {
+    m_errors++;
+    }
+  m_sessions.remove(s);
+  m_finished.push_back(s);
+  }
+
+/**
+ * ProcessFinished: execute callbacks of finished sessions
+ *  (needs to be called without mutex locked, so callbacks can issue new requests)
+ */
+void canisotp::ProcessFinished()
+  {
+  while (true)
+    {
+    m_mutex.Lock();
+    if (m_finished.empty())
+      {
+      m_mutex.Unlock();
+      return;
+      }
+    canisotp_session* s = m_finished.front();
+    m_finished.pop_front();
+    m_callbacks++;
+    m_mutex.Unlock();
+
+    if (s->m_callback)
+      s->m_callback(s->m_bus, s->m_txid, s->m_rxid, s->m_status, s->m_rxbuf);
+    delete s;
+
+    m_mutex.Lock();
+    m_callbacks--;
+    m_mutex.Unlock();
+    }
+  }
+
+/**
+ * Schedule: arm the timer for the next CF transmission or timeout
+ *  (needs to be called with mutex locked)
+ */
+void canisotp::Schedule()
+  {
+  if (!m_timer) return;
+  esp_timer_stop(m_timer);
+  if (m_sessions.empty()) return;
+
+  int64_t next = INT64_MAX;
+  for (auto it = m_sessions.begin(); it != m_sessions.end(); ++it)
+    {
+    canisotp_session* s = *it;
+    if (s->m_deadline < next) next = s->m_deadline;
+    if (s->m_state == canisotp_session::TxSending && s->m_tx_next < next)
+      next = s->m_tx_next;
+    }
+  int64_t delay = next - esp_timer_get_time();
+  if (delay < 100) delay = 100;
+  esp_timer_start_once(m_timer, delay);
+  }
+
+void canisotp::TimerCallback(void* arg)
+  {
+  ((canisotp*)arg)->Timer();
+  }
+
+void canisotp::Timer()
+  {
+  m_mutex.Lock();
+  int64_t now = esp_timer_get_time();
+  for (auto it = m_sessions.begin(); it != m_sessions.end(); )
+    {
+    canisotp_session* s = *it++;
+    if (s->m_state == canisotp_session::TxSending)
+      SendConsecutive(s, now);
+    if (s->m_state != canisotp_session::Done && s->m_deadline <= now)
+      {
+      ESP_LOGD(TAG, "%s: %03x/%03x timeout in state %d", m_name, s->m_txid, s->m_rxid, s->m_state);
+      Finish(s, ISOTP_TIMEOUT);
+      }
+    }
+  Schedule();
+  m_mutex.Unlock();
+
+  ProcessFinished();
+  }
@@ -0,0 +1,179 @@
+/*
+;    Project:       Open Vehicle Monitor System
+;    Module:        CAN ISO-TP (ISO 15765-2) transport engine
+;    Date:          19th October 2026
+;
+;    (C) 2026       Open Vehicles Project
+;
+; Permission is hereby granted, free of charge, to any person obtaining a copy
+; of this software and associated documentation files (the "Software"), to deal
+; in the Software without restriction, including without limitation the rights
+; to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+; copies of the Software, and to permit persons to whom the Software is
+; furnished to do so, subject to the following conditions:
+;
+; The above copyright notice and this permission notice shall be included in
+; all copies or substantial portions of the Software.
+;
+; THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+; IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+; FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+; AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+; LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+; OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+; THE SOFTWARE.
+*/
+
+#ifndef __CANISOTP_H__
+#define __CANISOTP_H__
+
+#include <string>
+#include <list>
+#include <functional>
+#include "can.h"
+#include "ovms_mutex.h"
+
+/**
+ * canisotp: ISO-TP transport engine
+ *
+ * Runs any number of concurrent request/response sessions, each identified
+ * by (bus, txid, rxid). Requests of any length up to 4095 bytes are sent as
+ * single or segmented messages, honouring the flow control (block size,
+ * STmin) of the receiver. Responses are reassembled into one buffer and
+ * delivered to the session callback, with our own flow control parameters
+ * sent to the ECU (see SetFlowControl()).
+ *
+ * rxid 0 on a standard ID request means functional addressing (e.g. 0x7df):
+ * the first ECU responding in the 0x7e8-0x7ef range takes the session, flow
+ * control is sent to the physical ID (rxid - 8).
+ *
+ * UDS "response pending" replies (7F xx 78) are consumed by the engine,
+ * extending the response timeout to ISOTP_PENDING_TIMEOUT.
+ *
+ * The engine needs to be fed with received frames via IncomingFrame(). The
+ * instance MyCanIsoTp is fed by the CAN framework; owners of private
+ * instances (e.g. the vehicle poller) feed them from their own task.
+ * Response callbacks are executed by the feeding task, timeouts are signaled
+ * from the esp_timer task.
+ */
+
+#define ISOTP_MAXLEN              4095
+#define ISOTP_DEFAULT_TIMEOUT     1000      // response / N_Bs / N_Cr timeout [ms]
+#define ISOTP_PENDING_TIMEOUT     5000      // UDS P2* timeout after "response pending" [ms]
+
+typedef enum
+  {
+  ISOTP_OK = 0,
+  ISOTP_TIMEOUT,              // no (complete) response within timeout
+  ISOTP_OVERFLOW,             // receiver signaled overflow / response too long
+  ISOTP_SEQERROR,             // consecutive frame sequence error
+  ISOTP_TXERROR,              // CAN TX failed
+  ISOTP_ABORTED,              // session cancelled
+  } canisotp_status_t;
+
+class canisotp;
+
+typedef std::function<void(canbus* bus, uint32_t txid, uint32_t rxid,
+  canisotp_status_t status, const std::string& response)> IsoTpCallback;
+
+class canisotp_session
+  {
+  friend class canisotp;
+
+  public:
+    typedef enum
+      {
+      Idle = 0,
+      TxWaitFC,                 // segmented TX: waiting for flow control
+      TxSending,                // segmented TX: sending consecutive frames
+      RxWait,                   // waiting for response single/first frame
+      RxReceiving,              // receiving consecutive frames
+      Done
+      } state_t;
+
+  public:
+    canbus*         m_bus;
+    uint32_t        m_txid;
+    uint32_t        m_rxid;
+    bool            m_functional;     // rxid to be determined from first response
+    bool            m_extended;       // 29 bit IDs
+    state_t         m_state;
+    canisotp_status_t m_status;
+    IsoTpCallback   m_callback;
+    bool            m_expect_response;
+    uint32_t        m_timeout_us;
+
+  protected:
+    std::string     m_txbuf;
+    size_t          m_txpos;
+    uint8_t         m_txseq;
+    uint8_t         m_tx_bs;          // receiver block size (0 = unlimited)
+    uint8_t         m_tx_bs_left;     // frames left in current block
+    uint32_t        m_tx_stmin_us;    // receiver min separation time
+    int64_t         m_tx_next;        // next CF due time [us]
+    std::string     m_rxbuf;
+    size_t          m_rxlen;          // expected response length
+    uint8_t         m_rxseq;
+    uint8_t         m_rx_bs_count;    // frames received in current block
+    int64_t         m_deadline;       // current timeout [us]
+  };
+
+class canisotp : public InternalRamAllocated
+  {
+  public:
+    canisotp(const char* name);
+    virtual ~canisotp();
+
+  public:
+    void SetFlowControl(uint8_t blocksize, uint8_t stmin);
+    void SetPadding(uint8_t padding);
+
+  public:
+    bool Request(canbus* bus, uint32_t txid, uint32_t rxid, const std::string& request,
+      IsoTpCallback callback, bool expect_response=true, uint32_t timeout_ms=ISOTP_DEFAULT_TIMEOUT);
+    bool Request(canbus* bus, uint32_t txid, uint32_t rxid, const std::string& request,
+      std::string& response, uint32_t timeout_ms=ISOTP_DEFAULT_TIMEOUT);
+    bool Cancel(canbus* bus, uint32_t txid, uint32_t rxid);
+    void CancelAll();
+    void Drain();
+    bool IsBusy(canbus* bus, uint32_t txid, uint32_t rxid);
+    int GetSessionCount();
+    bool IncomingFrame(const CAN_frame_t* frame);
+
+  public:
+    static const char* StatusName(canisotp_status_t status);
+    static uint32_t DecodeSTmin(uint8_t stmin);
+
+  protected:
+    canisotp_session* FindSession(canbus* bus, uint32_t txid, uint32_t rxid);
+    canisotp_session* FindRxSession(const CAN_frame_t* frame);
+    bool SendFrame(canisotp_session* s, const uint8_t* data, uint8_t len);
+    bool SendFlowControl(canisotp_session* s, uint8_t status);
+    void SendConsecutive(canisotp_session* s, int64_t now);
+    void Finish(canisotp_session* s, canisotp_status_t status);
+    void ProcessFinished();
+    void Schedule();
+    static void TimerCallback(void* arg);
+    void Timer();
+
+  protected:
+    const char*     m_name;
+    OvmsMutex       m_mutex;
+    std::list<canisotp_session*> m_sessions;
+    std::list<canisotp_session*> m_finished;
+    int             m_callbacks;      // callbacks currently running
+    esp_timer_handle_t m_timer;
+    uint8_t         m_fc_bs;          // our block size
+    uint8_t         m_fc_stmin;       // our STmin
+    uint8_t         m_padding;
+
+  public:
+    uint32_t        m_requests;
+    uint32_t        m_responses;
+    uint32_t        m_errors;
+    uint32_t        m_pending;        // UDS "response pending" extensions
+  };
+
+extern canisotp MyCanIsoTp;
+
+#endif // __CANISOTP_H__
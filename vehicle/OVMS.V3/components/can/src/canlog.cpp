@@ -40,6 +40,7 @@ static const char *TAG = "canlog";
 #include "ovms_command.h"
 #include "ovms_events.h"
 #include "ovms_peripherals.h"
+#include "ovms_malloc.h"
 #include "metrics_standard.h"
 
 ////////////////////////////////////////////////////////////////////////
@@ -168,6 +169,27 @@ canlog::canlog(const char* type, std::string format, canformat::canformat_serve_
   m_dropcount = 0;
   m_filtercount = 0;
 
+  m_changed = NULL;
+  m_changed_size = 0;
+  m_changed_shift = 32;
+  m_changed_used = 0;
+  m_changed_silence = 0;
+  m_suppresscount = 0;
+  if (MyConfig.GetParamValueBool("can", "log.changed", false))
+    {
+    int size = MyConfig.GetParamValueInt("can", "log.changed.ids", 1024);
+    if (size > 8192) size = 8192;
+    m_changed_size = 16;
+    while (m_changed_size < size) m_changed_size <<= 1;
+    for (uint16_t k = m_changed_size; k > 1; k >>= 1) m_changed_shift--;
+    m_changed_silence = MyConfig.GetParamValueInt("can", "log.changed.silence", 10000);
+    m_changed = (canlog_changed_t*)ExternalRamMalloc(m_changed_size * sizeof(canlog_changed_t));
+    if (m_changed)
+      memset(m_changed, 0, m_changed_size * sizeof(canlog_changed_t));
+    else
+      ESP_LOGE(TAG, "Out of memory for change only mode, logging all frames");
+    }
+
   using std::placeholders::_1;
   using std::placeholders::_2;
   MyEvents.RegisterEvent(IDTAG, "*", std::bind(&canlog::EventListener, this, _1, _2));
@@ -217,6 +239,12 @@ canlog::~canlog()
     delete m_filter;
     m_filter = NULL;
     }
+
+  if (m_changed)
+    {
+    free(m_changed);
+    m_changed = NULL;
+    }
   }
 
 void canlog::RxTask(void *context)
@@ -282,6 +310,9 @@ std::string canlog::GetInfo()
     buf << " Filter:off";
     }
 
+  if (m_changed)
+    buf << " Mode:changed(" << m_changed_silence << "ms)";
+
   buf << " Vehicle:" << StdMetrics.ms_v_type->AsString();
 
   return buf.str();
@@ -299,6 +330,14 @@ std::string canlog::GetStats()
     << ", filtered: " << m_filtercount
     << " = " << std::fixed << std::setprecision(1) << droprate << "%";
 
+  if (m_changed)
+    {
+    uint32_t frames = m_msgcount + m_suppresscount;
+    buf << ", suppressed: " << m_suppresscount
+      << " = " << std::fixed << std::setprecision(1)
+      << ((frames > 0) ? ((float) m_suppresscount/frames*100) : 0) << "%";
+    }
+
   if (waiting > 0)
     buf << ", waiting: " << waiting;
 
@@ -323,12 +362,63 @@ void canlog::ClearFilter()
     }
   }
 
+/**
+ * FrameChanged: change only mode filter
+ *  Returns true if the frame payload differs from the last one logged for
+ *  the bus & ID, or the max silence time has passed.
+ *  Note: called by the CAN RX task only, so no locking needed.
+ */
+bool canlog::FrameChanged(canbus* bus, const CAN_frame_t* frame)
+  {
+  uint32_t key = CANLOG_CHANGED_KEY_USED | (frame->MsgID & 0x1fffffff);
+  if (frame->FIR.B.FF == CAN_frame_ext) key |= CANLOG_CHANGED_KEY_EXT;
+  uint8_t busnumber = bus->m_busnumber;
+  uint8_t dlc = (frame->FIR.B.DLC > 8) ? 8 : frame->FIR.B.DLC;
+  uint32_t now = esp_timer_get_time() / 1000;
+
+  uint32_t mask = m_changed_size - 1;
+  uint32_t i = ((key + busnumber) * 2654435761u) >> m_changed_shift;
+  for (uint32_t n = 0; n < m_changed_size; n++, i = (i+1) & mask)
+    {
+    canlog_changed_t* e = &m_changed[i];
+    if (e->key == key && e->bus == busnumber)
+      {
+      if (e->dlc == dlc && memcmp(e->data, frame->data.u8, dlc) == 0
+          && (now - e->time) < m_changed_silence)
+        return false;
+      e->dlc = dlc;
+      memcpy(e->data, frame->data.u8, dlc);
+      e->time = now;
+      return true;
+      }
+    if (e->key == 0)
+      {
+      if (m_changed_used >= m_changed_size * 3 / 4)
+        return true;
+      m_changed_used++;
+      e->key = key;
+      e->bus = busnumber;
+      e->dlc = dlc;
+      memcpy(e->data, frame->data.u8, dlc);
+      e->time = now;
+      return true;
+      }
+    }
+  return true;
+  }
+
 void canlog::LogFrame(canbus* bus, CAN_log_type_t type, const CAN_frame_t* frame)
   {
   if (!IsOpen() || !bus || !frame) return;
 
   if ((m_filter == NULL)||(m_filter->IsFiltered(frame)))
     {
+    if (m_changed && (type == CAN_LogFrame_RX || type == CAN_LogFrame_TX)
+        && !FrameChanged(bus, frame))
+      {
+      m_suppresscount++;
+      return;
+      }
     CAN_log_message_t msg;
     msg.type = type;
     gettimeofday(&msg.timestamp,NULL);
@@ -50,7 +50,25 @@
  * Note: loggers get messages for all interfaces, if a log format does not
  *  allow multiple buses within a file, the logger needs to manage a set
  *  of files or may return false on Open() without a bus filter.
+ *
+ * Change only mode (config "can log.changed"): received & transmitted frames
+ *  are only logged if their payload differs from the last frame logged for
+ *  the same bus & ID, or if "log.changed.silence" milliseconds have passed
+ *  since. The last payloads are kept in an open addressed hash table of
+ *  "log.changed.ids" slots (IDs not fitting in are always logged).
  */
+
+typedef struct
+  {
+  uint32_t key;             // ID | flags, 0 = free slot
+  uint32_t time;            // time logged [ms]
+  uint8_t bus;              // bus number
+  uint8_t dlc;
+  uint8_t data[8];
+  } canlog_changed_t;
+
+#define CANLOG_CHANGED_KEY_USED   0x80000000
+#define CANLOG_CHANGED_KEY_EXT    0x40000000
 class canlog : public InternalRamAllocated
   {
   public:
@@ -78,6 +96,9 @@ class canlog : public InternalRamAllocated
     virtual void SetFilter(canfilter* filter);
     virtual void ClearFilter();
 
+  protected:
+    bool FrameChanged(canbus* bus, const CAN_frame_t* frame);
+
   public:
     // Logging API:
     virtual void LogFrame(canbus* bus, CAN_log_type_t type, const CAN_frame_t* p_frame);
@@ -88,6 +109,7 @@ class canlog : public InternalRamAllocated
     const char*         m_type;
     std::string         m_format;
     canformat*          m_formatter;
+    std::string         m_outbuf;           // formatter output, reused by OutputMsg()
     canfilter*          m_filter;
 
   public:
@@ -96,6 +118,14 @@ class canlog : public InternalRamAllocated
     uint32_t            m_msgcount;
     uint32_t            m_dropcount;
     uint32_t            m_filtercount;
+
+  public:
+    canlog_changed_t*   m_changed;          // change only mode payload table, NULL = off
+    uint16_t            m_changed_size;
+    uint8_t             m_changed_shift;
+    uint16_t            m_changed_used;
+    uint32_t            m_changed_silence;  // max silence [ms]
+    uint32_t            m_suppresscount;
   };
 
 #endif // __CANLOG_H__
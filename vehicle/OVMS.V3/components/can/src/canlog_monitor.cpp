@@ -106,8 +106,8 @@ void canlog_monitor::OutputMsg(CAN_log_message_t& msg)
   {
   if (m_formatter == NULL) return;
 
-  std::string result = m_formatter->get(&msg);
-  if (result.length()>0)
+  m_outbuf.clear();
+  if (m_formatter->get(&msg, m_outbuf) > 0)
     {
     switch (msg.type)
       {
@@ -115,16 +115,16 @@ void canlog_monitor::OutputMsg(CAN_log_message_t& msg)
       case CAN_LogFrame_TX:
       case CAN_LogFrame_TX_Queue:
       case CAN_LogFrame_TX_Fail:
-        ESP_LOGV(TAG,"%s",result.c_str());
+        ESP_LOGV(TAG,"%s",m_outbuf.c_str());
         break;
       case CAN_LogStatus_Error:
-        ESP_LOGE(TAG,"%s",result.c_str());
+        ESP_LOGE(TAG,"%s",m_outbuf.c_str());
         break;
       case CAN_LogStatus_Statistics:
       case CAN_LogInfo_Comment:
       case CAN_LogInfo_Config:
       case CAN_LogInfo_Event:
-        ESP_LOGD(TAG,"%s",result.c_str());
+        ESP_LOGD(TAG,"%s",m_outbuf.c_str());
         break;
       default:
         break;
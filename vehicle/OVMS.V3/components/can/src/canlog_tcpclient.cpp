@@ -214,13 +214,13 @@ void canlog_tcpclient::OutputMsg(CAN_log_message_t& msg)
 
   if ((m_mgconn != NULL)&&(m_isopen))
     {
-    std::string result = m_formatter->get(&msg);
-    if (result.length()>0)
+    m_outbuf.clear();
+    if (m_formatter->get(&msg, m_outbuf) > 0)
       {
       OvmsMutexLock lock(&m_mgmutex);
       if (m_mgconn->send_mbuf.len < 4096)
         {
-        mg_send(m_mgconn, (const char*)result.c_str(), result.length());
+        mg_send(m_mgconn, m_outbuf.data(), m_outbuf.length());
         }
       else
         {
@@ -35,6 +35,14 @@ static const char *TAG = "canlog-tcpserver";
 #include "canlog_tcpserver.h"
 #include "ovms_config.h"
 #include "ovms_peripherals.h"
+#include "ovms.h"
+#include "ovms_malloc.h"
+#include <sys/param.h>
+#include <sstream>
+#include <iomanip>
+
+// Limit the per client mongoose output queue, everything beyond stays in the ring:
+#define TS_SENDQUEUE_MAX    4096
 
 canlog_tcpserver* MyCanLogTcpServer = NULL;
 
@@ -155,6 +163,15 @@ canlog_tcpserver::canlog_tcpserver(std::string path, std::string format, canform
   m_isopen = false;
   m_mgconn = NULL;
 
+  // Ring buffer size must be a power of two for stream offset wrapping:
+  uint32_t size = MyConfig.GetParamValueInt("can", "tcpserver.buffer", 32) * 1024;
+  m_ringsize = 4096;
+  while (m_ringsize < size && m_ringsize < 1024*1024) m_ringsize <<= 1;
+  m_ring = (uint8_t*)ExternalRamMalloc(m_ringsize);
+  m_head = 0;
+  m_lagpolicy = (MyConfig.GetParamValue("can", "tcpserver.lag", "skip") == "disconnect")
+    ? LagDisconnect : LagSkip;
+
   if (m_formatter)
     {
     m_formatter->SetPutCallback(tsPutCallback);
@@ -165,6 +182,11 @@ canlog_tcpserver::~canlog_tcpserver()
   {
   Close();
   MyCanLogTcpServer = NULL;
+  if (m_ring)
+    {
+    free(m_ring);
+    m_ring = NULL;
+    }
   }
 
 bool canlog_tcpserver::Open()
@@ -231,30 +253,124 @@ std::string canlog_tcpserver::GetInfo()
   std::string result = canlog::GetInfo();
   result.append(" Path:");
   result.append(m_path);
+  result.append(" Lag:");
+  result.append((m_lagpolicy == LagDisconnect) ? "disconnect" : "skip");
   return result;
   }
 
+std::string canlog_tcpserver::GetStats()
+  {
+  std::ostringstream buf;
+  buf << canlog::GetStats();
+
+  OvmsMutexLock lock(&m_mgmutex);
+  for (ts_map_t::iterator it=m_smap.begin(); it!=m_smap.end(); ++it)
+    {
+    ts_client_t& c = it->second;
+    uint32_t secs = MAX(1, monotonictime - c.connected);
+    buf << "\n    client " << c.addr
+      << ": sent " << c.sentmsgs << " msgs / " << c.sentbytes << " bytes"
+      << " = " << std::fixed << std::setprecision(1) << (float)c.sentbytes / secs / 1024 << " kB/s"
+      << ", lost " << c.lostmsgs << " msgs in " << c.skips << " skips"
+      << ", lag " << (m_head - c.cursor) << " bytes";
+    }
+
+  return buf.str();
+  }
+
+void canlog_tcpserver::RingRead(uint32_t pos, uint8_t* dst, size_t len)
+  {
+  pos &= (m_ringsize-1);
+  size_t first = MIN(len, m_ringsize-pos);
+  memcpy(dst, m_ring+pos, first);
+  if (first < len) memcpy(dst+first, m_ring, len-first);
+  }
+
+uint32_t canlog_tcpserver::CountRecords(uint32_t from, uint32_t to)
+  {
+  uint32_t count = 0;
+  uint8_t lb[2];
+  while (from != to)
+    {
+    RingRead(from, lb, 2);
+    from += 2 + (lb[0] | (lb[1] << 8));
+    count++;
+    }
+  return count;
+  }
+
+void canlog_tcpserver::FlushClient(mg_connection* nc, ts_client_t& client)
+  {
+  uint8_t lb[2];
+
+  if (client.closing) return;
+
+  // Send whole records only, so skipping never cuts a record:
+  while (client.cursor != m_head && nc->send_mbuf.len < TS_SENDQUEUE_MAX)
+    {
+    RingRead(client.cursor, lb, 2);
+    size_t len = lb[0] | (lb[1] << 8);
+    uint32_t pos = (client.cursor + 2) & (m_ringsize-1);
+    size_t first = MIN(len, m_ringsize-pos);
+    mg_send(nc, m_ring+pos, first);
+    if (first < len) mg_send(nc, m_ring, len-first);
+    client.cursor += 2 + len;
+    client.sentmsgs++;
+    client.sentbytes += len;
+    }
+  }
+
 void canlog_tcpserver::OutputMsg(CAN_log_message_t& msg)
   {
-  if (m_formatter == NULL) return;
+  if (m_formatter == NULL || m_ring == NULL) return;
 
-  std::string result = m_formatter->get(&msg);
-  if (result.length()>0)
+  // Format once for all clients:
+  m_outbuf.clear();
+  size_t len = m_formatter->get(&msg, m_outbuf);
+  if (len == 0) return;
+  if (len > 0xffff || len+2 > m_ringsize)
     {
-    OvmsMutexLock lock(&m_mgmutex);
-    for (ts_map_t::iterator it=m_smap.begin(); it!=m_smap.end(); ++it)
+    m_dropcount++;
+    return;
+    }
+
+  OvmsMutexLock lock(&m_mgmutex);
+  if (m_smap.empty()) return;
+
+  // Handle clients that would lose unsent records by this write:
+  uint32_t newhead = m_head + 2 + len;
+  for (ts_map_t::iterator it=m_smap.begin(); it!=m_smap.end(); ++it)
+    {
+    ts_client_t& c = it->second;
+    if (c.closing || newhead - c.cursor <= m_ringsize) continue;
+    c.lostmsgs += CountRecords(c.cursor, m_head);
+    c.skips++;
+    c.cursor = m_head;
+    if (m_lagpolicy == LagDisconnect)
       {
-      if (it->first->send_mbuf.len < 4096)
-        {
-        // Limit to 4KB queue on output buffer
-        mg_send(it->first, (const char*)result.c_str(), result.length());
-        }
-      else
-        {
-        m_dropcount++;
-        }
+      ESP_LOGW(TAG, "Log service client %s lagging, disconnecting", c.addr.c_str());
+      it->first->flags |= MG_F_CLOSE_IMMEDIATELY;
+      c.closing = true;
       }
     }
+
+  // Store record:
+  uint8_t lb[2] = { (uint8_t)(len & 0xff), (uint8_t)(len >> 8) };
+  const uint8_t* src[2] = { lb, (const uint8_t*)m_outbuf.data() };
+  size_t srclen[2] = { 2, len };
+  for (int k=0; k<2; k++)
+    {
+    uint32_t pos = m_head & (m_ringsize-1);
+    size_t first = MIN(srclen[k], m_ringsize-pos);
+    memcpy(m_ring+pos, src[k], first);
+    if (first < srclen[k]) memcpy(m_ring, src[k]+first, srclen[k]-first);
+    m_head += srclen[k];
+    }
+
+  for (ts_map_t::iterator it=m_smap.begin(); it!=m_smap.end(); ++it)
+    {
+    FlushClient(it->first, it->second);
+    }
   }
 
 void canlog_tcpserver::MongooseHandler(struct mg_connection *nc, int ev, void *p)
@@ -270,7 +386,12 @@ void canlog_tcpserver::MongooseHandler(struct mg_connection *nc, int ev, void *p
       // New network connection has arrived
       mg_sock_addr_to_str(&nc->sa, addr, sizeof(addr), MG_SOCK_STRINGIFY_IP);
       ESP_LOGI(TAG, "Log service connection from %s",addr);
-      m_smap[nc] = 1;
+      ts_client_t& c = m_smap[nc];
+      c.addr = addr;
+      c.cursor = m_head;
+      c.connected = monotonictime;
+      c.sentmsgs = c.sentbytes = c.lostmsgs = c.skips = 0;
+      c.closing = false;
       if (m_formatter != NULL)
         {
         std::string result = m_formatter->getheader();
@@ -288,13 +409,25 @@ void canlog_tcpserver::MongooseHandler(struct mg_connection *nc, int ev, void *p
       auto k = m_smap.find(nc);
       if (k != m_smap.end())
         {
-        mg_sock_addr_to_str(&nc->sa, addr, sizeof(addr), MG_SOCK_STRINGIFY_IP);
-        ESP_LOGI(TAG, "Log service disconnection from %s",addr);
+        ESP_LOGI(TAG, "Log service disconnection from %s: sent %u msgs, lost %u msgs in %u skips",
+          k->second.addr.c_str(), k->second.sentmsgs, k->second.lostmsgs, k->second.skips);
         m_smap.erase(k);
         }
       break;
       }
 
+    case MG_EV_SEND:
+    case MG_EV_POLL:
+      {
+      // Output queue drained: continue sending from the ring
+      auto k = m_smap.find(nc);
+      if (k != m_smap.end())
+        {
+        FlushClient(nc, k->second);
+        }
+      break;
+      }
+
     case MG_EV_RECV:
       {
       // Receive data on the network connection
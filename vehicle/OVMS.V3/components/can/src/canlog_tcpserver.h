@@ -51,16 +51,51 @@ class canlog_tcpserver : public canlog
   public:
     virtual void OutputMsg(CAN_log_message_t& msg);
 
+    virtual std::string GetStats();
+
   public:
     void MongooseHandler(struct mg_connection *nc, int ev, void *p);
 
   public:
-    typedef std::map<mg_connection*, uint8_t> ts_map_t;
+    // Formatted output is stored once in a shared ring buffer as
+    // length prefixed records, each client has its own read cursor
+    // into the ring. Clients falling behind by more than the ring size
+    // are skipped ahead or disconnected, depending on the lag policy.
+    typedef enum
+      {
+      LagSkip = 0,              // skip lagging client ahead to the newest record
+      LagDisconnect             // disconnect lagging client
+      } lag_policy_t;
+
+    typedef struct
+      {
+      std::string addr;         // client address
+      uint32_t cursor;          // ring read position (stream offset)
+      uint32_t connected;       // monotonictime of connect
+      uint32_t sentmsgs;        // records sent
+      uint32_t sentbytes;       // bytes sent
+      uint32_t lostmsgs;        // records lost by skipping
+      uint32_t skips;           // number of skips
+      bool closing;             // disconnect requested
+      } ts_client_t;
+
+    typedef std::map<mg_connection*, ts_client_t> ts_map_t;
     OvmsMutex m_mgmutex;
     ts_map_t m_smap;
     bool m_isopen;
     struct mg_connection *m_mgconn;
 
+  protected:
+    void FlushClient(mg_connection* nc, ts_client_t& client);
+    uint32_t CountRecords(uint32_t from, uint32_t to);
+    void RingRead(uint32_t pos, uint8_t* dst, size_t len);
+
+  protected:
+    uint8_t*            m_ring;
+    uint32_t            m_ringsize;
+    uint32_t            m_head;         // ring write position (stream offset)
+    lag_policy_t        m_lagpolicy;
+
   public:
     std::string         m_path;
   };
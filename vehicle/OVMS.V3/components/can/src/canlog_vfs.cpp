@@ -183,7 +183,7 @@ void canlog_vfs::OutputMsg(CAN_log_message_t& msg)
   if (m_file == NULL) return;
   if (m_formatter == NULL) return;
 
-  std::string result = m_formatter->get(&msg);
-  if (result.length()>0)
-    fwrite(result.c_str(),result.length(),1,m_file);
+  m_outbuf.clear();
+  if (m_formatter->get(&msg, m_outbuf) > 0)
+    fwrite(m_outbuf.data(),m_outbuf.length(),1,m_file);
   }
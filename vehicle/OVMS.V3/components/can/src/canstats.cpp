@@ -0,0 +1,503 @@
+/*
+;    Project:       Open Vehicle Monitor System
+;    Module:        CAN bus load & traffic statistics
+;    Date:          19th October 2026
+;
+;    (C) 2026       Open Vehicles Project
+;
+; Permission is hereby granted, free of charge, to any person obtaining a copy
+; of this software and associated documentation files (the "Software"), to deal
+; in the Software without restriction, including without limitation the rights
+; to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+; copies of the Software, and to permit persons to whom the Software is
+; furnished to do so, subject to the following conditions:
+;
+; The above copyright notice and this permission notice shall be included in
+; all copies or substantial portions of the Software.
+;
+; THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+; IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+; FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+; AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+; LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+; OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+; THE SOFTWARE.
+*/
+
+#include "ovms_log.h"
+static const char *TAG = "canstats";
+
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "canstats.h"
+#include "ovms_config.h"
+#include "ovms_events.h"
+#include "ovms_malloc.h"
+#include "metrics_standard.h"
+#include "ovms_peripherals.h"
+
+canstats MyCanStats __attribute__ ((init_priority (4516)));
+
+////////////////////////////////////////////////////////////////////////
+// Shell commands
+////////////////////////////////////////////////////////////////////////
+
+static int can_stats_busnumber(OvmsWriter* writer, const char* name)
+  {
+  canbus* bus = (canbus*)MyPcpApp.FindDeviceByName(name);
+  if (bus == NULL)
+    {
+    writer->puts("Error: Cannot find named CAN bus");
+    return -1;
+    }
+  return bus->m_busnumber;
+  }
+
+void can_stats_status(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  MyCanStats.Status(writer);
+  }
+
+void can_stats_ids(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  int busnumber = can_stats_busnumber(writer, argv[0]);
+  if (busnumber < 0) return;
+  bool quietonly = (argc > 1 && strcmp(argv[1], "quiet") == 0);
+  MyCanStats.ListIds(writer, busnumber, quietonly);
+  }
+
+void can_stats_json(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  int busnumber = -1;
+  if (argc > 0)
+    {
+    busnumber = can_stats_busnumber(writer, argv[0]);
+    if (busnumber < 0) return;
+    }
+  writer->puts(MyCanStats.GetJSON(busnumber).c_str());
+  }
+
+void can_stats_reset(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  int busnumber = -1;
+  if (argc > 0)
+    {
+    busnumber = can_stats_busnumber(writer, argv[0]);
+    if (busnumber < 0) return;
+    }
+  MyCanStats.Reset(busnumber);
+  writer->puts("CAN statistics reset");
+  }
+
+////////////////////////////////////////////////////////////////////////
+// canstats
+////////////////////////////////////////////////////////////////////////
+
+canstats::canstats()
+  {
+  ESP_LOGI(TAG, "Initialising CAN statistics (4516)");
+
+  for (int k=0; k<CAN_MAXBUSES; k++)
+    m_bus[k] = NULL;
+  memset(m_metrics, 0, sizeof(m_metrics));
+  m_tablesize = 0;    // enabled on config mount
+
+  OvmsCommand* cmd_can = MyCommandApp.FindCommand("can");
+  if (cmd_can)
+    {
+    OvmsCommand* cmd_stats = cmd_can->RegisterCommand("stats", "CAN statistics framework");
+    cmd_stats->RegisterCommand("status", "Show bus load & traffic summary", can_stats_status);
+    cmd_stats->RegisterCommand("ids", "Show per ID statistics", can_stats_ids,
+      "<bus> [quiet]\nquiet = only list IDs that went quiet", 1, 2);
+    cmd_stats->RegisterCommand("json", "Output statistics as JSON", can_stats_json, "[<bus>]", 0, 1);
+    cmd_stats->RegisterCommand("reset", "Reset statistics", can_stats_reset, "[<bus>]", 0, 1);
+    }
+
+  MyCan.RegisterCallback(TAG, [this](const CAN_frame_t* frame, bool success)
+    {
+    Count(frame, false);
+    });
+  MyCan.RegisterCallback(TAG, [this](const CAN_frame_t* frame, bool success)
+    {
+    if (success) Count(frame, true);
+    }, true);
+
+  using std::placeholders::_1;
+  using std::placeholders::_2;
+  MyEvents.RegisterEvent(TAG, "ticker.1", std::bind(&canstats::Ticker1, this, _1, _2));
+  MyEvents.RegisterEvent(TAG, "config.mounted", std::bind(&canstats::ConfigChanged, this, _1, _2));
+  MyEvents.RegisterEvent(TAG, "config.changed", std::bind(&canstats::ConfigChanged, this, _1, _2));
+  }
+
+canstats::~canstats()
+  {
+  MyCan.DeregisterCallback(TAG);
+  MyEvents.DeregisterEvent(TAG);
+  for (int k=0; k<CAN_MAXBUSES; k++)
+    FreeBus(k);
+  }
+
+void canstats::ConfigChanged(std::string event, void* data)
+  {
+  if (event == "config.changed")
+    {
+    OvmsConfigParam* param = (OvmsConfigParam*) data;
+    if (!param || param->GetName() != "can") return;
+    }
+
+  int size = MyConfig.GetParamValueInt("can", "stats.ids", CANSTATS_DEFAULT_IDS);
+  uint16_t tablesize = 0;
+  if (size > 0)
+    {
+    if (size > 4096) size = 4096;
+    tablesize = 16;
+    while (tablesize < size) tablesize <<= 1;
+    }
+  if (tablesize == m_tablesize) return;
+
+  OvmsMutexLock lock(&m_mutex);
+  for (int k=0; k<CAN_MAXBUSES; k++)
+    FreeBus(k);
+  m_tablesize = tablesize;
+  ESP_LOGI(TAG, "Per ID statistics: %d slots per bus", m_tablesize);
+  }
+
+canstats_bus_t* canstats::NewBus(canbus* bus)
+  {
+  canstats_bus_t* b = new canstats_bus_t;
+  memset(b, 0, sizeof(*b));
+  b->table = (canstats_id_t*)ExternalRamMalloc(m_tablesize * sizeof(canstats_id_t));
+  if (b->table == NULL)
+    {
+    ESP_LOGE(TAG, "%s: out of memory for %d ID slots", bus->GetName(), m_tablesize);
+    delete b;
+    return NULL;
+    }
+  memset(b->table, 0, m_tablesize * sizeof(canstats_id_t));
+  b->bus = bus;
+  b->size = m_tablesize;
+  b->shift = 32;
+  for (uint16_t s = m_tablesize; s > 1; s >>= 1) b->shift--;
+  b->interval_start = esp_timer_get_time();
+  m_bus[bus->m_busnumber] = b;
+  return b;
+  }
+
+void canstats::FreeBus(int busnumber)
+  {
+  canstats_bus_t* b = m_bus[busnumber];
+  if (b == NULL) return;
+  // Note: metrics are kept in m_metrics, they will go stale
+  m_bus[busnumber] = NULL;
+  free(b->table);
+  delete b;
+  }
+
+void canstats::Reset(int busnumber /*=-1*/)
+  {
+  OvmsMutexLock lock(&m_mutex);
+  for (int k=0; k<CAN_MAXBUSES; k++)
+    {
+    canstats_bus_t* b = m_bus[k];
+    if (b == NULL || (busnumber >= 0 && k != busnumber)) continue;
+    memset(b->table, 0, b->size * sizeof(canstats_id_t));
+    b->used = 0;
+    b->untracked = 0;
+    b->frames_rx = b->frames_tx = 0;
+    b->bits = 0;
+    b->frames = 0;
+    b->interval_start = esp_timer_get_time();
+    b->load = b->load_peak = 0;
+    b->fps = 0;
+    b->quiet = 0;
+    }
+  }
+
+/**
+ * FrameBits: estimate the bus time of a frame in bits
+ *  Standard frame: 47 + 8*DLC bits incl. 3 bit interframe space, 34 + 8*DLC
+ *  bits subject to stuffing. Extended frame: 67 + 8*DLC, 54 + 8*DLC.
+ *  Worst case stuffing adds (n-1)/4 bits, we use half of that as the
+ *  average estimate.
+ */
+uint32_t canstats::FrameBits(const CAN_frame_t* frame)
+  {
+  uint32_t databits = (frame->FIR.B.RTR == CAN_RTR) ? 0 : 8 * std::min((int)frame->FIR.B.DLC, 8);
+  if (frame->FIR.B.FF == CAN_frame_ext)
+    return 67 + databits + (53 + databits) / 8;
+  else
+    return 47 + databits + (33 + databits) / 8;
+  }
+
+bool canstats::IsQuiet(const canstats_id_t* entry, int64_t now)
+  {
+  if (entry->count < 3) return false;
+  int64_t limit = (int64_t)entry->period * CANSTATS_QUIET_FACTOR;
+  if (limit < CANSTATS_QUIET_MIN) limit = CANSTATS_QUIET_MIN;
+  return (now - entry->last > limit);
+  }
+
+canstats_id_t* canstats::Lookup(canstats_bus_t* b, uint32_t key)
+  {
+  uint32_t mask = b->size - 1;
+  uint32_t i = (key * 2654435761u) >> b->shift;
+  for (uint32_t n = 0; n < b->size; n++, i = (i+1) & mask)
+    {
+    canstats_id_t* e = &b->table[i];
+    if (e->key == key)
+      return e;
+    if (e->key == 0)
+      {
+      if (b->used >= CANSTATS_MAXFILL(b->size))
+        return NULL;
+      e->key = key;
+      b->used++;
+      return e;
+      }
+    }
+  return NULL;
+  }
+
+/**
+ * Count: account a frame received or sent
+ *  (called by the CAN RX task)
+ */
+void canstats::Count(const CAN_frame_t* frame, bool tx)
+  {
+  canbus* bus = frame->origin;
+  if (m_tablesize == 0 || bus == NULL || bus->m_busnumber < 0 || bus->m_busnumber >= CAN_MAXBUSES)
+    return;
+  int64_t now = esp_timer_get_time();
+
+  OvmsMutexLock lock(&m_mutex);
+  canstats_bus_t* b = m_bus[bus->m_busnumber];
+  if (b == NULL && (b = NewBus(bus)) == NULL)
+    return;
+
+  b->bits += FrameBits(frame);
+  b->frames++;
+  if (tx) b->frames_tx++; else b->frames_rx++;
+
+  uint32_t key = CANSTATS_KEY_USED | (frame->MsgID & 0x1fffffff)
+    | ((frame->FIR.B.FF == CAN_frame_ext) ? CANSTATS_KEY_EXT : 0);
+  canstats_id_t* e = Lookup(b, key);
+  if (e == NULL)
+    {
+    b->untracked++;
+    return;
+    }
+
+  if (e->count > 0)
+    {
+    int64_t period = now - e->last;
+    if (period > UINT32_MAX) period = UINT32_MAX;
+    if (e->count == 1)
+      {
+      e->period = period;
+      }
+    else
+      {
+      int64_t dev = period - (int64_t)e->period;
+      e->period += dev / 8;
+      e->jitter += ((dev < 0 ? -dev : dev) - (int64_t)e->jitter) / 8;
+      }
+    }
+  e->count++;
+  e->last = now;
+  e->tx = tx;
+  e->dlc = frame->FIR.B.DLC;
+  memcpy(e->data, frame->data.u8, 8);
+  }
+
+void canstats::Ticker1(std::string event, void* data)
+  {
+  if (m_tablesize == 0) return;
+
+  for (int k=0; k<CAN_MAXBUSES; k++)
+    {
+    float load, load_peak;
+    int fps, ids, quiet;
+    canbus* bus;
+
+    m_mutex.Lock();
+    canstats_bus_t* b = m_bus[k];
+    if (b == NULL)
+      {
+      m_mutex.Unlock();
+      continue;
+      }
+    int64_t now = esp_timer_get_time();
+    int64_t dt = now - b->interval_start;
+    if (dt <= 0)
+      {
+      m_mutex.Unlock();
+      continue;
+      }
+    if (b->bus->m_mode == CAN_MODE_OFF)
+      b->load = 0;
+    else
+      b->load = (float)b->bits * 100.0e6 / ((float)MAP_CAN_SPEED(b->bus->m_speed) * dt);
+    if (b->load > b->load_peak)
+      b->load_peak = b->load;
+    b->fps = (uint64_t)b->frames * 1000000 / dt;
+    b->bits = 0;
+    b->frames = 0;
+    b->interval_start = now;
+    b->quiet = 0;
+    for (int i=0; i<b->size; i++)
+      {
+      if (b->table[i].key && IsQuiet(&b->table[i], now))
+        b->quiet++;
+      }
+    load = b->load;
+    load_peak = b->load_peak;
+    fps = b->fps;
+    ids = b->used;
+    quiet = b->quiet;
+    bus = b->bus;
+    m_mutex.Unlock();
+    // b may be freed by ConfigChanged() from here on
+
+    // Metrics are only created for buses with traffic, the names
+    // are kept for the metrics lifetime (i.e. never freed):
+    canstats_metrics_t* m = &m_metrics[k];
+    if (m->m_load == NULL)
+      {
+      std::string prefix = std::string("m.can.") + bus->GetName();
+      m->m_load = MyMetrics.InitFloat(strdup((prefix + ".load").c_str()), SM_STALE_MIN, 0, Percentage);
+      m->m_load_peak = MyMetrics.InitFloat(strdup((prefix + ".load.peak").c_str()), SM_STALE_MIN, 0, Percentage);
+      m->m_fps = MyMetrics.InitInt(strdup((prefix + ".fps").c_str()), SM_STALE_MIN, 0);
+      m->m_ids = MyMetrics.InitInt(strdup((prefix + ".ids").c_str()), SM_STALE_MIN, 0);
+      m->m_quiet = MyMetrics.InitInt(strdup((prefix + ".ids.quiet").c_str()), SM_STALE_MIN, 0);
+      }
+    m->m_load->SetValue(load);
+    m->m_load_peak->SetValue(load_peak);
+    m->m_fps->SetValue(fps);
+    m->m_ids->SetValue(ids);
+    m->m_quiet->SetValue(quiet);
+    }
+  }
+
+void canstats::Status(OvmsWriter* writer)
+  {
+  if (m_tablesize == 0)
+    {
+    writer->puts("CAN statistics disabled (config can stats.ids = 0)");
+    return;
+    }
+
+  OvmsMutexLock lock(&m_mutex);
+  int cnt = 0;
+  for (int k=0; k<CAN_MAXBUSES; k++)
+    {
+    canstats_bus_t* b = m_bus[k];
+    if (b == NULL) continue;
+    if (cnt++ == 0)
+      writer->puts("Bus   Speed  Load%  Peak%  Frames/s  RX frames  TX frames   IDs  Quiet  Untracked");
+    writer->printf("%-4s %6d %6.1f %6.1f %9u %10u %10u %5u %6u %10u\n",
+      b->bus->GetName(), MAP_CAN_SPEED(b->bus->m_speed) / 1000,
+      b->load, b->load_peak, b->fps, b->frames_rx, b->frames_tx,
+      b->used, b->quiet, b->untracked);
+    }
+  if (cnt == 0)
+    writer->puts("No CAN traffic seen yet");
+  }
+
+void canstats::ListIds(OvmsWriter* writer, int busnumber, bool quietonly)
+  {
+  std::vector<canstats_id_t> list;
+  int64_t now = esp_timer_get_time();
+
+  m_mutex.Lock();
+  canstats_bus_t* b = m_bus[busnumber];
+  if (b)
+    {
+    list.reserve(b->used);
+    for (int i=0; i<b->size; i++)
+      {
+      if (b->table[i].key && (!quietonly || IsQuiet(&b->table[i], now)))
+        list.push_back(b->table[i]);
+      }
+    }
+  m_mutex.Unlock();
+
+  if (list.empty())
+    {
+    writer->puts(quietonly ? "No quiet IDs" : "No IDs seen");
+    return;
+    }
+
+  std::sort(list.begin(), list.end(), [](const canstats_id_t& a, const canstats_id_t& b)
+    {
+    return (a.key & ~CANSTATS_KEY_USED) < (b.key & ~CANSTATS_KEY_USED);
+    });
+
+  writer->puts("      ID     Count  Period ms  Jitter ms    Age ms  Data");
+  for (auto& e : list)
+    {
+    char data[3*8+1] = "";
+    int dlc = std::min((int)e.dlc, 8);
+    for (int i=0; i<dlc; i++)
+      sprintf(data+3*i, "%02x ", e.data[i]);
+    writer->printf("%8x%s %8u %10.1f %10.1f %9d  %s%s%s\n",
+      e.key & 0x1fffffff, (e.key & CANSTATS_KEY_EXT) ? "x" : " ",
+      e.count, (float)e.period / 1000, (float)e.jitter / 1000,
+      (int)((now - e.last) / 1000), data, e.tx ? "(tx) " : "",
+      IsQuiet(&e, now) ? "QUIET" : "");
+    }
+  writer->printf("%d IDs\n", (int)list.size());
+  }
+
+/**
+ * GetJSON: statistics for the web UI
+ *  busnumber -1 = all buses, ids = include per ID statistics
+ */
+std::string canstats::GetJSON(int busnumber /*=-1*/, bool ids /*=true*/)
+  {
+  std::string json;
+  char buf[160];
+  int64_t now = esp_timer_get_time();
+
+  OvmsMutexLock lock(&m_mutex);
+  json = "{";
+  int cnt = 0;
+  for (int k=0; k<CAN_MAXBUSES; k++)
+    {
+    canstats_bus_t* b = m_bus[k];
+    if (b == NULL || (busnumber >= 0 && k != busnumber)) continue;
+    snprintf(buf, sizeof(buf),
+      "%s\"%s\":{\"speed\":%d,\"load\":%.1f,\"load_peak\":%.1f,\"fps\":%u,"
+      "\"rx\":%u,\"tx\":%u,\"quiet\":%u,\"untracked\":%u",
+      cnt++ ? "," : "", b->bus->GetName(), MAP_CAN_SPEED(b->bus->m_speed),
+      b->load, b->load_peak, b->fps, b->frames_rx, b->frames_tx, b->quiet, b->untracked);
+    json.append(buf);
+    if (ids)
+      {
+      json.append(",\"ids\":[");
+      int n = 0;
+      for (int i=0; i<b->size; i++)
+        {
+        canstats_id_t* e = &b->table[i];
+        if (!e->key) continue;
+        snprintf(buf, sizeof(buf),
+          "%s{\"id\":%u,\"ext\":%s,\"count\":%u,\"period\":%.1f,\"jitter\":%.1f,"
+          "\"age\":%d,\"quiet\":%s,\"data\":\"",
+          n++ ? "," : "", e->key & 0x1fffffff, (e->key & CANSTATS_KEY_EXT) ? "true" : "false",
+          e->count, (float)e->period / 1000, (float)e->jitter / 1000,
+          (int)((now - e->last) / 1000), IsQuiet(e, now) ? "true" : "false");
+        json.append(buf);
+        for (int j=0; j<std::min((int)e->dlc, 8); j++)
+          {
+          snprintf(buf, sizeof(buf), "%02x", e->data[j]);
+          json.append(buf);
+          }
+        json.append("\"}");
+        }
+      json.append("]");
+      }
+    json.append("}");
+    }
+  json.append("}");
+  return json;
+  }
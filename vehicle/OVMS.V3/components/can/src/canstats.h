@@ -0,0 +1,135 @@
+/*
+;    Project:       Open Vehicle Monitor System
+;    Module:        CAN bus load & traffic statistics
+;    Date:          19th October 2026
+;
+;    (C) 2026       Open Vehicles Project
+;
+; Permission is hereby granted, free of charge, to any person obtaining a copy
+; of this software and associated documentation files (the "Software"), to deal
+; in the Software without restriction, including without limitation the rights
+; to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+; copies of the Software, and to permit persons to whom the Software is
+; furnished to do so, subject to the following conditions:
+;
+; The above copyright notice and this permission notice shall be included in
+; all copies or substantial portions of the Software.
+;
+; THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+; IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+; FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+; AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+; LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+; OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+; THE SOFTWARE.
+*/
+
+#ifndef __CANSTATS_H__
+#define __CANSTATS_H__
+
+#include <string>
+#include "can.h"
+#include "ovms_mutex.h"
+#include "ovms_metrics.h"
+#include "ovms_command.h"
+
+/**
+ * canstats: per bus load estimation & per ID traffic statistics
+ *
+ * All frames received and successfully sent are accounted via the CAN
+ * framework callbacks. The bus load is estimated from the frame bit
+ * lengths (ID type, DLC, CRC/ACK/EOF & interframe space, plus an average
+ * bit stuffing estimate of half the worst case) against the configured
+ * bit rate, and updated once per second.
+ *
+ * Per ID statistics are kept in an open addressed hash table (linear
+ * probing, size configurable by "can stats.ids", 0 = disabled). Frame
+ * periods and jitter are tracked as exponential moving averages of the
+ * interval and its absolute deviation, based on the CAN RX task time.
+ * An ID is considered quiet when it has not been seen for five times
+ * its mean period (at least 500 ms).
+ */
+
+#define CANSTATS_DEFAULT_IDS      512
+#define CANSTATS_MAXFILL(size)    ((size) * 3 / 4)
+#define CANSTATS_KEY_USED         0x40000000
+#define CANSTATS_KEY_EXT          0x80000000
+#define CANSTATS_QUIET_MIN        500000      // [us]
+#define CANSTATS_QUIET_FACTOR     5
+
+typedef struct
+  {
+  uint32_t key;             // MsgID | KEY_USED | KEY_EXT, 0 = free slot
+  uint32_t count;           // frames seen
+  int64_t last;             // last seen [us]
+  uint32_t period;          // mean period [us]
+  uint32_t jitter;          // mean absolute period deviation [us]
+  uint8_t dlc;
+  uint8_t tx;               // last frame was sent by us
+  uint8_t data[8];          // last payload
+  } canstats_id_t;
+
+typedef struct
+  {
+  canbus* bus;
+  canstats_id_t* table;     // hash table, power of 2 size
+  uint16_t size;
+  uint8_t shift;            // hash shift: 32 - log2(size)
+  uint16_t used;            // slots used
+  uint32_t untracked;       // frames not tracked due to table full
+  uint32_t frames_rx;
+  uint32_t frames_tx;
+  uint64_t bits;            // bits in current load interval
+  uint32_t frames;          // frames in current load interval
+  int64_t interval_start;   // current load interval start [us]
+  float load;               // bus load of last interval [%]
+  float load_peak;          // peak bus load [%]
+  uint32_t fps;             // frames per second in last interval
+  uint16_t quiet;           // IDs currently quiet
+  } canstats_bus_t;
+
+// Metrics are created once per bus number and kept when the bus
+// statistics are freed (metrics cannot be removed):
+typedef struct
+  {
+  OvmsMetricFloat* m_load;
+  OvmsMetricFloat* m_load_peak;
+  OvmsMetricInt* m_fps;
+  OvmsMetricInt* m_ids;
+  OvmsMetricInt* m_quiet;
+  } canstats_metrics_t;
+
+class canstats : public InternalRamAllocated
+  {
+  public:
+    canstats();
+    ~canstats();
+
+  public:
+    void Count(const CAN_frame_t* frame, bool tx);
+    void Reset(int busnumber=-1);
+    static uint32_t FrameBits(const CAN_frame_t* frame);
+    static bool IsQuiet(const canstats_id_t* entry, int64_t now);
+
+  public:
+    void Status(OvmsWriter* writer);
+    void ListIds(OvmsWriter* writer, int busnumber, bool quietonly);
+    std::string GetJSON(int busnumber=-1, bool ids=true);
+
+  protected:
+    canstats_bus_t* NewBus(canbus* bus);
+    void FreeBus(int busnumber);
+    canstats_id_t* Lookup(canstats_bus_t* b, uint32_t key);
+    void Ticker1(std::string event, void* data);
+    void ConfigChanged(std::string event, void* data);
+
+  protected:
+    OvmsMutex m_mutex;
+    canstats_bus_t* m_bus[CAN_MAXBUSES];
+    canstats_metrics_t m_metrics[CAN_MAXBUSES];   // only accessed by Ticker1()
+    uint16_t m_tablesize;
+  };
+
+extern canstats MyCanStats;
+
+#endif // __CANSTATS_H__
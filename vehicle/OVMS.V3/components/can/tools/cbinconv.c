@@ -0,0 +1,342 @@
+/**
+ * Project:      Open Vehicle Monitor System
+ * Module:       CAN logging tools
+ *
+ * cbinconv: convert CBIN compact binary CAN logs to CRTD or PCAP
+ *
+ * Usage examples:
+ *    cbinconv some.cbin > some.crtd
+ *    cbinconv -f pcap some.cbin > some.pcap
+ *    cbinconv -s 1760000000 -e 1760000060 some.cbin > minute.crtd
+ *
+ * Start and end times are given as UNIX timestamps (fractional seconds allowed).
+ * The start position is located by bisection over the index blocks, so only
+ * the relevant part of large files needs to be decoded.
+ *
+ * See canformat_cbin.h for the format specification.
+ *
+ * Build: gcc cbinconv.c -o cbinconv
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#define HDRLEN      16
+#define INDEXLEN    20
+#define MAXDICT     2048
+#define MAXTEXT     512
+
+#define TAG_INDEX   0x80
+#define TAG_EVENT   0x81
+#define TAG_STATUS  0x82
+#define TAG_TEXT    0x83
+
+#define FL_EXT      0x20
+#define FL_RTR      0x08
+
+static const char* const typenames[] = {
+  "RX", "TX", "TX_Queue", "TX_Fail", "Error", "Status", "Comment", "Info", "Event"
+};
+
+typedef struct {
+  uint32_t id;
+  uint8_t bus;
+  uint8_t flags;
+} dict_t;
+
+static const uint8_t *data;
+static size_t size;
+static dict_t dict[MAXDICT];
+static int dictsize;
+static int64_t now;
+static int pcap;
+static int64_t tstart = -1, tend = -1;
+
+static int in_range(void)
+{
+  return (tstart < 0 || now >= tstart) && (tend < 0 || now <= tend);
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+  return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void put_be32(uint8_t *p, uint32_t v)
+{
+  p[0] = v >> 24; p[1] = v >> 16; p[2] = v >> 8; p[3] = v;
+}
+
+static int get_varint(size_t pos, uint32_t *val)
+{
+  uint32_t v = 0;
+  int k;
+  for (k = 0; k < 5 && pos + k < size; k++) {
+    v |= (uint32_t)(data[pos+k] & 0x7f) << (7*k);
+    if ((data[pos+k] & 0x80) == 0) {
+      *val = v;
+      return k + 1;
+    }
+  }
+  return -1;
+}
+
+static int valid_index(size_t pos)
+{
+  uint8_t sum = 0;
+  int k;
+  if (pos + INDEXLEN > size || data[pos] != TAG_INDEX || data[pos+1] != 'I' || data[pos+2] != 'X')
+    return 0;
+  for (k = 1; k < INDEXLEN-1; k++)
+    sum += data[pos+k];
+  sum ^= 0xff;
+  return (data[pos+INDEXLEN-1] == sum);
+}
+
+static size_t next_index(size_t pos)
+{
+  while (pos < size && !valid_index(pos))
+    pos++;
+  return pos;
+}
+
+static int64_t index_time(size_t pos)
+{
+  return (int64_t)get_u32(data+pos+3) * 1000000 + get_u32(data+pos+7);
+}
+
+/* Find the last index block starting at or before time t */
+static size_t seek_time(int64_t t)
+{
+  size_t lo = HDRLEN, hi = size, best = next_index(HDRLEN), mid, pos;
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    pos = next_index(mid);
+    if (pos >= size || index_time(pos) > t) {
+      hi = mid;
+    } else {
+      best = pos;
+      lo = pos + 1;
+    }
+  }
+  return best;
+}
+
+static void out_frame(const char *type, int bus, int tx, const dict_t *d, const uint8_t *p, int dlc)
+{
+  int k;
+  if (!in_range()) return;
+  if (pcap) {
+    uint8_t rec[32];
+    if (type || tx) return;
+    memset(rec, 0, sizeof(rec));
+    put_be32(rec+0, now / 1000000);
+    put_be32(rec+4, now % 1000000);
+    put_be32(rec+8, 16);
+    put_be32(rec+12, 16);
+    put_be32(rec+16, d->id | ((d->flags & FL_EXT) ? 0x80000000 : 0) | ((d->flags & FL_RTR) ? 0x40000000 : 0));
+    rec[20] = dlc;
+    memcpy(rec+24, p, dlc);
+    fwrite(rec, 1, 32, stdout);
+    return;
+  }
+  if (type)
+    printf("%ld.%06ld %cCER %s %c%s %0*X", (long)(now / 1000000), (long)(now % 1000000),
+      bus, type, 'T', (d->flags & FL_EXT) ? "29" : "11", (d->flags & FL_EXT) ? 8 : 3, d->id);
+  else
+    printf("%ld.%06ld %c%c%s %0*X", (long)(now / 1000000), (long)(now % 1000000),
+      bus, tx ? 'T' : 'R', (d->flags & FL_EXT) ? "29" : "11", (d->flags & FL_EXT) ? 8 : 3, d->id);
+  for (k = 0; k < dlc; k++)
+    printf(" %02x", p[k]);
+  printf("\n");
+}
+
+static int busname(uint8_t bus)
+{
+  return (bus >= 7) ? '1' : '1' + bus;
+}
+
+/* Decode record at pos, returns size or -1 on error */
+static int decode(size_t pos)
+{
+  uint8_t tag = data[pos];
+  size_t p = pos + 1;
+  uint32_t delta, v[11];
+  int n, k, dlc;
+
+  if ((tag & 0xc0) == 0x00) {
+    int isize = (tag & 0x10) ? 2 : 1;
+    unsigned index;
+    dlc = tag & 0x0f;
+    if (dlc > 8 || (n = get_varint(p, &delta)) < 0) return -1;
+    p += n;
+    if (p + isize + dlc > size) return -1;
+    index = (isize == 2) ? (data[p] | (data[p+1] << 8)) : data[p];
+    p += isize;
+    if (index >= (unsigned)dictsize) return -1;
+    now += delta;
+    out_frame(NULL, busname(dict[index].bus), tag & 0x20, &dict[index], data+p, dlc);
+    return p + dlc - pos;
+  }
+  if ((tag & 0xc0) == 0x40) {
+    int isize = (tag & FL_EXT) ? 4 : 2;
+    if (p + isize > size || dictsize >= MAXDICT) return -1;
+    dict[dictsize].id = (isize == 4) ? get_u32(data+p) : (uint32_t)(data[p] | (data[p+1] << 8));
+    dict[dictsize].bus = tag & 0x07;
+    dict[dictsize].flags = tag & (FL_EXT|FL_RTR);
+    dictsize++;
+    return p + isize - pos;
+  }
+  if (tag != TAG_INDEX && p + 1 >= size) return -1;
+  switch (tag) {
+    case TAG_INDEX:
+      if (!valid_index(pos)) return -1;
+      now = index_time(pos);
+      dictsize = 0;
+      return INDEXLEN;
+    case TAG_EVENT: {
+      dict_t d;
+      uint8_t type = data[p++];
+      if (type > 8 || (n = get_varint(p, &delta)) < 0) return -1;
+      p += n;
+      if (p + 7 > size) return -1;
+      d.flags = data[p+1];
+      d.id = get_u32(data+p+2);
+      dlc = data[p+6];
+      if (dlc > 8 || p + 7 + dlc > size) return -1;
+      now += delta;
+      out_frame(typenames[type], busname(data[p]), 1, &d, data+p+7, dlc);
+      return p + 7 + dlc - pos;
+    }
+    case TAG_STATUS: {
+      uint8_t type = data[p++], bus;
+      if (type > 8 || (n = get_varint(p, &delta)) < 0) return -1;
+      p += n;
+      if (p >= size) return -1;
+      bus = data[p++];
+      for (k = 0; k < 11; k++) {
+        if ((n = get_varint(p, &v[k])) < 0) return -1;
+        p += n;
+      }
+      now += delta;
+      if (!pcap && in_range())
+        printf("%ld.%06ld %c%s %s intr=%d rxpkt=%d txpkt=%d errflags=%#x rxerr=%d txerr=%d rxovr=%d txovr=%d txdelay=%d wdgreset=%d errreset=%d\n",
+          (long)(now / 1000000), (long)(now % 1000000), busname(bus),
+          (type == 4) ? "CER" : "CST", typenames[type],
+          v[0], v[1], v[2], v[6], v[7], v[8], v[4], v[5], v[3], v[9], v[10]);
+      return p - pos;
+    }
+    case TAG_TEXT: {
+      uint8_t type = data[p++], bus;
+      uint32_t len;
+      if (type > 8 || (n = get_varint(p, &delta)) < 0) return -1;
+      p += n;
+      if (p >= size) return -1;
+      bus = data[p++];
+      if ((n = get_varint(p, &len)) < 0 || len > MAXTEXT) return -1;
+      p += n;
+      if (p + len > size) return -1;
+      now += delta;
+      if (!pcap && in_range())
+        printf("%ld.%06ld %c%s %s %.*s\n", (long)(now / 1000000), (long)(now % 1000000),
+          busname(bus), (type == 8) ? "CEV" : "CXX", typenames[type], (int)len, data+p);
+      return p + len - pos;
+    }
+  }
+  return -1;
+}
+
+int main(int argc, char *argv[])
+{
+  FILE *f;
+  uint8_t *buf;
+  size_t pos, cap = 0;
+  int opt, n, resyncs = 0;
+
+  while ((opt = getopt(argc, argv, "f:s:e:")) != -1) {
+    switch (opt) {
+      case 'f': pcap = (strcmp(optarg, "pcap") == 0); break;
+      case 's': tstart = (int64_t)(atof(optarg) * 1000000); break;
+      case 'e': tend = (int64_t)(atof(optarg) * 1000000); break;
+      default: optind = argc + 1; break;
+    }
+  }
+  if (optind != argc - 1) {
+    fprintf(stderr,
+      "%s: convert CBIN compact binary CAN log to CRTD or PCAP\n"
+      "Usage: %s [-f crtd|pcap] [-s start] [-e end] file.cbin > output\n",
+      argv[0], argv[0]);
+    return 1;
+  }
+
+  if (!(f = fopen(argv[optind], "rb"))) {
+    perror(argv[optind]);
+    return 1;
+  }
+  buf = NULL;
+  do {
+    cap += 1 << 20;
+    if (!(buf = realloc(buf, cap))) {
+      fprintf(stderr, "out of memory\n");
+      return 1;
+    }
+    size += fread(buf + size, 1, cap - size, f);
+  } while (size == cap);
+  fclose(f);
+  data = buf;
+
+  if (size < HDRLEN || memcmp(data, "OVCB", 4) != 0) {
+    fprintf(stderr, "%s: not a CBIN file\n", argv[optind]);
+    return 1;
+  }
+
+  if (pcap) {
+    uint8_t hdr[24] = { 0xa1, 0xb2, 0xc3, 0xd4, 0, 2, 0, 4 };
+    put_be32(hdr+16, 8);
+    put_be32(hdr+20, 0xe3);
+    fwrite(hdr, 1, sizeof(hdr), stdout);
+  } else {
+    printf("%ld.%06ld CXX OVMS CRTD\n", (long)get_u32(data+8), (long)get_u32(data+12));
+  }
+
+  pos = (tstart >= 0) ? seek_time(tstart) : next_index(HDRLEN);
+  while (pos < size) {
+    if (tend >= 0 && data[pos] == TAG_INDEX && valid_index(pos) && index_time(pos) > tend)
+      break;
+    n = decode(pos);
+    if (n < 0) {
+      resyncs++;
+      pos = next_index(pos + 1);
+      continue;
+    }
+    if (tend >= 0 && now > tend)
+      break;
+    pos += n;
+  }
+
+  if (resyncs)
+    fprintf(stderr, "%d invalid records skipped\n", resyncs);
+  free(buf);
+  return 0;
+}
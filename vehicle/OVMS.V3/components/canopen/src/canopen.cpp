@@ -87,8 +87,10 @@ CANopen::~CANopen()
     }
   if (m_rxtask)
     {
-    vQueueDelete(m_rxqueue);
+    MyCan.DeregisterListener(m_rxqueue);
     vTaskDelete(m_rxtask);
+    MyCan.FlushListenerQueue(m_rxqueue);
+    vQueueDelete(m_rxqueue);
     }
   }
 
@@ -105,7 +107,7 @@ static void CANopenRxTask(void *pvParameters)
 
 void CANopen::CanRxTask()
   {
-  CAN_frame_t frame;
+  CAN_frame_t* frame;
 
   while(1)
     {
@@ -113,12 +115,13 @@ void CANopen::CanRxTask()
       {
       for (int i=0; i < CAN_INTERFACE_CNT; i++)
         {
-        if (m_worker[i] && m_worker[i]->m_bus == frame.origin)
+        if (m_worker[i] && m_worker[i]->m_bus == frame->origin)
           {
-          m_worker[i]->IncomingFrame(&frame);
+          m_worker[i]->IncomingFrame(frame);
           break;
           }
         }
+      MyCan.m_framepool.Release(frame);
       }
     }
   }
@@ -139,7 +142,7 @@ CANopenWorker* CANopen::Start(canbus* bus)
   // start CAN rx task:
   if (m_rxtask == NULL)
     {
-    m_rxqueue = xQueueCreate(20, sizeof(CAN_frame_t));
+    m_rxqueue = xQueueCreate(CAN_LISTENER_QUEUE_SIZE, sizeof(CAN_frame_t*));
     xTaskCreatePinnedToCore(CANopenRxTask, "OVMS COrx",
       CONFIG_OVMS_COMP_CANOPEN_RX_STACK, (void*)this, 15, &m_rxtask, CORE(0));
     MyCan.RegisterListener(m_rxqueue);
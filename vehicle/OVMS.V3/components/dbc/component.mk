@@ -17,7 +17,7 @@ endif
 COMPONENT_ADD_INCLUDEDIRS:=src yacclex
 COMPONENT_SRCDIRS:=src yacclex
 COMPONENT_ADD_LDFLAGS = -Wl,--whole-archive -l$(COMPONENT_NAME) -Wl,--no-whole-archive
-COMPONENT_OBJS = src/dbc_app.o src/dbc_number.o src/dbc.o yacclex/dbc_tokeniser.o yacclex/dbc_parser.o
+COMPONENT_OBJS = src/dbc_app.o src/dbc_number.o src/dbc.o src/dbc_cache.o yacclex/dbc_tokeniser.o yacclex/dbc_parser.o
 
 COMPONENT_EXTRA_CLEAN := $(COMPONENT_PATH)/yacclex/dbc_tokeniser.cpp \
 	$(COMPONENT_PATH)/yacclex/dbc_tokeniser.c \
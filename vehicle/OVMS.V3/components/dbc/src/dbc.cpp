@@ -42,7 +42,11 @@ static const char *TAG = "dbc";
 #include "dbc_tokeniser.hpp"
 #include "dbc_parser.hpp"
 #ifdef CONFIG_OVMS
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
 #include "ovms_config.h"
+#else
+#include <sys/time.h>
 #endif // #ifdef CONFIG_OVMS
 
 // N.B. The conditions on CONFIG_OVMS are to allow this module to be
@@ -51,58 +55,127 @@ static const char *TAG = "dbc";
 ////////////////////////////////////////////////////////////////////////
 // Helper functions
 
-static inline uint64_t
-dbc_extract_bits(uint8_t *candata, unsigned int bpos, unsigned int align, unsigned int shifter, unsigned int pos)
+// Signal definition generation, incremented on any change affecting the
+// decoding of signals; compiled message plans are rebuilt on mismatch.
+static uint32_t dbc_plan_generation = 1;
+
+static inline void dbc_plan_invalidate()
   {
-  uint64_t val = (uint64_t)candata[bpos/8];
-  unsigned int mask = (1 << shifter) - 1;
-  return ((val >> align) & mask) << pos;
+  dbc_plan_generation++;
   }
 
-static uint64_t
-dbc_extract_bits_little_endian(uint8_t *candata, unsigned int bpos, unsigned int bits)
+static inline int64_t dbc_time_us()
   {
-  unsigned int pos, aligner, shifter;
-  uint64_t val = 0;
-
-  pos = 0;
-  while (bits > 0)
-    {
-    aligner = bpos % 8;
-    shifter = 8 - aligner;
-    shifter = MIN(shifter, bits);
+#ifdef CONFIG_OVMS
+  return esp_timer_get_time();
+#else
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+#endif // #ifdef CONFIG_OVMS
+  }
 
-    val |= dbc_extract_bits(candata, bpos, aligner, shifter, pos);
-    pos += shifter;
+static inline size_t dbc_heap_free()
+  {
+#ifdef CONFIG_OVMS
+  return heap_caps_get_free_size(MALLOC_CAP_8BIT);
+#else
+  return 0;
+#endif // #ifdef CONFIG_OVMS
+  }
 
-    bpos += shifter;
-    bits -= shifter;
-    }
+static inline void dbc_set_stats(dbcLoadStats_t& stats, int64_t start, size_t heap)
+  {
+  size_t heapnow = dbc_heap_free();
+  stats.time_us = dbc_time_us() - start;
+  stats.heap = (heapnow < heap) ? heap - heapnow : 0;
+  }
 
-  return val;
+static inline void dbc_load_words(const CAN_frame_t* msg, uint64_t& le, uint64_t& be)
+  {
+  le = msg->data.u64;
+  be = __builtin_bswap64(le);
   }
 
-static uint64_t
-dbc_extract_bits_big_endian(uint8_t *candata, unsigned int bpos, unsigned int bits)
+static inline uint64_t dbc_decode_raw(const dbcDecodeStep_t& step, uint64_t le, uint64_t be)
   {
-  unsigned int pos, aligner, slicer;
-  uint64_t val = 0;
+  uint64_t raw = (((step.flags & DBC_DECODE_BIGENDIAN) ? be : le) >> step.shift) & step.mask;
+  if ((step.flags & DBC_DECODE_SIGNED) && step.bits < 64)
+    raw = (uint64_t)((int64_t)(raw << (64 - step.bits)) >> (64 - step.bits));
+  return raw;
+  }
 
-  pos = bits;
-  while (bits > 0)
+static inline void dbc_decode_value(const dbcDecodeStep_t& step, uint64_t raw, dbcNumber& result)
+  {
+  switch (step.mode)
     {
-    slicer = (bpos % 8) + 1;
-    slicer = MIN(slicer, bits);
-    aligner = ((bpos % 8) + 1) - slicer;
+    case DBC_SCALE_INT:
+      {
+      int64_t value = (int64_t)raw * step.scale.i.factor + step.scale.i.offset;
+      if ((step.flags & DBC_DECODE_SIGNED) || value < 0)
+        {
+        if (value >= INT32_MIN && value <= INT32_MAX)
+          result = (int32_t)value;
+        else
+          result = (double)value;
+        }
+      else
+        {
+        if (value <= UINT32_MAX)
+          result = (uint32_t)value;
+        else
+          result = (double)value;
+        }
+      break;
+      }
+    case DBC_SCALE_FLOAT:
+      result = (double)((float)(int32_t)raw * step.scale.f.factor + step.scale.f.offset);
+      break;
+    default:
+      if (step.flags & DBC_DECODE_SIGNED)
+        result = (double)(int64_t)raw * step.scale.d.factor + step.scale.d.offset;
+      else
+        result = (double)raw * step.scale.d.factor + step.scale.d.offset;
+      break;
+    }
+  }
 
-    pos -= slicer;
-    val |= dbc_extract_bits(candata, bpos, aligner, slicer, pos);
+/**
+ * dbc_encode_raw: translate a physical value into the raw signal value
+ *  Returns false if the value cannot be encoded (undefined or NaN).
+ */
+static inline bool dbc_encode_raw(const dbcEncodeStep_t& step, const dbcNumber& value, uint64_t& raw)
+  {
+  dbcNumber& number = const_cast<dbcNumber&>(value);
+  if (!number.IsDefined())
+    return false;
+  double v = round((number.GetDouble() - step.offset) * step.factor);
+  if (isnan(v))
+    return false;
+  if (v < step.rawmin) v = step.rawmin;
+  if (v > step.rawmax) v = step.rawmax;
+  if (step.flags & DBC_DECODE_SIGNED)
+    raw = (uint64_t)(int64_t)v;
+  else
+    raw = (uint64_t)v;
+  return true;
+  }
 
-    bpos = ((bpos / 8) + 1) * 8 + 7;
-    bits -= slicer;
-    }
+/**
+ * dbc_encode_insert: collect a raw signal value for dbc_encode_apply()
+ *  set/clear: bits to set/clear per byte order (0 = little, 1 = big endian)
+ */
+static inline void dbc_encode_insert(const dbcEncodeStep_t& step, uint64_t raw, uint64_t* set, uint64_t* clear)
+  {
+  int k = (step.flags & DBC_DECODE_BIGENDIAN) ? 1 : 0;
+  clear[k] |= step.mask << step.shift;
+  set[k] = (set[k] & ~(step.mask << step.shift)) | ((raw & step.mask) << step.shift);
+  }
 
-  return val;
+static inline void dbc_encode_apply(CAN_frame_t* msg, const uint64_t* set, const uint64_t* clear)
+  {
+  msg->data.u64 = (msg->data.u64 & ~(clear[0] | __builtin_bswap64(clear[1])))
+    | set[0] | __builtin_bswap64(set[1]);
   }
 
 uint32_t dbcMessageIdFromString(const char* id)
@@ -580,19 +653,26 @@ dbcSignal::dbcSignal()
   {
   m_start_bit = 0;
   m_signal_size = 0;
+  m_mux.multiplexed = DBC_MUX_NONE;
+  m_mux.switchvalue = 0;
   m_metric = NULL;
+  m_policy = NULL;
   }
 
 dbcSignal::dbcSignal(std::string name)
   {
   m_start_bit = 0;
   m_signal_size = 0;
+  m_mux.multiplexed = DBC_MUX_NONE;
+  m_mux.switchvalue = 0;
   m_name = name;
   m_metric = MyMetrics.Find(name.c_str());
+  m_policy = NULL;
   }
 
 dbcSignal::~dbcSignal()
   {
+  if (m_policy) delete m_policy;
   }
 
 void dbcSignal::AddReceiver(std::string receiver)
@@ -663,6 +743,7 @@ void dbcSignal::SetName(const std::string& name)
   std::string mappedname(name);
   std::replace( mappedname.begin(), mappedname.end(), '_', '.');
   m_metric = MyMetrics.Find(mappedname.c_str());
+  dbc_plan_invalidate();
   }
 
 void dbcSignal::SetName(const char* name)
@@ -683,6 +764,7 @@ bool dbcSignal::IsMultiplexSwitch()
 void dbcSignal::SetMultiplexor()
   {
   m_mux.multiplexed = DBC_MUX_MULTIPLEXOR;
+  dbc_plan_invalidate();
   }
 
 uint32_t dbcSignal::GetMultiplexSwitchvalue()
@@ -700,6 +782,7 @@ bool dbcSignal::SetMultiplexed(const uint32_t switchvalue)
     {
     m_mux.multiplexed = DBC_MUX_MULTIPLEXED;
     m_mux.switchvalue = switchvalue;
+    dbc_plan_invalidate();
     return true;
     }
   }
@@ -714,6 +797,7 @@ bool dbcSignal::ClearMultiplexed()
     {
     m_mux.multiplexed = DBC_MUX_NONE;
     m_mux.switchvalue = 0;
+    dbc_plan_invalidate();
     return true;
     }
   }
@@ -762,28 +846,33 @@ void dbcSignal::SetStartSize(const int startbit, const int size)
   {
   m_start_bit = startbit;
   m_signal_size = size;
+  dbc_plan_invalidate();
   }
 
 void dbcSignal::SetByteOrder(const dbcByteOrder_t order)
   {
   m_byte_order = order;
+  dbc_plan_invalidate();
   }
 
 void dbcSignal::SetValueType(const dbcValueType_t type)
   {
   m_value_type = type;
+  dbc_plan_invalidate();
   }
 
 void dbcSignal::SetFactorOffset(const dbcNumber factor, const dbcNumber offset)
   {
   m_factor = factor;
   m_offset = offset;
+  dbc_plan_invalidate();
   }
 
 void dbcSignal::SetFactorOffset(const double factor, const double offset)
   {
   m_factor = factor;
   m_offset = offset;
+  dbc_plan_invalidate();
   }
 
 void dbcSignal::SetMinMax(const dbcNumber minimum, const dbcNumber maximum)
@@ -813,42 +902,178 @@ void dbcSignal::SetUnit(const char* unit)
   m_unit = std::string(unit);
   }
 
+/**
+ * Encode: set the signal in the frame to the physical value source
+ *  The value is scaled, rounded and clamped to the signal range, other
+ *  signals in the frame are not changed. An undefined value is ignored.
+ *  Use dbcMessage::EncodeValues() to encode multiple signals of a frame.
+ */
 void dbcSignal::Encode(dbcNumber* source, CAN_frame_t* msg)
   {
-  // TODO: An efficient encoding of the signal
+  dbcEncodeStep_t step;
+  uint64_t raw, set[2] = { 0, 0 }, clear[2] = { 0, 0 };
+
+  CompileEncoder(step);
+  if ((step.flags & DBC_DECODE_INVALID) || !dbc_encode_raw(step, *source, raw))
+    return;
+  dbc_encode_insert(step, raw, set, clear);
+  dbc_encode_apply(msg, set, clear);
+  }
+
+/**
+ * EncodeRaw: set the unscaled signal value (truncated to the signal size)
+ */
+void dbcSignal::EncodeRaw(int64_t raw, CAN_frame_t* msg)
+  {
+  dbcEncodeStep_t step;
+  uint64_t set[2] = { 0, 0 }, clear[2] = { 0, 0 };
+
+  CompileEncoder(step);
+  if (step.flags & DBC_DECODE_INVALID)
+    return;
+  dbc_encode_insert(step, (uint64_t)raw, set, clear);
+  dbc_encode_apply(msg, set, clear);
+  }
+
+/**
+ * CompileEncoder: translate the signal definition into an encoder step
+ */
+void dbcSignal::CompileEncoder(dbcEncodeStep_t& step)
+  {
+  dbcDecodeStep_t dec;
+  Compile(dec);
+
+  memset(&step, 0, sizeof(step));
+  step.signal = this;
+  step.mask = dec.mask;
+  step.shift = dec.shift;
+  step.bits = dec.bits;
+  step.flags = dec.flags;
+  step.switchvalue = dec.switchvalue;
+  if (step.flags & DBC_DECODE_INVALID)
+    return;
+
+  double factor = m_factor.IsDefined() ? m_factor.GetDouble() : 1;
+  if (factor == 0) factor = 1;
+  step.factor = 1 / factor;
+  step.offset = m_offset.IsDefined() ? m_offset.GetDouble() : 0;
+
+  // Raw range of the signal bits, limited to doubles convertible to 64 bit:
+  int nbits = (step.flags & DBC_DECODE_SIGNED) ? step.bits - 1 : step.bits;
+  double hi = ldexp(1, nbits);
+  step.rawmax = (nbits <= 53) ? hi - 1 : hi - ldexp(1, nbits - 53);
+  step.rawmin = (step.flags & DBC_DECODE_SIGNED) ? -hi : 0;
+
+  // Physical range, if defined:
+  if (m_minimum.IsDefined() && m_maximum.IsDefined()
+    && m_minimum.GetDouble() < m_maximum.GetDouble())
+    {
+    double rmin = (m_minimum.GetDouble() - step.offset) / factor;
+    double rmax = (m_maximum.GetDouble() - step.offset) / factor;
+    if (rmin > rmax) std::swap(rmin, rmax);
+    rmin = ceil(rmin - 1e-6);
+    rmax = floor(rmax + 1e-6);
+    if (rmin > step.rawmin) step.rawmin = rmin;
+    if (rmax < step.rawmax) step.rawmax = rmax;
+    }
   }
 
-dbcNumber dbcSignal::Decode(CAN_frame_t* msg)
+/**
+ * Compile: translate the signal definition into a decoder step
+ *  Big endian (Motorola) signals are extracted from the frame data loaded
+ *  as a big endian word, so the start bit (MSB) translates to the LSB word
+ *  position (7 - byte) * 8 + bit - (size - 1).
+ */
+void dbcSignal::Compile(dbcDecodeStep_t& step)
   {
-  uint64_t val;
-  dbcNumber result;
+  memset(&step, 0, sizeof(step));
+  step.signal = this;
+  step.metric = m_metric;
+  step.policy = m_policy;
+  if (IsMultiplexSwitch())
+    {
+    step.flags |= DBC_DECODE_MULTIPLEXED;
+    step.switchvalue = m_mux.switchvalue;
+    }
 
+  int lsb;
   if (m_byte_order == DBC_BYTEORDER_BIG_ENDIAN)
-    val = dbc_extract_bits_big_endian(msg->data.u8,m_start_bit,m_signal_size);
-  else
-    val = dbc_extract_bits_little_endian(msg->data.u8,m_start_bit,m_signal_size);
-
-  if (m_value_type == DBC_VALUETYPE_UNSIGNED)
-    result.Cast((uint32_t)val, DBC_NUMBER_INTEGER_UNSIGNED);
+    {
+    step.flags |= DBC_DECODE_BIGENDIAN;
+    lsb = (7 - m_start_bit / 8) * 8 + (m_start_bit % 8) - (m_signal_size - 1);
+    }
   else
-    result.Cast((uint32_t)val, DBC_NUMBER_INTEGER_SIGNED);
-
-  // Apply factor and offset
-  if (!(m_factor == 1))
     {
-    result = (result * m_factor);
+    lsb = m_start_bit;
     }
-  if (!(m_offset == 0))
+  if (m_signal_size < 1 || m_signal_size > 64 || lsb < 0 || lsb + m_signal_size > 64)
     {
-    result = (result + m_offset);
+    step.flags |= DBC_DECODE_INVALID;
+    step.mode = DBC_SCALE_INT;
+    step.scale.i.factor = 0;
+    return;
     }
+  step.shift = lsb;
+  step.bits = m_signal_size;
+  step.mask = (m_signal_size == 64) ? UINT64_MAX : ((1ULL << m_signal_size) - 1);
+  if (m_value_type == DBC_VALUETYPE_SIGNED)
+    step.flags |= DBC_DECODE_SIGNED;
+
+  double factor = m_factor.IsDefined() ? m_factor.GetDouble() : 1;
+  double offset = m_offset.IsDefined() ? m_offset.GetDouble() : 0;
+  if (m_signal_size <= 32
+    && factor == trunc(factor) && fabs(factor) <= INT32_MAX
+    && offset == trunc(offset) && fabs(offset) <= INT32_MAX)
+    {
+    step.mode = DBC_SCALE_INT;
+    step.scale.i.factor = factor;
+    step.scale.i.offset = offset;
+    }
+  else if (m_signal_size <= 24)
+    {
+    step.mode = DBC_SCALE_FLOAT;
+    step.scale.f.factor = factor;
+    step.scale.f.offset = offset;
+    }
+  else
+    {
+    step.mode = DBC_SCALE_DOUBLE;
+    step.scale.d.factor = factor;
+    step.scale.d.offset = offset;
+    }
+  }
+
+dbcNumber dbcSignal::Decode(CAN_frame_t* msg)
+  {
+  dbcDecodeStep_t step;
+  uint64_t le, be;
+  dbcNumber result;
 
+  Compile(step);
+  dbc_load_words(msg, le, be);
+  dbc_decode_value(step, dbc_decode_raw(step, le, be), result);
   return result;
   }
 
+/**
+ * DecodeRaw: get the unscaled signal value, sign extended for signed signals
+ *  Use this to access all 64 bits of large signals, the physical value
+ *  returned by Decode() has double precision (53 bits) for these.
+ */
+int64_t dbcSignal::DecodeRaw(CAN_frame_t* msg)
+  {
+  dbcDecodeStep_t step;
+  uint64_t le, be;
+
+  Compile(step);
+  dbc_load_words(msg, le, be);
+  return (int64_t)dbc_decode_raw(step, le, be);
+  }
+
 void dbcSignal::AssignMetric(OvmsMetric* metric)
   {
   m_metric = metric;
+  dbc_plan_invalidate();
   }
 
 OvmsMetric* dbcSignal::GetMetric()
@@ -856,6 +1081,42 @@ OvmsMetric* dbcSignal::GetMetric()
   return m_metric;
   }
 
+/**
+ * SetPolicy: set the metric publishing policy (see dbcPublishPolicy_t)
+ *  The policy is updated in place, as it may be in use by the decoder.
+ */
+void dbcSignal::SetPolicy(double deadband, double deadband_rel, uint32_t interval_ms, bool average)
+  {
+  if (!m_policy)
+    {
+    m_policy = new dbcPublishPolicy_t;
+    memset(m_policy, 0, sizeof(*m_policy));
+    dbc_plan_invalidate();
+    }
+  m_policy->active = false;
+  m_policy->deadband = deadband;
+  m_policy->deadband_rel = deadband_rel;
+  m_policy->interval_us = (int64_t)interval_ms * 1000;
+  m_policy->average = average && interval_ms > 0;
+  m_policy->published = false;
+  m_policy->sum = 0;
+  m_policy->count = 0;
+  m_policy->cnt_published = 0;
+  m_policy->cnt_suppressed = 0;
+  m_policy->active = (deadband > 0 || deadband_rel > 0 || interval_ms > 0);
+  }
+
+void dbcSignal::ClearPolicy()
+  {
+  if (m_policy)
+    m_policy->active = false;
+  }
+
+dbcPublishPolicy_t* dbcSignal::GetPolicy()
+  {
+  return (m_policy && m_policy->active) ? m_policy : NULL;
+  }
+
 void dbcSignal::WriteFile(dbcOutputCallback callback, void* param)
   {
   std::ostringstream ss;
@@ -943,6 +1204,12 @@ dbcMessage::dbcMessage()
   m_id = 0;
   m_size = 0;
   m_multiplexor = NULL;
+  m_plan_common = 0;
+  m_plan_generation = 0;
+  m_encplan_generation = 0;
+  m_encplan_mux = m_encplan_counter = m_encplan_checksum = -1;
+  m_counter_signal = m_checksum_signal = NULL;
+  m_counter = 0;
   }
 
 dbcMessage::dbcMessage(uint32_t id)
@@ -950,6 +1217,12 @@ dbcMessage::dbcMessage(uint32_t id)
   m_size = 0;
   m_multiplexor = NULL;
   m_id = id;
+  m_plan_common = 0;
+  m_plan_generation = 0;
+  m_encplan_generation = 0;
+  m_encplan_mux = m_encplan_counter = m_encplan_checksum = -1;
+  m_counter_signal = m_checksum_signal = NULL;
+  m_counter = 0;
   }
 
 dbcMessage::~dbcMessage()
@@ -979,12 +1252,23 @@ bool dbcMessage::HasComment(const std::string& comment)
 void dbcMessage::AddSignal(dbcSignal* signal)
   {
   m_signals.push_back(signal);
+  m_plan_generation = 0;
+  m_encplan_generation = 0;
   }
 
 void dbcMessage::RemoveSignal(dbcSignal* signal, bool free)
   {
   m_signals.remove(signal);
+  if (m_counter_signal == signal) m_counter_signal = NULL;
+  if (m_checksum_signal == signal) m_checksum_signal = NULL;
+  if (m_multiplexor == signal) m_multiplexor = NULL;
+  m_encplan.clear();
+  m_encplan_generation = 0;
   if (free) delete signal;
+  m_plan.clear();
+  m_plan_groups.clear();
+  m_plan_common = 0;
+  m_plan_generation = 0;
   }
 
 void dbcMessage::RemoveAllSignals(bool free)
@@ -994,6 +1278,13 @@ void dbcMessage::RemoveAllSignals(bool free)
     if (free) delete signal;
     }
   m_signals.clear();
+  m_counter_signal = m_checksum_signal = m_multiplexor = NULL;
+  m_encplan.clear();
+  m_encplan_generation = 0;
+  m_plan.clear();
+  m_plan_groups.clear();
+  m_plan_common = 0;
+  m_plan_generation = 0;
   }
 
 dbcSignal* dbcMessage::FindSignal(std::string name)
@@ -1095,10 +1386,316 @@ dbcSignal* dbcMessage::GetMultiplexorSignal()
 void dbcMessage::SetMultiplexorSignal(dbcSignal* signal)
   {
   m_multiplexor = signal;
+  m_encplan_generation = 0;
   if (signal != NULL)
     {
     signal->SetMultiplexor();
     }
+  m_plan_generation = 0;
+  }
+
+/**
+ * Compile: build the decode plan for all signals of the message
+ *  Called after loading, automatically repeated on decoding after changes.
+ *  The plan holds the unmultiplexed signals first, followed by the
+ *  multiplexed signals grouped by their switch value, so decoding a frame
+ *  only visits the common steps and the group selected by the multiplexor.
+ */
+void dbcMessage::Compile()
+  {
+  m_plan.resize(m_signals.size());
+  int i = 0;
+  for (dbcSignal* signal : m_signals)
+    {
+    dbcDecodeStep_t& step = m_plan[i];
+    signal->Compile(step);
+    step.index = i++;
+    if (!m_multiplexor)
+      step.flags &= ~DBC_DECODE_MULTIPLEXED;
+    }
+
+  std::stable_sort(m_plan.begin(), m_plan.end(),
+    [](const dbcDecodeStep_t& a, const dbcDecodeStep_t& b)
+      {
+      bool am = (a.flags & DBC_DECODE_MULTIPLEXED), bm = (b.flags & DBC_DECODE_MULTIPLEXED);
+      if (am != bm) return bm;
+      return am && a.switchvalue < b.switchvalue;
+      });
+
+  m_plan_groups.clear();
+  m_plan_common = 0;
+  while (m_plan_common < m_plan.size() && !(m_plan[m_plan_common].flags & DBC_DECODE_MULTIPLEXED))
+    m_plan_common++;
+  for (size_t k = m_plan_common; k < m_plan.size(); k++)
+    {
+    if (m_plan_groups.empty() || m_plan_groups.back().switchvalue != m_plan[k].switchvalue)
+      m_plan_groups.push_back({ m_plan[k].switchvalue, (uint16_t)k, (uint16_t)k });
+    m_plan_groups.back().end = k + 1;
+    }
+
+  if (m_multiplexor)
+    m_multiplexor->Compile(m_plan_mux);
+  m_plan_generation = dbc_plan_generation;
+  }
+
+/**
+ * FindMuxGroup: find the plan group for a multiplexor switch value
+ *  Returns NULL if no signal is multiplexed on the value.
+ */
+const dbcMuxGroup_t* dbcMessage::FindMuxGroup(uint32_t switchvalue)
+  {
+  auto it = std::lower_bound(m_plan_groups.begin(), m_plan_groups.end(), switchvalue,
+    [](const dbcMuxGroup_t& g, uint32_t v) { return g.switchvalue < v; });
+  if (it == m_plan_groups.end() || it->switchvalue != switchvalue)
+    return NULL;
+  return &*it;
+  }
+
+/**
+ * dbc_policy_filter: apply the publishing policy to a decoded value
+ *  Returns false if the value shall not be published, may replace the
+ *  value by the interval average.
+ */
+static bool dbc_policy_filter(dbcPublishPolicy_t* p, dbcNumber& value)
+  {
+  double v = value.GetDouble();
+  int64_t now = dbc_time_us();
+
+  if (p->published)
+    {
+    if (p->average)
+      {
+      p->sum += v;
+      p->count++;
+      }
+    if (now - p->window < p->interval_us)
+      {
+      p->cnt_suppressed++;
+      return false;
+      }
+    if (p->average)
+      {
+      v = p->sum / p->count;
+      p->sum = 0;
+      p->count = 0;
+      p->window = now;
+      }
+    double delta = fabs(v - p->last);
+    if ((delta < p->deadband || delta < fabs(p->last) * p->deadband_rel)
+      && now - p->last_time < DBC_POLICY_REFRESH_US)
+      {
+      p->cnt_suppressed++;
+      return false;
+      }
+    if (p->average)
+      value = v;
+    }
+
+  p->published = true;
+  p->last = v;
+  p->last_time = p->window = now;
+  p->cnt_published++;
+  return true;
+  }
+
+static inline void dbc_decode_metrics(const dbcDecodeStep_t* step, const dbcDecodeStep_t* end,
+  uint64_t le, uint64_t be)
+  {
+  dbcNumber value;
+  for (; step < end; step++)
+    {
+    if (step->metric == NULL)
+      continue;
+    dbc_decode_value(*step, dbc_decode_raw(*step, le, be), value);
+    if (step->policy && step->policy->active && !dbc_policy_filter(step->policy, value))
+      continue;
+    step->metric->SetValue(value);
+    }
+  }
+
+/**
+ * DecodeMetrics: decode the frame into the metrics of the signals
+ *  This is the receive hot path: one load of the frame data, then a few
+ *  integer operations and a multiply & add per signal.
+ */
+void dbcMessage::DecodeMetrics(CAN_frame_t* msg)
+  {
+  if (m_plan_generation != dbc_plan_generation)
+    Compile();
+
+  uint64_t le, be;
+  dbc_load_words(msg, le, be);
+  dbc_decode_metrics(m_plan.data(), m_plan.data() + m_plan_common, le, be);
+  if (!m_plan_groups.empty())
+    {
+    const dbcMuxGroup_t* group = FindMuxGroup((uint32_t)dbc_decode_raw(m_plan_mux, le, be));
+    if (group)
+      dbc_decode_metrics(m_plan.data() + group->begin, m_plan.data() + group->end, le, be);
+    }
+  }
+
+/**
+ * DecodeValues: decode all signals of the frame
+ *  values: array of at least m_signals.size() entries, filled in signal order,
+ *    multiplexed signals not active in the frame are cleared (undefined)
+ *  Returns the number of signals decoded.
+ */
+int dbcMessage::DecodeValues(CAN_frame_t* msg, dbcNumber* values)
+  {
+  if (m_plan_generation != dbc_plan_generation)
+    Compile();
+
+  uint64_t le, be;
+  dbc_load_words(msg, le, be);
+
+  int count = 0;
+  for (size_t k = 0; k < m_plan_common; k++)
+    {
+    const dbcDecodeStep_t& step = m_plan[k];
+    dbc_decode_value(step, dbc_decode_raw(step, le, be), values[step.index]);
+    count++;
+    }
+  if (!m_plan_groups.empty())
+    {
+    for (size_t k = m_plan_common; k < m_plan.size(); k++)
+      values[m_plan[k].index].Clear();
+    const dbcMuxGroup_t* group = FindMuxGroup((uint32_t)dbc_decode_raw(m_plan_mux, le, be));
+    if (group)
+      {
+      for (size_t k = group->begin; k < group->end; k++)
+        {
+        const dbcDecodeStep_t& step = m_plan[k];
+        dbc_decode_value(step, dbc_decode_raw(step, le, be), values[step.index]);
+        count++;
+        }
+      }
+    }
+  return count;
+  }
+
+/**
+ * InitFrame: initialize a frame for the message
+ *  Sets ID, format & length from the message definition, clears the data.
+ */
+void dbcMessage::InitFrame(CAN_frame_t* msg)
+  {
+  memset(msg, 0, sizeof(*msg));
+  msg->FIR.B.FF = GetFormat();
+  msg->FIR.B.DLC = (m_size > 8) ? 8 : m_size;
+  msg->MsgID = m_id & 0x1FFFFFFF;
+  }
+
+/**
+ * SetCounterSignal: set the rolling counter signal (NULL = none)
+ *  The counter is encoded by EncodeValues() with an internal counter value
+ *  incremented per call, wrapping at the signal size.
+ */
+void dbcMessage::SetCounterSignal(dbcSignal* signal)
+  {
+  m_counter_signal = signal;
+  m_counter = 0;
+  m_encplan_generation = 0;
+  }
+
+/**
+ * SetChecksumSignal: set the checksum signal and calculation (NULL = none)
+ *  The callback is called by EncodeValues() after all other signals have
+ *  been encoded, with the checksum signal cleared. It returns the raw
+ *  checksum value, e.g. for an XOR over bytes 0-6:
+ *    msg->SetChecksumSignal(sig, [](dbcMessage* m, const CAN_frame_t* f) -> uint64_t
+ *      { uint8_t x = 0; for (int i = 0; i < 7; i++) x ^= f->data.u8[i]; return x; });
+ */
+void dbcMessage::SetChecksumSignal(dbcSignal* signal, dbcChecksumCallback callback)
+  {
+  m_checksum_signal = signal;
+  m_checksum = callback;
+  m_encplan_generation = 0;
+  }
+
+/**
+ * CompileEncoder: build the encode plan for all signals of the message
+ *  Automatically done on encoding after changes.
+ */
+void dbcMessage::CompileEncoder()
+  {
+  m_encplan.resize(m_signals.size());
+  m_encplan_mux = m_encplan_counter = m_encplan_checksum = -1;
+  int i = 0;
+  for (dbcSignal* signal : m_signals)
+    {
+    signal->CompileEncoder(m_encplan[i]);
+    if (signal == m_multiplexor)
+      m_encplan_mux = i;
+    else if (!m_multiplexor)
+      m_encplan[i].flags &= ~DBC_DECODE_MULTIPLEXED;
+    if (signal == m_counter_signal)
+      m_encplan_counter = i;
+    if (signal == m_checksum_signal && m_checksum)
+      m_encplan_checksum = i;
+    i++;
+    }
+  m_encplan_generation = dbc_plan_generation;
+  }
+
+/**
+ * EncodeValues: encode physical values into the frame in one pass
+ *  values: array of m_signals.size() entries in signal order, undefined
+ *    values leave the signal unchanged in the frame.
+ *  For multiplexed messages, the multiplexor value is taken from values or,
+ *  if undefined there, from the frame; multiplexed signals not active on
+ *  that value are skipped. Counter & checksum signals are set automatically
+ *  (see SetCounterSignal() & SetChecksumSignal()).
+ *  Returns the number of signals encoded.
+ */
+int dbcMessage::EncodeValues(CAN_frame_t* msg, const dbcNumber* values)
+  {
+  if (m_encplan_generation != dbc_plan_generation)
+    CompileEncoder();
+
+  uint64_t raw, set[2] = { 0, 0 }, clear[2] = { 0, 0 };
+  int count = 0;
+
+  uint32_t muxval = 0;
+  if (m_encplan_mux >= 0)
+    {
+    const dbcEncodeStep_t& step = m_encplan[m_encplan_mux];
+    if ((step.flags & DBC_DECODE_INVALID) == 0)
+      {
+      if (dbc_encode_raw(step, values[m_encplan_mux], raw))
+        muxval = raw & step.mask;
+      else
+        muxval = ((((step.flags & DBC_DECODE_BIGENDIAN) ? __builtin_bswap64(msg->data.u64)
+          : msg->data.u64) >> step.shift) & step.mask);
+      }
+    }
+
+  for (size_t i = 0; i < m_encplan.size(); i++)
+    {
+    const dbcEncodeStep_t& step = m_encplan[i];
+    if (step.flags & DBC_DECODE_INVALID)
+      continue;
+    if ((step.flags & DBC_DECODE_MULTIPLEXED) && step.switchvalue != muxval)
+      continue;
+    if ((int)i == m_encplan_counter)
+      raw = m_counter++;
+    else if ((int)i == m_encplan_checksum)
+      raw = 0;
+    else if (!dbc_encode_raw(step, values[i], raw))
+      continue;
+    dbc_encode_insert(step, raw, set, clear);
+    count++;
+    }
+  dbc_encode_apply(msg, set, clear);
+
+  if (m_encplan_checksum >= 0)
+    {
+    const dbcEncodeStep_t& step = m_encplan[m_encplan_checksum];
+    set[0] = set[1] = clear[0] = clear[1] = 0;
+    dbc_encode_insert(step, m_checksum(this, msg), set, clear);
+    dbc_encode_apply(msg, set, clear);
+    }
+
+  return count;
   }
 
 void dbcMessage::WriteFile(dbcOutputCallback callback, void* param)
@@ -1153,6 +1750,8 @@ void dbcMessage::WriteFileValues(dbcOutputCallback callback, void* param)
 
 dbcMessageTable::dbcMessageTable()
   {
+  m_indexed = false;
+  m_extshift = 32;
   }
 
 dbcMessageTable::~dbcMessageTable()
@@ -1163,6 +1762,7 @@ dbcMessageTable::~dbcMessageTable()
 void dbcMessageTable::AddMessage(uint32_t id, dbcMessage* message)
   {
   m_entrymap[id] = message;
+  m_indexed = false;
   }
 
 void dbcMessageTable::RemoveMessage(uint32_t id, bool free)
@@ -1172,30 +1772,113 @@ void dbcMessageTable::RemoveMessage(uint32_t id, bool free)
     {
     if (free) delete search->second;
     m_entrymap.erase(search);
+    m_indexed = false;
+    }
+  }
+
+static inline uint32_t dbc_hash_id(uint32_t id, uint32_t shift)
+  {
+  return (id * 0x9E3779B1u) >> shift;
+  }
+
+/**
+ * BuildIndex: build the receive lookup tables
+ *  Standard IDs are looked up directly in a 2048 entry table (only allocated
+ *  if the DBC defines standard ID messages), extended IDs in an open
+ *  addressed hash table with linear probing, sized to a load factor <= 50%.
+ */
+void dbcMessageTable::BuildIndex()
+  {
+  m_stdindex.clear();
+  m_indexlist.clear();
+  m_extindex.clear();
+  m_extshift = 32;
+
+  int extcount = 0;
+  for (auto& it : m_entrymap)
+    {
+    if (it.first & 0x80000000)
+      extcount++;
+    else if (it.first < 2048)
+      m_indexlist.push_back(it.second);
+    }
+
+  if (!m_indexlist.empty())
+    {
+    m_stdindex.assign(2048, 0);
+    for (size_t i = 0; i < m_indexlist.size(); i++)
+      m_stdindex[m_indexlist[i]->GetID()] = i + 1;
+    }
+
+  if (extcount > 0)
+    {
+    uint32_t bits = 2;
+    while ((1u << bits) < (uint32_t)extcount * 2)
+      bits++;
+    m_extshift = 32 - bits;
+    m_extindex.assign(1u << bits, { 0, NULL });
+    uint32_t mask = (1u << bits) - 1;
+    for (auto& it : m_entrymap)
+      {
+      if (!(it.first & 0x80000000))
+        continue;
+      uint32_t pos = dbc_hash_id(it.first, m_extshift);
+      while (m_extindex[pos].id != 0)
+        pos = (pos + 1) & mask;
+      m_extindex[pos] = { it.first, it.second };
+      }
+    }
+
+  m_indexed = true;
+  }
+
+dbcMessage* dbcMessageTable::FindExtended(uint32_t id)
+  {
+  if (m_extindex.empty())
+    return NULL;
+  uint32_t mask = m_extindex.size() - 1;
+  uint32_t pos = dbc_hash_id(id, m_extshift);
+  while (true)
+    {
+    const dbcMessageHashEntry_t& entry = m_extindex[pos];
+    if (entry.id == id)
+      return entry.message;
+    if (entry.id == 0)
+      return NULL;
+    pos = (pos + 1) & mask;
     }
   }
 
 dbcMessage* dbcMessageTable::FindMessage(uint32_t id)
   {
-  auto search = m_entrymap.find(id);
-  if (search != m_entrymap.end())
-    return search->second;
+  if (id & 0x80000000)
+    return FindMessage(CAN_frame_ext, id);
   else
-    return NULL;
+    return FindMessage(CAN_frame_std, id);
   }
 
+/**
+ * FindMessage: receive lookup
+ *  A standard ID frame costs one table load if the ID is not defined.
+ */
 dbcMessage* dbcMessageTable::FindMessage(CAN_frame_format_t format, uint32_t id)
   {
+  if (!m_indexed)
+    BuildIndex();
+
   if (format == CAN_frame_ext)
-    id |= 0x80000000;
-  else
-    id &= 0x7FFFFFFF;
+    return FindExtended(id | 0x80000000);
 
-  auto search = m_entrymap.find(id);
-  if (search != m_entrymap.end())
-    return search->second;
-  else
+  if (id >= 2048)
+    {
+    // Out of range standard IDs are not indexed, use the map:
+    auto it = m_entrymap.find(id);
+    return (it != m_entrymap.end()) ? it->second : NULL;
+    }
+  if (id >= m_stdindex.size())
     return NULL;
+  uint16_t pos = m_stdindex[id];
+  return pos ? m_indexlist[pos-1] : NULL;
   }
 
 void dbcMessageTable::Count(int* messages, int* signals, int* bits, int* covered)
@@ -1217,6 +1900,15 @@ void dbcMessageTable::Count(int* messages, int* signals, int* bits, int* covered
     }
   }
 
+void dbcMessageTable::Compile()
+  {
+  for (dbcMessageEntry_t::iterator itt = m_entrymap.begin();
+       itt != m_entrymap.end();
+       itt++)
+    itt->second->Compile();
+  BuildIndex();
+  }
+
 void dbcMessageTable::EmptyContent()
   {
   dbcMessageEntry_t::iterator it=m_entrymap.begin();
@@ -1226,6 +1918,10 @@ void dbcMessageTable::EmptyContent()
     ++it;
     }
   m_entrymap.clear();
+  m_indexed = false;
+  m_stdindex.clear();
+  m_indexlist.clear();
+  m_extindex.clear();
   }
 
 void dbcMessageTable::WriteFile(dbcOutputCallback callback, void* param)
@@ -1266,6 +1962,9 @@ void dbcMessageTable::WriteSummary(dbcOutputCallback callback, void* param)
 dbcfile::dbcfile()
   {
   m_locks = 0;
+  m_cached = false;
+  memset(&m_stats_source, 0, sizeof(m_stats_source));
+  memset(&m_stats_cache, 0, sizeof(m_stats_cache));
   }
 
 dbcfile::~dbcfile()
@@ -1282,12 +1981,20 @@ void dbcfile::FreeAllocations()
   m_values.EmptyContent();
   m_messages.EmptyContent();
   m_comments.EmptyContent();
+  m_cached = false;
   }
 
-bool dbcfile::LoadFile(const char* name, const char* path, FILE* fd)
+/**
+ * LoadFile: load a DBC source file
+ *  usecache: load from the binary cache (see dbc_cache.cpp) if it is valid
+ *    for the source, else parse the source and (re)generate the cache.
+ */
+bool dbcfile::LoadFile(const char* name, const char* path, FILE* fd, bool usecache)
   {
   FreeAllocations();
   m_name = std::string(name);
+  memset(&m_stats_source, 0, sizeof(m_stats_source));
+  memset(&m_stats_cache, 0, sizeof(m_stats_cache));
 
 #ifdef CONFIG_OVMS
   if (MyConfig.ProtectedPath(path))
@@ -1302,6 +2009,18 @@ bool dbcfile::LoadFile(const char* name, const char* path, FILE* fd)
   bool result;
   m_path = path;
 
+  int64_t start = dbc_time_us();
+  size_t heap = dbc_heap_free();
+  if (fd == NULL && usecache)
+    {
+    if (LoadCache(CachePath(m_path)))
+      {
+      dbc_set_stats(m_stats_cache, start, heap);
+      return true;
+      }
+    start = dbc_time_us();
+    }
+
   if (fd == NULL)
     {
     fd = fopen(path, "r");
@@ -1324,6 +2043,13 @@ bool dbcfile::LoadFile(const char* name, const char* path, FILE* fd)
     fseek(fd,0,SEEK_SET);
     }
 
+  if (result)
+    {
+    m_messages.Compile();
+    dbc_set_stats(m_stats_source, start, heap);
+    if (usecache)
+      WriteCache(CachePath(m_path));
+    }
   return result;
   }
 
@@ -1339,6 +2065,7 @@ bool dbcfile::LoadString(const char* name, const char* source, size_t length)
   bool result = (yyparse (this) == 0);
   yy_delete_buffer(buffer);
 
+  if (result) m_messages.Compile();
   return result;
   }
 
@@ -1394,6 +2121,22 @@ std::string dbcfile::Status()
   ss << ", ";
   ss << m_locks;
   ss << " lock(s)";
+  if (m_cached)
+    {
+    ss << ", cache load ";
+    ss << m_stats_cache.time_us / 1000;
+    ss << " ms ";
+    ss << (m_stats_cache.heap + 512) / 1024;
+    ss << " kB";
+    }
+  if (m_stats_source.time_us > 0)
+    {
+    ss << ", source parse ";
+    ss << m_stats_source.time_us / 1000;
+    ss << " ms ";
+    ss << (m_stats_source.heap + 512) / 1024;
+    ss << " kB";
+    }
 
   return ss.str();
   }
@@ -1413,6 +2156,11 @@ std::string dbcfile::GetVersion()
   return m_version;
   }
 
+bool dbcfile::IsCached()
+  {
+  return m_cached;
+  }
+
 void dbcfile::LockFile()
   {
   m_locks++;
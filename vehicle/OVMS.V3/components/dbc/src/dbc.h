@@ -34,6 +34,7 @@
 #include <string>
 #include <map>
 #include <list>
+#include <vector>
 #include <functional>
 #include <iostream>
 #include "dbc_number.h"
@@ -71,6 +72,108 @@ typedef enum
 
 uint32_t dbcMessageIdFromString(const char* id);
 
+/**
+ * dbcDecodeStep_t: compiled signal decoder (see dbcSignal::Compile())
+ *  The signal is extracted from the frame data loaded as a 64 bit word in
+ *  the signal byte order by a shift & mask, sign extended if signed, and
+ *  scaled by a fused multiply & add in the cheapest exact number format.
+ */
+typedef enum
+  {
+  DBC_SCALE_INT=0,                    // integer factor & offset, size <= 32 bits
+  DBC_SCALE_FLOAT=1,                  // size <= 24 bits
+  DBC_SCALE_DOUBLE=2
+  } dbcScaleMode_t;
+
+#define DBC_DECODE_BIGENDIAN    0x01
+#define DBC_DECODE_SIGNED       0x02
+#define DBC_DECODE_MULTIPLEXED  0x04
+#define DBC_DECODE_INVALID      0x08  // signal exceeds frame data, decodes as 0
+
+/**
+ * dbcPublishPolicy_t: metric publishing policy of a signal
+ *  Evaluated on decoding before the metric is set, to reduce metric updates
+ *  from high frequency signals: a new value is only published if it differs
+ *  from the last published value by at least the absolute or relative
+ *  deadband, and if at least the interval has passed since the last update.
+ *  With averaging, the mean value over the interval is published instead.
+ *  Unchanged values are published at least every DBC_POLICY_REFRESH_US to
+ *  keep the metric from becoming stale.
+ */
+#define DBC_POLICY_REFRESH_US   10000000
+
+struct dbcPublishPolicy_t
+  {
+  bool active;
+  bool average;                       // publish mean value over interval
+  double deadband;                    // absolute deadband, 0 = none
+  double deadband_rel;                // relative deadband (fraction of last value), 0 = none
+  int64_t interval_us;                // min update interval, 0 = none
+  bool published;
+  double last;                        // last value published
+  int64_t last_time;                  // time of last publish [us]
+  int64_t window;                     // start of current interval [us]
+  double sum;                         // averaging
+  uint32_t count;
+  uint32_t cnt_published;             // statistics
+  uint32_t cnt_suppressed;
+  };
+
+class dbcSignal;
+struct dbcDecodeStep_t
+  {
+  uint64_t mask;
+  union
+    {
+    struct { int64_t factor, offset; } i;
+    struct { float factor, offset; } f;
+    struct { double factor, offset; } d;
+    } scale;
+  dbcSignal* signal;
+  OvmsMetric* metric;
+  dbcPublishPolicy_t* policy;
+  uint32_t switchvalue;
+  uint16_t index;                     // signal position in message
+  uint8_t shift;
+  uint8_t bits;
+  uint8_t flags;
+  uint8_t mode;                       // dbcScaleMode_t
+  };
+typedef std::vector<dbcDecodeStep_t> dbcDecodePlan_t;
+
+struct dbcMuxGroup_t
+  {
+  uint32_t switchvalue;
+  uint16_t begin;                     // plan steps [begin,end) active on switchvalue
+  uint16_t end;
+  };
+typedef std::vector<dbcMuxGroup_t> dbcMuxGroupList_t;
+
+/**
+ * dbcEncodeStep_t: compiled signal encoder (see dbcSignal::CompileEncoder())
+ *  The physical value is translated to the raw value by (value - offset) *
+ *  1/factor, rounded and clamped to the raw range, which is the signal
+ *  range [min|max] (if defined) limited to the range the signal bits can
+ *  hold. The raw value is then inserted at the decoder position.
+ */
+struct dbcEncodeStep_t
+  {
+  uint64_t mask;
+  double factor;                      // 1 / signal factor
+  double offset;
+  double rawmin;
+  double rawmax;
+  dbcSignal* signal;
+  uint32_t switchvalue;
+  uint8_t shift;
+  uint8_t bits;
+  uint8_t flags;                      // DBC_DECODE_*
+  };
+typedef std::vector<dbcEncodeStep_t> dbcEncodePlan_t;
+
+class dbcMessage;
+typedef std::function<uint64_t(dbcMessage* message, const CAN_frame_t* frame)> dbcChecksumCallback;
+
 typedef std::list<std::string> dbcCommentList_t;
 class dbcCommentTable
   {
@@ -300,11 +403,18 @@ class dbcSignal
 
   public:
     void Encode(dbcNumber* source, CAN_frame_t* msg);
+    void EncodeRaw(int64_t raw, CAN_frame_t* msg);
     dbcNumber Decode(CAN_frame_t* msg);
+    int64_t DecodeRaw(CAN_frame_t* msg);
+    void Compile(dbcDecodeStep_t& step);
+    void CompileEncoder(dbcEncodeStep_t& step);
 
   public:
     void AssignMetric(OvmsMetric* metric);
     OvmsMetric* GetMetric();
+    void SetPolicy(double deadband, double deadband_rel, uint32_t interval_ms, bool average);
+    void ClearPolicy();
+    dbcPublishPolicy_t* GetPolicy();
 
   public:
     void WriteFile(dbcOutputCallback callback, void* param);
@@ -329,6 +439,7 @@ class dbcSignal
     dbcNumber m_maximum;
     std::string m_unit;
     OvmsMetric* m_metric;
+    dbcPublishPolicy_t* m_policy;     // allocated on first use, kept until destruction
   };
 
 typedef std::list<dbcSignal*> dbcSignalList_t;
@@ -346,6 +457,18 @@ class dbcMessage
     dbcSignal* FindSignal(std::string name);
     void Count(int* signals, int* bits, int* covered);
 
+  public:
+    void Compile();
+    void DecodeMetrics(CAN_frame_t* msg);
+    int DecodeValues(CAN_frame_t* msg, dbcNumber* values);
+
+  public:
+    void InitFrame(CAN_frame_t* msg);
+    int EncodeValues(CAN_frame_t* msg, const dbcNumber* values);
+    void SetCounterSignal(dbcSignal* signal);
+    void SetChecksumSignal(dbcSignal* signal, dbcChecksumCallback callback);
+    void CompileEncoder();
+
   public:
     void AddComment(const std::string& comment);
     void AddComment(const char* comment);
@@ -383,9 +506,33 @@ class dbcMessage
     std::string m_name;
     int m_size;
     std::string m_transmitter_node;
+    dbcDecodePlan_t m_plan;           // compiled decoders: unmultiplexed, then grouped by switch value
+    dbcMuxGroupList_t m_plan_groups;  // multiplexed plan groups, sorted by switch value
+    uint16_t m_plan_common;           // number of unmultiplexed steps at plan start
+    dbcDecodeStep_t m_plan_mux;       // compiled decoder of m_multiplexor
+    uint32_t m_plan_generation;       // signal definitions generation compiled
+    dbcEncodePlan_t m_encplan;        // compiled encoders of m_signals (same order)
+    uint32_t m_encplan_generation;
+    int m_encplan_mux;                // encoder index of multiplexor, -1 = none
+    int m_encplan_counter;            // encoder index of counter signal, -1 = none
+    int m_encplan_checksum;           // encoder index of checksum signal, -1 = none
+    dbcSignal* m_counter_signal;      // rolling counter, incremented per EncodeValues()
+    uint32_t m_counter;
+    dbcSignal* m_checksum_signal;     // checksum, calculated by callback after encoding
+    dbcChecksumCallback m_checksum;
+
+  protected:
+    const dbcMuxGroup_t* FindMuxGroup(uint32_t switchvalue);
   };
 
 typedef std::map<uint32_t, dbcMessage*> dbcMessageEntry_t;
+
+struct dbcMessageHashEntry_t
+  {
+  uint32_t id;                        // 0 = empty
+  dbcMessage* message;
+  };
+
 class dbcMessageTable
   {
   public:
@@ -398,6 +545,7 @@ class dbcMessageTable
     dbcMessage* FindMessage(uint32_t id);
     dbcMessage* FindMessage(CAN_frame_format_t format, uint32_t id);
     void Count(int* messages, int* signals, int* bits, int* covered);
+    void Compile();
 
   public:
     void EmptyContent();
@@ -408,8 +556,26 @@ class dbcMessageTable
     void WriteFileValues(dbcOutputCallback callback, void* param);
     void WriteSummary(dbcOutputCallback callback, void* param);
 
+  protected:
+    void BuildIndex();
+    dbcMessage* FindExtended(uint32_t id);
+
   public:
     dbcMessageEntry_t m_entrymap;
+
+  protected:
+    // Receive lookup index, rebuilt on the next lookup after changes:
+    bool m_indexed;
+    std::vector<uint16_t> m_stdindex;                 // 11 bit ID → m_indexlist position + 1, 0 = none
+    std::vector<dbcMessage*> m_indexlist;             // standard ID messages
+    std::vector<dbcMessageHashEntry_t> m_extindex;    // extended ID messages (open addressing)
+    uint32_t m_extshift;                              // hash shift (32 - log2(size))
+  };
+
+struct dbcLoadStats_t
+  {
+  uint32_t time_us;                   // load duration, 0 = unknown
+  uint32_t heap;                      // heap used by the loaded content [bytes]
   };
 
 class dbcfile
@@ -422,7 +588,7 @@ class dbcfile
     void FreeAllocations();
 
   public:
-    bool LoadFile(const char* name, const char* path, FILE *fd=NULL);
+    bool LoadFile(const char* name, const char* path, FILE *fd=NULL, bool usecache=false);
     bool LoadString(const char* name, const char* source, size_t length);
     void WriteFile(dbcOutputCallback callback, void* param);
     void WriteSummary(dbcOutputCallback callback, void* param);
@@ -430,6 +596,12 @@ class dbcfile
     std::string GetName();
     std::string GetPath();
     std::string GetVersion();
+    bool IsCached();
+
+  public:
+    static std::string CachePath(const std::string& path);
+    bool LoadCache(const std::string& path);
+    bool WriteCache(const std::string& path);
 
   public:
     void LockFile();
@@ -447,9 +619,14 @@ class dbcfile
     dbcMessageTable m_messages;
     dbcCommentTable m_comments;
 
+  public:
+    dbcLoadStats_t m_stats_source;    // parsing the DBC source
+    dbcLoadStats_t m_stats_cache;     // loading the binary cache
+
   private:
     dbcMessage* m_lastmsg;
     int m_locks;
+    bool m_cached;                    // loaded from cache: no comments, values, nodes & receivers
   };
 
 #endif //#ifndef __DBC_H__
@@ -35,8 +35,11 @@ static const char *TAG = "dbc-app";
 #include <list>
 #include <vector>
 #include <string>
+#include <memory>
 #include <sys/types.h>
 #include <dirent.h>
+#include <math.h>
+#include "esp_timer.h"
 #include "dbc.h"
 #include "dbc_app.h"
 #include "ovms_config.h"
@@ -57,6 +60,35 @@ void dbc_list(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, con
     }
   }
 
+void dbc_policy(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  OvmsMutexLock ldbc(&MyDBC.m_mutex);
+
+  int found = 0;
+  for (auto& file : MyDBC.m_dbclist)
+    {
+    for (auto& entry : file.second->m_messages.m_entrymap)
+      {
+      for (dbcSignal* sig : entry.second->m_signals)
+        {
+        dbcPublishPolicy_t* p = sig->GetPolicy();
+        if (!p || !sig->GetMetric()) continue;
+        uint32_t total = p->cnt_published + p->cnt_suppressed;
+        writer->printf("%s: %s: deadband %g%s, interval %u ms%s: %u published, %u suppressed (%u%%)
+",
+          file.first.c_str(), sig->GetMetric()->m_name,
+          (p->deadband_rel > 0) ? p->deadband_rel * 100 : p->deadband, (p->deadband_rel > 0) ? "%" : "",
+          (unsigned)(p->interval_us / 1000), p->average ? " avg" : "",
+          p->cnt_published, p->cnt_suppressed,
+          total ? (unsigned)((uint64_t)p->cnt_suppressed * 100 / total) : 0);
+        found++;
+        }
+      }
+    }
+  if (found == 0)
+    writer->puts("No DBC signal publishing policies active");
+  }
+
 void dbc_load(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
   {
   if (MyDBC.LoadFile(argv[0],argv[1]))
@@ -81,6 +113,25 @@ void dbc_unload(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, c
     }
   }
 
+/**
+ * dbc_full_content: get a DBC file with complete content for output
+ *  Files loaded from the binary cache lack comments, value tables & nodes,
+ *  for these the source is parsed into a temporary instance owned by full.
+ */
+static dbcfile* dbc_full_content(dbcfile* dbc, std::unique_ptr<dbcfile>& full)
+  {
+  if (!dbc->IsCached())
+    return dbc;
+  full.reset(new dbcfile());
+  if (!full->LoadFile(dbc->GetName().c_str(), dbc->GetPath().c_str()))
+    {
+    ESP_LOGW(TAG, "Cannot parse source of cached DBC %s", dbc->GetName().c_str());
+    full.reset();
+    return dbc;
+    }
+  return full.get();
+  }
+
 void dbc_show_callback(void* param, const char* buffer)
   {
   OvmsWriter* writer = (OvmsWriter*)param;
@@ -112,6 +163,9 @@ void dbc_show(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, con
 
   writer->printf("DBC:     %s\n",dbc->GetName().c_str());
 
+  std::unique_ptr<dbcfile> full;
+  dbc = dbc_full_content(dbc, full);
+
   using std::placeholders::_1;
   using std::placeholders::_2;
   dbc->WriteSummary(std::bind(dbc_show_callback,_1,_2), writer);
@@ -139,6 +193,9 @@ void dbc_dump(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, con
       }
     }
 
+  std::unique_ptr<dbcfile> full;
+  dbc = dbc_full_content(dbc, full);
+
   using std::placeholders::_1;
   using std::placeholders::_2;
   dbc->WriteFile(std::bind(dbc_show_callback,_1,_2), writer);
@@ -173,6 +230,13 @@ void dbc_save(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, con
       }
     }
 
+  // Never write a re-parsed source over the file: a cached DBC is unchanged
+  if (dbc->IsCached())
+    {
+    writer->printf("Error: DBC %s is loaded from cache and cannot be edited, nothing to save\n",dbc->GetName().c_str());
+    return;
+    }
+
   FILE* fd = fopen(dbc->m_path.c_str(), "w");
   if (fd == NULL)
     {
@@ -201,6 +265,16 @@ void dbc_sdmounted(std::string event, void* data)
     MyDBC.LoadAutoExtras(true);
   }
 
+void dbc_configchanged(std::string event, void* data)
+  {
+  if (event == "config.changed")
+    {
+    OvmsConfigParam* param = (OvmsConfigParam*) data;
+    if (!param || param->GetName() != "dbc") return;
+    }
+  MyDBC.ApplyPolicies();
+  }
+
 void dbc_select(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
   {
   if (argc == 0)
@@ -226,13 +300,31 @@ void dbc_deselect(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc,
   writer->puts("DBC deselected");
   }
 
-void dbc_set_version(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+/**
+ * dbc_editable: check the selected DBC file can be edited
+ *  A cached file in use is selected as loaded from the binary cache, it
+ *  lacks comments, value tables & nodes and cannot be saved.
+ */
+static bool dbc_editable(OvmsWriter* writer)
   {
   if (MyDBC.m_selected == NULL)
     {
     writer->puts("Error: No DBC selected");
-    return;
+    return false;
+    }
+  if (MyDBC.m_selected->IsCached())
+    {
+    writer->printf("Error: DBC %s is in use and loaded from cache, cannot edit\n",
+      MyDBC.m_selected->GetName().c_str());
+    return false;
     }
+  return true;
+  }
+
+void dbc_set_version(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  if (!dbc_editable(writer))
+    return;
 
   MyDBC.m_selected->m_version = std::string(argv[0]);
   writer->printf("DBC: Version set to '%s'\n",argv[0]);
@@ -240,11 +332,8 @@ void dbc_set_version(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int ar
 
 void dbc_set_timing(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
   {
-  if (MyDBC.m_selected == NULL)
-    {
-    writer->puts("Error: No DBC selected");
+  if (!dbc_editable(writer))
     return;
-    }
 
   MyDBC.m_selected->m_bittiming.SetBaud(atoi(argv[0]),atoi(argv[1]),atoi(argv[2]));
   writer->printf("DBC: Bit timing set to %s : %s,%s'\n",argv[0],argv[1],argv[2]);
@@ -252,11 +341,8 @@ void dbc_set_timing(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int arg
 
 void dbc_node_clear(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
   {
-  if (MyDBC.m_selected == NULL)
-    {
-    writer->puts("Error: No DBC selected");
+  if (!dbc_editable(writer))
     return;
-    }
 
   MyDBC.m_selected->m_nodes.EmptyContent();
   writer->puts("DBC: Node table cleared");
@@ -264,11 +350,8 @@ void dbc_node_clear(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int arg
 
 void dbc_node_add(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
   {
-  if (MyDBC.m_selected == NULL)
-    {
-    writer->puts("Error: No DBC selected");
+  if (!dbc_editable(writer))
     return;
-    }
 
   if (MyDBC.m_selected->m_nodes.FindNode(argv[0]) != NULL)
     {
@@ -283,11 +366,8 @@ void dbc_node_add(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc,
 
 void dbc_node_remove(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
   {
-  if (MyDBC.m_selected == NULL)
-    {
-    writer->puts("No DBC selected");
+  if (!dbc_editable(writer))
     return;
-    }
 
   dbcNode* node = MyDBC.m_selected->m_nodes.FindNode(argv[0]);
   if (node != NULL)
@@ -303,11 +383,8 @@ void dbc_node_remove(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int ar
 
 void dbc_message_clear(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
   {
-  if (MyDBC.m_selected == NULL)
-    {
-    writer->puts("Error: No DBC selected");
+  if (!dbc_editable(writer))
     return;
-    }
 
   MyDBC.m_selected->m_messages.EmptyContent();
   writer->puts("DBC: Message table cleared");
@@ -315,11 +392,8 @@ void dbc_message_clear(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int
 
 void dbc_message_add(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
   {
-  if (MyDBC.m_selected == NULL)
-    {
-    writer->puts("Error: No DBC selected");
+  if (!dbc_editable(writer))
     return;
-    }
 
   uint32_t msgid = dbcMessageIdFromString(argv[0]);
   if (MyDBC.m_selected->m_messages.FindMessage(msgid))
@@ -338,11 +412,8 @@ void dbc_message_add(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int ar
 
 void dbc_message_remove(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
   {
-  if (MyDBC.m_selected == NULL)
-    {
-    writer->puts("Error: No DBC selected");
+  if (!dbc_editable(writer))
     return;
-    }
 
   uint32_t msgid = dbcMessageIdFromString(argv[0]);
   dbcMessage* msg = MyDBC.m_selected->m_messages.FindMessage(msgid);
@@ -359,11 +430,8 @@ void dbc_message_remove(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int
 
 void dbc_message_set_mux(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
   {
-  if (MyDBC.m_selected == NULL)
-    {
-    writer->puts("Error: No DBC selected");
+  if (!dbc_editable(writer))
     return;
-    }
 
   uint32_t msgid = dbcMessageIdFromString(argv[0]);
   dbcMessage* msg = MyDBC.m_selected->m_messages.FindMessage(msgid);
@@ -393,11 +461,8 @@ void dbc_message_set_mux(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, in
 
 void dbc_signal_clear(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
   {
-  if (MyDBC.m_selected == NULL)
-    {
-    writer->puts("Error: No DBC selected");
+  if (!dbc_editable(writer))
     return;
-    }
 
   uint32_t msgid = dbcMessageIdFromString(argv[0]);
   dbcMessage* msg = MyDBC.m_selected->m_messages.FindMessage(msgid);
@@ -416,11 +481,8 @@ void dbc_signal_clear(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int a
 
 void dbc_signal_add(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
   {
-  if (MyDBC.m_selected == NULL)
-    {
-    writer->puts("Error: No DBC selected");
+  if (!dbc_editable(writer))
     return;
-    }
 
   uint32_t msgid = dbcMessageIdFromString(argv[0]);
   dbcMessage* msg = MyDBC.m_selected->m_messages.FindMessage(msgid);
@@ -454,11 +516,8 @@ void dbc_signal_add(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int arg
 
 void dbc_signal_remove(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
   {
-  if (MyDBC.m_selected == NULL)
-    {
-    writer->puts("Error: No DBC selected");
+  if (!dbc_editable(writer))
     return;
-    }
 
   uint32_t msgid = dbcMessageIdFromString(argv[0]);
   dbcMessage* msg = MyDBC.m_selected->m_messages.FindMessage(msgid);
@@ -483,11 +542,8 @@ void dbc_signal_remove(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int
 
 void dbc_signal_set_mux(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
   {
-  if (MyDBC.m_selected == NULL)
-    {
-    writer->puts("Error: No DBC selected");
+  if (!dbc_editable(writer))
     return;
-    }
 
   uint32_t msgid = dbcMessageIdFromString(argv[0]);
   dbcMessage* msg = MyDBC.m_selected->m_messages.FindMessage(msgid);
@@ -516,6 +572,187 @@ void dbc_signal_set_mux(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int
     }
   }
 
+// Reference bit by bit extraction, used to verify the compiled decoders
+static uint64_t dbc_benchmark_extract(const uint8_t* data, int start, int size, bool bigendian)
+  {
+  uint64_t value = 0;
+  if (bigendian)
+    {
+    // MSB first, walking down the byte, then on to bit 7 of the next byte
+    for (int n = 0, pos = start; n < size; n++)
+      {
+      value = (value << 1) | ((data[pos/8] >> (pos%8)) & 1);
+      pos = (pos % 8 == 0) ? pos + 15 : pos - 1;
+      }
+    }
+  else
+    {
+    for (int pos = start + size - 1; pos >= start; pos--)
+      value = (value << 1) | ((data[pos/8] >> (pos%8)) & 1);
+    }
+  return value;
+  }
+
+static void dbc_benchmark_insert(uint8_t* data, int start, int size, bool bigendian, uint64_t value)
+  {
+  if (bigendian)
+    {
+    for (int n = size-1, pos = start; n >= 0; n--)
+      {
+      data[pos/8] = (data[pos/8] & ~(1 << (pos%8))) | (((value >> n) & 1) << (pos%8));
+      pos = (pos % 8 == 0) ? pos + 15 : pos - 1;
+      }
+    }
+  else
+    {
+    for (int n = 0; n < size; n++)
+      data[(start+n)/8] = (data[(start+n)/8] & ~(1 << ((start+n)%8))) | (((value >> n) & 1) << ((start+n)%8));
+    }
+  }
+
+void dbc_benchmark(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  const int nsignals = 60;
+  int frames = (argc > 0) ? atoi(argv[0]) : 1000;
+  if (frames < 1)
+    {
+    cmd->PutUsage(writer);
+    return;
+    }
+
+  // Build a synthetic message covering all signal sizes, both byte orders,
+  // signed & unsigned, integer & fractional scaling:
+  uint32_t rnd = 12345;
+  auto rand32 = [&rnd]() { rnd = rnd * 1103515245 + 12345; return rnd >> 8; };
+  dbcMessage msg(0x123);
+  for (int i = 0; i < nsignals; i++)
+    {
+    dbcSignal* sig = new dbcSignal();
+    char name[16];
+    snprintf(name, sizeof(name), "bench%d", i);
+    sig->SetName(name);
+    int size = (i < 2) ? 64 - i : (i < 8) ? 32 + rand32() % 33 : 1 + rand32() % 24;
+    int lsb = rand32() % (65 - size);
+    if (i % 2)
+      {
+      int msb = lsb + size - 1;
+      sig->SetByteOrder(DBC_BYTEORDER_BIG_ENDIAN);
+      sig->SetStartSize((7 - msb / 8) * 8 + msb % 8, size);
+      }
+    else
+      {
+      sig->SetByteOrder(DBC_BYTEORDER_LITTLE_ENDIAN);
+      sig->SetStartSize(lsb, size);
+      }
+    sig->SetValueType((i % 3 == 0) ? DBC_VALUETYPE_SIGNED : DBC_VALUETYPE_UNSIGNED);
+    switch (i % 4)
+      {
+      case 0:   sig->SetFactorOffset(1.0, 0.0); break;
+      case 1:   sig->SetFactorOffset(0.1, 0.0); break;
+      case 2:   sig->SetFactorOffset(2.0, -40.0); break;
+      default:  sig->SetFactorOffset(0.25, 0.5); break;
+      }
+    msg.AddSignal(sig);
+    }
+  msg.Compile();
+
+  std::vector<CAN_frame_t> data(16);
+  for (CAN_frame_t& frame : data)
+    {
+    memset(&frame, 0, sizeof(frame));
+    frame.FIR.B.DLC = 8;
+    for (int k = 0; k < 8; k++)
+      frame.data.u8[k] = rand32();
+    }
+
+  // Verify:
+  std::vector<dbcNumber> values(nsignals);
+  int errors = 0;
+  for (CAN_frame_t& frame : data)
+    {
+    msg.DecodeValues(&frame, values.data());
+    int i = 0;
+    for (dbcSignal* sig : msg.m_signals)
+      {
+      bool bigendian = (sig->GetByteOrder() == DBC_BYTEORDER_BIG_ENDIAN);
+      int size = sig->GetSignalSize();
+      uint64_t raw = dbc_benchmark_extract(frame.data.u8, sig->GetStartBit(), size, bigendian);
+      if (sig->GetValueType() == DBC_VALUETYPE_SIGNED && size < 64 && (raw >> (size-1)))
+        raw |= UINT64_MAX << size;
+      double expect = ((sig->GetValueType() == DBC_VALUETYPE_SIGNED) ? (double)(int64_t)raw : (double)raw)
+        * sig->GetFactor().GetDouble() + sig->GetOffset().GetDouble();
+      double value = values[i].GetDouble();
+      if (sig->DecodeRaw(&frame) != (int64_t)raw || fabs(value - expect) > fabs(expect) * 1e-6 + 1e-6)
+        {
+        if (errors++ < 5)
+          writer->printf("ERROR: %s start %d size %d: got %g, expected %g\n",
+            sig->GetName().c_str(), sig->GetStartBit(), size, value, expect);
+        }
+      i++;
+      }
+    }
+
+  // Verify encoding of random raw values (up to 48 bits for exact doubles):
+  for (CAN_frame_t& frame : data)
+    {
+    for (dbcSignal* sig : msg.m_signals)
+      {
+      int size = sig->GetSignalSize();
+      if (size > 48) continue;
+      bool bigendian = (sig->GetByteOrder() == DBC_BYTEORDER_BIG_ENDIAN);
+      uint64_t raw = (((uint64_t)rand32() << 24) | rand32()) & ((1ULL << size) - 1);
+      int64_t sraw = raw;
+      if (sig->GetValueType() == DBC_VALUETYPE_SIGNED && (raw >> (size-1)))
+        sraw = (int64_t)(raw | (UINT64_MAX << size));
+      dbcNumber value((double)sraw * sig->GetFactor().GetDouble() + sig->GetOffset().GetDouble());
+      CAN_frame_t expect = frame, result = frame;
+      dbc_benchmark_insert(expect.data.u8, sig->GetStartBit(), size, bigendian, raw);
+      sig->Encode(&value, &result);
+      if (result.data.u64 != expect.data.u64)
+        {
+        if (errors++ < 5)
+          writer->printf("ERROR: %s start %d size %d: encoding %g failed\n",
+            sig->GetName().c_str(), sig->GetStartBit(), size, value.GetDouble());
+        }
+      }
+    }
+
+  // Measure:
+  int64_t start = esp_timer_get_time();
+  for (int n = 0; n < frames; n++)
+    {
+    CAN_frame_t* frame = &data[n % data.size()];
+    int i = 0;
+    for (dbcSignal* sig : msg.m_signals)
+      values[i++] = sig->Decode(frame);
+    }
+  int64_t time_signal = esp_timer_get_time() - start;
+
+  start = esp_timer_get_time();
+  for (int n = 0; n < frames; n++)
+    msg.DecodeValues(&data[n % data.size()], values.data());
+  int64_t time_plan = esp_timer_get_time() - start;
+
+  msg.DecodeValues(&data[0], values.data());
+  CAN_frame_t txframe;
+  msg.InitFrame(&txframe);
+  start = esp_timer_get_time();
+  for (int n = 0; n < frames; n++)
+    msg.EncodeValues(&txframe, values.data());
+  int64_t time_encode = esp_timer_get_time() - start;
+
+  msg.RemoveAllSignals(true);
+
+  writer->printf("DBC decode benchmark: %d signals, %d frames, %d verification errors\n",
+    nsignals, frames, errors);
+  writer->printf("  dbcSignal::Decode() per signal:  %7.2f us/frame  %6.0f ns/signal\n",
+    (double)time_signal / frames, (double)time_signal * 1000 / frames / nsignals);
+  writer->printf("  dbcMessage::DecodeValues() plan: %7.2f us/frame  %6.0f ns/signal\n",
+    (double)time_plan / frames, (double)time_plan * 1000 / frames / nsignals);
+  writer->printf("  dbcMessage::EncodeValues() plan: %7.2f us/frame  %6.0f ns/signal\n",
+    (double)time_encode / frames, (double)time_encode * 1000 / frames / nsignals);
+  }
+
 dbc::dbc()
   {
   ESP_LOGI(TAG, "Initialising DBC (4520)");
@@ -524,6 +761,7 @@ dbc::dbc()
   OvmsCommand* cmd_dbc = MyCommandApp.RegisterCommand("dbc","DBC framework");
 
   cmd_dbc->RegisterCommand("list", "List DBC status", dbc_list);
+  cmd_dbc->RegisterCommand("policy", "List DBC signal publishing policies", dbc_policy);
   cmd_dbc->RegisterCommand("load", "Load DBC file", dbc_load, "<name> <path>", 2, 2);
   cmd_dbc->RegisterCommand("unload", "Unload DBC file", dbc_unload, "<name>", 1, 1);
   cmd_dbc->RegisterCommand("save", "Save DBC file", dbc_save, "[<name>]", 0, 1);
@@ -532,6 +770,7 @@ dbc::dbc()
   cmd_dbc->RegisterCommand("autoload", "Autoload DBC files", dbc_autoload);
   cmd_dbc->RegisterCommand("select", "Select DBC file for editing", dbc_select, "[<name>]", 0, 1);
   cmd_dbc->RegisterCommand("deselect", "Deselect DBC file for editing", dbc_deselect);
+  cmd_dbc->RegisterCommand("benchmark", "Benchmark DBC signal decoding & encoding", dbc_benchmark, "[<frames>]", 0, 1);
 
   OvmsCommand* cmd_set = cmd_dbc->RegisterCommand("set","DBC Set framework");
   cmd_set->RegisterCommand("version", "Set version for selected DBC file", dbc_set_version, "<version>", 1, 1);
@@ -557,11 +796,17 @@ dbc::dbc()
   MyConfig.RegisterParam("dbc", "DBC Configuration", true, true);
   // Our instances:
   //   'autodirs': Space separated list of directories to auto load DBC files from
+  //   'cache': Load DBC files via binary cache files <path>.cache (default yes)
+  //   'policy.<metric>': Publishing policy for a DBC signal bound to the metric:
+  //      <deadband>[%] [<interval_ms> [avg]]
+  //      e.g. "0.5 100 avg": publish the 100 ms average if it changed by >= 0.5
 
   #undef bind  // Kludgy, but works
   using std::placeholders::_1;
   using std::placeholders::_2;
   MyEvents.RegisterEvent(TAG, "sd.mounted", std::bind(&dbc_sdmounted, _1, _2));
+  MyEvents.RegisterEvent(TAG, "config.mounted", std::bind(&dbc_configchanged, _1, _2));
+  MyEvents.RegisterEvent(TAG, "config.changed", std::bind(&dbc_configchanged, _1, _2));
   }
 
 dbc::~dbc()
@@ -569,12 +814,13 @@ dbc::~dbc()
   DeselectFile();
   }
 
-bool dbc::LoadFile(const char* name, const char* path)
+bool dbc::LoadFile(const char* name, const char* path, bool usecache)
   {
   OvmsMutexLock ldbc(&m_mutex);
 
+  usecache = usecache && MyConfig.GetParamValueBool("dbc", "cache", true);
   dbcfile* ndbc = new dbcfile();
-  if (!ndbc->LoadFile(name, path))
+  if (!ndbc->LoadFile(name, path, NULL, usecache))
     {
     delete ndbc;
     return false;
@@ -602,6 +848,7 @@ bool dbc::LoadFile(const char* name, const char* path)
       }
     }
 
+  ApplyPolicies(ndbc);
   return true;
   }
 
@@ -636,6 +883,7 @@ dbcfile* dbc::LoadString(const char* name, const char* content)
       }
     }
 
+  ApplyPolicies(ndbc);
   return ndbc;
   }
 
@@ -736,6 +984,27 @@ bool dbc::SelectFile(const char* name)
   dbcfile* select = Find(name);
   if (select == NULL) return false;
 
+  // Already selected: keep the loaded file
+  if (select == m_selected) return true;
+
+  if (select->IsCached() && select->IsLocked())
+    {
+    // In use (e.g. by vehicle_dbc), cannot be replaced: select the cached version
+    // read only (see dbc_editable)
+    ESP_LOGW(TAG,"DBC file %s is in use, selected cached version read only",name);
+    }
+  else if (select->IsCached())
+    {
+    // Editing needs the complete content, reload from source:
+    std::string path = select->GetPath();
+    if (!LoadFile(name, path.c_str(), false))
+      {
+      ESP_LOGE(TAG,"DBC file %s loaded from cache, cannot reload source for editing",name);
+      return false;
+      }
+    select = Find(name);
+    }
+
   DeselectFile();
   m_selected = select;
   m_selected->LockFile();
@@ -756,6 +1025,68 @@ dbcfile* dbc::SelectedFile()
   return m_selected;
   }
 
+/**
+ * ApplyPolicies: set the signal publishing policies from the configuration
+ *  Policies are defined per metric by config instances "policy.<metric>"
+ *  of param "dbc", and apply to all signals bound to the metric.
+ *  Only changed policies are set, so config changes don't reset the
+ *  publishing state & statistics of other signals.
+ */
+void dbc::ApplyPolicies()
+  {
+  OvmsMutexLock ldbc(&m_mutex);
+  for (auto& file : m_dbclist)
+    ApplyPolicies(file.second);
+  }
+
+void dbc::ApplyPolicies(dbcfile* dbc)
+  {
+  for (auto& entry : dbc->m_messages.m_entrymap)
+    {
+    for (dbcSignal* sig : entry.second->m_signals)
+      {
+      OvmsMetric* metric = sig->GetMetric();
+      if (!metric) continue;
+      std::string policy = MyConfig.GetParamValue("dbc", std::string("policy.") + metric->m_name);
+      if (policy.empty())
+        {
+        sig->ClearPolicy();
+        continue;
+        }
+      char* end;
+      double deadband = strtod(policy.c_str(), &end);
+      double deadband_rel = 0;
+      if (*end == '%')
+        {
+        deadband_rel = deadband / 100;
+        deadband = 0;
+        end++;
+        }
+      unsigned long interval = strtoul(end, &end, 10);
+      while (*end == ' ') end++;
+      bool average = (strcmp(end, "avg") == 0);
+      if (deadband < 0 || deadband_rel < 0 || (*end && !average))
+        {
+        ESP_LOGW(TAG, "Invalid policy for %s: '%s'", metric->m_name, policy.c_str());
+        sig->ClearPolicy();
+        continue;
+        }
+      // Keep the publishing state of unchanged policies:
+      dbcPublishPolicy_t* current = sig->GetPolicy();
+      if (current)
+        {
+        if (current->deadband == deadband && current->deadband_rel == deadband_rel &&
+            current->interval_us == (int64_t)interval * 1000 &&
+            current->average == (average && interval > 0))
+          continue;
+        }
+      else if (deadband == 0 && deadband_rel == 0 && interval == 0)
+        continue;
+      sig->SetPolicy(deadband, deadband_rel, interval, average);
+      }
+    }
+  }
+
 void dbc::AutoInit()
   {
   if (MyConfig.GetParamValueBool("auto", "dbc", false))
@@ -45,7 +45,7 @@ class dbc
     ~dbc();
 
   public:
-    bool LoadFile(const char* name, const char* path);
+    bool LoadFile(const char* name, const char* path, bool usecache=true);
     dbcfile* LoadString(const char* name, const char* content);
     bool Unload(const char* name);
     void LoadDirectory(const char* path, bool log=false);
@@ -60,6 +60,10 @@ class dbc
 
   public:
     void AutoInit();
+    void ApplyPolicies();
+
+  protected:
+    void ApplyPolicies(dbcfile* dbc);
 
   public:
     OvmsMutex m_mutex;
@@ -0,0 +1,378 @@
+/*
+;    Project:       Open Vehicle Monitor System
+;    Module:        DBC binary cache
+;    Date:          19th October 2026
+;
+;    (C) 2026       Open Vehicles Project
+;
+; Permission is hereby granted, free of charge, to any person obtaining a copy
+; of this software and associated documentation files (the "Software"), to deal
+; in the Software without restriction, including without limitation the rights
+; to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+; copies of the Software, and to permit persons to whom the Software is
+; furnished to do so, subject to the following conditions:
+;
+; The above copyright notice and this permission notice shall be included in
+; all copies or substantial portions of the Software.
+;
+; THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+; IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+; FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+; AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+; LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+; OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+; THE SOFTWARE.
+*/
+
+#include "ovms_log.h"
+static const char *TAG = "dbc";
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "dbc.h"
+
+/**
+ * The binary cache holds what decoding and metric binding need: bit timing,
+ * version, messages (ID, name, size, multiplexor) and signals (name, unit,
+ * layout, multiplexing, factor, offset, min, max). Comments, value tables,
+ * nodes, receivers and transmitters are not cached; commands needing them
+ * parse the source on demand.
+ *
+ * The cache is written next to the source as "<path>.cache" after parsing
+ * and is valid as long as size, mtime and FNV-1a hash of the source match.
+ * It is read as a stream of fixed size records, so loading needs no buffer
+ * besides the string table. Numbers are stored in native byte order, the
+ * cache is not meant to be portable.
+ *
+ * Layout:
+ *    dbc_cache_header_t
+ *    string table (NUL terminated strings, offset 0 = version)
+ *    per message: dbc_cache_message_t, followed by its dbc_cache_signal_t
+ */
+
+#define DBC_CACHE_MAGIC     0x4344564f    // "OVDC"
+#define DBC_CACHE_VERSION   1
+
+struct dbc_cache_header_t
+  {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t reserved;
+  uint32_t src_size;
+  uint32_t src_mtime;
+  uint32_t src_hash;
+  uint32_t src_time_us;               // source parse stats
+  uint32_t src_heap;
+  uint32_t baudrate;
+  uint32_t btr1;
+  uint32_t btr2;
+  uint32_t messages;
+  uint32_t signals;
+  uint32_t strings;                   // string table size
+  };
+
+struct dbc_cache_message_t
+  {
+  uint32_t id;
+  uint32_t name;                      // string table offset
+  uint16_t size;
+  uint16_t signals;
+  };
+
+struct dbc_cache_signal_t
+  {
+  uint32_t name;                      // string table offset
+  uint32_t unit;                      // string table offset
+  uint32_t switchvalue;
+  uint16_t start;
+  uint8_t size;
+  uint8_t byteorder;
+  uint8_t valuetype;
+  uint8_t mux;                        // dbcMultiplex_t
+  uint8_t types[4];                   // dbcNumberType_t of factor, offset, min, max
+  uint16_t reserved;
+  double values[4];
+  };
+
+struct dbc_source_t
+  {
+  uint32_t size;
+  uint32_t mtime;
+  uint32_t hash;
+  };
+
+static bool dbc_source_stat(const std::string& path, dbc_source_t& src)
+  {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0)
+    return false;
+  src.size = st.st_size;
+  src.mtime = st.st_mtime;
+  return true;
+  }
+
+static bool dbc_source_hash(const std::string& path, dbc_source_t& src)
+  {
+  FILE* f = fopen(path.c_str(), "r");
+  if (!f)
+    return false;
+  uint32_t hash = 2166136261u;
+  uint8_t buf[512];
+  size_t len;
+  while ((len = fread(buf, 1, sizeof(buf), f)) > 0)
+    {
+    for (size_t i = 0; i < len; i++)
+      hash = (hash ^ buf[i]) * 16777619u;
+    }
+  fclose(f);
+  src.hash = hash;
+  return true;
+  }
+
+static void dbc_number_store(dbcNumber n, uint8_t& type, double& value)
+  {
+  if (n.IsSignedInteger())
+    {
+    type = DBC_NUMBER_INTEGER_SIGNED;
+    value = n.GetSignedInteger();
+    }
+  else if (n.IsUnsignedInteger())
+    {
+    type = DBC_NUMBER_INTEGER_UNSIGNED;
+    value = n.GetUnsignedInteger();
+    }
+  else if (n.IsDouble())
+    {
+    type = DBC_NUMBER_DOUBLE;
+    value = n.GetDouble();
+    }
+  else
+    {
+    type = DBC_NUMBER_NONE;
+    value = 0;
+    }
+  }
+
+static dbcNumber dbc_number_load(uint8_t type, double value)
+  {
+  switch (type)
+    {
+    case DBC_NUMBER_INTEGER_SIGNED:   return dbcNumber((int32_t)value);
+    case DBC_NUMBER_INTEGER_UNSIGNED: return dbcNumber((uint32_t)value);
+    case DBC_NUMBER_DOUBLE:           return dbcNumber(value);
+    default:                          return dbcNumber();
+    }
+  }
+
+static uint32_t dbc_string_add(std::string& strings, const std::string& s)
+  {
+  uint32_t offset = strings.size();
+  strings.append(s.c_str(), s.size() + 1);
+  return offset;
+  }
+
+std::string dbcfile::CachePath(const std::string& path)
+  {
+  return path + ".cache";
+  }
+
+/**
+ * LoadCache: load the DBC content from the binary cache
+ *  Fails if the cache does not exist, is invalid or outdated.
+ */
+bool dbcfile::LoadCache(const std::string& path)
+  {
+  dbc_source_t src;
+  if (!dbc_source_stat(m_path, src))
+    return false;
+
+  FILE* f = fopen(path.c_str(), "r");
+  if (!f)
+    return false;
+
+  dbc_cache_header_t hdr;
+  if (fread(&hdr, sizeof(hdr), 1, f) != 1 ||
+      hdr.magic != DBC_CACHE_MAGIC || hdr.version != DBC_CACHE_VERSION ||
+      hdr.src_size != src.size || hdr.src_mtime != src.mtime ||
+      hdr.strings == 0 || !dbc_source_hash(m_path, src) || hdr.src_hash != src.hash)
+    {
+    fclose(f);
+    ESP_LOGD(TAG, "Cache %s invalid or outdated", path.c_str());
+    return false;
+    }
+
+  char* strings = (char*)malloc(hdr.strings);
+  bool ok = (strings && fread(strings, hdr.strings, 1, f) == 1 && strings[hdr.strings-1] == 0);
+  if (ok)
+    {
+    m_version = strings;
+    m_bittiming.SetBaud(hdr.baudrate, hdr.btr1, hdr.btr2);
+    }
+
+  uint32_t signals = 0;
+  for (uint32_t i = 0; ok && i < hdr.messages; i++)
+    {
+    dbc_cache_message_t mrec;
+    if (fread(&mrec, sizeof(mrec), 1, f) != 1 || mrec.name >= hdr.strings)
+      {
+      ok = false;
+      break;
+      }
+    dbcMessage* msg = new dbcMessage(mrec.id);
+    msg->SetName(strings + mrec.name);
+    msg->SetSize(mrec.size);
+    m_messages.AddMessage(mrec.id, msg);
+
+    for (int k = 0; k < mrec.signals; k++)
+      {
+      dbc_cache_signal_t srec;
+      if (fread(&srec, sizeof(srec), 1, f) != 1 ||
+          srec.name >= hdr.strings || srec.unit >= hdr.strings)
+        {
+        ok = false;
+        break;
+        }
+      dbcSignal* sig = new dbcSignal();
+      sig->SetName(strings + srec.name);
+      if (srec.mux == DBC_MUX_MULTIPLEXED)
+        sig->SetMultiplexed(srec.switchvalue);
+      else if (srec.mux == DBC_MUX_MULTIPLEXOR)
+        msg->SetMultiplexorSignal(sig);
+      sig->SetStartSize(srec.start, srec.size);
+      sig->SetByteOrder((dbcByteOrder_t)srec.byteorder);
+      sig->SetValueType((dbcValueType_t)srec.valuetype);
+      sig->SetFactorOffset(dbc_number_load(srec.types[0], srec.values[0]),
+                           dbc_number_load(srec.types[1], srec.values[1]));
+      sig->SetMinMax(dbc_number_load(srec.types[2], srec.values[2]),
+                     dbc_number_load(srec.types[3], srec.values[3]));
+      sig->SetUnit(strings + srec.unit);
+      msg->AddSignal(sig);
+      signals++;
+      }
+    }
+
+  free(strings);
+  fclose(f);
+
+  if (!ok || signals != hdr.signals)
+    {
+    ESP_LOGW(TAG, "Cache %s corrupt", path.c_str());
+    FreeAllocations();
+    return false;
+    }
+
+  m_messages.Compile();
+  m_stats_source.time_us = hdr.src_time_us;
+  m_stats_source.heap = hdr.src_heap;
+  m_cached = true;
+  ESP_LOGD(TAG, "Loaded %s from cache %s", m_name.c_str(), path.c_str());
+  return true;
+  }
+
+/**
+ * WriteCache: write the DBC content to the binary cache
+ *  The cache is written to a temporary file first, so an interrupted write
+ *  cannot leave a truncated cache.
+ */
+bool dbcfile::WriteCache(const std::string& path)
+  {
+  dbc_source_t src;
+  if (!dbc_source_stat(m_path, src) || !dbc_source_hash(m_path, src))
+    return false;
+
+  dbc_cache_header_t hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic = DBC_CACHE_MAGIC;
+  hdr.version = DBC_CACHE_VERSION;
+  hdr.src_size = src.size;
+  hdr.src_mtime = src.mtime;
+  hdr.src_hash = src.hash;
+  hdr.src_time_us = m_stats_source.time_us;
+  hdr.src_heap = m_stats_source.heap;
+  hdr.baudrate = m_bittiming.GetBaudRate();
+  hdr.btr1 = m_bittiming.GetBTR1();
+  hdr.btr2 = m_bittiming.GetBTR2();
+
+  std::string strings;
+  dbc_string_add(strings, m_version);
+  std::vector<dbc_cache_message_t> mrecs;
+  std::vector<dbc_cache_signal_t> srecs;
+  for (auto& it : m_messages.m_entrymap)
+    {
+    dbcMessage* msg = it.second;
+    dbc_cache_message_t mrec;
+    memset(&mrec, 0, sizeof(mrec));
+    mrec.id = it.first;
+    mrec.name = dbc_string_add(strings, msg->GetName());
+    mrec.size = msg->GetSize();
+    for (dbcSignal* sig : msg->m_signals)
+      {
+      dbc_cache_signal_t srec;
+      memset(&srec, 0, sizeof(srec));
+      srec.name = dbc_string_add(strings, sig->GetName());
+      srec.unit = dbc_string_add(strings, sig->GetUnit());
+      srec.start = sig->GetStartBit();
+      srec.size = sig->GetSignalSize();
+      srec.byteorder = sig->GetByteOrder();
+      srec.valuetype = sig->GetValueType();
+      if (sig == msg->GetMultiplexorSignal())
+        srec.mux = DBC_MUX_MULTIPLEXOR;
+      else if (sig->IsMultiplexSwitch())
+        {
+        srec.mux = DBC_MUX_MULTIPLEXED;
+        srec.switchvalue = sig->GetMultiplexSwitchvalue();
+        }
+      dbc_number_store(sig->GetFactor(), srec.types[0], srec.values[0]);
+      dbc_number_store(sig->GetOffset(), srec.types[1], srec.values[1]);
+      dbc_number_store(sig->GetMinimum(), srec.types[2], srec.values[2]);
+      dbc_number_store(sig->GetMaximum(), srec.types[3], srec.values[3]);
+      srecs.push_back(srec);
+      mrec.signals++;
+      }
+    mrecs.push_back(mrec);
+    }
+  hdr.messages = mrecs.size();
+  hdr.signals = srecs.size();
+  hdr.strings = strings.size();
+
+  std::string tmppath = path + ".tmp";
+  FILE* f = fopen(tmppath.c_str(), "w");
+  if (!f)
+    {
+    ESP_LOGD(TAG, "Cannot write cache %s", tmppath.c_str());
+    return false;
+    }
+  bool ok = (fwrite(&hdr, sizeof(hdr), 1, f) == 1 &&
+             fwrite(strings.data(), strings.size(), 1, f) == 1);
+  size_t s = 0;
+  for (const dbc_cache_message_t& mrec : mrecs)
+    {
+    if (!ok) break;
+    ok = (fwrite(&mrec, sizeof(mrec), 1, f) == 1);
+    if (ok && mrec.signals > 0)
+      ok = (fwrite(&srecs[s], sizeof(dbc_cache_signal_t), mrec.signals, f) == mrec.signals);
+    s += mrec.signals;
+    }
+  if (fclose(f) != 0)
+    ok = false;
+
+  if (ok)
+    {
+    unlink(path.c_str());
+    ok = (rename(tmppath.c_str(), path.c_str()) == 0);
+    }
+  if (!ok)
+    {
+    ESP_LOGW(TAG, "Failed to write cache %s", path.c_str());
+    unlink(tmppath.c_str());
+    return false;
+    }
+
+  ESP_LOGI(TAG, "Cache %s written: %u messages, %u signals, %u bytes", path.c_str(),
+    (unsigned)hdr.messages, (unsigned)hdr.signals, (unsigned)(sizeof(hdr) + strings.size() +
+    mrecs.size() * sizeof(dbc_cache_message_t) + srecs.size() * sizeof(dbc_cache_signal_t)));
+  return true;
+  }
@@ -98,7 +98,7 @@ void dbcNumber::Set(uint32_t value)
 
 void dbcNumber::Set(double value)
   {
-  if (ceil(value)==value)
+  if (ceil(value)==value && value >= INT32_MIN && value <= UINT32_MAX)
     {
     if (value<0)
       {
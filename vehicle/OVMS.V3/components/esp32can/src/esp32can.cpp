@@ -53,7 +53,7 @@ static portMUX_TYPE esp32can_spinlock = portMUX_INITIALIZER_UNLOCKED;
 
 static inline uint32_t ESP32CAN_rxframe(esp32can *me, BaseType_t* task_woken)
   {
-  static CAN_queue_msg_t msg;
+  CAN_queue_msg_t msg;
   uint32_t error_irqs = 0;
 
   // The ESP32 CAN controller works different from the SJA1000 here.
@@ -115,37 +115,49 @@ static inline uint32_t ESP32CAN_rxframe(esp32can *me, BaseType_t* task_woken)
       }
     else
       {
-      // Valid frame in receive buffer: record the origin
-      memset(&msg,0,sizeof(msg));
-      msg.type = CAN_frame;
-      msg.body.frame.origin = me;
+      // Valid frame in receive buffer: get a frame pool slot
+      CAN_frame_t* frame = MyCan.m_framepool.Alloc();
+      if (frame == NULL)
+        {
+        // Pool exhausted => discard frame:
+        MODULE_ESP32CAN->CMR.B.RRB = 1;
+        me->m_status.rxbuf_overflow++;
+        continue;
+        }
+
+      // …record the origin
+      memset(frame,0,sizeof(CAN_frame_t));
+      frame->origin = me;
 
       // get FIR
-      msg.body.frame.FIR.U = MODULE_ESP32CAN->MBX_CTRL.FCTRL.FIR.U;
+      frame->FIR.U = MODULE_ESP32CAN->MBX_CTRL.FCTRL.FIR.U;
 
       // check if this is a standard or extended CAN frame
-      if (msg.body.frame.FIR.B.FF == CAN_frame_std)
+      if (frame->FIR.B.FF == CAN_frame_std)
         {
         // Standard frame: Get Message ID
-        msg.body.frame.MsgID = ESP32CAN_GET_STD_ID;
+        frame->MsgID = ESP32CAN_GET_STD_ID;
         // …deep copy data bytes
-        for (int k=0 ; k<msg.body.frame.FIR.B.DLC ; k++)
-          msg.body.frame.data.u8[k] = MODULE_ESP32CAN->MBX_CTRL.FCTRL.TX_RX.STD.data[k];
+        for (int k=0 ; k<frame->FIR.B.DLC ; k++)
+          frame->data.u8[k] = MODULE_ESP32CAN->MBX_CTRL.FCTRL.TX_RX.STD.data[k];
         }
       else
         {
         // Extended frame: Get Message ID
-        msg.body.frame.MsgID = ESP32CAN_GET_EXT_ID;
+        frame->MsgID = ESP32CAN_GET_EXT_ID;
         // …deep copy data bytes
-        for (int k=0 ; k<msg.body.frame.FIR.B.DLC ; k++)
-          msg.body.frame.data.u8[k] = MODULE_ESP32CAN->MBX_CTRL.FCTRL.TX_RX.EXT.data[k];
+        for (int k=0 ; k<frame->FIR.B.DLC ; k++)
+          frame->data.u8[k] = MODULE_ESP32CAN->MBX_CTRL.FCTRL.TX_RX.EXT.data[k];
         }
 
       // Request next frame:
       MODULE_ESP32CAN->CMR.B.RRB = 1;
 
-      // Send frame to CAN framework:
-      xQueueSendFromISR(MyCan.m_rxqueue, &msg, task_woken);
+      // Send frame handle to CAN framework:
+      msg.type = CAN_frame;
+      msg.body.frame = frame;
+      if (xQueueSendFromISR(MyCan.m_rxqueue, &msg, task_woken) != pdTRUE)
+        MyCan.m_framepool.Release(frame);
       }
 
     } // while (MODULE_ESP32CAN->SR.B.RBS | MODULE_ESP32CAN->SR.B.DOS)
@@ -178,9 +190,13 @@ static IRAM_ATTR void ESP32CAN_isr(void *pvParameters)
       // Request TxCallback:
       CAN_queue_msg_t msg;
       msg.type = CAN_txcallback;
-      msg.body.frame = me->m_tx_frame;
-      msg.body.bus = me;
-      xQueueSendFromISR(MyCan.m_rxqueue, &msg, &task_woken);
+      msg.body.frame = MyCan.m_framepool.Copy(&me->m_tx_frame, true);
+      if (msg.body.frame)
+        {
+        msg.body.frame->origin = me;
+        if (xQueueSendFromISR(MyCan.m_rxqueue, &msg, &task_woken) != pdTRUE)
+          MyCan.m_framepool.Release(msg.body.frame);
+        }
       }
 
     // Handle error interrupts:
@@ -393,7 +409,7 @@ esp_err_t esp32can::Stop()
   return ESP_OK;
   }
 
-esp_err_t esp32can::Write(const CAN_frame_t* p_frame, TickType_t maxqueuewait /*=0*/)
+esp_err_t esp32can::Write(const CAN_frame_t* p_frame, TickType_t maxqueuewait /*=0*/, int txprio /*=CAN_TXPRIO_NORMAL*/)
   {
   uint8_t __byte_i; // Byte iterator
 
@@ -403,17 +419,20 @@ esp_err_t esp32can::Write(const CAN_frame_t* p_frame, TickType_t maxqueuewait /*
     return ESP_OK;
     }
 
+  if (!TxAdmit(p_frame, txprio))
+    return ESP_FAIL;
+
   ESP32CAN_ENTER_CRITICAL();
 
   // check if TX buffer is available:
   if(MODULE_ESP32CAN->SR.B.TBS == 0)
     {
     ESP32CAN_EXIT_CRITICAL();
-    return QueueWrite(p_frame, maxqueuewait);
+    return QueueWrite(p_frame, maxqueuewait, txprio);
     }
 
   // copy frame information record
-  MODULE_ESP32CAN->MBX_CTRL.FCTRL.FIR.U=p_frame->FIR.U;
+  MODULE_ESP32CAN->MBX_CTRL.FCTRL.FIR.U=p_frame->FIR.U & 0xff;
 
   if (p_frame->FIR.B.FF==CAN_frame_std)
     { // Standard frame
@@ -438,7 +457,7 @@ esp_err_t esp32can::Write(const CAN_frame_t* p_frame, TickType_t maxqueuewait /*
   ESP32CAN_EXIT_CRITICAL();
 
   // stats & logging:
-  canbus::Write(p_frame, maxqueuewait);
+  canbus::Write(p_frame, maxqueuewait, txprio);
 
   return ESP_OK;
   }
@@ -449,8 +468,9 @@ void esp32can::TxCallback(CAN_frame_t* p_frame, bool success)
 
   // TX buffer has become available; send next queued frame (if any):
   CAN_frame_t frame;
-  if (xQueueReceive(m_txqueue, (void*)&frame, 0) == pdTRUE)
-    Write(&frame, 0);
+  int txprio;
+  if (TxQueueReceive(&frame, &txprio))
+    Write(&frame, 0, txprio);
   }
 
 void esp32can::SetPowerMode(PowerMode powermode)
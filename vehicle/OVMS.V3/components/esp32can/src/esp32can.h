@@ -59,7 +59,7 @@ class esp32can : public canbus
     void InitController();
 
   public:
-    esp_err_t Write(const CAN_frame_t* p_frame, TickType_t maxqueuewait=0);
+    esp_err_t Write(const CAN_frame_t* p_frame, TickType_t maxqueuewait=0, int txprio=CAN_TXPRIO_NORMAL);
     void TxCallback(CAN_frame_t* p_frame, bool success);
 
   public:
@@ -306,7 +306,7 @@ esp_err_t mcp2515::ViewRegisters()
   return ESP_OK;
   }
 
-esp_err_t mcp2515::Write(const CAN_frame_t* p_frame, TickType_t maxqueuewait /*=0*/)
+esp_err_t mcp2515::Write(const CAN_frame_t* p_frame, TickType_t maxqueuewait /*=0*/, int txprio /*=CAN_TXPRIO_NORMAL*/)
   {
   uint8_t buf[16];
   uint8_t id[4];
@@ -317,6 +317,9 @@ esp_err_t mcp2515::Write(const CAN_frame_t* p_frame, TickType_t maxqueuewait /*=
     return ESP_OK;
     }
 
+  if (!TxAdmit(p_frame, txprio))
+    return ESP_FAIL;
+
   // check for free TX buffer:
   uint8_t txbuf;
   uint8_t* p = m_spibus->spi_cmd(m_spi, buf, 1, 1, CMD_READ_STATUS);
@@ -324,7 +327,7 @@ esp_err_t mcp2515::Write(const CAN_frame_t* p_frame, TickType_t maxqueuewait /*=
   if((p[0] & 0b01010100) == 0)  // any buffers busy?
     txbuf = 0b000;  // all clear - use TxB0
   else
-    return QueueWrite(p_frame, maxqueuewait);  // otherwise, queue the frame and wait.  Single frame at a time!
+    return QueueWrite(p_frame, maxqueuewait, txprio);  // otherwise, queue the frame and wait.  Single frame at a time!
 
   if (p_frame->FIR.B.FF == CAN_frame_std)
     {
@@ -361,7 +364,7 @@ esp_err_t mcp2515::Write(const CAN_frame_t* p_frame, TickType_t maxqueuewait /*=
   m_spibus->spi_cmd(m_spi, buf, 0, 1, CMD_RTS | (txbuf ? txbuf : 0b001));
 
   // stats & logging:
-  canbus::Write(p_frame, maxqueuewait);
+  canbus::Write(p_frame, maxqueuewait, txprio);
 
   return ESP_OK;
   }
@@ -446,12 +449,19 @@ bool mcp2515::AsynchronousInterruptHandler(CAN_frame_t* frame, bool * frameRecei
     // send "tx success" callback request to main CAN processor task
     CAN_queue_msg_t msg;
     msg.type = CAN_txcallback;
-    msg.body.frame = m_tx_frame;
-    msg.body.bus = this;
-    xQueueSend(MyCan.m_rxqueue,&msg,0);
+    msg.body.frame = MyCan.m_framepool.Copy(&m_tx_frame, true);
+    if (msg.body.frame)
+      {
+      msg.body.frame->origin = this;
+      if (xQueueSend(MyCan.m_rxqueue,&msg,0) != pdTRUE)
+        MyCan.m_framepool.Release(msg.body.frame);
+      }
 
-    if(xQueueReceive(m_txqueue, (void*)frame, 0) == pdTRUE)  { // if any queued for later?
-      Write(frame, 0);  // if so, send one
+    // note: *frame may hold a received frame, use a separate buffer
+    CAN_frame_t txframe;
+    int txprio;
+    if(TxQueueReceive(&txframe, &txprio))  { // if any queued for later?
+      Write(&txframe, 0, txprio);  // if so, send one
       }
     }
 
@@ -478,9 +488,13 @@ bool mcp2515::AsynchronousInterruptHandler(CAN_frame_t* frame, bool * frameRecei
       // send "tx failed" callback request to main CAN processor task
       CAN_queue_msg_t msg;
       msg.type = CAN_txfailedcallback;
-      msg.body.frame = m_tx_frame;
-      msg.body.bus = this;
-      xQueueSend(MyCan.m_rxqueue,&msg,0);
+      msg.body.frame = MyCan.m_framepool.Copy(&m_tx_frame, true);
+      if (msg.body.frame)
+        {
+        msg.body.frame->origin = this;
+        if (xQueueSend(MyCan.m_rxqueue,&msg,0) != pdTRUE)
+          MyCan.m_framepool.Release(msg.body.frame);
+        }
       }
     m_status.errors_tx = p[0];
     m_status.errors_rx = p[1];
@@ -91,7 +91,7 @@ class mcp2515 : public canbus
     esp_err_t ViewRegisters();
 
   public:
-    esp_err_t Write(const CAN_frame_t* p_frame, TickType_t maxqueuewait=0);
+    esp_err_t Write(const CAN_frame_t* p_frame, TickType_t maxqueuewait=0, int txprio=CAN_TXPRIO_NORMAL);
     bool AsynchronousInterruptHandler(CAN_frame_t* frame, bool * frameReceived);
 
   public:
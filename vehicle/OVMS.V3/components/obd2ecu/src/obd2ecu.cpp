@@ -147,13 +147,14 @@ static void OBD2ECU_task(void *pvParameters)
   {
   obd2ecu *me = (obd2ecu*)pvParameters;
 
-  CAN_frame_t frame;
+  CAN_frame_t* frame;
   while(1)
     {
     if (xQueueReceive(me->m_rxqueue, &frame, (portTickType)portMAX_DELAY)==pdTRUE)
       {
       // Only handle incoming frames on our CAN bus
-      if (frame.origin == me->m_can) me->IncomingFrame(&frame);
+      if (frame->origin == me->m_can) me->IncomingFrame(frame);
+      MyCan.m_framepool.Release(frame);
       }
     }
   }
@@ -165,7 +166,7 @@ obd2ecu::obd2ecu(const char* name, canbus* can)
   m_can->Start(CAN_MODE_ACTIVE,CAN_SPEED_500KBPS);
   m_can->SetPowerMode(On);
 
-  m_rxqueue = xQueueCreate(20,sizeof(CAN_frame_t));
+  m_rxqueue = xQueueCreate(CAN_LISTENER_QUEUE_SIZE,sizeof(CAN_frame_t*));
 
   m_starttime = time(NULL);
   LoadMap();
@@ -180,8 +181,9 @@ obd2ecu::~obd2ecu()
   m_can->SetPowerMode(Off);
   MyCan.DeregisterListener(m_rxqueue);
 
-  vQueueDelete(m_rxqueue);
   vTaskDelete(m_task);
+  MyCan.FlushListenerQueue(m_rxqueue);
+  vQueueDelete(m_rxqueue);
 
   ClearMap();
   }
@@ -365,6 +365,18 @@ function initSocketConnection(){
         $.extend(metrics, msg.metrics);
         $(".receiver").trigger("msg:metrics", msg.metrics);
       }
+      else if (msgtype == "metrics_patch") {
+        // vector element patches: { name: [ start, [ values… ] ] }
+        var update = {};
+        for (var name in msg.metrics_patch) {
+          var patch = msg.metrics_patch[name];
+          var vec = $.isArray(metrics[name]) ? metrics[name].slice() : [];
+          for (var i = 0; i < patch[1].length; i++)
+            vec[patch[0]+i] = patch[1][i];
+          metrics[name] = update[name] = vec;
+        }
+        $(".receiver").trigger("msg:metrics", update);
+      }
       else if (msgtype == "notify") {
         processNotification(msg.notify);
         $(".receiver").trigger("msg:notify", msg.notify);
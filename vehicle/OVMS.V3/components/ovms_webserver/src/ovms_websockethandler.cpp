@@ -121,26 +121,54 @@ void WebSocketHandler::ProcessTxJob()
       for (i=0, m=MyMetrics.m_first; i < m_sent && m != NULL; m=m->m_next, i++);
       
       // build msg:
-      extram::string msg;
-      msg.reserve(2*XFER_CHUNK_SIZE+128);
-      msg = "{\"metrics\":{";
-      for (i=0; m && msg.size() < XFER_CHUNK_SIZE; m=m->m_next) {
+      //  Vector metrics supporting element patches (see OvmsMetric::AsJSONPatch)
+      //  are sent as "metrics_patch" updates after the initial full transmission.
+      //  Patch format: { "<name>": [ <start index>, [ <values…> ] ], … }
+      extram::string list, patches;
+      std::string patch;
+      int np = 0;
+      list.reserve(XFER_CHUNK_SIZE+128);
+      for (i=0; m && list.size() + patches.size() < XFER_CHUNK_SIZE; m=m->m_next) {
         if (m->IsModifiedAndClear(m_modifier) || m_job.type == WSTX_MetricsAll) {
-          if (i) msg += ',';
-          msg += '\"';
-          msg += m->m_name;
-          msg += "\":";
-          msg += m->AsJSON().c_str();
-          i++;
+          if (m_job.type == WSTX_MetricsUpdate && m->AsJSONPatch(m_modifier, patch)) {
+            if (patch.empty()) continue;
+            if (np) patches += ',';
+            patches += '\"';
+            patches += m->m_name;
+            patches += "\":";
+            patches += patch.c_str();
+            np++;
+          } else {
+            if (i) list += ',';
+            list += '\"';
+            list += m->m_name;
+            list += "\":";
+            list += m->AsJSON().c_str();
+            i++;
+          }
         }
       }
       
       // send msg:
-      if (i) {
-        msg += "}}";
+      if (i || np) {
+        extram::string msg;
+        msg.reserve(list.size() + patches.size() + 40);
+        msg = "{";
+        if (i) {
+          msg += "\"metrics\":{";
+          msg += list;
+          msg += '}';
+        }
+        if (np) {
+          if (i) msg += ',';
+          msg += "\"metrics_patch\":{";
+          msg += patches;
+          msg += '}';
+        }
+        msg += '}';
         //ESP_LOGV(TAG, "WebSocket msg: %s", msg.c_str());
         mg_send_websocket_frame(m_nc, WEBSOCKET_OP_TEXT, msg.data(), msg.size());
-        m_sent += i;
+        m_sent += i + np;
       }
       
       // done?
@@ -601,12 +601,14 @@ void OvmsWebServer::HandleBmsCellMonitor(PageEntry_t& p, PageContext_t& c)
           "<div class=\"receiver\" id=\"livestatus\">\n"
             "<div id=\"voltchart\" style=\"width: 100%; max-width: 100%; height: 45vh; min-height: 280px; margin: 0 auto\"></div>\n"
             "<div id=\"tempchart\" style=\"width: 100%; max-width: 100%; height: 25vh; min-height: 160px; margin: 0 auto\"></div>\n"
+            "<div id=\"driftchart\" style=\"width: 100%; max-width: 100%; height: 35vh; min-height: 220px; margin: 0 auto; display: none\"></div>\n"
           "</div>\n"
         "</div>\n"
       "</div>\n"
       "<div class=\"panel-footer\">\n"
         "<button class=\"btn btn-default\" data-toggle=\"modal\" data-target=\"#cfg-dialog\">Alert config</button>\n"
         "<button class=\"btn btn-default\" data-cmd=\"bms reset\" data-target=\"#output\" data-watchcnt=\"0\">Reset min/max</button>\n"
+        "<button class=\"btn btn-default\" id=\"action-drift\">Voltage drift history</button>\n"
         "<samp id=\"output\" class=\"samp-inline\"></samp>\n"
       "</div>\n"
     "</div>\n"
@@ -801,6 +803,15 @@ void OvmsWebServer::HandleBmsCellMonitor(PageEntry_t& p, PageContext_t& c)
     "}\n"
     ".night #tempchart .highcharts-boxplot-median {\n"
       "stroke: #fdd02e;\n"
+    "}\n"
+    "\n"
+    "#driftchart .highcharts-graph {\n"
+      "stroke-width: 1px;\n"
+      "stroke-opacity: 0.4;\n"
+    "}\n"
+    "#driftchart .drift-weak .highcharts-graph {\n"
+      "stroke-width: 3px;\n"
+      "stroke-opacity: 1;\n"
     "}\n");
   
   c.printf(
@@ -1096,6 +1107,70 @@ void OvmsWebServer::HandleBmsCellMonitor(PageEntry_t& p, PageContext_t& c)
     "}\n"
     "\n"
     "\n"
+    "/**\n"
+     "* Cell voltage drift chart (from BMS history)\n"
+     "*/\n"
+    "\n"
+    "var driftchart;\n"
+    "\n"
+    "function load_drift_chart() {\n"
+      "loadcmd('bms history volt 90').done(function(output) {\n"
+        "var lines = output.split('\\n'), series = [], last = [], cols, day, i, j;\n"
+        "for (i = 0; i < lines.length; i++) {\n"
+          "cols = lines[i].split(',');\n"
+          "if (!/^\\d{4}-\\d\\d-\\d\\d$/.test(cols[0]))\n"
+            "continue;\n"
+          "day = Date.parse(cols[0]);\n"
+          "for (j = 2; j < cols.length; j++) {\n"
+            "if (!series[j-2])\n"
+              "series[j-2] = { name: '#' + (j-1), data: [], showInLegend: false };\n"
+            "series[j-2].data.push([day, Number(cols[j])]);\n"
+            "last[j-2] = Number(cols[j]);\n"
+          "}\n"
+        "}\n"
+        "if (series.length == 0) {\n"
+          "$('#output').text(output);\n"
+          "return;\n"
+        "}\n"
+        "// highlight the five cells currently furthest below average:\n"
+        "last.map(function(v, i) { return [v, i]; })\n"
+          ".sort(function(a, b) { return a[0] - b[0]; })\n"
+          ".slice(0, 5)\n"
+          ".forEach(function(e) { series[e[1]].showInLegend = true; series[e[1]].className = 'drift-weak'; });\n"
+        "$('#driftchart').show();\n"
+        "if (driftchart)\n"
+          "driftchart.destroy();\n"
+        "driftchart = Highcharts.chart('driftchart', {\n"
+          "chart: { type: 'line', zoomType: 'x' },\n"
+          "title: { text: 'Cell voltage deviation from average (daily mean)' },\n"
+          "credits: { enabled: false },\n"
+          "legend: {\n"
+            "enabled: true,\n"
+            "align: 'center',\n"
+            "verticalAlign: 'bottom',\n"
+            "margin: 2,\n"
+            "padding: 2,\n"
+          "},\n"
+          "xAxis: { type: 'datetime' },\n"
+          "yAxis: {\n"
+            "title: { text: null },\n"
+            "labels: { format: \"{value:.0f} mV\" },\n"
+          "},\n"
+          "tooltip: {\n"
+            "xDateFormat: '%Y-%m-%d',\n"
+            "headerFormat: '{point.key}<br/>',\n"
+            "pointFormat: 'Cell {series.name}: <b>{point.y:.1f} mV</b>',\n"
+          "},\n"
+          "plotOptions: { series: { marker: { enabled: false }, animation: false } },\n"
+          "series: series\n"
+        "});\n"
+        "$('#driftchart').data('chart', driftchart).addClass('has-chart');\n"
+      "});\n"
+    "}\n"
+    "\n"
+    "$('#action-drift').on('click', load_drift_chart);\n"
+    "\n"
+    "\n"
     "/**\n"
      "* Chart initialization\n"
      "*/\n"
@@ -100,11 +100,11 @@ static void RE_task(void *pvParameters)
 
 void re::Task()
   {
-  CAN_log_message_t message;
+  CAN_frame_t* frame;
 
   while(1)
     {
-    if (xQueueReceive(m_rxqueue, &message.frame, (portTickType)portMAX_DELAY)==pdTRUE)
+    if (xQueueReceive(m_rxqueue, &frame, (portTickType)portMAX_DELAY)==pdTRUE)
       {
       if (MyRE != NULL) // Protect against MyRE not set (during init)
         {
@@ -112,18 +112,19 @@ void re::Task()
           {
           case Analyse:
           case Discover:
-            if ((m_filter)&&(!m_filter->IsFiltered(&message.frame)))
+            if ((m_filter)&&(!m_filter->IsFiltered(frame)))
               {
               // Frame is filtered, just drop it...
               }
             else
               {
-              DoAnalyse(&message.frame);
+              DoAnalyse(frame);
               }
             break;
           }
         m_finished = monotonictime;
         }
+      MyCan.m_framepool.Release(frame);
       }
     }
   }
@@ -285,7 +286,7 @@ re::re(const char* name, canfilter* filter)
   m_started = monotonictime;
   m_finished = monotonictime;
   m_mode = Analyse;
-  m_rxqueue = xQueueCreate(20,sizeof(CAN_frame_t));
+  m_rxqueue = xQueueCreate(CAN_LISTENER_QUEUE_SIZE,sizeof(CAN_frame_t*));
   xTaskCreatePinnedToCore(RE_task, "OVMS RE", 4096, (void*)this, 5, &m_task, CORE(1));
   MyCan.RegisterListener(m_rxqueue, true);
   }
@@ -294,9 +295,10 @@ re::~re()
   {
   MyCan.DeregisterListener(m_rxqueue);
 
+  vTaskDelete(m_task);
+  MyCan.FlushListenerQueue(m_rxqueue);
   Clear();
   vQueueDelete(m_rxqueue);
-  vTaskDelete(m_task);
   if (m_filter)
     {
     delete m_filter;
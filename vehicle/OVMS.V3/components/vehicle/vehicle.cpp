@@ -97,6 +97,60 @@ void vehicle_status(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int arg
     }
   }
 
+void vehicle_poll_stats(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  if (MyVehicleFactory.m_currentvehicle != NULL)
+    {
+    MyVehicleFactory.m_currentvehicle->PollStats(verbosity, writer);
+    }
+  else
+    {
+    writer->puts("No vehicle module selected");
+    }
+  }
+
+void vehicle_poll_reset(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  if (MyVehicleFactory.m_currentvehicle != NULL)
+    {
+    MyVehicleFactory.m_currentvehicle->PollResetStats();
+    writer->puts("Poll statistics have been reset.");
+    }
+  else
+    {
+    writer->puts("No vehicle module selected");
+    }
+  }
+
+void vehicle_poll_load(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  if (MyVehicleFactory.m_currentvehicle == NULL)
+    {
+    writer->puts("No vehicle module selected");
+    return;
+    }
+  std::string path = (argc > 0) ? argv[0] : MyConfig.GetParamValue("vehicle", "poll.file");
+  std::string error;
+  if (path.empty())
+    writer->puts("No file given (config vehicle poll.file)");
+  else if (!MyVehicleFactory.m_currentvehicle->PollLoadDefinitions(path, error))
+    writer->printf("Error: %s\n", error.c_str());
+  else
+    MyVehicleFactory.m_currentvehicle->PollListDefinitions(writer);
+  }
+
+void vehicle_poll_list(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  if (MyVehicleFactory.m_currentvehicle != NULL)
+    {
+    MyVehicleFactory.m_currentvehicle->PollListDefinitions(writer);
+    }
+  else
+    {
+    writer->puts("No vehicle module selected");
+    }
+  }
+
 void vehicle_wakeup(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
   {
   if (MyVehicleFactory.m_currentvehicle==NULL)
@@ -449,6 +503,41 @@ void bms_reset(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, co
     }
   }
 
+void bms_history_record(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  if (MyVehicleFactory.m_currentvehicle != NULL)
+    {
+    std::string error;
+    if (MyVehicleFactory.m_currentvehicle->BmsHistoryRecord(BMS_HISTORY_MANUAL, error))
+      writer->puts("BMS history snapshot recorded.");
+    else
+      writer->printf("ERROR: %s\n", error.c_str());
+    }
+  else
+    {
+    writer->puts("No vehicle module selected");
+    }
+  }
+
+void bms_history_show(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  if (MyVehicleFactory.m_currentvehicle != NULL)
+    {
+    int days = (argc > 0) ? atoi(argv[0]) : 30;
+    int cell = (argc > 1) ? atoi(argv[1]) : 0;
+    if (days < 1 || days > 3650 || cell < 0)
+      {
+      cmd->PutUsage(writer);
+      return;
+      }
+    MyVehicleFactory.m_currentvehicle->BmsHistoryQuery(writer, strcmp(cmd->GetName(), "temp") == 0, days, cell);
+    }
+  else
+    {
+    writer->puts("No vehicle module selected");
+    }
+  }
+
 void bms_alerts(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
   {
   if (MyVehicleFactory.m_currentvehicle != NULL)
@@ -806,6 +895,11 @@ OvmsVehicleFactory::OvmsVehicleFactory()
   cmd_vehicle->RegisterCommand("module","Set (or clear) vehicle module",vehicle_module,"<type>",0,1);
   cmd_vehicle->RegisterCommand("list","Show list of available vehicle modules",vehicle_list);
   cmd_vehicle->RegisterCommand("status","Show vehicle module status",vehicle_status);
+  OvmsCommand* cmd_poll = cmd_vehicle->RegisterCommand("poll","Vehicle poller");
+  cmd_poll->RegisterCommand("stats","Show poll statistics per PID",vehicle_poll_stats);
+  cmd_poll->RegisterCommand("reset","Reset poll statistics",vehicle_poll_reset);
+  cmd_poll->RegisterCommand("load","(Re)load poll definitions",vehicle_poll_load,"[<file>]",0,1);
+  cmd_poll->RegisterCommand("list","Show poll definitions",vehicle_poll_list);
 
   MyCommandApp.RegisterCommand("wakeup","Wake up vehicle",vehicle_wakeup);
   MyCommandApp.RegisterCommand("homelink","Activate specified homelink button",vehicle_homelink,"<homelink><durationms>",1,2);
@@ -832,6 +926,16 @@ OvmsVehicleFactory::OvmsVehicleFactory()
   cmd_bms->RegisterCommand("status","Show BMS status",bms_status);
   cmd_bms->RegisterCommand("reset","Reset BMS statistics",bms_reset);
   cmd_bms->RegisterCommand("alerts","Show BMS alerts",bms_alerts);
+  OvmsCommand* cmd_bmshist = cmd_bms->RegisterCommand("history","BMS cell history");
+  cmd_bmshist->RegisterCommand("record","Record cell snapshot",bms_history_record);
+  cmd_bmshist->RegisterCommand("volt","Show cell voltage history",bms_history_show,
+    "[<days>] [<cell>]\n"
+    "Without <cell>: daily average cell deviations [mV], else cell snapshots.\n"
+    "<days> defaults to 30.",0,2);
+  cmd_bmshist->RegisterCommand("temp","Show cell temperature history",bms_history_show,
+    "[<days>] [<cell>]\n"
+    "Without <cell>: daily average cell deviations [°C], else cell snapshots.\n"
+    "<days> defaults to 30.",0,2);
 
 #ifdef CONFIG_OVMS_SC_JAVASCRIPT_DUKTAPE
   DuktapeObjectRegistration* dto = new DuktapeObjectRegistration("OvmsVehicle");
@@ -941,6 +1045,7 @@ static void OvmsVehicleRxTask(void *pvParameters)
   }
 
 OvmsVehicle::OvmsVehicle()
+  : m_poll_isotp("poller")
   {
   m_can1 = NULL;
   m_can2 = NULL;
@@ -952,14 +1057,13 @@ OvmsVehicle::OvmsVehicle()
   m_chargestate_ticker = 0;
   m_idle_ticker = 0;
   m_registeredlistener = false;
+  m_replaying = false;
   m_autonotifications = true;
   m_ready = false;
 
   m_poll_state = 0;
   m_poll_bus = NULL;
   m_poll_plist = NULL;
-  m_poll_plcur = NULL;
-  m_poll_ticker = 0;
   m_poll_moduleid_sent = 0;
   m_poll_moduleid_low = 0;
   m_poll_moduleid_high = 0;
@@ -968,7 +1072,27 @@ OvmsVehicle::OvmsVehicle()
   m_poll_ml_remain = 0;
   m_poll_ml_offset = 0;
   m_poll_ml_frame = 0;
-  m_poll_wait = 0;
+  m_poll_generation = 0;
+  m_poll_timeout = VEHICLE_POLL_TIMEOUT;
+  m_poll_retries = VEHICLE_POLL_RETRIES;
+  m_poll_s3 = VEHICLE_POLL_S3;
+  m_poll_multipid = 1;
+  for (int i = 0; i < 8; i++)
+    m_poll_bcrx[i].length = 0;
+  m_poll_stats_start = esp_timer_get_time();
+  m_poll_stats_metrics = false;
+  esp_timer_create_args_t args = {};
+  args.callback = PollerTimer;
+  args.arg = this;
+  args.dispatch_method = ESP_TIMER_TASK;
+  args.name = "poller";
+  if (esp_timer_create(&args, &m_poll_timer) != ESP_OK)
+    m_poll_timer = NULL;
+  m_poll_task_stop = false;
+  m_poll_rxframe = NULL;
+  xTaskCreatePinnedToCore(PollerTask, "OVMS Poller", 4096, (void*)this, 10, &m_poll_task, CORE(1));
+  // Legacy flow control: request all frames with 25 ms send interval
+  PollSetFlowControl(0, 0x19);
 
   m_bms_voltages = NULL;
   m_bms_vmins = NULL;
@@ -1004,6 +1128,27 @@ OvmsVehicle::OvmsVehicle()
   m_bms_defthr_valert = BMS_DEFTHR_VALERT;
   m_bms_defthr_twarn  = BMS_DEFTHR_TWARN;
   m_bms_defthr_talert = BMS_DEFTHR_TALERT;
+  m_bms_thr_vwarn  = BMS_DEFTHR_VWARN;
+  m_bms_thr_valert = BMS_DEFTHR_VALERT;
+  m_bms_thr_twarn  = BMS_DEFTHR_TWARN;
+  m_bms_thr_talert = BMS_DEFTHR_TALERT;
+
+  m_bms_vsum = 0;
+  m_bms_vsqrsum = 0;
+  m_bms_vsweepmin = 0;
+  m_bms_vsweepmax = 0;
+  m_bms_vrescan = false;
+  m_bms_vminmax_changed = false;
+  m_bms_tsum = 0;
+  m_bms_tsqrsum = 0;
+  m_bms_tsweepmin = 0;
+  m_bms_tsweepmax = 0;
+  m_bms_trescan = false;
+  m_bms_tminmax_changed = false;
+  m_bms_hist_enable = false;
+  m_bms_hist_interval = 0;
+  m_bms_hist_pending = 0;
+  m_bms_hist_records = 0;
 
   m_minsoc = 0;
   m_minsoc_triggered = 0;
@@ -1023,7 +1168,7 @@ OvmsVehicle::OvmsVehicle()
   m_brakelight_basepwr = 0;
   m_brakelight_ignftbrk = false;
 
-  m_rxqueue = xQueueCreate(CONFIG_OVMS_VEHICLE_CAN_RX_QUEUE_SIZE,sizeof(CAN_frame_t));
+  m_rxqueue = xQueueCreate(CONFIG_OVMS_VEHICLE_CAN_RX_QUEUE_SIZE,sizeof(CAN_frame_t*));
   xTaskCreatePinnedToCore(OvmsVehicleRxTask, "OVMS Vehicle",
     CONFIG_OVMS_VEHICLE_RXTASK_STACK, (void*)this, 10, &m_rxtask, CORE(1));
 
@@ -1039,6 +1184,31 @@ OvmsVehicle::OvmsVehicle()
 
 OvmsVehicle::~OvmsVehicle()
   {
+  // Stop the poller: timer, task, then wait for running ISO-TP callbacks
+  m_poll_defs.reset();
+  PollSetPidList(NULL, NULL);
+  m_poll_mutex.Lock();
+  esp_timer_handle_t timer = m_poll_timer;
+  m_poll_timer = NULL;
+  m_poll_task_stop = true;
+  if (m_poll_task)
+    xTaskNotifyGive(m_poll_task);
+  m_poll_mutex.Unlock();
+  if (timer)
+    {
+    esp_timer_stop(timer);
+    esp_timer_delete(timer);
+    }
+  for (int i = 0; i < 100; i++)
+    {
+    m_poll_mutex.Lock();
+    bool running = (m_poll_task != NULL);
+    m_poll_mutex.Unlock();
+    if (!running) break;
+    vTaskDelay(pdMS_TO_TICKS(10));
+    }
+  m_poll_isotp.Drain();
+
   if (m_can1) m_can1->SetPowerMode(Off);
   if (m_can2) m_can2->SetPowerMode(Off);
   if (m_can3) m_can3->SetPowerMode(Off);
@@ -1102,8 +1272,9 @@ OvmsVehicle::~OvmsVehicle()
     m_registeredlistener = false;
     }
 
-  vQueueDelete(m_rxqueue);
   vTaskDelete(m_rxtask);
+  MyCan.FlushListenerQueue(m_rxqueue);
+  vQueueDelete(m_rxqueue);
 
   MyEvents.DeregisterEvent(TAG);
   MyMetrics.DeregisterListener(TAG);
@@ -1116,27 +1287,31 @@ const char* OvmsVehicle::VehicleShortName()
 
 void OvmsVehicle::RxTask()
   {
-  CAN_frame_t frame;
+  CAN_frame_t* frame;
 
   while(1)
     {
     if (xQueueReceive(m_rxqueue, &frame, (portTickType)portMAX_DELAY)==pdTRUE)
       {
-      if (!m_ready)
+      if (!m_ready || m_replaying)
+        {
+        MyCan.m_framepool.Release(frame);
         continue;
-      if ((frame.origin == m_poll_bus)&&(m_poll_plist))
+        }
+      if (!m_poll_entries.empty())
         {
-        // This is intended for our poller
-        // ESP_LOGI(TAG, "Poller Rx candidate ID=%03x (expecting %03x-%03x)",frame.MsgID,m_poll_moduleid_low,m_poll_moduleid_high);
-        if ((frame.MsgID >= m_poll_moduleid_low)&&(frame.MsgID <= m_poll_moduleid_high))
-          {
-          PollerReceive(&frame);
-          }
+        // Feed the poller transport, additional broadcast responses are
+        // not taken by a session and need to be handled by the poller:
+        m_poll_rxframe = frame;
+        if (!m_poll_isotp.IncomingFrame(frame))
+          PollerReceive(frame);
+        m_poll_rxframe = NULL;
         }
-      if (m_can1 == frame.origin) IncomingFrameCan1(&frame);
-      else if (m_can2 == frame.origin) IncomingFrameCan2(&frame);
-      else if (m_can3 == frame.origin) IncomingFrameCan3(&frame);
-      else if (m_can4 == frame.origin) IncomingFrameCan4(&frame);
+      if (m_can1 == frame->origin) IncomingFrameCan1(frame);
+      else if (m_can2 == frame->origin) IncomingFrameCan2(frame);
+      else if (m_can3 == frame->origin) IncomingFrameCan3(frame);
+      else if (m_can4 == frame->origin) IncomingFrameCan4(frame);
+      MyCan.m_framepool.Release(frame);
       }
     }
   }
@@ -1161,6 +1336,17 @@ void OvmsVehicle::IncomingPollReply(canbus* bus, uint16_t type, uint16_t pid, ui
   {
   }
 
+/**
+ * PollSecurityKey: calculate the UDS security access key for a seed
+ *  Override to enable VEHICLE_POLL_TYPE_SECURITYACCESS poll entries.
+ *  Return false if the key cannot be calculated.
+ */
+bool OvmsVehicle::PollSecurityKey(canbus* bus, uint32_t txid, uint8_t level, const std::string& seed, std::string& key)
+  {
+  ESP_LOGW(TAG, "Poller: no security access key algorithm for %03x level %02x", txid, level);
+  return false;
+  }
+
 void OvmsVehicle::Status(int verbosity, OvmsWriter* writer)
   {
   writer->puts("Vehicle module loaded and running");
@@ -1194,6 +1380,16 @@ void OvmsVehicle::RegisterCanBus(int bus, CAN_mode_t mode, CAN_speed_t speed, db
       break;
     }
 
+  // Poll definitions may refer to this bus:
+  if (m_poll_defs)
+    {
+    m_poll_mutex.Lock();
+    PollerRebuild();
+    m_poll_mutex.Unlock();
+    m_poll_isotp.CancelAll();
+    PollerSchedule();
+    }
+
   if (!m_registeredlistener)
     {
     m_registeredlistener = true;
@@ -1216,10 +1412,12 @@ void OvmsVehicle::VehicleTicker1(std::string event, void* data)
 
   m_ticker++;
 
-  PollerSend();
-
   Ticker1(m_ticker);
-  if ((m_ticker % 10) == 0) Ticker10(m_ticker);
+  if ((m_ticker % 10) == 0)
+    {
+    if (m_poll_stats_metrics) PollerUpdateMetrics();
+    Ticker10(m_ticker);
+    }
   if ((m_ticker % 60) == 0) Ticker60(m_ticker);
   if ((m_ticker % 300) == 0) Ticker300(m_ticker);
   if ((m_ticker % 600) == 0) Ticker600(m_ticker);
@@ -1322,6 +1520,22 @@ void OvmsVehicle::VehicleTicker1(std::string event, void* data)
     m_bms_talerts_new = 0;
     }
 
+  // BMS history snapshots:
+  if (m_bms_hist_enable)
+    {
+    int reason = m_bms_hist_pending;
+    m_bms_hist_pending = 0;
+    if (!reason && m_bms_hist_interval > 0 && StandardMetrics.ms_v_env_on->AsBool())
+      {
+      int drivetime = StandardMetrics.ms_v_env_drivetime->AsInt();
+      if (drivetime > 0 && (drivetime % (m_bms_hist_interval * 60)) == 0)
+        reason = BMS_HISTORY_DRIVE;
+      }
+    std::string error;
+    if (reason && !BmsHistoryRecord(reason, error))
+      ESP_LOGW(TAG, "BMS history: %s", error.c_str());
+    }
+
   // Idle alert:
   if (!StdMetrics.ms_v_env_awake->AsBool() || StdMetrics.ms_v_pos_speed->AsFloat() > 0)
     {
@@ -1650,6 +1864,28 @@ void OvmsVehicle::VehicleConfigChanged(std::string event, void* data)
     m_brakelight_basepwr = MyConfig.GetParamValueFloat("vehicle", "brakelight.basepwr", 0);
     m_brakelight_ignftbrk = MyConfig.GetParamValueBool("vehicle", "brakelight.ignftbrk", false);
     m_brakelight_start = 0;
+
+    // BMS deviation thresholds:
+    BmsUpdateThresholds();
+
+    // BMS history:
+    m_bms_hist_enable = MyConfig.GetParamValueBool("vehicle", "bms.history.enable", false);
+    m_bms_hist_interval = MyConfig.GetParamValueInt("vehicle", "bms.history.interval", 10);
+    m_bms_hist_mutex.Lock();
+    m_bms_hist_path = MyConfig.GetParamValue("vehicle", "bms.history.path", "/sd/bmshistory");
+    m_bms_hist_mutex.Unlock();
+
+    // poller statistics:
+    m_poll_stats_metrics = MyConfig.GetParamValueBool("vehicle", "poll.metrics", false);
+
+    // poll definitions:
+    std::string pollfile = MyConfig.GetParamValue("vehicle", "poll.file");
+    if (pollfile != (m_poll_defs ? m_poll_defs->path : std::string()))
+      {
+      std::string error;
+      if (!PollLoadDefinitions(pollfile, error))
+        ESP_LOGE(TAG, "%s", error.c_str());
+      }
     }
 
   // read vehicle specific config:
@@ -1705,6 +1941,8 @@ void OvmsVehicle::MetricModified(OvmsMetric* metric)
       {
       MyEvents.SignalEvent("vehicle.charge.stop",NULL);
       NotifiedVehicleChargeStop();
+      if (m_bms_hist_enable)
+        m_bms_hist_pending = BMS_HISTORY_CHARGE;
       }
     }
   else if (metric == StandardMetrics.ms_v_door_chargeport)
@@ -1992,314 +2230,1257 @@ OvmsVehicle::vehicle_mode_t OvmsVehicle::VehicleModeKey(const std::string code)
   return key;
   }
 
+/**
+ * PollSetPidList: set the poll list
+ *  This replaces all poll lists currently active, pass NULL to stop polling.
+ *  Requests to different ECUs (request/response ID pairs, on any bus) are
+ *  run concurrently, with one outstanding request per ECU. The next due
+ *  request for an ECU is sent as soon as the previous one has been answered.
+ *  Poll times are scheduled by a timer independent of the vehicle ticker,
+ *  see VEHICLE_POLL_MS() for sub second intervals.
+ */
 void OvmsVehicle::PollSetPidList(canbus* bus, const poll_pid_t* plist)
   {
-  OvmsMutexLock lock(&m_poll_mutex);
+  m_poll_mutex.Lock();
   m_poll_bus = bus;
   m_poll_plist = plist;
-  m_poll_ticker = 0;
-  m_poll_plcur = NULL;
+  m_poll_lists.clear();
+  if (bus && plist)
+    {
+    poll_list_t list = { bus, plist };
+    m_poll_lists.push_back(list);
+    }
+  PollerRebuild();
+  m_poll_mutex.Unlock();
+
+  // Abort running requests (callbacks need the poll mutex):
+  m_poll_isotp.CancelAll();
+  PollerSchedule();
+  }
+
+/**
+ * PollAddPidList: add a poll list for another bus
+ *  Use this after PollSetPidList() to poll ECUs on multiple buses.
+ */
+void OvmsVehicle::PollAddPidList(canbus* bus, const poll_pid_t* plist)
+  {
+  if (!bus || !plist) return;
+  m_poll_mutex.Lock();
+  if (!m_poll_bus)
+    {
+    m_poll_bus = bus;
+    m_poll_plist = plist;
+    }
+  poll_list_t list = { bus, plist };
+  m_poll_lists.push_back(list);
+  PollerAddEntries(bus, plist);
+  m_poll_mutex.Unlock();
+  PollerSchedule();
   }
 
 void OvmsVehicle::PollSetState(uint8_t state)
   {
   if ((state < VEHICLE_POLL_NSTATES)&&(state != m_poll_state))
     {
-    OvmsMutexLock lock(&m_poll_mutex);
+    m_poll_mutex.Lock();
     m_poll_state = state;
-    m_poll_ticker = 0;
-    m_poll_plcur = NULL;
+    // Poll all entries of the new state now:
+    int64_t now = esp_timer_get_time();
+    for (poll_entry_t& entry : m_poll_entries)
+      {
+      entry.due = now;
+      entry.retries = 0;
+      entry.backoff = 1;
+      }
+    m_poll_mutex.Unlock();
+    PollerSchedule();
     }
   }
 
-void OvmsVehicle::PollerSend()
+/**
+ * PollSetTimeout: set response timeout & number of retries
+ *  PIDs failing after all retries are polled at increasing intervals (up
+ *  to VEHICLE_POLL_MAXBACKOFF times the poll time) until they respond again.
+ */
+void OvmsVehicle::PollSetTimeout(uint32_t timeout_ms, uint8_t retries /*=VEHICLE_POLL_RETRIES*/)
+  {
+  OvmsMutexLock lock(&m_poll_mutex);
+  m_poll_timeout = timeout_ms;
+  m_poll_retries = retries;
+  }
+
+/**
+ * PollSetSessionTimeout: set the UDS session timeout (S3 server)
+ *  ECUs with an active VEHICLE_POLL_TYPE_OBDIISESSION entry get their
+ *  session opened before any other request. While opened, TesterPresent
+ *  is sent after half the timeout without any other request to the ECU.
+ */
+void OvmsVehicle::PollSetSessionTimeout(uint32_t s3_ms)
+  {
+  OvmsMutexLock lock(&m_poll_mutex);
+  m_poll_s3 = s3_ms;
+  }
+
+/**
+ * PollSetFlowControl: set the flow control sent to ECUs for multi frame responses
+ *  Applies to the ISO-TP sessions and to additional broadcast responses.
+ *  blocksize: frames per block (0 = all), stmin: separation time (ISO-TP encoding)
+ */
+void OvmsVehicle::PollSetFlowControl(uint8_t blocksize, uint8_t stmin)
+  {
+  OvmsMutexLock lock(&m_poll_mutex);
+  m_poll_fc_bs = blocksize;
+  m_poll_fc_stmin = stmin;
+  m_poll_isotp.SetFlowControl(blocksize, stmin);
+  }
+
+/**
+ * PollSetMultiPid: request up to maxpids OBD mode 01 PIDs at once
+ *  Mode 01 PIDs of an ECU that are due at the same time are combined into
+ *  one request, the response is split into single PID responses for
+ *  IncomingPollReply(). Only PIDs of known data length can be combined.
+ *  1 = off (default), max VEHICLE_POLL_MAXMULTIPID.
+ */
+void OvmsVehicle::PollSetMultiPid(uint8_t maxpids)
   {
   OvmsMutexLock lock(&m_poll_mutex);
-  if (!m_poll_bus || !m_poll_plist) return;
-  if (m_poll_plcur == NULL) m_poll_plcur = m_poll_plist;
+  m_poll_multipid = std::max((uint8_t)1, std::min(maxpids, (uint8_t)VEHICLE_POLL_MAXMULTIPID));
+  }
 
-  while (m_poll_plcur->txmoduleid != 0)
+/**
+ * PollerRebuild: rebuild the entry table from vehicle lists & poll definitions
+ *  Poll definitions are skipped while the vehicle has stopped polling.
+ *  (needs to be called with m_poll_mutex locked)
+ */
+void OvmsVehicle::PollerRebuild()
+  {
+  m_poll_generation++;
+  m_poll_entries.clear();
+  m_poll_ecus.clear();
+  for (poll_list_t& list : m_poll_lists)
+    PollerAddEntries(list.bus, list.plist);
+  if (m_poll_defs && (m_poll_plist || !m_poll_bus))
     {
-    // there are remaining poll replays from last poll. we wait for it.
-    if (m_poll_ml_remain > 7)
-      {
-      if (m_poll_wait)
-        {
-        // ESP_LOGD(TAG,"wait last Polling for %02x: there are remaining poll replays", m_poll_plcur->pid);
-        m_poll_wait = 0;
-        m_poll_ml_remain = 0;
-        return;
-        }
-      else
-        {
-        // ESP_LOGD(TAG,"wait Polling for %02x: there are remaining poll replays", m_poll_plcur->pid);
-        m_poll_wait = 1;
-        return;
-        }
-      }
-    m_poll_wait = 0;
-    if ((m_poll_plcur->polltime[m_poll_state] > 0)&&
-        ((m_poll_ticker % m_poll_plcur->polltime[m_poll_state] ) == 0))
+    canbus* buses[4] = { m_can1, m_can2, m_can3, m_can4 };
+    for (int i = 0; i < (int)m_poll_defs->polls.size(); i++)
       {
-      // We need to poll this one...
-      m_poll_type = m_poll_plcur->type;
-      m_poll_pid = m_poll_plcur->pid;
-      if (m_poll_plcur->rxmoduleid != 0)
-        {
-        // send to <moduleid>, listen to response from <rmoduleid>:
-        m_poll_moduleid_sent = m_poll_plcur->txmoduleid;
-        m_poll_moduleid_low = m_poll_plcur->rxmoduleid;
-        m_poll_moduleid_high = m_poll_plcur->rxmoduleid;
-        }
-      else
-        {
-        // broadcast: send to 0x7df, listen to all responses:
-        m_poll_moduleid_sent = 0x7df;
-        m_poll_moduleid_low = 0x7e8;
-        m_poll_moduleid_high = 0x7ef;
-        }
-
-      // ESP_LOGD(TAG, "Polling for %d/%02x (expecting %03x/%03x-%03x)",
-      //   m_poll_type,m_poll_pid,m_poll_moduleid_sent,m_poll_moduleid_low,m_poll_moduleid_high);
-      CAN_frame_t txframe;
-      memset(&txframe,0,sizeof(txframe));
-      txframe.origin = m_poll_bus;
-      txframe.MsgID = m_poll_moduleid_sent;
-      txframe.FIR.B.FF = CAN_frame_std;
-      txframe.FIR.B.DLC = 8;
-      switch (m_poll_plcur->type)
-        {
-        case VEHICLE_POLL_TYPE_OBDIICURRENT:
-        case VEHICLE_POLL_TYPE_OBDIIFREEZE:
-        case VEHICLE_POLL_TYPE_OBDIISESSION:
-          // 8 bit PID request for single frame response:
-          txframe.data.u8[0] = 0x02;
-          txframe.data.u8[1] = m_poll_type;
-          txframe.data.u8[2] = m_poll_pid;
-          break;
-        case VEHICLE_POLL_TYPE_OBDIIVEHICLE:
-        case VEHICLE_POLL_TYPE_OBDIIGROUP:
-        case VEHICLE_POLL_TYPE_OBDII_1A:
-          // 8 bit PID request for multi frame response:
-          m_poll_ml_remain = 0;
-          txframe.data.u8[0] = 0x02;
-          txframe.data.u8[1] = m_poll_type;
-          txframe.data.u8[2] = m_poll_pid;
-          break;
-        case VEHICLE_POLL_TYPE_OBDIIEXTENDED:
-          // 16 bit PID request:
-          m_poll_ml_remain = 0;
-          txframe.data.u8[0] = 0x03;
-          txframe.data.u8[1] = m_poll_type; //VEHICLE_POLL_TYPE_OBDIIEXTENDED;    // Get extended PID
-          txframe.data.u8[2] = m_poll_pid >> 8;
-          txframe.data.u8[3] = m_poll_pid & 0xff;
-          break;
-        }
-      m_poll_bus->Write(&txframe);
-      m_poll_plcur++;
-      return;
+      const poll_def_t& def = m_poll_defs->polls[i];
+      if (buses[def.busno-1])
+        PollerAddEntry(buses[def.busno-1], def.poll, i);
       }
-    m_poll_plcur++;
     }
-
-  m_poll_plcur = m_poll_plist;
-  m_poll_ticker++;
-  if (m_poll_ticker > 3600) m_poll_ticker -= 3600;
   }
 
-void OvmsVehicle::PollerReceive(CAN_frame_t* frame)
+/**
+ * PollerAddEntries: copy poll list into the entry table
+ *  (needs to be called with m_poll_mutex locked)
+ */
+void OvmsVehicle::PollerAddEntries(canbus* bus, const poll_pid_t* plist)
   {
-  // ESP_LOGI(TAG, "Receive Poll Response for %d/%02x",m_poll_type,m_poll_pid);
-  switch (m_poll_type)
-    {
-    case VEHICLE_POLL_TYPE_OBDIICURRENT:
-    case VEHICLE_POLL_TYPE_OBDIIFREEZE:
-    case VEHICLE_POLL_TYPE_OBDIISESSION:
-      // 8 bit PID single frame response:
-      if ((frame->data.u8[1] == 0x40+m_poll_type)&&
-          (frame->data.u8[2] == m_poll_pid))
-        {
-        m_poll_ml_frame = 0;
-        IncomingPollReply(frame->origin, m_poll_type, m_poll_pid, &frame->data.u8[3], 5, 0);
-        return;
-        }
-      break;
-    case VEHICLE_POLL_TYPE_OBDIIVEHICLE:
-    case VEHICLE_POLL_TYPE_OBDIIGROUP:
-    case VEHICLE_POLL_TYPE_OBDII_1A:
-      // 8 bit PID multiple frame response:
-      if (((frame->data.u8[0]>>4) == 0x1)&&
-          (frame->data.u8[2] == 0x40+m_poll_type)&&
-          (frame->data.u8[3] == m_poll_pid))
-        {
-        // First frame is 4 bytes header (2 ISO-TP, 2 OBDII), 4 bytes data:
-        // [first=1,lenH] [lenL] [type+40] [pid] [data0] [data1] [data2] [data3]
-        // Note that the value of 'len' includes the OBDII type and pid bytes,
-        // but we don't count these in the data we pass to IncomingPollReply.
-        //
-        // First frame; send flow control frame:
-        CAN_frame_t txframe;
-        memset(&txframe,0,sizeof(txframe));
-        txframe.origin = frame->origin;
-        txframe.FIR.B.FF = CAN_frame_std;
-        txframe.FIR.B.DLC = 8;
-
-        if (m_poll_moduleid_sent == 0x7df)
-          {
-          // broadcast request: derive module ID from response ID:
-          // (Note: this only works for the SAE standard ID scheme)
-          txframe.MsgID = frame->MsgID - 8;
-          }
-        else
-          {
-          // use known module ID:
-          txframe.MsgID = m_poll_moduleid_sent;
-          }
+  for (const poll_pid_t* p = plist; p->txmoduleid != 0; p++)
+    PollerAddEntry(bus, *p, -1);
+  }
 
-        txframe.data.u8[0] = 0x30; // flow control frame type
-        txframe.data.u8[1] = 0x00; // request all frames available
-        txframe.data.u8[2] = 0x19; // with 25ms send interval
-        txframe.Write();
+/**
+ * PollerAddEntry: add a poll to the entry table, group by ECU
+ *  (needs to be called with m_poll_mutex locked)
+ */
+void OvmsVehicle::PollerAddEntry(canbus* bus, const poll_pid_t& poll, int def)
+  {
+  int64_t now = esp_timer_get_time();
 
-        // prepare frame processing, first frame contains first 4 bytes:
-        m_poll_ml_remain = (((uint16_t)(frame->data.u8[0]&0x0f))<<8) + frame->data.u8[1] - 2 - 4;
-        m_poll_ml_offset = 4;
-        m_poll_ml_frame = 0;
+  // rxmoduleid 0 = broadcast: send to 0x7df, listen to all responses
+  uint32_t txid = (poll.rxmoduleid != 0) ? poll.txmoduleid : 0x7df;
+  uint32_t rxid = poll.rxmoduleid;
 
-        // ESP_LOGI(TAG, "Poll ML first frame (frame=%d, remain=%d)",m_poll_ml_frame,m_poll_ml_remain);
-        IncomingPollReply(frame->origin, m_poll_type, m_poll_pid, &frame->data.u8[4], 4, m_poll_ml_remain);
-        return;
-        }
-      else if (((frame->data.u8[0]>>4)==0x2)&&(m_poll_ml_remain>0))
-        {
-        // Consecutive frame (1 control + 7 data bytes)
-        uint16_t len;
-        if (m_poll_ml_remain>7)
-          {
-          m_poll_ml_remain -= 7;
-          m_poll_ml_offset += 7;
-          len = 7;
-          }
-        else
-          {
-          len = m_poll_ml_remain;
-          m_poll_ml_offset += m_poll_ml_remain;
-          m_poll_ml_remain = 0;
-          }
-        m_poll_ml_frame++;
-        // ESP_LOGI(TAG, "Poll ML subsequent frame (frame=%d, remain=%d)",m_poll_ml_frame,m_poll_ml_remain);
-        IncomingPollReply(frame->origin, m_poll_type, m_poll_pid, &frame->data.u8[1], len, m_poll_ml_remain);
-        return;
-        }
+  int ecu;
+  for (ecu = 0; ecu < (int)m_poll_ecus.size(); ecu++)
+    {
+    if (m_poll_ecus[ecu].bus == bus && m_poll_ecus[ecu].txid == txid && m_poll_ecus[ecu].rxid == rxid)
       break;
-    case VEHICLE_POLL_TYPE_OBDIIEXTENDED:
-      // 16 bit PID response:
-      if (((frame->data.u8[0]>>4) == 0x1)&&
-          (frame->data.u8[2] == 0x40+m_poll_type)&&
-          ((frame->data.u8[4]+(((uint16_t) frame->data.u8[3]) << 8))  == m_poll_pid))
-        {
-        // First frame is 4 bytes header (2 ISO-TP, 2 OBDII), 4 bytes data:
-        // [first=1,lenH] [lenL] [type+40] [pid] [data0] [data1] [data2] [data3]
-        // Note that the value of 'len' includes the OBDII type and pid bytes,
-        // but we don't count these in the data we pass to IncomingPollReply.
-        //
-        // First frame; send flow control frame:
-        CAN_frame_t txframe;
-        memset(&txframe,0,sizeof(txframe));
-        txframe.origin = frame->origin;
-        txframe.FIR.B.FF = CAN_frame_std; //CAN_frame_ext?
-        txframe.FIR.B.DLC = 8;
-
-        if (m_poll_moduleid_sent == 0x7df)
-          {
-          // broadcast request: derive module ID from response ID:
-          // (Note: this only works for the SAE standard ID scheme)
-          txframe.MsgID = frame->MsgID - 8;
-          }
-        else
-          {
-          // use known module ID:
-          txframe.MsgID = m_poll_moduleid_sent;
-          }
-
-        txframe.data.u8[0] = 0x30; // flow control frame type
-        txframe.data.u8[1] = 0x00; // request all frames available
-        txframe.data.u8[2] = 0x19; // with 25ms send interval
-        txframe.Write();
-
-        // prepare frame processing, first frame contains first 4 bytes:
-        m_poll_ml_remain = (((uint16_t)(frame->data.u8[0]&0x0f))<<8) + frame->data.u8[1] - 3;
-        m_poll_ml_offset = 3;
-        m_poll_ml_frame = 0;
+    }
+  if (ecu == (int)m_poll_ecus.size())
+    {
+    poll_ecu_t e;
+    e.bus = bus;
+    e.txid = txid;
+    e.rxid = rxid;
+    e.current = -1;
+    e.last = -1;
+    e.lasttime = 0;
+    e.lastsent = 0;
+    e.session = 0;
+    e.security = 0;
+    e.unlock = -1;
+    m_poll_ecus.push_back(e);
+    }
 
-        //ESP_LOGD(TAG, "Poll ML first frame (frame=%d, remain=%d)",m_poll_ml_frame,m_poll_ml_remain);
-        IncomingPollReply(frame->origin, m_poll_type, m_poll_pid, &frame->data.u8[4], 4, m_poll_ml_remain);
-        return;
-        }
-      else if (((frame->data.u8[0]>>4)==0x2)&&(m_poll_ml_remain>0))
-        {
-        // Consecutive frame (1 control + 7 data bytes)
-        uint16_t len;
-        if (m_poll_ml_remain>7)
-          {
-          m_poll_ml_remain -= 7;
-          m_poll_ml_offset += 7;
-          len = 7;
-          }
-        else
-          {
-          len = m_poll_ml_remain;
-          m_poll_ml_offset += m_poll_ml_remain;
-          m_poll_ml_remain = 0;
-          }
-        m_poll_ml_frame++;
-        //ESP_LOGD(TAG, "Poll ML subsequent frame (frame=%d, remain=%d)",m_poll_ml_frame,m_poll_ml_remain);
-        IncomingPollReply(frame->origin, m_poll_type, m_poll_pid, &frame->data.u8[1], len, m_poll_ml_remain);
-        return;
-        }
-      else if ((frame->data.u8[1] == 0x62)&&
-               ((frame->data.u8[3]+(((uint16_t) frame->data.u8[2]) << 8)) == m_poll_pid))
-        {
-        IncomingPollReply(frame->origin, m_poll_type, m_poll_pid, &frame->data.u8[4], 4, 0);
-        }
+  poll_stats_t* stats = NULL;
+  for (poll_stats_t& st : m_poll_stats)
+    {
+    if (st.bus == bus && st.txid == txid && st.rxid == rxid && st.type == poll.type && st.pid == poll.pid)
+      {
+      stats = &st;
       break;
+      }
     }
+  if (!stats)
+    {
+    poll_stats_t st;
+    memset(&st, 0, sizeof(st));
+    st.bus = bus;
+    st.txid = txid;
+    st.rxid = rxid;
+    st.type = poll.type;
+    st.pid = poll.pid;
+    m_poll_stats.push_back(st);
+    stats = &m_poll_stats.back();
+    }
+
+  poll_entry_t entry;
+  entry.poll = poll;
+  entry.bus = bus;
+  entry.ecu = ecu;
+  entry.due = now;
+  entry.retries = 0;
+  entry.backoff = 1;
+  entry.sent = 0;
+  entry.stats = stats;
+  entry.def = def;
+  m_poll_ecus[ecu].entries.push_back(m_poll_entries.size());
+  m_poll_entries.push_back(entry);
   }
 
 /**
- * SetFeature: V2 compatibility config wrapper
- *  Note: V2 only supported integer values, V3 values may be text
+ * PollerInterval: get poll interval [ms] for the current state (0 = off)
  */
-bool OvmsVehicle::SetFeature(int key, const char *value)
+uint32_t OvmsVehicle::PollerInterval(const poll_entry_t& entry)
   {
-  switch (key)
+  uint16_t polltime = entry.poll.polltime[m_poll_state];
+  if (polltime & 0x8000)
+    return polltime & 0x7fff;
+  else
+    return (uint32_t)polltime * 1000;
+  }
+
+/**
+ * PollerDue: get the next request for an ECU
+ *  Returns the due time and sets entry to the most overdue entry, or -2 for
+ *  TesterPresent (INT64_MAX = nothing to poll). The session and security
+ *  access entries are sent first and hold back all other requests until
+ *  they succeed, while opened they are kept alive by TesterPresent.
+ *  (needs to be called with m_poll_mutex locked)
+ */
+int64_t OvmsVehicle::PollerDue(int ecu, int& entry, int64_t now)
+  {
+  poll_ecu_t& e = m_poll_ecus[ecu];
+  int64_t due = INT64_MAX;
+  int session = -1, security = -1;
+  entry = -1;
+  for (int i : e.entries)
+    {
+    poll_entry_t& pe = m_poll_entries[i];
+    if (PollerInterval(pe) == 0)
+      continue;
+    if (pe.poll.type == VEHICLE_POLL_TYPE_OBDIISESSION)
+      session = i;
+    else if (pe.poll.type == VEHICLE_POLL_TYPE_SECURITYACCESS)
+      security = i;
+    else if (pe.due < due)
+      {
+      due = pe.due;
+      entry = i;
+      }
+    }
+
+  // The ECU drops the session after S3 without requests:
+  if (e.session && now - e.lastsent > (int64_t)m_poll_s3 * 1000)
+    e.session = e.security = 0;
+
+  if (session >= 0 && e.session != m_poll_entries[session].poll.pid)
     {
-    case 8:
-      MyConfig.SetParamValue("vehicle", "stream", value);
-      return true;
-    case 9:
-      MyConfig.SetParamValue("vehicle", "minsoc", value);
-      return true;
-    case 14:
-      MyConfig.SetParamValue("vehicle", "carbits", value);
-      return true;
-    case 15:
-      MyConfig.SetParamValue("vehicle", "canwrite", value);
-      return true;
-    default:
-      return false;
+    entry = session;
+    return m_poll_entries[session].due;
+    }
+  if (security >= 0 && e.security != m_poll_entries[security].poll.pid)
+    {
+    entry = security;
+    return m_poll_entries[security].due;
+    }
+  if (session >= 0 && e.session != 0x01)
+    {
+    // Non default session: keep alive
+    int64_t tpdue = e.lastsent + (int64_t)m_poll_s3 * 500;
+    if (tpdue < due)
+      {
+      entry = -2;
+      due = tpdue;
+      }
     }
+  // Broadcast: give all ECUs time to respond before sending the next request
+  if (e.rxid == 0 && due != INT64_MAX && due < e.lastsent + VEHICLE_POLL_BROADCAST_GAP * 1000)
+    due = e.lastsent + VEHICLE_POLL_BROADCAST_GAP * 1000;
+  return due;
   }
 
 /**
- * GetFeature: V2 compatibility config wrapper
- *  Note: V2 only supported integer values, V3 values may be text
+ * PollerSchedule: arm the timer for the next due request of all idle ECUs
+ *  (busy ECUs reschedule on response or timeout)
  */
-const std::string OvmsVehicle::GetFeature(int key)
+void OvmsVehicle::PollerSchedule()
   {
-  switch (key)
+  OvmsMutexLock lock(&m_poll_mutex);
+  if (!m_poll_timer) return;
+  int64_t now = esp_timer_get_time();
+  int64_t next = INT64_MAX;
+  for (int ecu = 0; ecu < (int)m_poll_ecus.size(); ecu++)
     {
-    case 8:
+    if (m_poll_ecus[ecu].current != -1) continue;
+    int entry;
+    int64_t due = PollerDue(ecu, entry, now);
+    if (due < next)
+      next = due;
+    }
+  esp_timer_stop(m_poll_timer);
+  if (next == INT64_MAX) return;
+  int64_t delay = next - now;
+  if (delay < 1000) delay = 1000;
+  esp_timer_start_once(m_poll_timer, delay);
+  }
+
+void OvmsVehicle::PollerTimer(void* arg)
+  {
+  OvmsVehicle* me = (OvmsVehicle*)arg;
+  me->PollerWake();
+  }
+
+/**
+ * PollerWake: let the poller task send the next due requests
+ */
+void OvmsVehicle::PollerWake()
+  {
+  OvmsMutexLock lock(&m_poll_mutex);
+  if (m_poll_task)
+    xTaskNotifyGive(m_poll_task);
+  }
+
+/**
+ * PollerTask: all poll requests are sent from this task
+ *  (woken by the scheduler timer and by responses)
+ */
+void OvmsVehicle::PollerTask(void* arg)
+  {
+  OvmsVehicle* me = (OvmsVehicle*)arg;
+  while (!me->m_poll_task_stop)
+    {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    if (!me->m_poll_task_stop)
+      me->PollerSend();
+    }
+  me->m_poll_mutex.Lock();
+  me->m_poll_task = NULL;
+  me->m_poll_mutex.Unlock();
+  vTaskDelete(NULL);
+  }
+
+/**
+ * PollerSend: start due requests on all idle ECUs
+ *  (called by the poller task)
+ */
+void OvmsVehicle::PollerSend()
+  {
+  if (!m_ready)
+    {
+    // Vehicle not yet initialized, try again later:
+    OvmsMutexLock lock(&m_poll_mutex);
+    if (m_poll_timer)
+      esp_timer_start_once(m_poll_timer, 1000000);
+    return;
+    }
+
+  m_poll_mutex.Lock();
+  int ecucnt = m_poll_ecus.size();
+  m_poll_mutex.Unlock();
+
+  for (int ecu = 0; ecu < ecucnt; ecu++)
+    PollerNext(ecu);
+
+  PollerSchedule();
+  }
+
+/**
+ * PollerNext: send the next due request for an ECU if it is idle
+ */
+void OvmsVehicle::PollerNext(int ecu)
+  {
+  m_poll_mutex.Lock();
+  if (ecu >= (int)m_poll_ecus.size())
+    {
+    m_poll_mutex.Unlock();
+    return;
+    }
+
+  if (m_poll_ecus[ecu].unlock >= 0)
+    {
+    // Security access seed received: send the key, the ECU stays busy until answered
+    poll_ecu_t& u = m_poll_ecus[ecu];
+    poll_entry_t uentry = m_poll_entries[u.unlock];
+    std::string seed;
+    seed.swap(u.seed);
+    u.unlock = -1;
+    uint32_t generation = m_poll_generation;
+    m_poll_mutex.Unlock();
+    if (PollerUnlock(generation, ecu, uentry, seed))
+      return;
+    m_poll_mutex.Lock();
+    if (generation != m_poll_generation)
+      {
+      m_poll_mutex.Unlock();
+      return;
+      }
+    m_poll_ecus[ecu].current = -1;
+    }
+
+  if (m_poll_ecus[ecu].current != -1)
+    {
+    m_poll_mutex.Unlock();
+    return;
+    }
+
+  poll_ecu_t& e = m_poll_ecus[ecu];
+  int64_t now = esp_timer_get_time();
+  int entry;
+  if (PollerDue(ecu, entry, now) > now)
+    {
+    m_poll_mutex.Unlock();
+    return;
+    }
+  e.current = entry;
+  e.lastsent = now;
+
+  if (entry == -2)
+    {
+    // TesterPresent, suppressing the positive response (finishes synchronously):
+    uint32_t generation = m_poll_generation;
+    canbus* bus = e.bus;
+    uint32_t txid = e.txid;
+    uint32_t rxid = e.rxid;
+    m_poll_mutex.Unlock();
+    bool sent = m_poll_isotp.Request(bus, txid, rxid, std::string("\x3e\x80", 2),
+      [](canbus*, uint32_t, uint32_t, canisotp_status_t, const std::string&) {}, false);
+    OvmsMutexLock lock(&m_poll_mutex);
+    if (generation == m_poll_generation)
+      {
+      m_poll_ecus[ecu].current = -1;
+      if (!sent)
+        m_poll_ecus[ecu].lastsent = now - (int64_t)m_poll_s3 * 500 + 100000;
+      }
+    return;
+    }
+
+  poll_entry_t& pe = m_poll_entries[entry];
+  pe.sent = now;
+  pe.stats->requests++;
+  pe.stats->frames++;
+
+  std::string request;
+  request.push_back((char)pe.poll.type);
+  if (pe.poll.type == VEHICLE_POLL_TYPE_OBDIIEXTENDED)
+    request.push_back((char)(pe.poll.pid >> 8)); // 16 bit PID
+  request.push_back((char)(pe.poll.pid & 0xff));
+
+  // OBD mode 01: add PIDs due now or within 1/8 of their poll time
+  e.batch.clear();
+  if (m_poll_multipid > 1 && pe.poll.type == VEHICLE_POLL_TYPE_OBDIICURRENT && PollerObdPidBatchable(pe.poll.pid))
+    {
+    for (int i : e.entries)
+      {
+      if (request.size() > m_poll_multipid)
+        break;
+      poll_entry_t& be = m_poll_entries[i];
+      uint32_t interval = PollerInterval(be);
+      if (i == entry || be.poll.type != VEHICLE_POLL_TYPE_OBDIICURRENT || interval == 0 ||
+          be.due > now + (int64_t)interval * 125 || !PollerObdPidBatchable(be.poll.pid) ||
+          request.find((char)be.poll.pid, 1) != std::string::npos)
+        continue;
+      request.push_back((char)be.poll.pid);
+      be.sent = now;
+      be.stats->requests++;
+      e.batch.push_back(i);
+      }
+    }
+
+  uint32_t generation = m_poll_generation;
+  uint32_t timeout = m_poll_timeout;
+  canbus* bus = e.bus;
+  uint32_t txid = e.txid;
+  uint32_t rxid = e.rxid;
+  m_poll_mutex.Unlock();
+
+  // ESP_LOGD(TAG, "Polling for %d/%02x (%03x/%03x)", pe.poll.type, pe.poll.pid, txid, rxid);
+  if (!m_poll_isotp.Request(bus, txid, rxid, request,
+      std::bind(&OvmsVehicle::PollerResponse, this, generation, ecu, entry,
+        std::placeholders::_3, std::placeholders::_4, std::placeholders::_5),
+      true, timeout))
+    {
+    // Session still busy: retry in 100 ms
+    OvmsMutexLock lock(&m_poll_mutex);
+    if (generation == m_poll_generation)
+      {
+      m_poll_ecus[ecu].current = -1;
+      m_poll_entries[entry].due = now + 100000;
+      m_poll_entries[entry].stats->requests--;
+      m_poll_entries[entry].stats->frames--;
+      for (int i : m_poll_ecus[ecu].batch)
+        m_poll_entries[i].stats->requests--;
+      m_poll_ecus[ecu].batch.clear();
+      }
+    }
+  }
+
+/**
+ * PollerResponse: ISO-TP session callback
+ *  Delivers the response, schedules the entry and sends the next due
+ *  request to the ECU. Timeouts are retried immediately up to the retry
+ *  limit, then the entry backs off to a multiple of its poll time.
+ *  Negative responses telling the session or security access has been
+ *  lost are retried after reopening the session.
+ */
+void OvmsVehicle::PollerResponse(uint32_t generation, int ecu, int entry, uint32_t rxid,
+  canisotp_status_t status, const std::string& response)
+  {
+  m_poll_mutex.Lock();
+  if (generation != m_poll_generation)
+    {
+    // Poll list has been changed
+    m_poll_mutex.Unlock();
+    return;
+    }
+
+  poll_entry_t& pe = m_poll_entries[entry];
+  poll_ecu_t& e = m_poll_ecus[ecu];
+  int64_t now = esp_timer_get_time();
+  const uint8_t* r = (const uint8_t*)response.data();
+  size_t len = response.size();
+
+  // Frames received, multi frame responses include our flow control frame:
+  if (len > 7)
+    pe.stats->frames += 2 + (len - 6 + 6) / 7;
+  else if (len > 0)
+    pe.stats->frames++;
+
+  // Track UDS session & security access state:
+  bool lost = false, seed = false;
+  if (status == ISOTP_OK && len >= 3 && r[0] == 0x7f && (e.session || e.security))
+    {
+    // 0x7e/0x7f: (sub)function not supported in active session, 0x33: security access denied
+    if (r[2] == 0x7e || r[2] == 0x7f || r[2] == 0x33)
+      {
+      ESP_LOGD(TAG, "Poller: %d/%02x on %s %03x: session lost (NRC %02x), reopening",
+        pe.poll.type, pe.poll.pid, pe.bus->GetName(), e.txid, r[2]);
+      if (r[2] != 0x33)
+        e.session = 0;
+      e.security = 0;
+      lost = true;
+      }
+    }
+  else if (status == ISOTP_OK && len >= 2 && r[1] == (pe.poll.pid & 0xff))
+    {
+    if (pe.poll.type == VEHICLE_POLL_TYPE_OBDIISESSION && r[0] == 0x50)
+      {
+      e.session = pe.poll.pid;
+      e.security = 0;
+      }
+    else if (pe.poll.type == VEHICLE_POLL_TYPE_SECURITYACCESS && r[0] == 0x67)
+      {
+      // Zero seed = already unlocked:
+      seed = (response.find_first_not_of('\0', 2) != std::string::npos);
+      if (!seed)
+        e.security = pe.poll.pid;
+      }
+    }
+
+  bool retry = (status == ISOTP_TIMEOUT || lost) && pe.retries < m_poll_retries;
+  bool multi = !e.batch.empty();
+  std::vector<poll_entry_t> batch;
+  std::vector<std::string> parts;
+  if (!multi)
+    {
+    PollerCount(pe, status, response, now);
+    PollerReschedule(pe, status, retry, now);
+    }
+  else
+    {
+    // Multi PID request: split the response, PIDs missing count as not answered
+    e.batch.insert(e.batch.begin(), entry);
+    for (int i : e.batch)
+      {
+      poll_entry_t& be = m_poll_entries[i];
+      canisotp_status_t bstatus = status;
+      std::string part;
+      if (status == ISOTP_OK && len > 0 && r[0] == 0x40+VEHICLE_POLL_TYPE_OBDIICURRENT)
+        {
+        if (!PollerSplitObd(response, be.poll.pid, part))
+          bstatus = ISOTP_TIMEOUT;
+        }
+      else
+        part = response;
+      PollerCount(be, bstatus, part, now);
+      PollerReschedule(be, bstatus, retry, now);
+      if (bstatus == ISOTP_OK)
+        {
+        batch.push_back(be);
+        parts.push_back(part);
+        }
+      }
+    e.batch.clear();
+    }
+  if (status == ISOTP_OK)
+    {
+    e.last = entry;
+    e.lasttime = esp_log_timestamp();
+    }
+  poll_entry_t pentry = pe;
+  m_poll_mutex.Unlock();
+
+  // While replaying a CAN log, live responses must not mix with the replayed ones:
+  if (status == ISOTP_OK && m_replaying)
+    ESP_LOGD(TAG, "Poller: %d/%02x on %s %03x: response discarded (replay running)", pentry.poll.type,
+      pentry.poll.pid, pentry.bus->GetName(), pentry.poll.txmoduleid);
+  else if (status == ISOTP_OK && !multi)
+    PollerDeliver(generation, pentry, rxid, response);
+  else if (status == ISOTP_OK)
+    {
+    for (int i = 0; i < (int)batch.size() && generation == m_poll_generation; i++)
+      PollerDeliver(generation, batch[i], rxid, parts[i]);
+    }
+  else
+    ESP_LOGD(TAG, "Poller: %d/%02x on %s %03x failed: %s", pentry.poll.type, pentry.poll.pid,
+      pentry.bus->GetName(), pentry.poll.txmoduleid, canisotp::StatusName(status));
+
+  m_poll_mutex.Lock();
+  bool next = (generation == m_poll_generation);
+  if (next && seed)
+    {
+    // Security access: the poller task sends the key, the ECU stays busy until answered
+    m_poll_ecus[ecu].unlock = entry;
+    m_poll_ecus[ecu].seed = response.substr(2);
+    }
+  else if (next)
+    m_poll_ecus[ecu].current = -1;
+  m_poll_mutex.Unlock();
+
+  // Continue with the next request, on TX errors wait for the next schedule:
+  if (next && status != ISOTP_TXERROR)
+    PollerWake();
+  else
+    PollerSchedule();
+  }
+
+/**
+ * PollerReschedule: schedule the next request of an entry after a response
+ *  Timeouts are retried immediately if retry is set, else the entry backs
+ *  off to a multiple of its poll time until it responds again.
+ *  (needs to be called with m_poll_mutex locked)
+ */
+void OvmsVehicle::PollerReschedule(poll_entry_t& entry, canisotp_status_t status, bool retry, int64_t now)
+  {
+  if (retry)
+    {
+    // Retry now:
+    entry.retries++;
+    return;
+    }
+  if (status == ISOTP_TIMEOUT)
+    {
+    if (entry.backoff < VEHICLE_POLL_MAXBACKOFF)
+      {
+      entry.backoff *= 2;
+      ESP_LOGD(TAG, "Poller: %d/%02x on %s %03x: no response, backing off to %dx poll time",
+        entry.poll.type, entry.poll.pid, entry.bus->GetName(), entry.poll.txmoduleid, entry.backoff);
+      }
+    }
+  else if (status == ISOTP_OK && entry.backoff > 1)
+    {
+    ESP_LOGD(TAG, "Poller: %d/%02x on %s %03x: responding again",
+      entry.poll.type, entry.poll.pid, entry.bus->GetName(), entry.poll.txmoduleid);
+    entry.backoff = 1;
+    }
+  entry.retries = 0;
+  // Keep the schedule phase, restart if we're lagging behind:
+  int64_t interval = (int64_t)PollerInterval(entry) * 1000;
+  entry.due += interval * entry.backoff;
+  if (entry.due <= now)
+    entry.due = now + interval * entry.backoff;
+  }
+
+/**
+ * PollerUnlock: send the security access key for a seed
+ *  Returns false if no key could be calculated or sent.
+ */
+bool OvmsVehicle::PollerUnlock(uint32_t generation, int ecu, const poll_entry_t& entry, const std::string& seed)
+  {
+  uint8_t level = entry.poll.pid;
+  std::string key;
+  if (!PollSecurityKey(entry.bus, entry.poll.txmoduleid, level, seed, key))
+    return false;
+
+  m_poll_mutex.Lock();
+  if (generation != m_poll_generation)
+    {
+    m_poll_mutex.Unlock();
+    return false;
+    }
+  poll_ecu_t& e = m_poll_ecus[ecu];
+  canbus* bus = e.bus;
+  uint32_t txid = e.txid;
+  uint32_t rxid = e.rxid;
+  uint32_t timeout = m_poll_timeout;
+  e.lastsent = esp_timer_get_time();
+  m_poll_mutex.Unlock();
+
+  std::string request;
+  request.push_back((char)VEHICLE_POLL_TYPE_SECURITYACCESS);
+  request.push_back((char)(level + 1));
+  request.append(key);
+  return m_poll_isotp.Request(bus, txid, rxid, request,
+    std::bind(&OvmsVehicle::PollerUnlocked, this, generation, ecu, level,
+      std::placeholders::_4, std::placeholders::_5),
+    true, timeout);
+  }
+
+/**
+ * PollerUnlocked: ISO-TP session callback for the security access key
+ */
+void OvmsVehicle::PollerUnlocked(uint32_t generation, int ecu, uint8_t level,
+  canisotp_status_t status, const std::string& response)
+  {
+  m_poll_mutex.Lock();
+  if (generation != m_poll_generation)
+    {
+    m_poll_mutex.Unlock();
+    return;
+    }
+  poll_ecu_t& e = m_poll_ecus[ecu];
+  if (status == ISOTP_OK && response.size() >= 2 &&
+      (uint8_t)response[0] == 0x67 && (uint8_t)response[1] == level + 1)
+    {
+    e.security = level;
+    ESP_LOGD(TAG, "Poller: %s %03x: security access level %02x unlocked", e.bus->GetName(), e.txid, level);
+    }
+  else
+    {
+    ESP_LOGW(TAG, "Poller: %s %03x: security access level %02x denied (%s, NRC %02x)", e.bus->GetName(), e.txid,
+      level, canisotp::StatusName(status), (response.size() >= 3) ? (uint8_t)response[2] : 0);
+    }
+  e.current = -1;
+  m_poll_mutex.Unlock();
+
+  PollerWake();
+  }
+
+/**
+ * PollerObdPidLength: get the data length of an OBD mode 01 PID (0 = unknown / variable)
+ */
+int OvmsVehicle::PollerObdPidLength(uint16_t pid)
+  {
+  static const uint8_t lengths[0x68] =
+    {
+    4,4,2,2,1,1,0,0,0,0,1,1,2,1,1,1, // 00-0f (06-09: 1 or 2 bytes)
+    2,1,1,1,2,2,2,2,2,2,2,2,1,1,1,2, // 10-1f
+    4,2,2,2,4,4,4,4,4,4,4,4,1,1,1,1, // 20-2f
+    1,2,2,1,4,4,4,4,4,4,4,4,2,2,2,2, // 30-3f
+    4,4,2,2,2,1,1,1,1,1,1,1,1,2,2,4, // 40-4f
+    4,1,1,2,2,2,2,2,2,2,1,1,1,2,2,1, // 50-5f
+    4,1,1,2,5,2,5,3,                 // 60-67
+    };
+  if (pid < sizeof(lengths))
+    return lengths[pid];
+  else if (pid == 0x80 || pid == 0xa0 || pid == 0xc0)
+    return 4;
+  return 0;
+  }
+
+/**
+ * PollerObdPidBatchable: check if an OBD mode 01 PID can be combined with others
+ *  Needs a known data length. The supported PID bitmaps (00, 20, 40, …) are
+ *  always sent in their own request, ECUs may reject or truncate a request
+ *  mixing them with data PIDs.
+ */
+bool OvmsVehicle::PollerObdPidBatchable(uint16_t pid)
+  {
+  return (pid & 0x1f) != 0 && PollerObdPidLength(pid) > 0;
+  }
+
+/**
+ * PollerSplitObd: extract a single PID response from a mode 01 multi PID response
+ */
+bool OvmsVehicle::PollerSplitObd(const std::string& response, uint16_t pid, std::string& part)
+  {
+  size_t pos = 1;
+  while (pos < response.size())
+    {
+    uint8_t p = response[pos];
+    int len = PollerObdPidLength(p);
+    if (len == 0 || pos + 1 + len > response.size())
+      break;
+    if (p == pid)
+      {
+      part.assign(1, response[0]);
+      part.append(response, pos, 1 + len);
+      return true;
+      }
+    pos += 1 + len;
+    }
+  return false;
+  }
+
+/**
+ * PollerCount: update PID statistics for a finished request
+ *  (needs to be called with m_poll_mutex locked)
+ */
+void OvmsVehicle::PollerCount(poll_entry_t& entry, canisotp_status_t status, const std::string& response, int64_t now)
+  {
+  static const uint32_t rtt_limits[VEHICLE_POLL_RTT_BUCKETS-1] =
+    { 10000, 20000, 50000, 100000, 200000, 500000, 1000000 };
+  poll_stats_t* st = entry.stats;
+  size_t len = response.size();
+
+  switch (status)
+    {
+    case ISOTP_OK:
+      {
+      uint32_t rtt = now - entry.sent;
+      st->responses++;
+      st->bytes += len;
+      if (len > 0 && (uint8_t)response[0] == 0x7f)
+        st->negative++;
+      if (st->responses == 1 || rtt < st->rtt_min)
+        st->rtt_min = rtt;
+      if (rtt > st->rtt_max)
+        st->rtt_max = rtt;
+      st->rtt_sum += rtt;
+      int bucket = 0;
+      while (bucket < VEHICLE_POLL_RTT_BUCKETS-1 && rtt >= rtt_limits[bucket])
+        bucket++;
+      st->rtt_hist[bucket]++;
+      break;
+      }
+    case ISOTP_TIMEOUT:
+      // A timeout after the first frame means the response was truncated:
+      if (len > 0)
+        st->truncated++;
+      else
+        st->timeouts++;
+      break;
+    case ISOTP_OVERFLOW:
+    case ISOTP_SEQERROR:
+      st->truncated++;
+      break;
+    case ISOTP_TXERROR:
+      st->errors++;
+      break;
+    default:
+      break;
+    }
+  }
+
+/**
+ * PollStats: output poller statistics
+ */
+void OvmsVehicle::PollStats(int verbosity, OvmsWriter* writer)
+  {
+  static const char* const rtt_bucket_names[VEHICLE_POLL_RTT_BUCKETS] =
+    { "<10", "<20", "<50", "<100", "<200", "<500", "<1000", ">=1000" };
+
+  // Output a copy to keep the lock time short:
+  m_poll_mutex.Lock();
+  std::list<poll_stats_t> pollstats = m_poll_stats;
+  int64_t elapsed = esp_timer_get_time() - m_poll_stats_start;
+  m_poll_mutex.Unlock();
+
+  if (pollstats.empty())
+    {
+    writer->puts("No poll statistics available");
+    return;
+    }
+
+  if (elapsed < 1000000) elapsed = 1000000;
+  writer->printf("Poll statistics since %d s:\n", (int)(elapsed / 1000000));
+
+  // Bus time used by polling:
+  std::map<canbus*, uint64_t> busbits;
+  for (poll_stats_t& st : pollstats)
+    {
+    // 8 byte frames incl. stuff bits (worst case 1/8 for the stuffed part):
+    uint32_t framebits = (st.txid > 0x7ff) ? 67+64+(53+64)/8 : 47+64+(33+64)/8;
+    busbits[st.bus] += (uint64_t)st.frames * framebits;
+    }
+  for (auto& bb : busbits)
+    {
+    uint32_t speed = MAP_CAN_SPEED(bb.first->m_speed);
+    writer->printf("  %s: %.2f%% bus load\n", bb.first->GetName(),
+      speed ? (double)bb.second * 100 * 1000000 / ((double)speed * elapsed) : 0.0);
+    }
+
+  writer->printf("\n%-4s %-8s %-8s %-4s %-4s %6s %6s %5s %5s %5s %5s %8s %s\n",
+    "Bus", "TxID", "RxID", "Type", "PID", "Req", "Resp", "NRC", "TOut", "Trunc", "Err", "Bytes",
+    "RTT min/avg/max [ms]");
+  for (poll_stats_t& st : pollstats)
+    {
+    writer->printf("%-4s %-8x %-8x %-4x %-4x %6u %6u %5u %5u %5u %5u %8u",
+      st.bus->GetName(), st.txid, st.rxid, st.type, st.pid, st.requests, st.responses,
+      st.negative, st.timeouts, st.truncated, st.errors, st.bytes);
+    if (st.responses)
+      writer->printf(" %.1f/%.1f/%.1f\n", (float)st.rtt_min / 1000,
+        (float)st.rtt_sum / st.responses / 1000, (float)st.rtt_max / 1000);
+    else
+      writer->puts(" -");
+    }
+
+  if (verbosity >= COMMAND_RESULT_VERBOSE)
+    {
+    writer->printf("\nRTT histogram [ms]:\n%-4s %-8s %-4s %-4s", "Bus", "TxID", "Type", "PID");
+    for (int i = 0; i < VEHICLE_POLL_RTT_BUCKETS; i++)
+      writer->printf(" %6s", rtt_bucket_names[i]);
+    writer->puts("");
+    for (poll_stats_t& st : pollstats)
+      {
+      writer->printf("%-4s %-8x %-4x %-4x", st.bus->GetName(), st.txid, st.type, st.pid);
+      for (int i = 0; i < VEHICLE_POLL_RTT_BUCKETS; i++)
+        writer->printf(" %6u", st.rtt_hist[i]);
+      writer->puts("");
+      }
+    }
+  }
+
+/**
+ * PollResetStats: reset poller statistics
+ */
+void OvmsVehicle::PollResetStats()
+  {
+  OvmsMutexLock lock(&m_poll_mutex);
+  for (poll_stats_t& st : m_poll_stats)
+    {
+    st.requests = st.responses = st.negative = st.timeouts = st.truncated = st.errors = 0;
+    st.bytes = st.frames = 0;
+    st.rtt_min = st.rtt_max = 0;
+    st.rtt_sum = 0;
+    memset(st.rtt_hist, 0, sizeof(st.rtt_hist));
+    }
+  m_poll_stats_start = esp_timer_get_time();
+  }
+
+/**
+ * PollerUpdateMetrics: publish statistics as metrics (config vehicle poll.metrics)
+ *  Metrics m.poll.<bus>.<txid>.<type>.<pid>.rtt (avg RTT [ms]) and .success
+ *  (responses / requests [%]) are created on first use.
+ */
+void OvmsVehicle::PollerUpdateMetrics()
+  {
+  m_poll_mutex.Lock();
+  for (poll_stats_t& st : m_poll_stats)
+    {
+    if (!st.requests) continue;
+    if (!st.m_rtt)
+      {
+      char prefix[48];
+      snprintf(prefix, sizeof(prefix), "m.poll.%s.%x.%x.%x", st.bus->GetName(), st.txid, st.type, st.pid);
+      // Metric registration needs the metrics lock only:
+      m_poll_mutex.Unlock();
+      OvmsMetricFloat* rtt = MyMetrics.InitFloat(strdup((std::string(prefix) + ".rtt").c_str()), SM_STALE_MIN, 0);
+      OvmsMetricFloat* success = MyMetrics.InitFloat(strdup((std::string(prefix) + ".success").c_str()), SM_STALE_MIN, 0, Percentage);
+      m_poll_mutex.Lock();
+      st.m_rtt = rtt;
+      st.m_success = success;
+      }
+    if (st.responses)
+      st.m_rtt->SetValue((float)st.rtt_sum / st.responses / 1000);
+    st.m_success->SetValue((float)st.responses * 100 / st.requests);
+    }
+  m_poll_mutex.Unlock();
+  }
+
+/**
+ * PollerDeliver: pass a response to IncomingPollReply()
+ *  The response is sliced into the frame format of the legacy poller:
+ *  single frame responses pass the data following type & PID (5 bytes
+ *  for 8 bit PIDs, 4 bytes for 16 bit PIDs), multi frame responses pass
+ *  4 bytes from the first frame (starting with the low PID byte for 16 bit
+ *  PIDs) followed by 7 bytes per consecutive frame.
+ *  As with the legacy poller, mode 01/02 & session control responses are
+ *  only passed as single frames, mode 09/1A/21 responses only as multi
+ *  frames, and the bytes following the response in its last frame are the
+ *  ECU's own (padding) bytes. The latter needs the last frame, which is
+ *  available if the response has been completed by the frame RxTask is
+ *  processing (else zeros are passed).
+ */
+void OvmsVehicle::PollerDeliver(uint32_t generation, const poll_entry_t& entry, uint32_t rxid,
+  const std::string& response)
+  {
+  const uint8_t* r = (const uint8_t*)response.data();
+  size_t len = response.size();
+  uint16_t type = entry.poll.type;
+  uint16_t pid = entry.poll.pid;
+  size_t hdr = (type == VEHICLE_POLL_TYPE_OBDIIEXTENDED) ? 3 : 2;
+
+  if (len >= 3 && r[0] == 0x7f)
+    {
+    ESP_LOGD(TAG, "Poller: %d/%02x on %s %03x: negative response code %02x",
+      type, pid, entry.bus->GetName(), rxid, r[2]);
+    return;
+    }
+  if ((len < hdr)||(r[0] != 0x40+type)||
+      ((hdr == 3) ? (((uint16_t)r[1] << 8) + r[2] != pid) : (r[1] != (pid & 0xff))))
+    return;
+
+  if (entry.def >= 0)
+    {
+    // Poll definition: decode signals from the complete response
+    PollerDecode(entry, response);
+    return;
+    }
+
+  switch (type)
+    {
+    case VEHICLE_POLL_TYPE_OBDIICURRENT:
+    case VEHICLE_POLL_TYPE_OBDIIFREEZE:
+    case VEHICLE_POLL_TYPE_OBDIISESSION:
+      if (len > 7) return;
+      break;
+    case VEHICLE_POLL_TYPE_OBDIIVEHICLE:
+    case VEHICLE_POLL_TYPE_OBDIIGROUP:
+    case VEHICLE_POLL_TYPE_OBDII_1A:
+      if (len <= 7) return;
+      break;
+    }
+
+  const uint8_t* last = NULL;
+  if (m_poll_rxframe && xTaskGetCurrentTaskHandle() == m_rxtask)
+    last = m_poll_rxframe->data.u8;
+
+  m_poll_type = type;
+  m_poll_pid = pid;
+  if (entry.poll.rxmoduleid != 0)
+    {
+    m_poll_moduleid_sent = entry.poll.txmoduleid;
+    m_poll_moduleid_low = rxid;
+    m_poll_moduleid_high = rxid;
+    }
+  else
+    {
+    m_poll_moduleid_sent = 0x7df;
+    m_poll_moduleid_low = 0x7e8;
+    m_poll_moduleid_high = 0x7ef;
+    }
+
+  uint8_t data[8];
+  memset(data, 0, sizeof(data));
+  if (len <= 7)
+    {
+    // Single frame:
+    if (last && last[0] == len && memcmp(last+1, r, len) == 0)
+      memcpy(data, last+1+hdr, 7-hdr);
+    else
+      memcpy(data, r+hdr, len-hdr);
+    m_poll_ml_frame = 0;
+    m_poll_ml_remain = 0;
+    IncomingPollReply(entry.bus, type, pid, data, 7-hdr, 0);
+    return;
+    }
+
+  // First frame:
+  memcpy(data, r+2, 4);
+  m_poll_ml_remain = (hdr == 3) ? len-3 : len-6;
+  m_poll_ml_offset = (hdr == 3) ? 3 : 4;
+  m_poll_ml_frame = 0;
+  IncomingPollReply(entry.bus, type, pid, data, 4, m_poll_ml_remain);
+
+  // Consecutive frames:
+  size_t pos = 6;
+  while (m_poll_ml_remain > 0 && generation == m_poll_generation)
+    {
+    uint16_t cnt = (m_poll_ml_remain > 7) ? 7 : m_poll_ml_remain;
+    memset(data, 0, sizeof(data));
+    if (pos < len)
+      memcpy(data, r+pos, std::min((size_t)7, len-pos));
+    if (last && pos < len && len-pos <= 7 && (last[0] >> 4) == 2 && memcmp(last+1, r+pos, len-pos) == 0)
+      memcpy(data, last+1, 7);  // last frame
+    pos += 7;
+    m_poll_ml_remain -= cnt;
+    m_poll_ml_offset += cnt;
+    m_poll_ml_frame++;
+    IncomingPollReply(entry.bus, type, pid, data, cnt, m_poll_ml_remain);
+    }
+  }
+
+/**
+ * PollerReceive: handle additional responses to a broadcast request
+ *  (the first response is taken by the ISO-TP session). Multi frame
+ *  responses are reassembled per responder, flow control is sent to
+ *  the responder's physical request ID (response ID - 8).
+ */
+void OvmsVehicle::PollerReceive(CAN_frame_t* frame)
+  {
+  if ((frame->MsgID < 0x7e8)||(frame->MsgID > 0x7ef)||(frame->FIR.B.FF != CAN_frame_std))
+    return;
+  const uint8_t* d = frame->data.u8;
+  poll_bcrx_t& rx = m_poll_bcrx[frame->MsgID - 0x7e8];
+  uint32_t now = esp_log_timestamp();
+  std::string response;
+
+  switch (d[0] >> 4)
+    {
+    case 0:   // Single frame
+      {
+      uint8_t len = d[0];
+      if (len < 2 || len > 7)
+        return;
+      rx.length = 0;
+      response.assign((const char*)d+1, len);
+      break;
+      }
+    case 1:   // First frame
+      {
+      uint16_t len = ((uint16_t)(d[0] & 0x0f) << 8) + d[1];
+      rx.length = 0;
+      if (len < 8)
+        return;
+      // Only accept while a broadcast request is being answered:
+      bool pending = false;
+      m_poll_mutex.Lock();
+      for (poll_ecu_t& e : m_poll_ecus)
+        {
+        if (e.bus == frame->origin && e.rxid == 0 &&
+            (e.current >= 0 || (e.last >= 0 && now - e.lasttime < 1000)))
+          {
+          pending = true;
+          break;
+          }
+        }
+      m_poll_mutex.Unlock();
+      if (!pending)
+        return;
+      rx.data.assign((const char*)d+2, 6);
+      rx.length = len;
+      rx.sn = 1;
+      rx.bs_count = 0;
+      rx.time = now;
+      // Flow control: continue to send, same parameters as the ISO-TP sessions
+      uint8_t fc[8] = { 0x30, m_poll_fc_bs, m_poll_fc_stmin, 0x00, 0x00, 0x00, 0x00, 0x00 };
+      frame->origin->WriteStandard(frame->MsgID - 8, 8, fc);
+      return;
+      }
+    case 2:   // Consecutive frame
+      {
+      if (rx.length == 0)
+        return;
+      if ((d[0] & 0x0f) != rx.sn || now - rx.time > 1000)
+        {
+        // Sequence error or timeout: discard
+        rx.length = 0;
+        return;
+        }
+      rx.sn = (rx.sn + 1) & 0x0f;
+      rx.time = now;
+      rx.data.append((const char*)d+1, std::min((size_t)7, rx.length - rx.data.size()));
+      if (rx.data.size() < rx.length)
+        {
+        if (m_poll_fc_bs > 0 && ++rx.bs_count >= m_poll_fc_bs)
+          {
+          // Block complete: request the next block
+          rx.bs_count = 0;
+          uint8_t fc[8] = { 0x30, m_poll_fc_bs, m_poll_fc_stmin, 0x00, 0x00, 0x00, 0x00, 0x00 };
+          frame->origin->WriteStandard(frame->MsgID - 8, 8, fc);
+          }
+        return;
+        }
+      response.swap(rx.data);
+      rx.data.clear();
+      rx.length = 0;
+      break;
+      }
+    default:
+      return;
+    }
+
+  std::vector<poll_entry_t> entries;
+  uint32_t generation;
+  bool multi = false;
+  m_poll_mutex.Lock();
+  for (poll_ecu_t& e : m_poll_ecus)
+    {
+    if (e.bus == frame->origin && e.rxid == 0 && e.last >= 0 && now - e.lasttime < 1000)
+      {
+      const poll_entry_t& last = m_poll_entries[e.last];
+      generation = m_poll_generation;
+      if (m_poll_multipid > 1 && last.poll.type == VEHICLE_POLL_TYPE_OBDIICURRENT)
+        {
+        // Multi PID response: deliver to all mode 01 entries contained
+        multi = true;
+        for (int i : e.entries)
+          {
+          if (m_poll_entries[i].poll.type == VEHICLE_POLL_TYPE_OBDIICURRENT)
+            entries.push_back(m_poll_entries[i]);
+          }
+        }
+      else
+        entries.push_back(last);
+      break;
+      }
+    }
+  m_poll_mutex.Unlock();
+
+  if (!multi)
+    {
+    for (poll_entry_t& entry : entries)
+      PollerDeliver(generation, entry, frame->MsgID, response);
+    }
+  else if (response[0] == 0x40+VEHICLE_POLL_TYPE_OBDIICURRENT)
+    {
+    std::string part;
+    for (poll_entry_t& entry : entries)
+      {
+      if (PollerSplitObd(response, entry.poll.pid, part))
+        PollerDeliver(generation, entry, frame->MsgID, part);
+      }
+    }
+  }
+
+/**
+ * SetFeature: V2 compatibility config wrapper
+ *  Note: V2 only supported integer values, V3 values may be text
+ */
+bool OvmsVehicle::SetFeature(int key, const char *value)
+  {
+  switch (key)
+    {
+    case 8:
+      MyConfig.SetParamValue("vehicle", "stream", value);
+      return true;
+    case 9:
+      MyConfig.SetParamValue("vehicle", "minsoc", value);
+      return true;
+    case 14:
+      MyConfig.SetParamValue("vehicle", "carbits", value);
+      return true;
+    case 15:
+      MyConfig.SetParamValue("vehicle", "canwrite", value);
+      return true;
+    default:
+      return false;
+    }
+  }
+
+/**
+ * GetFeature: V2 compatibility config wrapper
+ *  Note: V2 only supported integer values, V3 values may be text
+ */
+const std::string OvmsVehicle::GetFeature(int key)
+  {
+  switch (key)
+    {
+    case 8:
       return MyConfig.GetParamValue("vehicle", "stream", "0");
     case 9:
       return MyConfig.GetParamValue("vehicle", "minsoc", "0");
@@ -2386,6 +3567,7 @@ void OvmsVehicle::BmsSetCellDefaultThresholdsVoltage(float warn, float alert)
   {
   m_bms_defthr_vwarn = warn;
   m_bms_defthr_valert = alert;
+  BmsUpdateThresholds();
   }
 void OvmsVehicle::BmsGetCellDefaultThresholdsVoltage(float* warn, float* alert)
   {
@@ -2397,6 +3579,7 @@ void OvmsVehicle::BmsSetCellDefaultThresholdsTemperature(float warn, float alert
   {
   m_bms_defthr_twarn = warn;
   m_bms_defthr_talert = alert;
+  BmsUpdateThresholds();
   }
 void OvmsVehicle::BmsGetCellDefaultThresholdsTemperature(float* warn, float* alert)
   {
@@ -2404,6 +3587,18 @@ void OvmsVehicle::BmsGetCellDefaultThresholdsTemperature(float* warn, float* ale
   if (alert) *alert = m_bms_defthr_talert;
   }
 
+/**
+ * BmsUpdateThresholds: read deviation thresholds from the config
+ *  (called on config changes, not per cell update)
+ */
+void OvmsVehicle::BmsUpdateThresholds()
+  {
+  m_bms_thr_vwarn  = MyConfig.GetParamValueFloat("vehicle", "bms.dev.voltage.warn", m_bms_defthr_vwarn);
+  m_bms_thr_valert = MyConfig.GetParamValueFloat("vehicle", "bms.dev.voltage.alert", m_bms_defthr_valert);
+  m_bms_thr_twarn  = MyConfig.GetParamValueFloat("vehicle", "bms.dev.temp.warn", m_bms_defthr_twarn);
+  m_bms_thr_talert = MyConfig.GetParamValueFloat("vehicle", "bms.dev.temp.alert", m_bms_defthr_talert);
+  }
+
 void OvmsVehicle::BmsSetCellLimitsVoltage(float min, float max)
   {
   m_bms_limit_vmin = min;
@@ -2416,56 +3611,96 @@ void OvmsVehicle::BmsSetCellLimitsTemperature(float min, float max)
   m_bms_limit_tmax = max;
   }
 
+/**
+ * BmsSetCellVoltage: set a cell voltage
+ *  Sum, sum of squares, min & max of the current sweep are updated per cell,
+ *  the pack statistics & cell deviations are calculated and published to the
+ *  metrics once per completed sweep (all cells set).
+ */
 void OvmsVehicle::BmsSetCellVoltage(int index, float value)
   {
   // ESP_LOGI(TAG,"BmsSetCellVoltage(%d,%f) c=%d", index, value, m_bms_bitset_cv);
   if ((index<0)||(index>=m_bms_readings_v)) return;
   if ((value<m_bms_limit_vmin)||(value>m_bms_limit_vmax)) return;
-  m_bms_voltages[index] = value;
 
   if (! m_bms_has_voltages)
     {
     m_bms_vmins[index] = value;
     m_bms_vmaxs[index] = value;
+    m_bms_vminmax_changed = true;
     }
   else if (m_bms_vmins[index] > value)
+    {
     m_bms_vmins[index] = value;
+    m_bms_vminmax_changed = true;
+    }
   else if (m_bms_vmaxs[index] < value)
+    {
     m_bms_vmaxs[index] = value;
+    m_bms_vminmax_changed = true;
+    }
+
+  // update sweep aggregates:
+  if (m_bms_bitset_v[index])
+    {
+    // cell set again within the sweep: replace old value
+    float old = m_bms_voltages[index];
+    m_bms_vsum -= old;
+    m_bms_vsqrsum -= SQR(old);
+    if (old <= m_bms_vsweepmin || old >= m_bms_vsweepmax)
+      m_bms_vrescan = true;
+    }
+  else
+    {
+    m_bms_bitset_v[index] = true;
+    m_bms_bitset_cv++;
+    }
+  m_bms_voltages[index] = value;
+  m_bms_vsum += value;
+  m_bms_vsqrsum += SQR(value);
+  if (m_bms_bitset_cv == 1 || value < m_bms_vsweepmin)
+    m_bms_vsweepmin = value;
+  if (m_bms_bitset_cv == 1 || value > m_bms_vsweepmax)
+    m_bms_vsweepmax = value;
 
-  if (m_bms_bitset_v[index] == false) m_bms_bitset_cv++;
   if (m_bms_bitset_cv == m_bms_readings_v)
     {
     // get min, max, avg & standard deviation:
-    double sum=0, sqrsum=0, avg, stddev=0;
-    float min=0, max=0;
-    for (int i=0; i<m_bms_readings_v; i++)
+    double avg, stddev;
+    float min = m_bms_vsweepmin, max = m_bms_vsweepmax;
+    if (m_bms_vrescan)
       {
-      sum += m_bms_voltages[i];
-      sqrsum += SQR(m_bms_voltages[i]);
-      if (min==0 || m_bms_voltages[i]<min)
-        min = m_bms_voltages[i];
-      if (max==0 || m_bms_voltages[i]>max)
-        max = m_bms_voltages[i];
+      min = max = m_bms_voltages[0];
+      for (int i=1; i<m_bms_readings_v; i++)
+        {
+        if (m_bms_voltages[i] < min) min = m_bms_voltages[i];
+        if (m_bms_voltages[i] > max) max = m_bms_voltages[i];
+        }
       }
-    avg = sum / m_bms_readings_v;
-    stddev = sqrt(LIMIT_MIN((sqrsum / m_bms_readings_v) - SQR(avg), 0));
+    avg = m_bms_vsum / m_bms_readings_v;
+    stddev = sqrt(LIMIT_MIN((m_bms_vsqrsum / m_bms_readings_v) - SQR(avg), 0));
     // check cell deviations:
     float dev;
-    float thr_warn  = MyConfig.GetParamValueFloat("vehicle", "bms.dev.voltage.warn", m_bms_defthr_vwarn);
-    float thr_alert = MyConfig.GetParamValueFloat("vehicle", "bms.dev.voltage.alert", m_bms_defthr_valert);
+    bool devchanged = !m_bms_has_voltages, alertchanged = !m_bms_has_voltages;
     for (int i=0; i<m_bms_readings_v; i++)
       {
       dev = ROUNDPREC(m_bms_voltages[i] - avg, 5);
       if (ABS(dev) > ABS(m_bms_vdevmaxs[i]))
+        {
         m_bms_vdevmaxs[i] = dev;
-      if (ABS(dev) >= thr_alert && m_bms_valerts[i] < 2)
+        devchanged = true;
+        }
+      if (ABS(dev) >= m_bms_thr_valert && m_bms_valerts[i] < 2)
         {
         m_bms_valerts[i] = 2;
         m_bms_valerts_new++; // trigger notification
+        alertchanged = true;
         }
-      else if (ABS(dev) >= thr_warn && m_bms_valerts[i] < 1)
+      else if (ABS(dev) >= m_bms_thr_vwarn && m_bms_valerts[i] < 1)
+        {
         m_bms_valerts[i] = 1;
+        alertchanged = true;
+        }
       }
     // publish to metrics:
     avg = ROUNDPREC(avg, 5);
@@ -2477,72 +3712,110 @@ void OvmsVehicle::BmsSetCellVoltage(int index, float value)
     if (stddev > StandardMetrics.ms_v_bat_pack_vstddev_max->AsFloat())
       StandardMetrics.ms_v_bat_pack_vstddev_max->SetValue(stddev);
     StandardMetrics.ms_v_bat_cell_voltage->SetElemValues(0, m_bms_readings_v, m_bms_voltages);
-    StandardMetrics.ms_v_bat_cell_vmin->SetElemValues(0, m_bms_readings_v, m_bms_vmins);
-    StandardMetrics.ms_v_bat_cell_vmax->SetElemValues(0, m_bms_readings_v, m_bms_vmaxs);
-    StandardMetrics.ms_v_bat_cell_vdevmax->SetElemValues(0, m_bms_readings_v, m_bms_vdevmaxs);
-    StandardMetrics.ms_v_bat_cell_valert->SetElemValues(0, m_bms_readings_v, m_bms_valerts);
+    if (m_bms_vminmax_changed)
+      {
+      StandardMetrics.ms_v_bat_cell_vmin->SetElemValues(0, m_bms_readings_v, m_bms_vmins);
+      StandardMetrics.ms_v_bat_cell_vmax->SetElemValues(0, m_bms_readings_v, m_bms_vmaxs);
+      }
+    if (devchanged)
+      StandardMetrics.ms_v_bat_cell_vdevmax->SetElemValues(0, m_bms_readings_v, m_bms_vdevmaxs);
+    if (alertchanged)
+      StandardMetrics.ms_v_bat_cell_valert->SetElemValues(0, m_bms_readings_v, m_bms_valerts);
     // complete:
     m_bms_has_voltages = true;
-    m_bms_bitset_v.clear();
-    m_bms_bitset_v.resize(m_bms_readings_v);
-    m_bms_bitset_cv = 0;
-    }
-  else
-    {
-    m_bms_bitset_v[index] = true;
+    m_bms_vminmax_changed = false;
+    BmsRestartCellVoltages();
     }
   }
 
+/**
+ * BmsSetCellTemperature: set a cell temperature
+ *  (see BmsSetCellVoltage)
+ */
 void OvmsVehicle::BmsSetCellTemperature(int index, float value)
   {
   // ESP_LOGI(TAG,"BmsSetCellTemperature(%d,%f) c=%d", index, value, m_bms_bitset_ct);
   if ((index<0)||(index>=m_bms_readings_t)) return;
   if ((value<m_bms_limit_tmin)||(value>m_bms_limit_tmax)) return;
-  m_bms_temperatures[index] = value;
 
   if (! m_bms_has_temperatures)
     {
     m_bms_tmins[index] = value;
     m_bms_tmaxs[index] = value;
+    m_bms_tminmax_changed = true;
     }
   else if (m_bms_tmins[index] > value)
+    {
     m_bms_tmins[index] = value;
+    m_bms_tminmax_changed = true;
+    }
   else if (m_bms_tmaxs[index] < value)
+    {
     m_bms_tmaxs[index] = value;
+    m_bms_tminmax_changed = true;
+    }
+
+  // update sweep aggregates:
+  if (m_bms_bitset_t[index])
+    {
+    // cell set again within the sweep: replace old value
+    float old = m_bms_temperatures[index];
+    m_bms_tsum -= old;
+    m_bms_tsqrsum -= SQR(old);
+    if (old <= m_bms_tsweepmin || old >= m_bms_tsweepmax)
+      m_bms_trescan = true;
+    }
+  else
+    {
+    m_bms_bitset_t[index] = true;
+    m_bms_bitset_ct++;
+    }
+  m_bms_temperatures[index] = value;
+  m_bms_tsum += value;
+  m_bms_tsqrsum += SQR(value);
+  if (m_bms_bitset_ct == 1 || value < m_bms_tsweepmin)
+    m_bms_tsweepmin = value;
+  if (m_bms_bitset_ct == 1 || value > m_bms_tsweepmax)
+    m_bms_tsweepmax = value;
 
-  if (m_bms_bitset_t[index] == false) m_bms_bitset_ct++;
   if (m_bms_bitset_ct == m_bms_readings_t)
     {
     // get min, max, avg & standard deviation:
-    double sum=0, sqrsum=0, avg, stddev=0;
-    float min=0, max=0;
-    for (int i=0; i<m_bms_readings_t; i++)
+    double avg, stddev;
+    float min = m_bms_tsweepmin, max = m_bms_tsweepmax;
+    if (m_bms_trescan)
       {
-      sum += m_bms_temperatures[i];
-      sqrsum += SQR(m_bms_temperatures[i]);
-      if (min==0 || m_bms_temperatures[i]<min)
-        min = m_bms_temperatures[i];
-      if (max==0 || m_bms_temperatures[i]>max)
-        max = m_bms_temperatures[i];
+      min = max = m_bms_temperatures[0];
+      for (int i=1; i<m_bms_readings_t; i++)
+        {
+        if (m_bms_temperatures[i] < min) min = m_bms_temperatures[i];
+        if (m_bms_temperatures[i] > max) max = m_bms_temperatures[i];
+        }
       }
-    avg = sum / m_bms_readings_t;
-    stddev = sqrt(LIMIT_MIN((sqrsum / m_bms_readings_t) - SQR(avg), 0));
+    avg = m_bms_tsum / m_bms_readings_t;
+    stddev = sqrt(LIMIT_MIN((m_bms_tsqrsum / m_bms_readings_t) - SQR(avg), 0));
     // check cell deviations:
     float dev;
-    float thr_warn  = MyConfig.GetParamValueFloat("vehicle", "bms.dev.temp.warn", m_bms_defthr_twarn);
-    float thr_alert = MyConfig.GetParamValueFloat("vehicle", "bms.dev.temp.alert", m_bms_defthr_talert);
+    bool devchanged = !m_bms_has_temperatures, alertchanged = !m_bms_has_temperatures;
     for (int i=0; i<m_bms_readings_t; i++)
       {
       dev = ROUNDPREC(m_bms_temperatures[i] - avg, 2);
       if (ABS(dev) > ABS(m_bms_tdevmaxs[i]))
+        {
         m_bms_tdevmaxs[i] = dev;
-      if (ABS(dev) >= thr_alert && m_bms_talerts[i] < 2)
+        devchanged = true;
+        }
+      if (ABS(dev) >= m_bms_thr_talert && m_bms_talerts[i] < 2)
         {
         m_bms_talerts[i] = 2;
         m_bms_talerts_new++; // trigger notification
+        alertchanged = true;
         }
-      else if (ABS(dev) >= thr_warn && m_bms_valerts[i] < 1)
+      else if (ABS(dev) >= m_bms_thr_twarn && m_bms_talerts[i] < 1)
+        {
         m_bms_talerts[i] = 1;
+        alertchanged = true;
+        }
       }
     // publish to metrics:
     avg = ROUNDPREC(avg, 2);
@@ -2554,19 +3827,19 @@ void OvmsVehicle::BmsSetCellTemperature(int index, float value)
     if (stddev > StandardMetrics.ms_v_bat_pack_tstddev_max->AsFloat())
       StandardMetrics.ms_v_bat_pack_tstddev_max->SetValue(stddev);
     StandardMetrics.ms_v_bat_cell_temp->SetElemValues(0, m_bms_readings_t, m_bms_temperatures);
-    StandardMetrics.ms_v_bat_cell_tmin->SetElemValues(0, m_bms_readings_t, m_bms_tmins);
-    StandardMetrics.ms_v_bat_cell_tmax->SetElemValues(0, m_bms_readings_t, m_bms_tmaxs);
-    StandardMetrics.ms_v_bat_cell_tdevmax->SetElemValues(0, m_bms_readings_t, m_bms_tdevmaxs);
-    StandardMetrics.ms_v_bat_cell_talert->SetElemValues(0, m_bms_readings_t, m_bms_talerts);
+    if (m_bms_tminmax_changed)
+      {
+      StandardMetrics.ms_v_bat_cell_tmin->SetElemValues(0, m_bms_readings_t, m_bms_tmins);
+      StandardMetrics.ms_v_bat_cell_tmax->SetElemValues(0, m_bms_readings_t, m_bms_tmaxs);
+      }
+    if (devchanged)
+      StandardMetrics.ms_v_bat_cell_tdevmax->SetElemValues(0, m_bms_readings_t, m_bms_tdevmaxs);
+    if (alertchanged)
+      StandardMetrics.ms_v_bat_cell_talert->SetElemValues(0, m_bms_readings_t, m_bms_talerts);
     // complete:
     m_bms_has_temperatures = true;
-    m_bms_bitset_t.clear();
-    m_bms_bitset_t.resize(m_bms_readings_t);
-    m_bms_bitset_ct = 0;
-    }
-  else
-    {
-    m_bms_bitset_t[index] = true;
+    m_bms_tminmax_changed = false;
+    BmsRestartCellTemperatures();
     }
   }
 
@@ -2575,22 +3848,26 @@ void OvmsVehicle::BmsRestartCellVoltages()
   m_bms_bitset_v.clear();
   m_bms_bitset_v.resize(m_bms_readings_v);
   m_bms_bitset_cv = 0;
+  m_bms_vsum = 0;
+  m_bms_vsqrsum = 0;
+  m_bms_vrescan = false;
   }
 
 void OvmsVehicle::BmsRestartCellTemperatures()
   {
   m_bms_bitset_t.clear();
-  m_bms_bitset_v.resize(m_bms_readings_t);
+  m_bms_bitset_t.resize(m_bms_readings_t);
   m_bms_bitset_ct = 0;
+  m_bms_tsum = 0;
+  m_bms_tsqrsum = 0;
+  m_bms_trescan = false;
   }
 
 void OvmsVehicle::BmsResetCellVoltages()
   {
   if (m_bms_readings_v > 0)
     {
-    m_bms_bitset_v.clear();
-    m_bms_bitset_v.resize(m_bms_readings_v);
-    m_bms_bitset_cv = 0;
+    BmsRestartCellVoltages();
     m_bms_has_voltages = false;
     for (int k=0; k<m_bms_readings_v; k++)
       {
@@ -2612,9 +3889,7 @@ void OvmsVehicle::BmsResetCellTemperatures()
   {
   if (m_bms_readings_t > 0)
     {
-    m_bms_bitset_t.clear();
-    m_bms_bitset_t.resize(m_bms_readings_t);
-    m_bms_bitset_ct = 0;
+    BmsRestartCellTemperatures();
     m_bms_has_temperatures = false;
     for (int k=0; k<m_bms_readings_t; k++)
       {
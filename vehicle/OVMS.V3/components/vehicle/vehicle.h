@@ -32,9 +32,12 @@
 #define __VEHICLE_H__
 
 #include <map>
+#include <list>
+#include <memory>
 #include <vector>
 #include <string>
 #include "can.h"
+#include "canisotp.h"
 #include "ovms_events.h"
 #include "ovms_config.h"
 #include "ovms_metrics.h"
@@ -57,9 +60,24 @@ struct DashboardConfig;
 #define VEHICLE_POLL_TYPE_OBDII_1A  			0x1A // Mode 1A
 #define VEHICLE_POLL_TYPE_OBDIIGROUP    0x21 // enhanced data by 8 bit PID
 #define VEHICLE_POLL_TYPE_OBDIIEXTENDED 0x22 // enhanced data by 16 bit PID
+#define VEHICLE_POLL_TYPE_SECURITYACCESS 0x27 // UDS: Security Access (PID = seed request level)
 
 #define VEHICLE_POLL_NSTATES            4
 
+// Poll times are given in seconds, or in milliseconds using this macro
+// (max 32767 ms), e.g. { 10, VEHICLE_POLL_MS(200), 0 }:
+#define VEHICLE_POLL_MS(ms)             (0x8000 | (ms))
+#define VEHICLE_POLL_TIMEOUT            1000 // Default response timeout [ms]
+#define VEHICLE_POLL_RETRIES            1    // Default retries on timeout
+#define VEHICLE_POLL_MAXBACKOFF         32   // Max interval multiplier for failing PIDs
+#define VEHICLE_POLL_RTT_BUCKETS        8    // RTT histogram: <10,20,50,100,200,500,1000,>=1000 ms
+#define VEHICLE_POLL_S3                 5000 // Default UDS session timeout (S3 server) [ms]
+#define VEHICLE_POLL_MAXMULTIPID        6    // Max PIDs per OBD mode 01 request
+#define VEHICLE_POLL_BROADCAST_GAP      50   // Min time between broadcast requests (OBD P2 max) [ms]
+
+#define VEHICLE_POLL_SIG_SIGNED         0x01 // Poll definition signal: signed value
+#define VEHICLE_POLL_SIG_LE             0x02 // … little endian (Intel) byte order
+
 
 // Standard MSG protocol commands:
 
@@ -98,6 +116,11 @@ struct DashboardConfig;
 #define BMS_DEFTHR_TWARN    2.00    // [°C]
 #define BMS_DEFTHR_TALERT   3.00    // [°C]
 
+// BMS history snapshot reasons:
+#define BMS_HISTORY_CHARGE  1       // charge stop
+#define BMS_HISTORY_DRIVE   2       // driving interval
+#define BMS_HISTORY_MANUAL  3       // user command
+
 
 class OvmsVehicle : public InternalRamAllocated
   {
@@ -114,6 +137,7 @@ class OvmsVehicle : public InternalRamAllocated
     bool m_registeredlistener;
     bool m_autonotifications;
     bool m_ready;
+    volatile bool m_replaying;                // CAN log replay running, RxTask discards bus frames
 
   public:
     canbus* m_can1;
@@ -133,6 +157,7 @@ class OvmsVehicle : public InternalRamAllocated
     virtual void IncomingFrameCan3(CAN_frame_t* p_frame);
     virtual void IncomingFrameCan4(CAN_frame_t* p_frame);
     virtual void IncomingPollReply(canbus* bus, uint16_t type, uint16_t pid, uint8_t* data, uint8_t length, uint16_t mlremain);
+    virtual bool PollSecurityKey(canbus* bus, uint32_t txid, uint8_t level, const std::string& seed, std::string& key);
 
   protected:
     int m_minsoc;            // The minimum SOC level before alert
@@ -282,13 +307,107 @@ class OvmsVehicle : public InternalRamAllocated
       uint16_t polltime[VEHICLE_POLL_NSTATES];
       } poll_pid_t;
 
+  protected:
+    typedef struct
+      {
+      canbus*         bus;                    // Key: bus, IDs, type & PID
+      uint32_t        txid;
+      uint32_t        rxid;
+      uint16_t        type;
+      uint16_t        pid;
+      uint32_t        requests;               // Requests sent
+      uint32_t        responses;              // Complete responses received
+      uint32_t        negative;               // … thereof negative responses
+      uint32_t        timeouts;               // No response within timeout
+      uint32_t        truncated;              // Incomplete multi frame responses
+      uint32_t        errors;                 // TX errors
+      uint32_t        bytes;                  // Response bytes received
+      uint32_t        frames;                 // CAN frames sent & received
+      uint32_t        rtt_min;                // Round trip time [us]
+      uint32_t        rtt_max;
+      uint64_t        rtt_sum;
+      uint32_t        rtt_hist[VEHICLE_POLL_RTT_BUCKETS];
+      OvmsMetricFloat* m_rtt;                 // Metrics (if enabled)
+      OvmsMetricFloat* m_success;
+      } poll_stats_t;
+
+    typedef struct
+      {
+      poll_pid_t      poll;                   // Poll definition
+      canbus*         bus;                    // Bus to poll on
+      int             ecu;                    // Index into m_poll_ecus
+      int64_t         due;                    // Next request due time [us]
+      uint8_t         retries;                // Retries done for current request
+      uint8_t         backoff;                // Interval multiplier after timeouts
+      int64_t         sent;                   // Time current request was sent [us]
+      poll_stats_t*   stats;                  // Statistics (in m_poll_stats)
+      int             def;                    // Poll definition index (-1 = vehicle list)
+      } poll_entry_t;
+
+    typedef struct
+      {
+      canbus*         bus;
+      const poll_pid_t* plist;
+      } poll_list_t;
+
+    typedef struct
+      {
+      OvmsMetric*     metric;                 // Metric to set
+      uint16_t        byte;                   // Offset into response data (following type & PID)
+      uint8_t         nbytes;                 // Bytes to read
+      uint8_t         shift;                  // Bit position of value LSB
+      uint32_t        mask;                   // Value mask (after shift)
+      uint8_t         flags;                  // VEHICLE_POLL_SIG_*
+      float           scale;
+      float           offset;
+      } poll_signal_t;
+
+    typedef struct
+      {
+      int             busno;                  // 1-4
+      poll_pid_t      poll;
+      uint16_t        signal;                 // First signal in signals
+      uint16_t        signals;                // Signal count
+      } poll_def_t;
+
+    typedef struct
+      {
+      std::string     path;                   // Source file
+      std::vector<poll_def_t> polls;
+      std::vector<poll_signal_t> signals;
+      } poll_defs_t;
+
+    typedef struct
+      {
+      canbus*         bus;                    // Bus the ECU is attached to
+      uint32_t        txid;                   // Request ID
+      uint32_t        rxid;                   // Response ID (0 = broadcast)
+      int             current;                // Entry currently polled (-1 = idle, -2 = TesterPresent)
+      int             last;                   // Entry last answered (-1 = none)
+      uint32_t        lasttime;               // Time [ms] of last response
+      int64_t         lastsent;               // Time [us] of last request
+      uint8_t         session;                // UDS session opened (0 = none)
+      uint8_t         security;               // Security access level unlocked (0 = none)
+      std::vector<int> entries;               // Poll entries for this ECU
+      std::vector<int> batch;                 // Entries added to the current request (multi PID)
+      int             unlock;                 // Security access entry waiting for the key (-1 = none)
+      std::string     seed;                   // Security access seed received
+      } poll_ecu_t;
+    typedef struct
+      {
+      std::string     data;                   // Response data received so far
+      uint16_t        length;                 // Response length (0 = idle)
+      uint8_t         sn;                     // Next consecutive frame sequence number
+      uint8_t         bs_count;               // Consecutive frames received in current block
+      uint32_t        time;                   // Time [ms] of last frame
+      } poll_bcrx_t;
+
   protected:
     OvmsMutex         m_poll_mutex;           // Concurrency protection
     uint8_t           m_poll_state;           // Current poll state
     canbus*           m_poll_bus;             // Bus to poll on
     const poll_pid_t* m_poll_plist;           // Head of poll list
-    const poll_pid_t* m_poll_plcur;           // Current position in poll list
-    uint32_t          m_poll_ticker;          // Polling ticker
+    std::vector<poll_list_t> m_poll_lists;    // All vehicle poll lists
     uint32_t          m_poll_moduleid_sent;   // ModuleID last sent
     uint32_t          m_poll_moduleid_low;    // Expected response moduleid low mark
     uint32_t          m_poll_moduleid_high;   // Expected response moduleid high mark
@@ -297,11 +416,83 @@ class OvmsVehicle : public InternalRamAllocated
     uint16_t          m_poll_ml_remain;       // Bytes remainign for ML poll
     uint16_t          m_poll_ml_offset;       // Offset of ML poll
     uint16_t          m_poll_ml_frame;        // Frame number for ML poll
-    uint16_t          m_poll_wait;            // Wait for remaining poll replays
+
+  private:
+    canisotp          m_poll_isotp;           // Transport engine for poll requests
+    std::vector<poll_entry_t> m_poll_entries; // Poll entries of all lists
+    std::vector<poll_ecu_t> m_poll_ecus;      // ECUs addressed by the poll entries
+    poll_bcrx_t       m_poll_bcrx[8];         // Additional multi frame broadcast responses (0x7e8-0x7ef)
+    uint32_t          m_poll_generation;      // Incremented on list/state changes
+    esp_timer_handle_t m_poll_timer;          // Scheduler timer
+    TaskHandle_t      m_poll_task;            // Sends the requests, woken by timer & responses
+    volatile bool     m_poll_task_stop;
+    const CAN_frame_t* m_poll_rxframe;        // Frame currently processed by RxTask
+    uint32_t          m_poll_timeout;         // Response timeout [ms]
+    uint8_t           m_poll_retries;         // Retries on timeout
+    uint32_t          m_poll_s3;              // UDS session timeout [ms]
+    uint8_t           m_poll_multipid;        // Max PIDs per mode 01 request
+    uint8_t           m_poll_fc_bs;           // Flow control block size (0 = unlimited)
+    uint8_t           m_poll_fc_stmin;        // Flow control separation time
+    std::list<poll_stats_t> m_poll_stats;     // Statistics of all PIDs polled
+    int64_t           m_poll_stats_start;     // Statistics start time [us]
+    bool              m_poll_stats_metrics;   // Publish statistics as metrics
+    std::shared_ptr<poll_defs_t> m_poll_defs; // Poll definitions loaded at runtime
 
   protected:
     void PollSetPidList(canbus* bus, const poll_pid_t* plist);
+    void PollAddPidList(canbus* bus, const poll_pid_t* plist);
     void PollSetState(uint8_t state);
+    void PollSetTimeout(uint32_t timeout_ms, uint8_t retries=VEHICLE_POLL_RETRIES);
+    void PollSetSessionTimeout(uint32_t s3_ms);
+    void PollSetMultiPid(uint8_t maxpids);
+    void PollSetFlowControl(uint8_t blocksize, uint8_t stmin);
+
+  public:
+    void PollStats(int verbosity, OvmsWriter* writer);
+    void PollResetStats();
+    bool PollLoadDefinitions(std::string path, std::string& error);
+    void PollListDefinitions(OvmsWriter* writer);
+
+  private:
+    void PollerAddEntries(canbus* bus, const poll_pid_t* plist);
+    void PollerAddEntry(canbus* bus, const poll_pid_t& poll, int def);
+    void PollerRebuild();
+    void PollerDecode(const poll_entry_t& entry, const std::string& response);
+    uint32_t PollerInterval(const poll_entry_t& entry);
+    int64_t PollerDue(int ecu, int& entry, int64_t now);
+    void PollerReschedule(poll_entry_t& entry, canisotp_status_t status, bool retry, int64_t now);
+    static int PollerObdPidLength(uint16_t pid);
+    static bool PollerObdPidBatchable(uint16_t pid);
+    static bool PollerSplitObd(const std::string& response, uint16_t pid, std::string& part);
+    void PollerSchedule();
+    static void PollerTimer(void* arg);
+    static void PollerTask(void* arg);
+    void PollerWake();
+    void PollerCount(poll_entry_t& entry, canisotp_status_t status, const std::string& response, int64_t now);
+    void PollerUpdateMetrics();
+    void PollerNext(int ecu);
+    void PollerResponse(uint32_t generation, int ecu, int entry, uint32_t rxid,
+      canisotp_status_t status, const std::string& response);
+    bool PollerUnlock(uint32_t generation, int ecu, const poll_entry_t& entry, const std::string& seed);
+    void PollerUnlocked(uint32_t generation, int ecu, uint8_t level,
+      canisotp_status_t status, const std::string& response);
+    void PollerDeliver(uint32_t generation, const poll_entry_t& entry, uint32_t rxid,
+      const std::string& response);
+
+  // CAN log replay (decoder benchmark)
+  private:
+    typedef struct
+      {
+      std::string     data;                   // Response data received
+      uint16_t        length;                 // Expected response length
+      uint8_t         seq;                    // Next consecutive frame sequence number
+      } replay_isotp_t;
+    typedef std::map<uint32_t, replay_isotp_t> replay_isotp_map_t;
+    void ReplayPollFrame(CAN_frame_t* frame, replay_isotp_map_t& buffers);
+
+  public:
+    bool ReplayLog(OvmsWriter* writer, const char* format, const std::string& path,
+      const std::string& golden, bool record);
 
   // BMS helpers
   protected:
@@ -335,6 +526,31 @@ class OvmsVehicle : public InternalRamAllocated
     float m_bms_defthr_valert;                // Default voltage deviation alert threshold [V]
     float m_bms_defthr_twarn;                 // Default temperature deviation warn threshold [°C]
     float m_bms_defthr_talert;                // Default temperature deviation alert threshold [°C]
+    float m_bms_thr_vwarn;                    // Voltage deviation warn threshold (config / default) [V]
+    float m_bms_thr_valert;                   // Voltage deviation alert threshold (config / default) [V]
+    float m_bms_thr_twarn;                    // Temperature deviation warn threshold (config / default) [°C]
+    float m_bms_thr_talert;                   // Temperature deviation alert threshold (config / default) [°C]
+    double m_bms_vsum;                        // BMS voltage sweep: sum of values set
+    double m_bms_vsqrsum;                     // BMS voltage sweep: sum of squared values set
+    float m_bms_vsweepmin;                    // BMS voltage sweep: minimum value set
+    float m_bms_vsweepmax;                    // BMS voltage sweep: maximum value set
+    bool m_bms_vrescan;                       // BMS voltage sweep: min/max need rescan (value replaced)
+    bool m_bms_vminmax_changed;               // BMS voltage cell mins/maxs changed since last publish
+    double m_bms_tsum;                        // BMS temperature sweep: sum of values set
+    double m_bms_tsqrsum;                     // BMS temperature sweep: sum of squared values set
+    float m_bms_tsweepmin;                    // BMS temperature sweep: minimum value set
+    float m_bms_tsweepmax;                    // BMS temperature sweep: maximum value set
+    bool m_bms_trescan;                       // BMS temperature sweep: min/max need rescan (value replaced)
+    bool m_bms_tminmax_changed;               // BMS temperature cell mins/maxs changed since last publish
+    OvmsMutex m_bms_hist_mutex;               // BMS history: file & state access
+    bool m_bms_hist_enable;                   // BMS history: automatic snapshots enabled
+    std::string m_bms_hist_path;              // BMS history: directory
+    int m_bms_hist_interval;                  // BMS history: snapshot interval while driving [min], 0 = off
+    int m_bms_hist_pending;                   // BMS history: deferred snapshot reason, 0 = none
+    std::string m_bms_hist_day;               // BMS history: day of last record written (YYYYMMDD)
+    int m_bms_hist_records;                   // BMS history: records written since last keyframe
+    std::vector<int> m_bms_hist_v;            // BMS history: last voltages written [mV]
+    std::vector<int> m_bms_hist_t;            // BMS history: last temperatures written [0.1 °C]
 
   protected:
     void BmsSetCellArrangementVoltage(int readings, int readingspermodule);
@@ -349,6 +565,7 @@ class OvmsVehicle : public InternalRamAllocated
     void BmsResetCellTemperatures();
     void BmsRestartCellVoltages();
     void BmsRestartCellTemperatures();
+    void BmsUpdateThresholds();
     virtual void NotifyBmsAlerts();
 
   public:
@@ -357,6 +574,8 @@ class OvmsVehicle : public InternalRamAllocated
     void BmsGetCellDefaultThresholdsVoltage(float* warn, float* alert);
     void BmsGetCellDefaultThresholdsTemperature(float* warn, float* alert);
     void BmsResetCellStats();
+    bool BmsHistoryRecord(int reason, std::string& error);
+    void BmsHistoryQuery(OvmsWriter* writer, bool temps, int days, int cell=0);
     virtual void BmsStatus(int verbosity, OvmsWriter* writer);
     virtual bool FormatBmsAlerts(int verbosity, OvmsWriter* writer, bool show_warnings);
   };
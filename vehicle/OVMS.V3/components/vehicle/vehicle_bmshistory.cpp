@@ -0,0 +1,444 @@
+/*
+;    Project:       Open Vehicle Monitor System
+;    Module:        Vehicle BMS cell history
+;    Date:          19th October 2026
+;
+;    (C) 2026       Open Vehicles Project
+;
+; Permission is hereby granted, free of charge, to any person obtaining a copy
+; of this software and associated documentation files (the "Software"), to deal
+; in the Software without restriction, including without limitation the rights
+; to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+; copies of the Software, and to permit persons to whom the Software is
+; furnished to do so, subject to the following conditions:
+;
+; The above copyright notice and this permission notice shall be included in
+; all copies or substantial portions of the Software.
+;
+; THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+; IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+; FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+; AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+; LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+; OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+; THE SOFTWARE.
+*/
+
+#include "ovms_log.h"
+static const char *TAG = "vehicle";
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "ovms_config.h"
+#include "ovms_peripherals.h"
+#include "ovms_utils.h"
+#include "vehicle.h"
+
+/**
+ * BMS cell history file format
+ *
+ * One file per day (local time) named <path>/YYYYMMDD.bmh, each file being
+ * a sequence of records:
+ *
+ *  <sync> <flags> <length> <payload> <crc>
+ *    sync:     0xB5
+ *    flags:    bit 7 = keyframe, bits 0-3 = reason (BMS_HISTORY_*)
+ *    length:   payload length (varint)
+ *    payload:  <time> <nv> <nt> <nv voltages> <nt temperatures>
+ *      time:   UTC seconds, uint32 little endian
+ *      nv, nt: cell voltage & temperature count (varint)
+ *      values: zigzag varints, voltages in mV, temperatures in 0.1 °C,
+ *              absolute on keyframes, else delta to the previous record
+ *    crc:      CRC-8 (polynomial 0x07) of the payload
+ *
+ * Keyframes are written on the first record of a file / after a restart,
+ * on a cell count change and every BMS_HISTORY_KEYINTERVAL records, so a
+ * damaged record (e.g. power loss during write) only affects the records up
+ * to the next keyframe. Readers resync on the sync byte.
+ *
+ * A 96 cell / 32 sensor snapshot needs ~260 bytes as a keyframe and ~140
+ * bytes as a delta record, so a day of driving with 10 minute snapshots
+ * typically results in a few kB.
+ */
+
+#define BMS_HISTORY_SYNC          0xB5
+#define BMS_HISTORY_KEYFRAME      0x80
+#define BMS_HISTORY_REASONMASK    0x0f
+#define BMS_HISTORY_KEYINTERVAL   32
+#define BMS_HISTORY_MAXRECORD     2048
+#define BMS_HISTORY_MINTIME       1577836800      // 2020-01-01: system time valid
+
+static void BmsHistoryPutVarint(std::string& buf, uint32_t value)
+  {
+  while (value >= 0x80)
+    {
+    buf.push_back((char)(value | 0x80));
+    value >>= 7;
+    }
+  buf.push_back((char)value);
+  }
+
+static void BmsHistoryPutZigzag(std::string& buf, int32_t value)
+  {
+  BmsHistoryPutVarint(buf, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+  }
+
+static bool BmsHistoryGetVarint(const uint8_t*& pos, const uint8_t* end, uint32_t& value)
+  {
+  value = 0;
+  for (int shift = 0; shift < 35 && pos < end; shift += 7)
+    {
+    uint8_t byte = *pos++;
+    value |= (uint32_t)(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0)
+      return true;
+    }
+  return false;
+  }
+
+static bool BmsHistoryGetZigzag(const uint8_t*& pos, const uint8_t* end, int32_t& value)
+  {
+  uint32_t raw;
+  if (!BmsHistoryGetVarint(pos, end, raw))
+    return false;
+  value = (int32_t)(raw >> 1) ^ -(int32_t)(raw & 1);
+  return true;
+  }
+
+static uint8_t BmsHistoryCrc(const uint8_t* data, size_t len)
+  {
+  uint8_t crc = 0;
+  while (len--)
+    {
+    crc ^= *data++;
+    for (int bit = 0; bit < 8; bit++)
+      crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : (crc << 1);
+    }
+  return crc;
+  }
+
+static std::string BmsHistoryDay(time_t time)
+  {
+  struct tm tm;
+  char day[12];
+  localtime_r(&time, &tm);
+  strftime(day, sizeof(day), "%Y%m%d", &tm);
+  return day;
+  }
+
+static const char* BmsHistoryReasonName(int reason)
+  {
+  switch (reason)
+    {
+    case BMS_HISTORY_CHARGE:  return "charge";
+    case BMS_HISTORY_DRIVE:   return "drive";
+    case BMS_HISTORY_MANUAL:  return "manual";
+    default:                  return "unknown";
+    }
+  }
+
+/**
+ * BmsHistoryRecord: append a snapshot of the current cell values to the history
+ */
+bool OvmsVehicle::BmsHistoryRecord(int reason, std::string& error)
+  {
+  if (!m_bms_has_voltages || m_bms_readings_v == 0)
+    {
+    error = "No complete set of cell voltages";
+    return false;
+    }
+  time_t now = time(NULL);
+  if (now < BMS_HISTORY_MINTIME)
+    {
+    error = "System time not set";
+    return false;
+    }
+
+  OvmsMutexLock lock(&m_bms_hist_mutex);
+
+#ifdef CONFIG_OVMS_COMP_SDCARD
+  if (startsWith(m_bms_hist_path, "/sd") && (!MyPeripherals || !MyPeripherals->m_sdcard || !MyPeripherals->m_sdcard->isavailable()))
+    {
+    error = "SD filesystem not available";
+    return false;
+    }
+#endif // #ifdef CONFIG_OVMS_COMP_SDCARD
+
+  // Quantize:
+  int nv = m_bms_readings_v;
+  int nt = m_bms_has_temperatures ? m_bms_readings_t : 0;
+  std::vector<int> volts(nv), temps(nt);
+  for (int i = 0; i < nv; i++)
+    volts[i] = lroundf(m_bms_voltages[i] * 1000);
+  for (int i = 0; i < nt; i++)
+    temps[i] = lroundf(m_bms_temperatures[i] * 10);
+
+  std::string day = BmsHistoryDay(now);
+  bool keyframe = (day != m_bms_hist_day
+    || volts.size() != m_bms_hist_v.size()
+    || temps.size() != m_bms_hist_t.size()
+    || m_bms_hist_records >= BMS_HISTORY_KEYINTERVAL);
+
+  std::string payload;
+  payload.reserve(8 + 2 * (nv + nt));
+  uint32_t utime = now;
+  for (int i = 0; i < 4; i++)
+    payload.push_back((char)(utime >> (8*i)));
+  BmsHistoryPutVarint(payload, nv);
+  BmsHistoryPutVarint(payload, nt);
+  for (int i = 0; i < nv; i++)
+    BmsHistoryPutZigzag(payload, keyframe ? volts[i] : volts[i] - m_bms_hist_v[i]);
+  for (int i = 0; i < nt; i++)
+    BmsHistoryPutZigzag(payload, keyframe ? temps[i] : temps[i] - m_bms_hist_t[i]);
+
+  std::string record;
+  record.reserve(payload.size() + 6);
+  record.push_back((char)BMS_HISTORY_SYNC);
+  record.push_back((char)((keyframe ? BMS_HISTORY_KEYFRAME : 0) | (reason & BMS_HISTORY_REASONMASK)));
+  BmsHistoryPutVarint(record, payload.size());
+  record.append(payload);
+  record.push_back((char)BmsHistoryCrc((const uint8_t*)payload.data(), payload.size()));
+
+  std::string filename = m_bms_hist_path + "/" + day + ".bmh";
+  if (!path_exists(m_bms_hist_path))
+    mkpath(m_bms_hist_path);
+  FILE* f = fopen(filename.c_str(), "a");
+  if (!f)
+    {
+    error = "Cannot write to " + filename;
+    return false;
+    }
+  bool ok = (fwrite(record.data(), record.size(), 1, f) == 1);
+  if (fclose(f) != 0)
+    ok = false;
+  if (!ok)
+    {
+    // force a keyframe on the next record, the file tail may be damaged:
+    m_bms_hist_day.clear();
+    error = "Write error on " + filename;
+    return false;
+    }
+
+  m_bms_hist_day = day;
+  m_bms_hist_records = keyframe ? 1 : m_bms_hist_records + 1;
+  m_bms_hist_v.swap(volts);
+  m_bms_hist_t.swap(temps);
+  ESP_LOGD(TAG, "BMS history: %s record (%s, %d bytes) written to %s",
+    keyframe ? "key" : "delta", BmsHistoryReasonName(reason), (int)record.size(), filename.c_str());
+  return true;
+  }
+
+/**
+ * bms_history_reader: streaming history file decoder
+ *  Reads one record at a time, the decoded values are kept as the delta base.
+ */
+class bms_history_reader
+  {
+  public:
+    bms_history_reader(FILE* file)
+      {
+      m_file = file;
+      m_valid = false;
+      m_time = 0;
+      m_reason = 0;
+      }
+
+  public:
+    // Read: returns 1 = record decoded, 0 = record skipped, -1 = end of file
+    int Read()
+      {
+      int c;
+      while ((c = getc(m_file)) != EOF && c != BMS_HISTORY_SYNC)
+        m_valid = false;
+      if (c == EOF)
+        return -1;
+      int flags = getc(m_file);
+      uint32_t len = 0;
+      for (int shift = 0; shift < 21; shift += 7)
+        {
+        if ((c = getc(m_file)) == EOF)
+          return -1;
+        len |= (uint32_t)(c & 0x7f) << shift;
+        if ((c & 0x80) == 0)
+          break;
+        }
+      if (flags == EOF || (c & 0x80) || len < 6 || len > BMS_HISTORY_MAXRECORD)
+        {
+        m_valid = false;
+        return 0;
+        }
+      m_buf.resize(len + 1);
+      if (fread(&m_buf[0], len + 1, 1, m_file) != 1)
+        return -1;
+      if (BmsHistoryCrc((const uint8_t*)m_buf.data(), len) != (uint8_t)m_buf[len])
+        {
+        // damaged: rewind to the payload start to resync on the next sync byte
+        fseek(m_file, -(long)(len + 1), SEEK_CUR);
+        m_valid = false;
+        return 0;
+        }
+
+      const uint8_t* pos = (const uint8_t*)m_buf.data();
+      const uint8_t* end = pos + len;
+      bool keyframe = (flags & BMS_HISTORY_KEYFRAME);
+      uint32_t nv, nt;
+      m_time = pos[0] | (pos[1] << 8) | (pos[2] << 16) | ((uint32_t)pos[3] << 24);
+      pos += 4;
+      if (!BmsHistoryGetVarint(pos, end, nv) || !BmsHistoryGetVarint(pos, end, nt) || nv + nt > len)
+        {
+        m_valid = false;
+        return 0;
+        }
+      if (!keyframe && (!m_valid || nv != m_volts.size() || nt != m_temps.size()))
+        {
+        m_valid = false;
+        return 0;
+        }
+      m_volts.resize(nv);
+      m_temps.resize(nt);
+      int32_t value;
+      for (uint32_t i = 0; i < nv + nt; i++)
+        {
+        if (!BmsHistoryGetZigzag(pos, end, value))
+          {
+          m_valid = false;
+          return 0;
+          }
+        int& dst = (i < nv) ? m_volts[i] : m_temps[i-nv];
+        dst = keyframe ? value : dst + value;
+        }
+      m_reason = flags & BMS_HISTORY_REASONMASK;
+      m_valid = true;
+      return 1;
+      }
+
+  public:
+    time_t            m_time;
+    int               m_reason;
+    std::vector<int>  m_volts;        // [mV]
+    std::vector<int>  m_temps;        // [0.1 °C]
+
+  protected:
+    FILE*             m_file;
+    bool              m_valid;
+    std::string       m_buf;
+  };
+
+/**
+ * BmsHistoryQuery: output history of cell voltages or temperatures
+ *  cell = 0: daily average deviation of each cell from the pack average,
+ *    CSV columns: date, records, cell 1 … cell n
+ *  cell > 0: all snapshots of that cell,
+ *    CSV columns: time, reason, value, deviation from pack average
+ *  Voltages are output in V, voltage deviations in mV, temperatures in °C.
+ *  Files are decoded record by record, so RAM usage is independent of the
+ *  period queried.
+ */
+void OvmsVehicle::BmsHistoryQuery(OvmsWriter* writer, bool temps, int days, int cell)
+  {
+  m_bms_hist_mutex.Lock();
+  std::string path = m_bms_hist_path;
+  m_bms_hist_mutex.Unlock();
+
+  time_t now = time(NULL);
+  if (now < BMS_HISTORY_MINTIME)
+    {
+    writer->puts("ERROR: system time not set");
+    return;
+    }
+
+  if (cell > 0)
+    writer->puts(temps ? "time,reason,temp,deviation" : "time,reason,voltage,deviation");
+  bool header = (cell > 0);
+  int files = 0;
+
+  std::vector<int64_t> sums;
+  for (int d = days-1; d >= 0; d--)
+    {
+    struct tm tm;
+    localtime_r(&now, &tm);
+    tm.tm_mday -= d;
+    tm.tm_hour = 12;
+    tm.tm_min = tm.tm_sec = 0;
+    tm.tm_isdst = -1;
+    std::string day = BmsHistoryDay(mktime(&tm));
+    std::string filename = path + "/" + day + ".bmh";
+
+    m_bms_hist_mutex.Lock();
+    FILE* f = fopen(filename.c_str(), "r");
+    m_bms_hist_mutex.Unlock();
+    if (!f)
+      continue;
+    files++;
+
+    bms_history_reader reader(f);
+    int records = 0, result;
+    sums.clear();
+    while ((result = reader.Read()) >= 0)
+      {
+      if (result == 0)
+        continue;
+      const std::vector<int>& values = temps ? reader.m_temps : reader.m_volts;
+      int n = values.size();
+      if (n == 0)
+        continue;
+      int64_t sum = 0;
+      for (int v : values)
+        sum += v;
+
+      if (cell > 0)
+        {
+        if (cell > n)
+          continue;
+        // deviation from the average, in value units * n:
+        int64_t dev = (int64_t)values[cell-1] * n - sum;
+        char timestr[24];
+        struct tm rtm;
+        localtime_r(&reader.m_time, &rtm);
+        strftime(timestr, sizeof(timestr), "%Y-%m-%d %H:%M:%S", &rtm);
+        if (temps)
+          writer->printf("%s,%s,%.1f,%.2f\n", timestr, BmsHistoryReasonName(reader.m_reason),
+            values[cell-1] / 10.0, (double)dev / n / 10.0);
+        else
+          writer->printf("%s,%s,%.3f,%.1f\n", timestr, BmsHistoryReasonName(reader.m_reason),
+            values[cell-1] / 1000.0, (double)dev / n);
+        }
+      else
+        {
+        if ((int)sums.size() != n)
+          {
+          // cell count changed (or first record): restart the day
+          sums.assign(n, 0);
+          records = 0;
+          }
+        for (int i = 0; i < n; i++)
+          sums[i] += (int64_t)values[i] * n - sum;
+        records++;
+        }
+      }
+    fclose(f);
+
+    if (cell == 0 && records > 0)
+      {
+      int n = sums.size();
+      if (!header)
+        {
+        writer->printf("date,records");
+        for (int i = 1; i <= n; i++)
+          writer->printf(",%d", i);
+        writer->puts("");
+        header = true;
+        }
+      writer->printf("%.4s-%.2s-%.2s,%d", day.c_str(), day.c_str()+4, day.c_str()+6, records);
+      double div = (double)n * records * (temps ? 10.0 : 1.0);
+      for (int i = 0; i < n; i++)
+        writer->printf(temps ? ",%.2f" : ",%.1f", sums[i] / div);
+      writer->puts("");
+      }
+    }
+
+  if (files == 0)
+    writer->printf("No BMS history found in %s\n", path.c_str());
+  }
@@ -0,0 +1,306 @@
+/*
+;    Project:       Open Vehicle Monitor System
+;    Module:        Vehicle poll definitions loaded at runtime
+;    Date:          19th October 2026
+;
+;    (C) 2026       Open Vehicles Project
+;
+; Permission is hereby granted, free of charge, to any person obtaining a copy
+; of this software and associated documentation files (the "Software"), to deal
+; in the Software without restriction, including without limitation the rights
+; to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+; copies of the Software, and to permit persons to whom the Software is
+; furnished to do so, subject to the following conditions:
+;
+; The above copyright notice and this permission notice shall be included in
+; all copies or substantial portions of the Software.
+;
+; THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+; IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+; FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+; AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+; LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+; OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+; THE SOFTWARE.
+*/
+
+#include "ovms_log.h"
+static const char *TAG = "vehicle";
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "vehicle.h"
+
+/**
+ * Poll definition file format (one statement per line, '#' starts a comment):
+ *
+ *  POLL <bus> <txid> <rxid> <type> <pid> <time0> [<time1> [<time2> [<time3>]]]
+ *    bus:    1-4
+ *    txid, rxid, type, pid: hex, rxid 0 = broadcast (0x7df)
+ *    time:   poll time per state in seconds, or in milliseconds with suffix
+ *            "ms" (e.g. 200ms), 0 = off
+ *
+ *  SIG <byte>[.<bit>] <bits> <format> <scale> <offset> <metric>
+ *    Signal of the preceding POLL, value = raw * scale + offset
+ *    byte:   offset into the response data following type & PID
+ *    bit:    position of the value LSB (default 0)
+ *    bits:   1-32
+ *    format: u = unsigned, s = signed, append 'l' for little endian (Intel)
+ *            byte order (default big endian)
+ *    metric: metric name, created as a float metric if not existing
+ *
+ * Example (OBD mode 01 coolant temperature & RPM, 1 second / 500 ms):
+ *
+ *  POLL 1 7df 0 01 05 1 1 1
+ *  SIG 0 8 u 1 -40 v.m.temp
+ *  POLL 1 7df 0 01 0c 500ms 500ms 500ms
+ *  SIG 0 16 u 0.25 0 xpd.rpm
+ *
+ * Definitions are translated into a compact table with precomputed byte
+ * offsets, shifts and masks, so decoding takes a few integer operations
+ * per signal.
+ */
+
+static bool PollDefParseTime(const char* token, uint16_t& polltime)
+  {
+  char* end;
+  unsigned long value = strtoul(token, &end, 10);
+  if (end == token)
+    return false;
+  if (strcmp(end, "ms") == 0)
+    {
+    if (value > 0x7fff) return false;
+    polltime = (value > 0) ? VEHICLE_POLL_MS(value) : 0;
+    }
+  else if (*end == 0)
+    {
+    if (value > 0x7fff) return false;
+    polltime = value;
+    }
+  else
+    return false;
+  return true;
+  }
+
+static bool PollDefParseHex(const char* token, uint32_t& value)
+  {
+  char* end;
+  value = strtoul(token, &end, 16);
+  return (end != token && *end == 0);
+  }
+
+/**
+ * PollLoadDefinitions: load poll definitions from a file
+ *  The definitions are polled in addition to the vehicle poll lists, using
+ *  the poll state set by the vehicle. Responses are decoded into metrics
+ *  directly, they are not passed to IncomingPollReply().
+ *  An empty path removes all definitions.
+ */
+bool OvmsVehicle::PollLoadDefinitions(std::string path, std::string& error)
+  {
+  std::shared_ptr<poll_defs_t> defs;
+
+  if (!path.empty())
+    {
+    FILE* f = fopen(path.c_str(), "r");
+    if (!f)
+      {
+      error = "Cannot open " + path;
+      return false;
+      }
+    defs = std::make_shared<poll_defs_t>();
+    defs->path = path;
+
+    char line[256];
+    int lineno = 0;
+    char* argv[12];
+    while (error.empty() && fgets(line, sizeof(line), f))
+      {
+      lineno++;
+      char* hash = strchr(line, '#');
+      if (hash) *hash = 0;
+      int argc = 0;
+      char* save;
+      for (char* tok = strtok_r(line, " \t\r\n", &save); tok && argc < 12; tok = strtok_r(NULL, " \t\r\n", &save))
+        argv[argc++] = tok;
+      if (argc == 0)
+        continue;
+
+      if (strcasecmp(argv[0], "POLL") == 0 && argc >= 7 && argc <= 10)
+        {
+        poll_def_t def;
+        memset(&def, 0, sizeof(def));
+        uint32_t type, pid;
+        def.busno = atoi(argv[1]);
+        if (def.busno < 1 || def.busno > 4 ||
+            !PollDefParseHex(argv[2], def.poll.txmoduleid) || def.poll.txmoduleid == 0 ||
+            !PollDefParseHex(argv[3], def.poll.rxmoduleid) ||
+            !PollDefParseHex(argv[4], type) || type > 0xff ||
+            !PollDefParseHex(argv[5], pid) || pid > 0xffff)
+          {
+          error = "invalid POLL";
+          break;
+          }
+        def.poll.type = type;
+        def.poll.pid = pid;
+        for (int i = 6; i < argc; i++)
+          {
+          if (!PollDefParseTime(argv[i], def.poll.polltime[i-6]))
+            {
+            error = "invalid poll time";
+            break;
+            }
+          }
+        def.signal = defs->signals.size();
+        def.signals = 0;
+        defs->polls.push_back(def);
+        }
+      else if (strcasecmp(argv[0], "SIG") == 0 && argc == 7)
+        {
+        if (defs->polls.empty())
+          {
+          error = "SIG without POLL";
+          break;
+          }
+        poll_signal_t sig;
+        memset(&sig, 0, sizeof(sig));
+        char* end;
+        unsigned long byte = strtoul(argv[1], &end, 10);
+        unsigned long bit = 0;
+        if (*end == '.')
+          bit = strtoul(end+1, &end, 10);
+        unsigned long bits = strtoul(argv[2], NULL, 10);
+        const char* format = argv[3];
+        if (*end != 0 || byte > 4095 || bit > 7 || bits < 1 || bits > 32 ||
+            (format[0] != 'u' && format[0] != 's') ||
+            (format[1] != 0 && (format[1] != 'l' || format[2] != 0)))
+          {
+          error = "invalid SIG";
+          break;
+          }
+        sig.byte = byte;
+        sig.shift = bit;
+        sig.nbytes = (bit + bits + 7) / 8;
+        sig.mask = (bits == 32) ? 0xffffffff : ((1ul << bits) - 1);
+        if (format[0] == 's') sig.flags |= VEHICLE_POLL_SIG_SIGNED;
+        if (format[1] == 'l') sig.flags |= VEHICLE_POLL_SIG_LE;
+        sig.scale = atof(argv[4]);
+        sig.offset = atof(argv[5]);
+        sig.metric = MyMetrics.Find(argv[6]);
+        if (!sig.metric)
+          sig.metric = MyMetrics.InitFloat(strdup(argv[6]));
+        defs->signals.push_back(sig);
+        defs->polls.back().signals++;
+        }
+      else
+        {
+        error = "syntax error";
+        }
+      }
+    fclose(f);
+
+    if (!error.empty())
+      {
+      char pos[32];
+      snprintf(pos, sizeof(pos), " in line %d", lineno);
+      error = path + ": " + error + pos;
+      return false;
+      }
+    }
+
+  m_poll_mutex.Lock();
+  m_poll_defs = defs;
+  PollerRebuild();
+  m_poll_mutex.Unlock();
+  m_poll_isotp.CancelAll();
+  PollerSchedule();
+
+  if (defs)
+    ESP_LOGI(TAG, "Poll definitions loaded from %s: %d polls, %d signals",
+      path.c_str(), (int)defs->polls.size(), (int)defs->signals.size());
+  return true;
+  }
+
+void OvmsVehicle::PollListDefinitions(OvmsWriter* writer)
+  {
+  m_poll_mutex.Lock();
+  std::shared_ptr<poll_defs_t> defs = m_poll_defs;
+  m_poll_mutex.Unlock();
+
+  if (!defs)
+    {
+    writer->puts("No poll definitions loaded");
+    return;
+    }
+
+  writer->printf("Poll definitions from %s:\n", defs->path.c_str());
+  for (const poll_def_t& def : defs->polls)
+    {
+    writer->printf("POLL can%d %x %x %02x %x", def.busno, def.poll.txmoduleid, def.poll.rxmoduleid,
+      def.poll.type, def.poll.pid);
+    for (int i = 0; i < VEHICLE_POLL_NSTATES; i++)
+      {
+      uint16_t polltime = def.poll.polltime[i];
+      if (polltime & 0x8000)
+        writer->printf(" %ums", polltime & 0x7fff);
+      else
+        writer->printf(" %u", polltime);
+      }
+    writer->puts("");
+    for (int i = def.signal; i < def.signal + def.signals; i++)
+      {
+      const poll_signal_t& sig = defs->signals[i];
+      writer->printf("  SIG %u.%u %u %c%s %g %g %s\n", sig.byte, sig.shift,
+        32 - __builtin_clz(sig.mask), (sig.flags & VEHICLE_POLL_SIG_SIGNED) ? 's' : 'u',
+        (sig.flags & VEHICLE_POLL_SIG_LE) ? "l" : "", sig.scale, sig.offset, sig.metric->m_name);
+      }
+    }
+  }
+
+/**
+ * PollerDecode: decode poll definition signals from a response
+ */
+void OvmsVehicle::PollerDecode(const poll_entry_t& entry, const std::string& response)
+  {
+  m_poll_mutex.Lock();
+  std::shared_ptr<poll_defs_t> defs = m_poll_defs;
+  m_poll_mutex.Unlock();
+  if (!defs || entry.def >= (int)defs->polls.size())
+    return;
+  const poll_def_t& def = defs->polls[entry.def];
+  if (def.poll.type != entry.poll.type || def.poll.pid != entry.poll.pid)
+    return;
+
+  size_t hdr = (entry.poll.type == VEHICLE_POLL_TYPE_OBDIIEXTENDED) ? 3 : 2;
+  if (response.size() < hdr)
+    return;
+  const uint8_t* data = (const uint8_t*)response.data() + hdr;
+  size_t len = response.size() - hdr;
+
+  for (int i = def.signal; i < def.signal + def.signals; i++)
+    {
+    const poll_signal_t& sig = defs->signals[i];
+    if (sig.byte + sig.nbytes > len)
+      continue;
+    uint64_t raw = 0;
+    if (sig.flags & VEHICLE_POLL_SIG_LE)
+      {
+      for (int k = sig.nbytes-1; k >= 0; k--)
+        raw = (raw << 8) | data[sig.byte+k];
+      }
+    else
+      {
+      for (int k = 0; k < sig.nbytes; k++)
+        raw = (raw << 8) | data[sig.byte+k];
+      }
+    uint32_t value = (raw >> sig.shift) & sig.mask;
+    double result;
+    if ((sig.flags & VEHICLE_POLL_SIG_SIGNED) && (value & ~(sig.mask >> 1)))
+      result = (int32_t)(value | ~sig.mask);
+    else
+      result = value;
+    dbcNumber number(result * sig.scale + sig.offset);
+    sig.metric->SetValue(number);
+    }
+  }
@@ -0,0 +1,448 @@
+/*
+;    Project:       Open Vehicle Monitor System
+;    Module:        Vehicle CAN log replay & decoder benchmark
+;    Date:          19th October 2026
+;
+;    (C) 2026       Open Vehicles Project
+;
+; Permission is hereby granted, free of charge, to any person obtaining a copy
+; of this software and associated documentation files (the "Software"), to deal
+; in the Software without restriction, including without limitation the rights
+; to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+; copies of the Software, and to permit persons to whom the Software is
+; furnished to do so, subject to the following conditions:
+;
+; The above copyright notice and this permission notice shall be included in
+; all copies or substantial portions of the Software.
+;
+; THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+; IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+; FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+; AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+; LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+; OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+; THE SOFTWARE.
+*/
+
+#include "ovms_log.h"
+static const char *TAG = "vehicle";
+// Metrics listener caller: needs to differ from TAG, which the vehicle module
+// uses for its own listener (callers are matched by pointer)
+static const char *REPLAY_CALLER = "vehicle-replay";
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <map>
+#include <algorithm>
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "ovms_config.h"
+#include "canformat.h"
+#include "vehicle.h"
+
+/**
+ * CAN log replay: feed a CAN log file through the vehicle decoders as fast
+ * as possible, to measure & verify decoder changes without a car.
+ *
+ *  vehicle replay run <format> <path> [<golden>]
+ *  vehicle replay record <format> <path> <golden>
+ *
+ * RX frames of the log are passed to IncomingFrameCanN() of the bus they
+ * were logged on. Responses to PIDs of the poll lists / definitions are
+ * reassembled from the log (ISO-TP single, first & consecutive frames) and
+ * passed to IncomingPollReply() like the poller does. Live bus frames are
+ * discarded by the vehicle task while replaying.
+ *
+ * Statistics: frames per second, per frame decode time percentiles, metric
+ * updates per frame (done by the replaying task) and the net heap change.
+ *
+ * Golden file: the values of all metrics updated by the replay, one line
+ * per metric: <name> <value>. "record" writes the file, "run" compares the
+ * resulting metric state against it.
+ */
+
+#define REPLAY_READSIZE       512         // File read chunk size
+#define REPLAY_HISTSIZE       1024        // Decode time histogram [us], last = overflow
+#define REPLAY_METRICSIZE     1024        // Max metrics tracked (power of 2)
+#define REPLAY_MAXDIFFS       20          // Max golden differences shown
+
+typedef struct
+  {
+  TaskHandle_t        task;               // Replaying task
+  uint32_t            updates;            // Metric updates
+  uint32_t            metrics;            // Metrics tracked
+  OvmsMetric**        table;              // Open addressed pointer set
+  } replay_metrics_t;
+
+static replay_metrics_t* replay_metrics = NULL;
+
+static void replay_metric_modified(OvmsMetric* metric)
+  {
+  replay_metrics_t* rm = replay_metrics;
+  if (rm == NULL || xTaskGetCurrentTaskHandle() != rm->task)
+    return;
+  rm->updates++;
+  uint32_t i = ((uint32_t)(uintptr_t)metric * 0x9E3779B1) >> 22;
+  while (rm->table[i] != NULL && rm->table[i] != metric)
+    i = (i + 1) & (REPLAY_METRICSIZE-1);
+  if (rm->table[i] == NULL && rm->metrics < REPLAY_METRICSIZE-1)
+    {
+    rm->table[i] = metric;
+    rm->metrics++;
+    }
+  }
+
+static uint32_t replay_percentile(const uint32_t* hist, uint32_t count, int percent)
+  {
+  uint32_t limit = (uint64_t)count * percent / 100, sum = 0;
+  for (int i = 0; i < REPLAY_HISTSIZE; i++)
+    {
+    sum += hist[i];
+    if (sum > limit)
+      return i;
+    }
+  return REPLAY_HISTSIZE-1;
+  }
+
+/**
+ * ReplayPollFrame: reassemble & deliver poll responses from the log
+ */
+void OvmsVehicle::ReplayPollFrame(CAN_frame_t* frame, replay_isotp_map_t& buffers)
+  {
+  // Find poll entries for the sender:
+  uint32_t rxid = frame->MsgID;
+  bool known = false;
+  m_poll_mutex.Lock();
+  for (const poll_entry_t& entry : m_poll_entries)
+    {
+    if (entry.bus == frame->origin &&
+        (entry.poll.rxmoduleid == rxid ||
+         (entry.poll.rxmoduleid == 0 && rxid >= 0x7e8 && rxid <= 0x7ef)))
+      {
+      known = true;
+      break;
+      }
+    }
+  m_poll_mutex.Unlock();
+  if (!known)
+    return;
+
+  // ISO-TP reassembly:
+  const uint8_t* d = frame->data.u8;
+  uint8_t dlc = frame->FIR.B.DLC;
+  replay_isotp_t& buf = buffers[rxid];
+  switch (d[0] >> 4)
+    {
+    case 0:   // Single frame
+      if ((d[0] & 0x0f) == 0 || (d[0] & 0x0f) > dlc-1)
+        return;
+      buf.data.assign((const char*)d+1, d[0] & 0x0f);
+      buf.length = buf.data.size();
+      break;
+    case 1:   // First frame
+      if (dlc < 8)
+        return;
+      buf.length = ((d[0] & 0x0f) << 8) | d[1];
+      buf.data.assign((const char*)d+2, 6);
+      buf.seq = 1;
+      return;
+    case 2:   // Consecutive frame
+      if (buf.data.empty() || buf.data.size() >= buf.length || (d[0] & 0x0f) != buf.seq)
+        {
+        buf.data.clear();
+        return;
+        }
+      buf.data.append((const char*)d+1, std::min((size_t)dlc-1, (size_t)(buf.length - buf.data.size())));
+      buf.seq = (buf.seq + 1) & 0x0f;
+      if (buf.data.size() < buf.length)
+        return;
+      break;
+    default:  // Flow control
+      return;
+    }
+
+  // Response complete, deliver to the matching entry:
+  std::string response;
+  response.swap(buf.data);
+  const uint8_t* r = (const uint8_t*)response.data();
+  if (response.size() < 2 || r[0] < 0x40 || r[0] == 0x7f)
+    return;
+  uint16_t type = r[0] - 0x40;
+  uint16_t pid = (type == VEHICLE_POLL_TYPE_OBDIIEXTENDED && response.size() >= 3)
+    ? ((uint16_t)r[1] << 8) + r[2] : r[1];
+  poll_entry_t match;
+  known = false;
+  m_poll_mutex.Lock();
+  for (const poll_entry_t& entry : m_poll_entries)
+    {
+    if (entry.bus == frame->origin && entry.poll.type == type &&
+        (entry.poll.pid == pid || (type != VEHICLE_POLL_TYPE_OBDIIEXTENDED && (entry.poll.pid & 0xff) == pid)) &&
+        (entry.poll.rxmoduleid == rxid || entry.poll.rxmoduleid == 0))
+      {
+      match = entry;
+      known = true;
+      break;
+      }
+    }
+  uint32_t generation = m_poll_generation;
+  m_poll_mutex.Unlock();
+  if (known)
+    PollerDeliver(generation, match, rxid, response);
+  }
+
+/**
+ * ReplayLog: replay a CAN log file through the decoders, see above
+ */
+bool OvmsVehicle::ReplayLog(OvmsWriter* writer, const char* format, const std::string& path,
+  const std::string& golden, bool record)
+  {
+  if (!m_ready)
+    {
+    writer->puts("Error: vehicle module not ready");
+    return false;
+    }
+  if (MyConfig.ProtectedPath(path) || (!golden.empty() && MyConfig.ProtectedPath(golden)))
+    {
+    writer->puts("Error: protected path");
+    return false;
+    }
+  canformat* formatter = MyCanFormatFactory.NewFormat(format);
+  if (formatter == NULL)
+    {
+    writer->printf("Error: unknown format '%s'\n", format);
+    return false;
+    }
+  formatter->SetServeMode(canformat::Simulate);
+  FILE* file = fopen(path.c_str(), "r");
+  if (file == NULL)
+    {
+    writer->printf("Error: can't open '%s'\n", path.c_str());
+    delete formatter;
+    return false;
+    }
+
+  // Allocate all statistics memory up front, so the heap change only
+  // reflects the decoders:
+  uint8_t* chunk = (uint8_t*)malloc(REPLAY_READSIZE);
+  uint32_t* hist = (uint32_t*)calloc(REPLAY_HISTSIZE, sizeof(uint32_t));
+  replay_metrics_t rm;
+  rm.task = xTaskGetCurrentTaskHandle();
+  rm.updates = rm.metrics = 0;
+  rm.table = (OvmsMetric**)calloc(REPLAY_METRICSIZE, sizeof(OvmsMetric*));
+  if (!chunk || !hist || !rm.table)
+    {
+    writer->puts("Error: out of memory");
+    free(chunk);
+    free(hist);
+    free(rm.table);
+    fclose(file);
+    delete formatter;
+    return false;
+    }
+  replay_isotp_map_t buffers;
+
+  // Take over decoding:
+  ESP_LOGI(TAG, "Replay: start %s '%s'", format, path.c_str());
+  m_replaying = true;
+  vTaskDelay(pdMS_TO_TICKS(50));
+  replay_metrics = &rm;
+  MyMetrics.RegisterListener(REPLAY_CALLER, "*", replay_metric_modified);
+
+  multi_heap_info_t heap_start, heap_end;
+  heap_caps_get_info(&heap_start, MALLOC_CAP_8BIT);
+  uint32_t frames = 0, skipped = 0, total_us = 0;
+  int64_t start = esp_timer_get_time();
+  bool eof = false;
+  size_t len = 0, pos = 0, idle = 0;
+
+  while (true)
+    {
+    if (pos == len && !eof)
+      {
+      len = fread(chunk, 1, REPLAY_READSIZE, file);
+      pos = 0;
+      eof = (len < REPLAY_READSIZE);
+      }
+    CAN_log_message_t msg;
+    memset(&msg, 0, sizeof(msg));
+    size_t used = formatter->put(&msg, chunk+pos, len-pos);
+    pos += used;
+    if (msg.origin == NULL)
+      {
+      // The formatter parses one record per call from its buffer, so at EOF
+      // continue until the buffer cannot hold any more (invalid) records:
+      if (eof && pos == len && ++idle > CANFORMAT_SERVE_BUFFERSIZE)
+        break;
+      continue;
+      }
+    idle = 0;
+    if (msg.type != CAN_LogFrame_RX)
+      {
+      skipped++;
+      continue;
+      }
+
+    int64_t t0 = esp_timer_get_time();
+    CAN_frame_t* frame = &msg.frame;
+    if (!m_poll_entries.empty())
+      ReplayPollFrame(frame, buffers);
+    if (m_can1 == frame->origin) IncomingFrameCan1(frame);
+    else if (m_can2 == frame->origin) IncomingFrameCan2(frame);
+    else if (m_can3 == frame->origin) IncomingFrameCan3(frame);
+    else if (m_can4 == frame->origin) IncomingFrameCan4(frame);
+    uint32_t us = esp_timer_get_time() - t0;
+    hist[std::min(us, (uint32_t)REPLAY_HISTSIZE-1)]++;
+    total_us += us;
+    frames++;
+    }
+
+  uint32_t elapsed_us = esp_timer_get_time() - start;
+  heap_caps_get_info(&heap_end, MALLOC_CAP_8BIT);
+
+  // Release decoding:
+  MyMetrics.DeregisterListener(REPLAY_CALLER);
+  replay_metrics = NULL;
+  m_replaying = false;
+  fclose(file);
+  delete formatter;
+  free(chunk);
+  ESP_LOGI(TAG, "Replay: done, %u frames", frames);
+
+  // Report:
+  writer->printf("Replayed %u frames (%u skipped) in %u ms\n", frames, skipped, elapsed_us / 1000);
+  if (frames > 0)
+    {
+    writer->printf("  Throughput:   %u frames/s overall, %u frames/s decoding\n",
+      (uint32_t)((uint64_t)frames * 1000000 / std::max(elapsed_us, (uint32_t)1)),
+      (uint32_t)((uint64_t)frames * 1000000 / std::max(total_us, (uint32_t)1)));
+    writer->printf("  Decode time:  avg %.1f us, p50 %u us, p90 %u us, p99 %u us%s\n",
+      (float)total_us / frames,
+      replay_percentile(hist, frames, 50),
+      replay_percentile(hist, frames, 90),
+      replay_percentile(hist, frames, 99),
+      hist[REPLAY_HISTSIZE-1] ? " (p >= 1023 us: overflow)" : "");
+    writer->printf("  Metrics:      %u updates (%.2f per frame), %u metrics updated\n",
+      rm.updates, (float)rm.updates / frames, rm.metrics);
+    writer->printf("  Heap change:  %+d blocks, %+d bytes\n",
+      (int)(heap_end.allocated_blocks - heap_start.allocated_blocks),
+      (int)(heap_end.total_allocated_bytes - heap_start.total_allocated_bytes));
+    }
+  free(hist);
+
+  // Collect metric state:
+  std::map<std::string, std::string> state;
+  for (int i = 0; i < REPLAY_METRICSIZE; i++)
+    {
+    if (rm.table[i])
+      state[rm.table[i]->m_name] = rm.table[i]->AsString();
+    }
+  free(rm.table);
+
+  if (golden.empty())
+    return true;
+
+  if (record)
+    {
+    FILE* gf = fopen(golden.c_str(), "w");
+    if (gf == NULL)
+      {
+      writer->printf("Error: can't write '%s'\n", golden.c_str());
+      return false;
+      }
+    for (auto& it : state)
+      fprintf(gf, "%s %s\n", it.first.c_str(), it.second.c_str());
+    fclose(gf);
+    writer->printf("Golden file '%s' written: %u metrics\n", golden.c_str(), (uint32_t)state.size());
+    return true;
+    }
+
+  // Compare to golden file:
+  FILE* gf = fopen(golden.c_str(), "r");
+  if (gf == NULL)
+    {
+    writer->printf("Error: can't read '%s'\n", golden.c_str());
+    return false;
+    }
+  int diffs = 0, matches = 0;
+  char line[256];
+  while (fgets(line, sizeof(line), gf))
+    {
+    char* nl = strchr(line, '\n');
+    if (nl) *nl = 0;
+    char* sep = strchr(line, ' ');
+    if (line[0] == 0 || sep == NULL)
+      continue;
+    *sep = 0;
+    auto it = state.find(line);
+    if (it == state.end())
+      {
+      OvmsMetric* m = MyMetrics.Find(line);
+      if (m == NULL || m->AsString() != sep+1)
+        {
+        if (++diffs <= REPLAY_MAXDIFFS)
+          writer->printf("  %s: expected '%s', not updated\n", line, sep+1);
+        }
+      else
+        matches++;
+      }
+    else
+      {
+      if (it->second != sep+1)
+        {
+        if (++diffs <= REPLAY_MAXDIFFS)
+          writer->printf("  %s: expected '%s', got '%s'\n", line, sep+1, it->second.c_str());
+        }
+      else
+        matches++;
+      state.erase(it);
+      }
+    }
+  fclose(gf);
+  for (auto& it : state)
+    {
+    if (++diffs <= REPLAY_MAXDIFFS)
+      writer->printf("  %s: unexpected update '%s'\n", it.first.c_str(), it.second.c_str());
+    }
+  if (diffs > REPLAY_MAXDIFFS)
+    writer->printf("  … %d more differences\n", diffs - REPLAY_MAXDIFFS);
+  writer->printf("Golden file '%s': %d metrics match, %d differ => %s\n",
+    golden.c_str(), matches, diffs, diffs ? "FAIL" : "PASS");
+  return (diffs == 0);
+  }
+
+
+void vehicle_replay(int verbosity, OvmsWriter* writer, OvmsCommand* cmd, int argc, const char* const* argv)
+  {
+  if (MyVehicleFactory.m_currentvehicle == NULL)
+    {
+    writer->puts("No vehicle module selected");
+    return;
+    }
+  bool record = (strcmp(cmd->GetParent()->GetName(), "record") == 0);
+  std::string golden = (argc > 1) ? argv[1] : "";
+  MyVehicleFactory.m_currentvehicle->ReplayLog(writer, cmd->GetName(), argv[0], golden, record);
+  }
+
+class OvmsVehicleReplayInit
+  {
+  public: OvmsVehicleReplayInit();
+} MyOvmsVehicleReplayInit  __attribute__ ((init_priority (4590)));
+
+OvmsVehicleReplayInit::OvmsVehicleReplayInit()
+  {
+  ESP_LOGI(TAG, "Initialising vehicle CAN log replay (4590)");
+
+  OvmsCommand* cmd_vehicle = MyCommandApp.FindCommand("vehicle");
+  if (cmd_vehicle)
+    {
+    // Registered after the CAN formats (4505):
+    OvmsCommand* cmd_replay = cmd_vehicle->RegisterCommand("replay","Replay CAN log through vehicle decoders");
+    OvmsCommand* cmd_run = cmd_replay->RegisterCommand("run","Replay log & compare to golden file");
+    MyCanFormatFactory.RegisterCommandSet(cmd_run, "Replay log & compare to golden file",
+      vehicle_replay, "<path> [<golden>]", 1, 2);
+    OvmsCommand* cmd_record = cmd_replay->RegisterCommand("record","Replay log & write golden file");
+    MyCanFormatFactory.RegisterCommandSet(cmd_record, "Replay log & write golden file",
+      vehicle_replay, "<path> <golden>", 2, 2);
+    }
+  }
@@ -37,6 +37,9 @@ static const char *TAG = "v-obdii";
 static const OvmsVehicle::poll_pid_t obdii_polls[]
   =
   {
+    { 0x7df, 0, VEHICLE_POLL_TYPE_OBDIICURRENT, 0x00, {999,999,999 } }, // PIDs supported 01-20
+    { 0x7df, 0, VEHICLE_POLL_TYPE_OBDIICURRENT, 0x20, {999,999,999 } }, // PIDs supported 21-40
+    { 0x7df, 0, VEHICLE_POLL_TYPE_OBDIICURRENT, 0x40, {999,999,999 } }, // PIDs supported 41-60
     { 0x7df, 0, VEHICLE_POLL_TYPE_OBDIICURRENT, 0x05, {  0, 30, 30 } }, // Engine coolant temp
     { 0x7df, 0, VEHICLE_POLL_TYPE_OBDIICURRENT, 0x0c, { 10, 10, 10 } }, // Engine RPM
     { 0x7df, 0, VEHICLE_POLL_TYPE_OBDIICURRENT, 0x0d, {  0, 10, 10 } }, // Speed
@@ -53,9 +56,14 @@ OvmsVehicleOBDII::OvmsVehicleOBDII()
   ESP_LOGI(TAG, "Generic OBDII vehicle module");
 
   memset(m_vin,0,sizeof(m_vin));
+  memset(m_supported,0,sizeof(m_supported));
+  m_supported_known = 0;
+  m_supported_changed = false;
 
   RegisterCanBus(1,CAN_MODE_ACTIVE,CAN_SPEED_500KBPS);
-  PollSetPidList(m_can1,obdii_polls);
+  // Data PIDs are combined, the supported PID bitmaps are sent separately:
+  PollSetMultiPid(VEHICLE_POLL_MAXMULTIPID);
+  UpdatePollList();
   PollSetState(0);
   }
 
@@ -64,6 +72,55 @@ OvmsVehicleOBDII::~OvmsVehicleOBDII()
   ESP_LOGI(TAG, "Shutdown OBDII vehicle module");
   }
 
+/**
+ * UpdatePollList: poll only PIDs supported by the car
+ *  PIDs of ranges without a known support bitmap are polled.
+ */
+void OvmsVehicleOBDII::UpdatePollList()
+  {
+  // Get a snapshot of the bitmaps, they are updated by the vehicle RX task:
+  uint32_t supported[3];
+  uint8_t known;
+  m_poll_mutex.Lock();
+  memcpy(supported, m_supported, sizeof(supported));
+  known = m_supported_known;
+  m_supported_changed = false;
+  m_poll_mutex.Unlock();
+
+  std::vector<poll_pid_t> polls;
+  for (const poll_pid_t* p = obdii_polls; p->txmoduleid != 0; p++)
+    {
+    if (p->type == VEHICLE_POLL_TYPE_OBDIICURRENT && p->pid > 0x00 && p->pid <= 0x60)
+      {
+      int range = (p->pid - 1) >> 5;
+      int bit = 31 - ((p->pid - 1) & 31);
+      if ((known & (1 << range)) && !(supported[range] & (1ul << bit)))
+        continue;
+      }
+    polls.push_back(*p);
+    }
+  polls.push_back(obdii_polls[sizeof(obdii_polls)/sizeof(obdii_polls[0]) - 1]);
+
+  if (polls.size() == m_polls.size() &&
+      memcmp(polls.data(), m_polls.data(), polls.size() * sizeof(poll_pid_t)) == 0)
+    return;
+  ESP_LOGI(TAG, "Polling %d of %d PIDs", (int)polls.size() - 1,
+    (int)(sizeof(obdii_polls)/sizeof(obdii_polls[0])) - 1);
+  // The poller copies the list, keep the previous one valid until replaced:
+  PollSetPidList(m_can1, polls.data());
+  m_polls.swap(polls);
+  }
+
+void OvmsVehicleOBDII::Ticker1(uint32_t ticker)
+  {
+  // Apply support bitmaps after all ECUs had time to respond:
+  m_poll_mutex.Lock();
+  bool changed = m_supported_changed;
+  m_poll_mutex.Unlock();
+  if (changed)
+    UpdatePollList();
+  }
+
 void OvmsVehicleOBDII::IncomingPollReply(canbus* bus, uint16_t type, uint16_t pid, uint8_t* data, uint8_t length, uint16_t mlremain)
   {
   int value1 = (int)data[0];
@@ -71,6 +128,19 @@ void OvmsVehicleOBDII::IncomingPollReply(canbus* bus, uint16_t type, uint16_t pi
 
   switch (pid)
     {
+    case 0x00:  // PIDs supported bitmaps
+    case 0x20:
+    case 0x40:
+      if (type == VEHICLE_POLL_TYPE_OBDIICURRENT && length >= 4)
+        {
+        // Combine responses of all ECUs:
+        m_poll_mutex.Lock();
+        m_supported[pid >> 5] |= ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+        m_supported_known |= 1 << (pid >> 5);
+        m_supported_changed = true;
+        m_poll_mutex.Unlock();
+        }
+      break;
     case 0x02:  // VIN (multi-line response)
       strncat(m_vin,(char*)data,length);
       if (mlremain==0)
@@ -42,10 +42,16 @@ class OvmsVehicleOBDII : public OvmsVehicle
     ~OvmsVehicleOBDII();
 
   protected:
+    void Ticker1(uint32_t ticker);
     void IncomingPollReply(canbus* bus, uint16_t type, uint16_t pid, uint8_t* data, uint8_t length, uint16_t mlremain);
+    void UpdatePollList();
 
   protected:
     char m_vin[18];
+    uint32_t m_supported[3];                  // Supported PIDs 0x01-0x60 (PID 0x00/0x20/0x40 bitmaps)
+    uint8_t m_supported_known;                // Bitmaps received (bit 0 = PID 0x00)
+    bool m_supported_changed;                 // (bitmaps are guarded by m_poll_mutex)
+    std::vector<poll_pid_t> m_polls;          // Poll list reduced to supported PIDs
   };
 
 #endif //#ifndef __VEHICLE_OBDII_H__
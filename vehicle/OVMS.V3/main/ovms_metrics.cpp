@@ -516,6 +516,12 @@ std::string OvmsMetric::AsJSON(const char* defvalue, metric_unit_t units, int pr
   return buf;
   }
 
+bool OvmsMetric::AsJSONPatch(size_t modifier, std::string& patch)
+  {
+  // Default: no element patches, full update needed
+  return false;
+  }
+
 float OvmsMetric::AsFloat(const float defvalue, metric_unit_t units)
   {
   return defvalue;
@@ -126,6 +126,7 @@ class OvmsMetric
     virtual std::string AsString(const char* defvalue = "", metric_unit_t units = Other, int precision = -1);
     std::string AsUnitString(const char* defvalue = "", metric_unit_t units = Other, int precision = -1);
     virtual std::string AsJSON(const char* defvalue = "", metric_unit_t units = Other, int precision = -1);
+    virtual bool AsJSONPatch(size_t modifier, std::string& patch);
     virtual float AsFloat(const float defvalue = 0, metric_unit_t units = Other);
 #ifdef CONFIG_OVMS_SC_JAVASCRIPT_DUKTAPE
     virtual void DukPush(DukContext &dc);
@@ -480,7 +481,15 @@ class OvmsMetricSet : public OvmsMetric
  *  vf->SetElemValues(10, 3, myvals);
  *
  * Note: use ExtRamAllocator<type> for large vectors (= use SPIRAM)
+ *
+ * The vector tracks the changed element range per modifier, so modifier
+ * clients can transmit element patches instead of the full vector, see
+ * AsJSONPatch(). Size reductions & external SetModified() calls invalidate
+ * the range, resulting in a full update.
  */
+#define METRIC_VECTOR_RANGE_END   0xffff
+#define METRIC_VECTOR_RANGE_MAX   0xfffe
+
 template
   <
   typename ElemType,
@@ -492,6 +501,11 @@ class OvmsMetricVector : public OvmsMetric
     OvmsMetricVector(const char* name, uint16_t autostale=0, metric_unit_t units = Other)
       : OvmsMetric(name, autostale, units)
       {
+      for (int i = 0; i < METRICS_MAX_MODIFIERS; i++)
+        {
+        m_changed_start[i] = METRIC_VECTOR_RANGE_END;
+        m_changed_end[i] = 0;
+        }
       }
     virtual ~OvmsMetricVector()
       {
@@ -526,6 +540,48 @@ class OvmsMetricVector : public OvmsMetric
       return json;
       }
 
+    /**
+     * AsJSONPatch: get & clear the changed element range for a modifier
+     *  as a JSON patch "[start,[values…]]".
+     *  Returns false if a full update is needed (or cheaper), true otherwise.
+     *  An empty patch means there is nothing (left) to send.
+     */
+    virtual bool AsJSONPatch(size_t modifier, std::string& patch)
+      {
+      if (modifier >= METRICS_MAX_MODIFIERS)
+        return false;
+      std::ostringstream ss;
+      OvmsMutexLock lock(&m_mutex);
+      size_t start = m_changed_start[modifier], end = m_changed_end[modifier];
+      m_changed_start[modifier] = METRIC_VECTOR_RANGE_END;
+      m_changed_end[modifier] = 0;
+      patch.clear();
+      if (start >= end)
+        return true;
+      if (end > m_value.size() || (end - start) * 2 > m_value.size())
+        return false;
+      ss << '[' << start << ",[";
+      for (size_t i = start; i < end; i++)
+        {
+        if (i > start)
+          ss << ',';
+        ss << m_value[i];
+        }
+      ss << "]]";
+      patch = ss.str();
+      return true;
+      }
+
+    virtual void SetModified(bool changed=true)
+      {
+      if (changed && m_mutex.Lock())
+        {
+        SetChangedRange(0, METRIC_VECTOR_RANGE_END);
+        m_mutex.Unlock();
+        }
+      OvmsMetric::SetModified(changed);
+      }
+
 #ifdef CONFIG_OVMS_SC_JAVASCRIPT_DUKTAPE
     void DukPush(DukContext &dc)
       {
@@ -567,11 +623,30 @@ class OvmsMetricVector : public OvmsMetric
         bool modified = false;
         if (m_value != value)
           {
+          size_t oldsize = m_value.size(), newsize = value.size();
+          if (newsize < oldsize)
+            {
+            SetChangedRange(0, METRIC_VECTOR_RANGE_END);
+            }
+          else
+            {
+            size_t start = 0, end = oldsize;
+            while (start < end && m_value[start] == value[start])
+              start++;
+            while (end > start && m_value[end-1] == value[end-1])
+              end--;
+            if (newsize > oldsize)
+              {
+              if (start == end) start = oldsize;
+              end = newsize;
+              }
+            SetChangedRange(start, end);
+            }
           m_value = value;
           modified = true;
           }
         m_mutex.Unlock();
-        SetModified(modified);
+        OvmsMetric::SetModified(modified);
         }
       }
     void operator=(std::vector<ElemType, Allocator> value) { SetValue(value); }
@@ -583,9 +658,10 @@ class OvmsMetricVector : public OvmsMetric
         if (m_mutex.Lock())
           {
           m_value.clear();
+          SetChangedRange(0, METRIC_VECTOR_RANGE_END);
           m_mutex.Unlock();
           }
-        SetModified(true);
+        OvmsMetric::SetModified(true);
         }
       }
 
@@ -611,16 +687,21 @@ class OvmsMetricVector : public OvmsMetric
       bool modified = false;
       if (m_mutex.Lock())
         {
-        if (m_value.size() < n+1)
+        size_t oldsize = m_value.size();
+        if (oldsize < n+1)
           m_value.resize(n+1);
         if (m_value[n] != value)
           {
           m_value[n] = value;
           modified = true;
           }
+        if (oldsize < n+1)
+          SetChangedRange(oldsize, n+1);
+        else if (modified)
+          SetChangedRange(n, n+1);
         m_mutex.Unlock();
         }
-      SetModified(modified);
+      OvmsMetric::SetModified(modified);
       }
 
     void SetElemValues(size_t start, size_t cnt, ElemType* values)
@@ -628,19 +709,30 @@ class OvmsMetricVector : public OvmsMetric
       bool modified = false;
       if (m_mutex.Lock())
         {
-        if (m_value.size() < start+cnt)
+        size_t oldsize = m_value.size();
+        size_t first = start+cnt, last = start;
+        if (oldsize < start+cnt)
           m_value.resize(start+cnt);
         for (size_t i = 0; i < cnt; i++)
           {
           if (m_value[start+i] != values[i])
             {
             m_value[start+i] = values[i];
+            if (first > start+i) first = start+i;
+            last = start+i+1;
             modified = true;
             }
           }
+        if (oldsize < start+cnt)
+          {
+          if (first > oldsize) first = oldsize;
+          last = start+cnt;
+          }
+        if (first < last)
+          SetChangedRange(first, last);
         m_mutex.Unlock();
         }
-      SetModified(modified);
+      OvmsMetric::SetModified(modified);
       }
 
     uint32_t GetSize()
@@ -648,9 +740,29 @@ class OvmsMetricVector : public OvmsMetric
       return m_value.size();
       }
 
+  protected:
+    // Extend the changed range of all modifiers by [start,end) (call with m_mutex locked):
+    void SetChangedRange(size_t start, size_t end)
+      {
+      if (end > METRIC_VECTOR_RANGE_MAX)
+        {
+        start = 0;
+        end = METRIC_VECTOR_RANGE_END;
+        }
+      for (int i = 0; i < METRICS_MAX_MODIFIERS; i++)
+        {
+        if (start < m_changed_start[i])
+          m_changed_start[i] = start;
+        if (end > m_changed_end[i])
+          m_changed_end[i] = end;
+        }
+      }
+
   protected:
     OvmsMutex m_mutex;
     std::vector<ElemType, Allocator> m_value;
+    uint16_t m_changed_start[METRICS_MAX_MODIFIERS];
+    uint16_t m_changed_end[METRICS_MAX_MODIFIERS];
   };
 
 